@@ -4,11 +4,12 @@
 #include "binding_node.glsl"
 
 layout(location = 0) in vec2 inUV;
+layout(location = 1) flat in uint inNodeIndex;
 layout(location = 0) out vec4 outColor;
 
 void main()
 {
-    vec4 color = texture(nodeColor[push.nodeHandle], inUV);
+    vec4 color = texture(nodeColor[nonuniformEXT(inNodeIndex)], inUV);
     if (color.a == 0)
         discard;
 
@@ -7,6 +7,7 @@
 #include "common_util.glsl"
 
 layout(location = 0) out vec2 outUV;
+layout(location = 1) flat out uint outNodeIndex;
 
 float doubleWide = 1.0f;
 bool clipped = false;
@@ -14,12 +15,17 @@ bool cropped = false;
 
 void main()
 {
-    mat4 nodeViewProj    = nodeState[push.nodeHandle].viewProj;
-    mat4 nodeInvViewProj = nodeState[push.nodeHandle].invViewProj;
-    mat4 nodeModel       = nodeState[push.nodeHandle].model;
-    vec2 nodeSwapSize    = nodeState[push.nodeHandle].framebufferSize;
-    vec2 nodeULUV        = nodeState[push.nodeHandle].ulUV;
-    vec2 nodeLRUV        = nodeState[push.nodeHandle].lrUV;
+    uint nodeIndex = nodeIndices[gl_InstanceIndex];
+    outNodeIndex = nodeIndex;
+
+    mat4 nodeViewProj    = nodeState[nonuniformEXT(nodeIndex)].viewProj;
+    mat4 nodeInvViewProj = nodeState[nonuniformEXT(nodeIndex)].invViewProj;
+    mat4 nodeModel       = nodeState[nonuniformEXT(nodeIndex)].model;
+    vec2 nodeSwapSize    = nodeState[nonuniformEXT(nodeIndex)].framebufferSize;
+    vec2 nodeULUV        = nodeState[nonuniformEXT(nodeIndex)].ulUV;
+    vec2 nodeLRUV        = nodeState[nonuniformEXT(nodeIndex)].lrUV;
+    vec2 nodeSwapULUV    = nodeState[nonuniformEXT(nodeIndex)].swapULUV;
+    vec2 nodeSwapLRUV    = nodeState[nonuniformEXT(nodeIndex)].swapLRUV;
 
     vec4 originClipPos = nodeViewProj * nodeModel * vec4(0,0,0,1);
     float originDepth  = originClipPos.z / originClipPos.w;
@@ -31,7 +37,7 @@ void main()
 //    vec2 finalUv = clipped ?
 //        vec2(scaledUV.x / doubleWide, scaledUV.y) :
 //        vec2(inUV.x / doubleWide, inUV.y);
-    vec2 finalUv = nodeUv;
+    vec2 finalUv = mix(nodeSwapULUV, nodeSwapLRUV, nodeUv);
     outUV = finalUv;
 
     vec2 nodeNdc       = NDCFromUV(nodeUv);
@@ -1,9 +1,8 @@
-// should be able to get rid of this if we bind arrays of nodeHandles
 #extension GL_EXT_nonuniform_qualifier : require
 
-
+// Graphics modes get the base through firstInstance and leave this unused
 layout(push_constant) uniform Push {
-    uint nodeHandle;
+    uint nodeIndexBase;
 } push;
 
 layout (std140, set = 1, binding = 0) uniform NodeState {
@@ -24,7 +23,22 @@ layout (std140, set = 1, binding = 0) uniform NodeState {
     vec2 ulUV;
     vec2 lrUV;
 
+    // Rendered imageRect in node swap UV
+    vec2 swapULUV;
+    vec2 swapLRUV;
+
+    float compositorRadius;
+
 } nodeState[];
 
 layout (set = 1, binding = 1) uniform sampler2D nodeColor[];
-layout (set = 1, binding = 2) uniform sampler2D nodeGBuffer[];
\ No newline at end of file
+layout (set = 1, binding = 2) uniform sampler2D nodeGBuffer[];
+
+#ifndef NODE_INDICES_QUALIFIER
+#define NODE_INDICES_QUALIFIER readonly
+#endif
+
+// Node index of each instance, written per frame by the cull prepass for every compositor mode
+layout (std430, set = 1, binding = 3) NODE_INDICES_QUALIFIER buffer NodeIndices {
+    uint nodeIndices[];
+};
\ No newline at end of file
@@ -1,17 +1,34 @@
-struct VkDispatchIndirectCommand {
-    uint x;
-    uint y;
-    uint z;
-};
-struct Tile {
-    uint upperLeftXU16YU16;
-    uint lowerRightXU16YU16;
-    uint depthF24IDU8;
+// Must match MXC_NODE_CAPACITY and MXC_COMPOSITOR_MODE_COUNT
+#define NODE_CAPACITY 64
+#define COMPOSITOR_MODE_COUNT 5
+
+// MxcNodeIndirect flattened to uints
+#define INDIRECT_COUNT 19
+#define INDIRECT_COMPUTE_TILE_COUNT 14  // compute.y, tiles the window covers
+#define INDIRECT_COMPUTE_NODE_COUNT 15  // compute.z, visible compute nodes
+#define INDIRECT_COMPUTE_TILES_COUNT 17 // computeTiles.y, binned node tiles
+
+layout (std430, set = 1, binding = 4) buffer NodeCull {
+    uint indirect[INDIRECT_COUNT];
+    uint activeCounts[COMPOSITOR_MODE_COUNT];
+    uvec4 damageTiles; // xy first damaged tile, zw one past the last. Tiles outside keep last cycle's output
+    uint activeNodeIndices[];
+} nodeCull;
+
+#ifndef NODE_TILES_QUALIFIER
+#define NODE_TILES_QUALIFIER readonly
+#endif
+
+// One compute compositor workgroup each. Tile index in the upper 16 bits, node index in the lower 16
+layout (std430, set = 1, binding = 5) NODE_TILES_QUALIFIER buffer NodeTiles {
+    uint nodeTiles[];
 };
-layout(set = 1, binding = 8) buffer TileBuffer {
-    VkDispatchIndirectCommand command;
-    Tile tiles[];
-} tileBuffer;
 
-#define LOCAL_SIZE 32
-#define SUPERSAMPLE 2
+#define NODE_TILE_TILE(_nodeTile) ((_nodeTile) >> 16)
+#define NODE_TILE_NODE(_nodeTile) ((_nodeTile) & 0xFFFF)
+
+bool TileDamaged(ivec2 tileCoord)
+{
+    return all(greaterThanEqual(uvec2(tileCoord), nodeCull.damageTiles.xy)) &&
+           all(lessThan(uvec2(tileCoord), nodeCull.damageTiles.zw));
+}
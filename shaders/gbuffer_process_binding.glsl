@@ -1,4 +1,5 @@
 #define GBUFFER_PROCESS_LOCAL_SIZE 32
+#define GBUFFER_PROCESS_MAX_MIP_COUNT 12
 
 struct ProcessState {
     float depthNearZ;
@@ -9,6 +10,9 @@ struct ProcessState {
 
 layout(push_constant) uniform Push {
     ProcessState state;
+    // Texel rect of the level being written. Single pass shaders get mip 0 and derive each level.
+    ivec2 rectOffset;
+    ivec2 rectExtent;
 } push;
 
 const int PIPE_SET_INDEX_GBUFFER_PROCESS_INOUT = 0;
@@ -16,8 +20,13 @@ const int PIPE_SET_INDEX_GBUFFER_PROCESS_INOUT = 0;
 const int SET_BIND_INDEX_GBUFFER_PROCESS_SRC_DEPTH = 0;
 const int SET_BIND_INDEX_GBUFFER_PROCESS_SRC_GBUFFER = 1;
 const int SET_BIND_INDEX_GBUFFER_PROCESS_DST_GBUFFER = 2;
+const int SET_BIND_INDEX_GBUFFER_PROCESS_DST_GBUFFER_MIPS = 3;
+const int SET_BIND_INDEX_GBUFFER_PROCESS_COUNTER = 4;
 
 layout (set = PIPE_SET_INDEX_GBUFFER_PROCESS_INOUT, binding = SET_BIND_INDEX_GBUFFER_PROCESS_SRC_DEPTH) uniform sampler2D srcDepth;
 layout (set = PIPE_SET_INDEX_GBUFFER_PROCESS_INOUT, binding = SET_BIND_INDEX_GBUFFER_PROCESS_SRC_GBUFFER) uniform sampler2D srcGbuffer;
 layout (set = PIPE_SET_INDEX_GBUFFER_PROCESS_INOUT, binding = SET_BIND_INDEX_GBUFFER_PROCESS_DST_GBUFFER, rgba16f) writeonly uniform image2D dstGbuffer;
-
+layout (set = PIPE_SET_INDEX_GBUFFER_PROCESS_INOUT, binding = SET_BIND_INDEX_GBUFFER_PROCESS_DST_GBUFFER_MIPS, rgba16f) coherent uniform image2D dstGbufferMips[GBUFFER_PROCESS_MAX_MIP_COUNT];
+layout (set = PIPE_SET_INDEX_GBUFFER_PROCESS_INOUT, binding = SET_BIND_INDEX_GBUFFER_PROCESS_COUNTER) coherent buffer Counter {
+    uint finishedWorkgroupCount;
+} counter;
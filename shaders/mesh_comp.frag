@@ -6,6 +6,7 @@
 
 layout (location = 0) in VertexInput {
     vec2 uv;
+    flat uint nodeIndex;
 } vertexInput;
 
 layout(location = 0) out vec4 outColor;
@@ -13,7 +14,7 @@ layout(location = 1) out vec4 outNormal;
 
 void main()
 {
-    const vec4 colorValue = texture(nodeColor[push.nodeHandle], vertexInput.uv);
+    const vec4 colorValue = texture(nodeColor[nonuniformEXT(vertexInput.nodeIndex)], vertexInput.uv);
 //    if (vertexInput.color.a < .99)
 //        discard;
     outColor = vec4(colorValue.rgb, 1);
@@ -461,18 +461,19 @@ float MinQuadOmitZero(vec4 quad) {
     return minValue == 1.0f ? 0.0f : minValue;
 }
 
-void InitializeSubgroupGridInfo(ivec2 dimensions) {
+// globalWorkgroupID lets binned dispatches place a workgroup on any tile of the grid
+void InitializeSubgroupGridInfo(ivec2 dimensions, uint globalWorkgroupID) {
     // Invocation = individual pixels and threads
     // SubgroupQuad = 4x4 invocations in subgroup
 
     grid_Dimensions = dimensions;
 
     // Workgroups
-    grid_GlobalWorkgroupID = gl_WorkGroupID.y;
+    grid_GlobalWorkgroupID = globalWorkgroupID;
     grid_GlobalWorkgroupCoord = GlobalWorkgroupCoordFromIndex(grid_GlobalWorkgroupID, grid_Dimensions);
 
     // Subgroup Quads
-    grid_GlobalSubgroupQuadID = gl_GlobalInvocationID.y;
+    grid_GlobalSubgroupQuadID = grid_GlobalWorkgroupID * WORKGROUP_SUBGROUP_COUNT + gl_LocalInvocationID.y;
     grid_SubgroupQuadID = grid_GlobalSubgroupQuadID % WORKGROUP_SUBGROUP_COUNT;
     grid_SubgroupQuadMortonCoord = MortonDecode4bit(grid_SubgroupQuadID);
     grid_SubgroupQuadCoord = SubgroupQuadCoordFromID(grid_SubgroupQuadID);
@@ -494,4 +495,8 @@ void InitializeSubgroupGridInfo(ivec2 dimensions) {
 
     grid_GlobalInvocationUV = vec2(grid_GlobalInvocationQuadCoord) / vec2(dimensions);
     grid_GlobalInvocationMortonUV = vec2(grid_GlobalInvocationQuadMortonCoord) / vec2(dimensions);
+}
+
+void InitializeSubgroupGridInfo(ivec2 dimensions) {
+    InitializeSubgroupGridInfo(dimensions, gl_WorkGroupID.y);
 }
\ No newline at end of file
@@ -5,16 +5,17 @@
 
 layout(location = 0) in vec3 inNormal;
 layout(location = 1) in vec2 inUV;
+layout(location = 3) flat in uint inNodeIndex;
 
 layout(location = 0) out vec4 outColor;
 
 void main()
 {
-    vec4 color = textureLod(nodeColor[push.nodeHandle], inUV, 0);
+    vec4 color = textureLod(nodeColor[nonuniformEXT(inNodeIndex)], inUV, 0);
     if (color.a == 0)
         discard;
 
-//    float depthValue = texture(nodeGBuffer[push.nodeHandle], inUV).r;
+//    float depthValue = texture(nodeGBuffer[nonuniformEXT(inNodeIndex)], inUV).r;
 //    outColor = vec4(depthValue);
     outColor = color;
 }
\ No newline at end of file
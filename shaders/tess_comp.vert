@@ -6,10 +6,12 @@
 
 layout(location = 0) out vec3 outNormal;
 layout(location = 1) out vec2 outUV;
+layout(location = 2) flat out uint outNodeIndex;
 
 void main() {
     // could remove pos and normal from pipe entirely !?
 //    gl_Position = vec4(inPos.xyz, 1.0);
     outNormal = inNormal;
     outUV = inUV;
+    outNodeIndex = nodeIndices[gl_InstanceIndex];
 }
\ No newline at end of file
@@ -27,6 +27,11 @@ MxcCompositor cst;
 #define GRID_WORKGROUP_SQUARE_SIZE    8
 #define GRID_WORKGROUP_SUBGROUP_COUNT 64
 
+// Each workgroup covers a 32x32 pixel tile of the compute framebuffer
+#define GRID_TILE_SIZE     (GRID_WORKGROUP_SQUARE_SIZE * GRID_SUBGROUP_SQUARE_SIZE)
+#define GRID_TILE_CAPACITY (DEFAULT_WIDTH * DEFAULT_HEIGHT / GRID_SUBGROUP_COUNT / GRID_WORKGROUP_SUBGROUP_COUNT)
+#define GRID_BIN_LOCAL_SIZE 64
+
 /*
  * Pipes
  */
@@ -58,14 +63,31 @@ enum {
 	SET_BIND_INDEX_NODE_STATE,
 	SET_BIND_INDEX_NODE_COLOR,
 	SET_BIND_INDEX_NODE_GBUFFER,
+	SET_BIND_INDEX_NODE_INDICES,
+	SET_BIND_INDEX_NODE_CULL,
+	SET_BIND_INDEX_NODE_TILES,
 	SET_BIND_INDEX_NODE_COUNT,
 };
 
 // this go in glsl file
 typedef struct NodePush {
-	u32 nodeHandle; // can be u16?
+	u32 nodeIndexBase; // Offset of the modes indices in nodeIndices. Graphics modes pass it as firstInstance instead.
 } NodePush;
 
+#define NODE_INDICES_BASE(_mode) ((_mode) * MXC_NODE_CAPACITY)
+
+// Shaders index MxcNodeIndirect as a flat u32 array
+static_assert(sizeof(MxcNodeIndirect) == sizeof(u32) * 19, "MxcNodeIndirect size must match compute_compositor_binding.glsl");
+static_assert(offsetof(MxcNodeIndirect, quad.instanceCount) == sizeof(u32) * 1, "Indirect count offset must match compositor_node_cull.comp");
+static_assert(offsetof(MxcNodeIndirect, tess.instanceCount) == sizeof(u32) * 6, "Indirect count offset must match compositor_node_cull.comp");
+static_assert(offsetof(MxcNodeIndirect, taskMesh.groupCountX) == sizeof(u32) * 10, "Indirect count offset must match compositor_node_cull.comp");
+static_assert(offsetof(MxcNodeIndirect, compute.y) == sizeof(u32) * 14, "Indirect count offset must match compute_compositor_binding.glsl");
+static_assert(offsetof(MxcNodeIndirect, compute.z) == sizeof(u32) * 15, "Indirect count offset must match compute_compositor_binding.glsl");
+static_assert(offsetof(MxcNodeIndirect, computeTiles.y) == sizeof(u32) * 17, "Indirect count offset must match compute_compositor_binding.glsl");
+static_assert(offsetof(MxcNodeCullState, damageTiles) == sizeof(u32) * 24, "Damage tiles offset must match compute_compositor_binding.glsl uvec4 alignment");
+static_assert(MXC_NODE_CAPACITY == 64 && MXC_COMPOSITOR_MODE_COUNT == 5, "Update compute_compositor_binding.glsl");
+static_assert(GRID_TILE_CAPACITY <= UINT16_MAX && MXC_NODE_CAPACITY <= UINT16_MAX, "Node tiles pack tile and node into 16 bits each");
+
 static VkShaderStageFlags CompositeModeShaderFlags(const bool* pModes)
 {
 	VkShaderStageFlags stageFlags = 0;
@@ -80,13 +102,18 @@ static void CreateNodeSetLayout(VkShaderStageFlags stageFlags, VkDescriptorSetLa
 		VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
 		&(VkDescriptorSetLayoutBindingFlagsCreateInfo ){
 			VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO,
-			.bindingCount = 3,
+			.bindingCount = SET_BIND_INDEX_NODE_COUNT,
 			.pBindingFlags = (VkDescriptorBindingFlags[]) {
-				VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT,
-				VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT,
-				VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT,
+				[SET_BIND_INDEX_NODE_STATE]   = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT,
+				// Swap images are rewritten every frame under the cached composite command buffers
+				[SET_BIND_INDEX_NODE_COLOR]   = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT,
+				[SET_BIND_INDEX_NODE_GBUFFER] = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT,
+				[SET_BIND_INDEX_NODE_INDICES] = 0,
+				[SET_BIND_INDEX_NODE_CULL]    = 0,
+				[SET_BIND_INDEX_NODE_TILES]   = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT,
 			},
 		},
+		.flags        = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT,
 		.bindingCount = SET_BIND_INDEX_NODE_COUNT,
 		.pBindings = (VkDescriptorSetLayoutBinding[]){
 			[SET_BIND_INDEX_NODE_STATE] = {
@@ -107,6 +134,24 @@ static void CreateNodeSetLayout(VkShaderStageFlags stageFlags, VkDescriptorSetLa
 				.descriptorCount = MXC_NODE_CAPACITY,
 				.stageFlags      = stageFlags,
 			},
+			[SET_BIND_INDEX_NODE_INDICES] = {
+				.binding         = SET_BIND_INDEX_NODE_INDICES,
+				.descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				.descriptorCount = 1,
+				.stageFlags      = stageFlags,
+			},
+			[SET_BIND_INDEX_NODE_CULL] = {
+				.binding         = SET_BIND_INDEX_NODE_CULL,
+				.descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				.descriptorCount = 1,
+				.stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT,
+			},
+			[SET_BIND_INDEX_NODE_TILES] = {
+				.binding         = SET_BIND_INDEX_NODE_TILES,
+				.descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				.descriptorCount = 1,
+				.stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT,
+			},
 		},
 	}, VK_ALLOC, pLayout));
 	VK_SET_DEBUG_NAME(*pLayout, "NodeSetLayout");
@@ -377,6 +422,11 @@ enum {
 	TIME_QUERY_COUNT,
 };
 
+// Gbuffer processing frames averaged per log of how long it took
+#define MXC_GBUFFER_PROCESS_LOG_INTERVAL 256
+// Cycles per log of the cycle rate and how busy recording and the GPU were
+#define MXC_CYCLE_STATS_LOG_INTERVAL 256
+
 /* Barriers */
 #define COMPOSITOR_DST_GRAPHICS_READ                                          \
 	.dstStageMask  = VK_PIPELINE_STAGE_2_VERTEX_INPUT_BIT |                   \
@@ -409,13 +459,71 @@ static u32 CompositorQueueFamilyIndex[] = {
 	[MXC_NODE_INTERPROCESS_MODE_EXPORTED] = 0,
 };
 
+// Depth is processed on the dedicated compute queue. Thread nodes render on graphics and release it from there.
+static u32 ProcessSrcQueueFamilyIndex[] = {
+	[MXC_NODE_INTERPROCESS_MODE_THREAD]   = 0,
+	[MXC_NODE_INTERPROCESS_MODE_EXPORTED] = VK_QUEUE_FAMILY_EXTERNAL,
+};
+
 void mxcClearNodeDescriptorSet(node_h hNode)
 {
 	u16 iNode = HANDLE_INDEX(hNode);
-	CMD_WRITE_SETS(vk.context.device, {
-		BIND_WRITE_NODE_COLOR(cst.nodeSet, iNode, vk.context.nearestSampler, VK_NULL_HANDLE, VK_IMAGE_LAYOUT_GENERAL),
-		BIND_WRITE_NODE_GBUFFER(cst.nodeSet, iNode, vk.context.nearestSampler, VK_NULL_HANDLE, VK_IMAGE_LAYOUT_GENERAL)
-	});
+	MxcCompositorNodeData* pNodeCpst = ARRAY_PTR_H(cst.nodeData, hNode);
+	pNodeCpst->colorView   = VK_NULL_HANDLE;
+	pNodeCpst->gbufferView = VK_NULL_HANDLE;
+	for (u32 iFrame = 0; iFrame < MXC_COMPOSITOR_FRAME_COUNT; ++iFrame) {
+		pNodeCpst->frameTimelineValues[iFrame] = 0;
+		CMD_WRITE_SETS(vk.context.device, {
+			BIND_WRITE_NODE_COLOR(cst.frames[iFrame].nodeSet, iNode, vk.context.nearestSampler, VK_NULL_HANDLE, VK_IMAGE_LAYOUT_GENERAL),
+			BIND_WRITE_NODE_GBUFFER(cst.frames[iFrame].nodeSet, iNode, vk.context.nearestSampler, VK_NULL_HANDLE, VK_IMAGE_LAYOUT_GENERAL)
+		});
+	}
+}
+
+/*
+ * Damage
+ */
+
+// Clean cycles re-present the framebuffers retained from the last composite.
+// Dirty cycles recomposite only the window tiles in the damaged clip rect.
+
+static bool PoseEqual(MidPose a, MidPose b)
+{
+	return a.pos.x == b.pos.x && a.pos.y == b.pos.y && a.pos.z == b.pos.z &&
+	       a.rot.x == b.rot.x && a.rot.y == b.rot.y && a.rot.z == b.rot.z && a.rot.w == b.rot.w;
+}
+
+static void DamageClip(MxcClip clip, MxcClip* pDamage)
+{
+	pDamage->ulUV = Vec2Min(pDamage->ulUV, clip.ulUV);
+	pDamage->lrUV = Vec2Max(pDamage->lrUV, clip.lrUV);
+}
+
+static bool ActiveNodesEqual(const MxcActiveNodes* pA, const MxcActiveNodes* pB)
+{
+	return pA->count == pB->count && memcmp(pA->handles, pB->handles, sizeof(node_h) * pA->count) == 0;
+}
+
+/*
+ * Composite Command Cache
+ */
+
+// Composite commands only vary by what is drawn and where, never by node or camera state,
+// so they are recorded once per key and replayed. A miss rerecords the least recently used.
+
+static MxcCompositeCmd* FindCompositeCmd(MxcCompositeCmd* pCmds, const MxcCompositeCmdKey* pKey)
+{
+	MxcCompositeCmd* pLru = &pCmds[0];
+	for (u32 iCmd = 0; iCmd < MXC_COMPOSITE_CMD_CAPACITY; ++iCmd) {
+		if (pCmds[iCmd].isRecorded && memcmp(&pCmds[iCmd].key, pKey, sizeof(MxcCompositeCmdKey)) == 0)
+			return &pCmds[iCmd];
+
+		if (!pCmds[iCmd].isRecorded || (pLru->isRecorded && pCmds[iCmd].lastUsedCycle < pLru->lastUsedCycle))
+			pLru = &pCmds[iCmd];
+	}
+
+	pLru->isRecorded = false;
+	return pLru;
 }
 
 /*
@@ -429,17 +537,22 @@ static void CompositorRun(MxcCompositorContext* pCstCtx, MxcCompositor* pCst)
 	 */
 	EXTRACT_FIELD(&vk.context, device);
 	EXTRACT_FIELD(&vk.context, depthRenderPass);
+	EXTRACT_FIELD(&vk.context, depthPreserveRenderPass);
 	EXTRACT_FIELD(&vk.context, depthFramebuffer);
 
 	EXTRACT_FIELD(&node, gbufferProcessDownPipe);
 	EXTRACT_FIELD(&node, gbufferProcessUpPipe);
 	EXTRACT_FIELD(&node, gbufferProcessPipeLayout);
 
-	EXTRACT_FIELD(pCstCtx, gfxCmd);
+	auto_t pGfxCmds = pCstCtx->gfxCmds;
+	auto_t pProcessCmds = pCstCtx->processCmds;
+	auto_t pCompositeCmds = pCstCtx->compositeCmds;
+	auto_t pBlitCmds = pCstCtx->blitCmds;
 	auto_t compTimeline = pCstCtx->timeline;
+	auto_t frameTimeline = pCstCtx->frameTimeline;
 	auto_t pSwapCtx = &pCstCtx->swapCtx;
 
-	EXTRACT_FIELD(pCst, globalSet);
+	auto_t pFrames = pCst->frames;
 	EXTRACT_FIELD(pCst, compOutputSet);
 
 	EXTRACT_FIELD(pCst, gfxPipeLayout);
@@ -448,16 +561,16 @@ static void CompositorRun(MxcCompositorContext* pCstCtx, MxcCompositor* pCst)
 	EXTRACT_FIELD(pCst, nodeTaskMeshPipe);
 
 	EXTRACT_FIELD(pCst, compPipeLayout);
+	EXTRACT_FIELD(pCst, compBinPipe);
 	EXTRACT_FIELD(pCst, compPipe);
 	EXTRACT_FIELD(pCst, postCompPipe);
 
 	EXTRACT_FIELD(pCst, finalBlitPipe);
 	EXTRACT_FIELD(pCst, finalBlitPipeLayout);
 
-	EXTRACT_FIELD(pCst, timeQryPool);
+	EXTRACT_FIELD(pCst, nodeCullPipe);
 
-	EXTRACT_FIELD(pCst, pLineMapped);
-	auto_t lineBuffer = pCst->lineBuffer.buffer;
+	EXTRACT_FIELD(pCst, timeQryPool);
 
 	auto_t quadMeshOffsets = pCst->quadMesh.offsets;
 	auto_t quadMeshBuf = pCst->quadMesh.buf;
@@ -474,9 +587,10 @@ static void CompositorRun(MxcCompositorContext* pCstCtx, MxcCompositor* pCst)
 	auto_t compFrameAtomicImg = pCst->compFrameAtomicTex.image;
 	auto_t compFrameColorImg = pCst->compFrameColorTex.image;
 
-	auto_t pGlobSetMapped = vkSharedMemoryPtr(pCst->globalBuffer.memory);
-
-	CompositorQueueFamilyIndex[MXC_NODE_INTERPROCESS_MODE_EXPORTED] = vk.context.queueFamilies[VK_QUEUE_FAMILY_TYPE_MAIN_GRAPHICS].index;
+	u32 graphicsQueueFamilyIndex = vk.context.queueFamilies[VK_QUEUE_FAMILY_TYPE_MAIN_GRAPHICS].index;
+	u32 processQueueFamilyIndex = vk.context.queueFamilies[VK_QUEUE_FAMILY_TYPE_DEDICATED_COMPUTE].index;
+	CompositorQueueFamilyIndex[MXC_NODE_INTERPROCESS_MODE_EXPORTED] = graphicsQueueFamilyIndex;
+	ProcessSrcQueueFamilyIndex[MXC_NODE_INTERPROCESS_MODE_THREAD] = graphicsQueueFamilyIndex;
 
 	atomic_store(&pCstCtx->isReady, true);
 
@@ -502,7 +616,31 @@ static void CompositorRun(MxcCompositorContext* pCstCtx, MxcCompositor* pCst)
 
 	VkGlobalSetState globSetState = (VkGlobalSetState){};
 	vkUpdateGlobalSetViewProj(globCam, globCamPose, &globSetState);
-	memcpy(pGlobSetMapped, &globSetState, sizeof(VkGlobalSetState));
+	for (u32 iFrame = 0; iFrame < MXC_COMPOSITOR_FRAME_COUNT; ++iFrame)
+		memcpy(vkSharedBufferPtr(pFrames[iFrame].globalBuffer), &globSetState, sizeof(VkGlobalSetState));
+
+	// State of the last composite the retained framebuffers hold
+	bool           hasComposited = false;
+	bool           hasGfx = false;
+	bool           hasComp = false;
+	MidPose        compositedCamPose = {};
+	ivec2          compositedWindowExtent = {};
+	MxcActiveNodes compositedActiveNodes[MXC_COMPOSITOR_MODE_COUNT] = {};
+
+	// Gbuffer process time averaged over the frames which processed any, per path so both can be compared
+	bool   frameHasProcess[MXC_COMPOSITOR_FRAME_COUNT] = {};
+	bool   frameProcessSinglePass[MXC_COMPOSITOR_FRAME_COUNT] = {};
+	bool   gbufferProcessSinglePass = MXC_NODE_GBUFFER_PROCESS_SINGLE_PASS;
+	double gbufferProcessMs[2] = {};
+	u32    gbufferProcessCt[2] = {};
+	double gbufferProcessAvgMs[2] = {};
+
+	// Recording time excludes the cycle waits. GPU time is the composite and gbuffer process, the blit is not timed.
+	// Gbuffer process runs on the compute queue so GPU time can pass 100% when it overlaps the composite.
+	u64    cycleStatsBeginUs = midQueryPerformanceCounter();
+	u64    cycleRecordUs = 0;
+	double cycleGpuMs = 0;
+	u32    cycleStatsCt = 0;
 
 CompositeLoop:
 
@@ -519,24 +657,92 @@ CompositeLoop:
 	vkTimelineWait(device, compositorContext.baseCycleValue + MXC_CYCLE_PROCESS_INPUT, compTimeline);
 	u64 baseCycleValue = compositorContext.baseCycleValue;
 
+	/* Frame */
+	// Main already held this cycle back until the composite last submitted with this frame finished.
+	// Waited again so its buffers, sets and queries are never reused early.
+	u32 iFrame = (baseCycleValue / MXC_CYCLE_COUNT) % MXC_COMPOSITOR_FRAME_COUNT;
+	u64 frameLag = MXC_COMPOSITOR_FRAME_COUNT * MXC_CYCLE_COUNT;
+	if (baseCycleValue >= frameLag) {
+		vkTimelineWait(device, baseCycleValue - frameLag + MXC_CYCLE_COUNT, frameTimeline);
+
+		u64 timestampsNS[TIME_QUERY_COUNT];
+		VK_CHECK(vk.GetQueryPoolResults(device, timeQryPool, iFrame * TIME_QUERY_COUNT, TIME_QUERY_COUNT, sizeof(u64) * TIME_QUERY_COUNT, timestampsNS, sizeof(u64), VK_QUERY_RESULT_64_BIT));
+		double timestampsMS[TIME_QUERY_COUNT];
+		for (u32 i = 0; i < TIME_QUERY_COUNT; ++i) timestampsMS[i] = (double)timestampsNS[i] / (double)1000000;  // ns to ms
+		timeQueryMs = timestampsMS[TIME_QUERY_COMPUTE_RENDER_END] - timestampsMS[TIME_QUERY_COMPUTE_RENDER_BEGIN];
+		cycleGpuMs += timestampsMS[TIME_QUERY_COMPUTE_RENDER_END] - timestampsMS[TIME_QUERY_QUAD_RENDER_BEGIN];
+
+		if (frameHasProcess[iFrame]) {
+			int iPath = frameProcessSinglePass[iFrame];
+			double processMs = timestampsMS[TIME_QUERY_GBUFFER_PROCESS_END] - timestampsMS[TIME_QUERY_GBUFFER_PROCESS_BEGIN];
+			gbufferProcessMs[iPath] += processMs;
+			cycleGpuMs += processMs;
+			if (++gbufferProcessCt[iPath] == MXC_GBUFFER_PROCESS_LOG_INTERVAL) {
+				gbufferProcessAvgMs[iPath] = gbufferProcessMs[iPath] / gbufferProcessCt[iPath];
+				gbufferProcessMs[iPath] = 0;
+				gbufferProcessCt[iPath] = 0;
+#if MXC_NODE_GBUFFER_PROCESS_COMPARE
+				LOG("GBuffer process multi dispatch %.4fms single pass %.4fms\n", gbufferProcessAvgMs[0], gbufferProcessAvgMs[1]);
+				// Frames already recorded with the old path still land in its own average
+				gbufferProcessSinglePass = !iPath;
+#else
+				LOG("GBuffer process %s %.4fms\n", iPath ? "single pass" : "multi dispatch", gbufferProcessAvgMs[iPath]);
+#endif
+			}
+		}
+	}
+
+	u64 cycleRecordBeginUs = midQueryPerformanceCounter();
+
+	MxcCompositorFrame* pFrame = &pFrames[iFrame];
+	VkCommandBuffer     gfxCmd = pGfxCmds[iFrame];
+	VkCommandBuffer     processCmd = pProcessCmds[iFrame];
+	u32                 iQuery = iFrame * TIME_QUERY_COUNT;
+
+	auto_t globalSet = pFrame->globalSet;
+	auto_t nodeSet = pFrame->nodeSet;
+	auto_t pNodeCullMapped = pFrame->pNodeCullMapped;
+	auto_t nodeCullBuf = pFrame->nodeCullBuffer.buffer;
+	auto_t pLineMapped = pFrame->pLineMapped;
+	auto_t lineBuffer = pFrame->lineBuffer.buffer;
+
 	midProcessCameraMouseInput(midWindowInput.deltaTime, mxcWindowInput.mouseDelta, &globCamPose);
 	midProcessCameraKeyInput(midWindowInput.deltaTime, mxcWindowInput.move, &globCamPose);
 	vkUpdateGlobalSetView(globCamPose, &globSetState);
-	memcpy(pGlobSetMapped, &globSetState, sizeof(VkGlobalSetState));
+	memcpy(vkSharedBufferPtr(pFrame->globalBuffer), &globSetState, sizeof(VkGlobalSetState));
 
 	/*
 	 * MXC_CYCLE_UPDATE_NODE_STATES
 	 */
 	vkTimelineSignal(device, baseCycleValue + MXC_CYCLE_UPDATE_NODE_STATES, compTimeline);
 
+	// Per frame acquires, then the cached composite and blit. Gbuffer processing is recorded
+	// into processCmd only once a node has a new frame.
+	VkCommandBuffer submitCmds[MXC_COMPOSITOR_SUBMIT_CAPACITY];
+	u32             submitCmdCt = 0;
+	bool            hasProcess = false;
+
 	CmdResetBegin(gfxCmd);
-	vk.ResetQueryPool(device, timeQryPool, 0, TIME_QUERY_COUNT);
-	vk.CmdWriteTimestamp2(gfxCmd, VK_PIPELINE_STAGE_2_NONE, timeQryPool, TIME_QUERY_GBUFFER_PROCESS_BEGIN);
+	vk.ResetQueryPool(device, timeQryPool, iQuery, TIME_QUERY_COUNT);
 
 	ivec2 windowExtent  = mxcWindowInput.iDimensions;
 	i32   windowPixelCt = windowExtent.x * windowExtent.y;
 	i32   windowGroupCt = windowPixelCt / GRID_SUBGROUP_COUNT / GRID_WORKGROUP_SUBGROUP_COUNT;
 
+	/* Damage */
+	// Anything moving the whole view or changing which nodes are drawn damages the whole window
+	bool damageAll = !hasComposited ||
+	                 !PoseEqual(globCamPose, compositedCamPose) ||
+	                 windowExtent.x != compositedWindowExtent.x ||
+	                 windowExtent.y != compositedWindowExtent.y;
+	for (u32 iCstMode = MXC_COMPOSITOR_MODE_QUAD; iCstMode < MXC_COMPOSITOR_MODE_COUNT; ++iCstMode) {
+		atomic_thread_fence(memory_order_acquire);
+		damageAll |= !ActiveNodesEqual(&node.active[iCstMode], &compositedActiveNodes[iCstMode]);
+	}
+
+	bool    isDamaged = damageAll;
+	MxcClip damage = {.ulUV = VEC2(1.0f, 1.0f), .lrUV = VEC2(0.0f, 0.0f)};
+
 	/* Iterate Node State Updates */
 	for (u32 iCstMode = MXC_COMPOSITOR_MODE_QUAD; iCstMode < MXC_COMPOSITOR_MODE_COUNT; ++iCstMode) {
 		atomic_thread_fence(memory_order_acquire);
@@ -584,9 +790,23 @@ CompositeLoop:
 			}
 
 			/* Poll New Node Swap */
-			u64 nodeTimelineValue = pNodeShrd->timelineValue;
-			if (nodeTimelineValue <= pNodeCpst->lastTimelineValue)
+			u64  nodeTimelineValue = pNodeShrd->timelineValue;
+			bool hasNewFrame = nodeTimelineValue > pNodeCpst->lastTimelineValue;
+
+			/* Damage Prior Clip */
+			bool nodeDamaged = hasNewFrame ||
+			                   pNodeCpst->interactionState != pNodeCpst->composited.interactionState ||
+			                   !PoseEqual(pNodeShrd->rootPose, pNodeCpst->composited.rootPose);
+			if (nodeDamaged) {
+				isDamaged = true;
+				DamageClip(pNodeCpst->composited.clip, &damage);
+				pNodeCpst->composited.rootPose = pNodeShrd->rootPose;
+			}
+
+			if (!hasNewFrame) {
+				pNodeCpst->composited.interactionState = pNodeCpst->interactionState;
 				continue;
+			}
 
 			pNodeCpst->lastTimelineValue = nodeTimelineValue;
 			atomic_thread_fence(memory_order_release);
@@ -601,6 +821,7 @@ CompositeLoop:
 				swap_i iRightColorImg  = pNodeShrd->viewSwaps[XR_VIEW_ID_RIGHT_STEREO].iColorImg;
 				swap_i iRightDepthSwap = pNodeShrd->viewSwaps[XR_VIEW_ID_RIGHT_STEREO].iDepthSwap;
 				swap_i iRightDepthImg  = pNodeShrd->viewSwaps[XR_VIEW_ID_RIGHT_STEREO].iDepthImg;
+				XrRect2Di leftImageRect = pNodeShrd->viewSwaps[XR_VIEW_ID_LEFT_STEREO].imageRect;
 
 				// need better way to determine these invalid
 				// and maybe better way to signify frame has been set
@@ -615,8 +836,10 @@ CompositeLoop:
 				MxcNodeSwap* pRightColorSwap = &pNodeCpst->swaps[iRightColorSwap][iRightColorImg];
 				MxcNodeSwap* pRightDepthSwap = &pNodeCpst->swaps[iRightDepthSwap][iRightDepthImg];
 
-				MxcNodeGBuffer* pLeftGBuffer = &pNodeCpst->gbuffer[XR_VIEW_ID_LEFT_STEREO];
-				MxcNodeGBuffer* pRightGBuffer = &pNodeCpst->gbuffer[XR_VIEW_ID_RIGHT_STEREO];
+				// Composites still in flight sample the prior gbuffer
+				pNodeCpst->iGBuffer = (pNodeCpst->iGBuffer + 1) % MXC_NODE_GBUFFER_COUNT;
+				MxcNodeGBuffer* pLeftGBuffer = &pNodeCpst->gbuffer[pNodeCpst->iGBuffer][XR_VIEW_ID_LEFT_STEREO];
+				MxcNodeGBuffer* pRightGBuffer = &pNodeCpst->gbuffer[pNodeCpst->iGBuffer][XR_VIEW_ID_RIGHT_STEREO];
 
 				// TODO each node needs its own process state
 //				memcpy(pProcessStateMapped, pProcState, sizeof(MxcProcessState));
@@ -644,7 +867,7 @@ CompositeLoop:
 				u32 srcQueueFamilyIndex = ExternalQueueFamilyIndex[activeInterprocessMode];
 				u32 dstQueueFamilyIndex = CompositorQueueFamilyIndex[activeInterprocessMode];
 
-				// Acquire Swaps
+				// Acquire Swaps. Gbuffer is acquired from the compute queue processing it this cycle.
 				CMD_IMAGE_BARRIERS2(gfxCmd, {
 					{	// Color
 						VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
@@ -659,26 +882,46 @@ CompositeLoop:
 						.dstAccessMask       = dstBarrier.dstAccessMask,
 						VK_IMAGE_BARRIER_COLOR_SUBRESOURCE_RANGE,
 					},
+					{	// Gbuffer
+						VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+						.image               = pLeftGBuffer->image,
+						.srcStageMask        = VK_PIPELINE_STAGE_2_NONE,
+						.srcAccessMask       = VK_ACCESS_2_NONE,
+						.oldLayout           = VK_IMAGE_LAYOUT_GENERAL,
+						.srcQueueFamilyIndex = processQueueFamilyIndex,
+						.dstQueueFamilyIndex = graphicsQueueFamilyIndex,
+						.newLayout           = dstBarrier.newLayout,
+						.dstStageMask        = dstBarrier.dstStageMask,
+						.dstAccessMask       = dstBarrier.dstAccessMask,
+						VK_IMAGE_BARRIER_COLOR_SUBRESOURCE_RANGE,
+					},
+				});
+
+				if (!hasProcess) {
+					hasProcess = true;
+					CmdResetBegin(processCmd);
+					vk.CmdWriteTimestamp2(processCmd, VK_PIPELINE_STAGE_2_NONE, timeQryPool, iQuery + TIME_QUERY_GBUFFER_PROCESS_BEGIN);
+				}
+
+				// Gbuffer was last sampled by a composite the frame wait already saw finish so its contents are discarded
+				CMD_IMAGE_BARRIERS2(processCmd, {
 					{	// Depth
 						VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
 						.image               = pLeftDepthSwap->image,
-						.srcStageMask        = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
-						.srcAccessMask       = VK_ACCESS_2_SHADER_READ_BIT,
+						.srcStageMask        = VK_PIPELINE_STAGE_2_NONE,
+						.srcAccessMask       = VK_ACCESS_2_NONE,
 						.oldLayout           = VK_IMAGE_LAYOUT_GENERAL,
-						.srcQueueFamilyIndex = srcQueueFamilyIndex,
-						.dstQueueFamilyIndex = dstQueueFamilyIndex,
+						.srcQueueFamilyIndex = ProcessSrcQueueFamilyIndex[activeInterprocessMode],
+						.dstQueueFamilyIndex = processQueueFamilyIndex,
 						VK_IMAGE_BARRIER_DST_COMPUTE_READ,
 						VK_IMAGE_BARRIER_COLOR_SUBRESOURCE_RANGE
 					},
 					{	// Gbuffer
 						VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
 						.image               = pLeftGBuffer->image,
-						.srcStageMask        = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
-						.srcAccessMask       = VK_ACCESS_2_SHADER_READ_BIT,
-						.oldLayout           = VK_IMAGE_LAYOUT_UNDEFINED, // Acquire discard
-						.srcQueueFamilyIndex = srcQueueFamilyIndex,
-						.dstQueueFamilyIndex = dstQueueFamilyIndex,
+						VK_IMAGE_BARRIER_SRC_UNDEFINED,
 						VK_IMAGE_BARRIER_DST_COMPUTE_WRITE,
+						VK_IMAGE_BARRIER_QUEUE_FAMILY_IGNORED,
 						VK_IMAGE_BARRIER_COLOR_SUBRESOURCE_RANGE,
 					},
 				});
@@ -688,28 +931,46 @@ CompositeLoop:
 				pProcessState->cameraNearZ = globCam.zNear;
 				pProcessState->cameraFarZ = globCam.zFar;
 
-				// TODO this needs to be specifically only the rect which was rendered into
+				// Only the rect the view rendered into is processed and sampled. Clamped as it comes from the node.
 				ivec2 nodeSwapExtent = IVEC2(pNodeShrd->swapMaxWidth, pNodeShrd->swapMaxHeight);
-				mxcNodeGBufferProcessDepth(gfxCmd, pProcessState, pLeftDepthSwap, pLeftGBuffer, nodeSwapExtent);
+				ivec2 rectOffset = IVEC2(
+					MIN(MAX(leftImageRect.offset.x, 0), nodeSwapExtent.x - 1),
+					MIN(MAX(leftImageRect.offset.y, 0), nodeSwapExtent.y - 1));
+				ivec2 rectExtent = IVEC2(
+					MIN(leftImageRect.extent.width, nodeSwapExtent.x - rectOffset.x),
+					MIN(leftImageRect.extent.height, nodeSwapExtent.y - rectOffset.y));
+				if (rectExtent.x <= 0 || rectExtent.y <= 0) {
+					rectOffset = IVEC2(0, 0);
+					rectExtent = nodeSwapExtent;
+				}
+				mxcNodeGBufferProcessDepth(processCmd, gbufferProcessSinglePass, pProcessState, pLeftDepthSwap, pLeftGBuffer, rectOffset, rectExtent);
 
-				CMD_IMAGE_BARRIERS2(gfxCmd, {
-					{	// Gbuffer
+				CMD_IMAGE_BARRIERS2(processCmd, {
+					{	// Gbuffer release to graphics
 						VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
-						.image         = pLeftGBuffer->image,
+						.image               = pLeftGBuffer->image,
 						VK_IMAGE_BARRIER_SRC_COMPUTE_WRITE,
-						.newLayout     = dstBarrier.newLayout,
-						.dstStageMask  = dstBarrier.dstStageMask,
-						.dstAccessMask = dstBarrier.dstAccessMask,
-						VK_IMAGE_BARRIER_QUEUE_FAMILY_IGNORED,
+						.srcQueueFamilyIndex = processQueueFamilyIndex,
+						.dstQueueFamilyIndex = graphicsQueueFamilyIndex,
+						.newLayout           = dstBarrier.newLayout,
+						.dstStageMask        = VK_PIPELINE_STAGE_2_NONE,
+						.dstAccessMask       = VK_ACCESS_2_NONE,
 						VK_IMAGE_BARRIER_COLOR_SUBRESOURCE_RANGE,
 					},
 				});
 
-				// Update Node Descriptor Sets
-				CMD_WRITE_SETS(device, {
-					BIND_WRITE_NODE_COLOR(cst.nodeSet, iNode, vk.context.nearestSampler, pLeftColorSwap->view, dstBarrier.newLayout),
-					BIND_WRITE_NODE_GBUFFER(cst.nodeSet, iNode, vk.context.nearestSampler, pLeftGBuffer->mipViews[0], dstBarrier.newLayout),
-				});
+				// Written into each frame's node set the next time that frame composites
+				pNodeCpst->colorView   = pLeftColorSwap->view;
+				pNodeCpst->gbufferView = pLeftGBuffer->mipViews[0];
+				pNodeCpst->viewLayout  = dstBarrier.newLayout;
+
+				// Belongs to the frame just acquired so goes out with the node set state that rendered it
+				pNodeCpst->renderingNodeSetState.swapULUV = VEC2(
+					(f32)rectOffset.x / nodeSwapExtent.x,
+					(f32)rectOffset.y / nodeSwapExtent.y);
+				pNodeCpst->renderingNodeSetState.swapLRUV = VEC2(
+					(f32)(rectOffset.x + rectExtent.x) / nodeSwapExtent.x,
+					(f32)(rectOffset.y + rectExtent.y) / nodeSwapExtent.y);
 			}
 
 			/* Calc new node uniform and shared data */
@@ -796,7 +1057,6 @@ CompositeLoop:
 
 				// Update compositor to use node state which rendered the frame
 				memcpy(&pNodeCpst->compositingNodeSetState, &pNodeCpst->renderingNodeSetState, sizeof(MxcCompositorNodeSetState));
-				memcpy(cst.pNodeSetMapped + iNode, &pNodeCpst->compositingNodeSetState, sizeof(MxcCompositorNodeSetState));
 
 				// Update node state to use in next node frame
 				pNodeShrd->cameraPose = globCamPose;
@@ -818,242 +1078,400 @@ CompositeLoop:
 				vkUpdateGlobalSetViewProj(pNodeShrd->camera, pNodeShrd->cameraPose, (VkGlobalSetState*)&pNodeCpst->renderingNodeSetState.view); // don't have to call SetViewProj every frame?
 				pNodeCpst->renderingNodeSetState.ulUV = pNodeShrd->clip.ulUV;
 				pNodeCpst->renderingNodeSetState.lrUV = pNodeShrd->clip.lrUV;
+				pNodeCpst->renderingNodeSetState.compositorRadius = pNodeShrd->compositorRadius;
+
+				/* Damage New Clip */
+				// Corners bound the quad and interaction lines, compositing clip bounds what compute reprojects
+				MxcClip compositingClip = {.ulUV = pNodeCpst->compositingNodeSetState.ulUV, .lrUV = pNodeCpst->compositingNodeSetState.lrUV};
+				pNodeCpst->composited.clip = (MxcClip){.ulUV = uvMinClamp, .lrUV = uvMaxClamp};
+				DamageClip(compositingClip, &pNodeCpst->composited.clip);
+				DamageClip(pNodeCpst->composited.clip, &damage);
+				pNodeCpst->composited.interactionState = pNodeCpst->interactionState;
 			}
 		}
 	}
-	vk.CmdWriteTimestamp2(gfxCmd, VK_PIPELINE_STAGE_2_NONE, timeQryPool, TIME_QUERY_GBUFFER_PROCESS_END);
+	if (hasProcess) {
+		vk.CmdWriteTimestamp2(processCmd, VK_PIPELINE_STAGE_2_NONE, timeQryPool, iQuery + TIME_QUERY_GBUFFER_PROCESS_END);
+		vk.EndCommandBuffer(processCmd);
+	} else {
+		// Queries are read back every frame so still need writing
+		vk.CmdWriteTimestamp2(gfxCmd, VK_PIPELINE_STAGE_2_NONE, timeQryPool, iQuery + TIME_QUERY_GBUFFER_PROCESS_BEGIN);
+		vk.CmdWriteTimestamp2(gfxCmd, VK_PIPELINE_STAGE_2_NONE, timeQryPool, iQuery + TIME_QUERY_GBUFFER_PROCESS_END);
+	}
 
 	/*
 	 * MXC_CYCLE_COMPOSITOR_RECORD
 	 */
 
-	/* Graphics Pipe */
-	vkTimelineSignal(device, baseCycleValue + MXC_CYCLE_COMPOSITOR_RECORD, compTimeline);
-
-	vk.CmdSetViewport(gfxCmd, 0, 1, &(VkViewport){.width = windowExtent.x, .height = windowExtent.y, .maxDepth = 1.0f});
-	vk.CmdSetScissor(gfxCmd,  0, 1, &(VkRect2D){.extent = {.width = windowExtent.x, .height = windowExtent.y}});
-	CmdBeginDepthRenderPass(gfxCmd, depthRenderPass, depthFramebuffer, VK_RENDER_PASS_CLEAR_COLOR, gfxFrameColorView, gfxFrameDepthView);
-
-	vk.CmdBindDescriptorSets(gfxCmd, VK_PIPELINE_BIND_POINT_GRAPHICS, gfxPipeLayout, PIPE_SET_INDEX_NODE_GRAPHICS_GLOBAL, 1, &globalSet,        0, NULL);
-	vk.CmdBindDescriptorSets(gfxCmd, VK_PIPELINE_BIND_POINT_GRAPHICS, gfxPipeLayout, PIPE_SET_INDEX_NODE_GRAPHICS_NODE,   1, &cst.nodeSet, 0, NULL);
-
-	bool hasGfx = false;
-	bool hasComp = false;
-
-	/* Graphics Quad Node Commands */
-	vk.CmdWriteTimestamp2(gfxCmd, VK_PIPELINE_STAGE_2_NONE, timeQryPool, TIME_QUERY_QUAD_RENDER_BEGIN);
-	atomic_thread_fence(memory_order_acquire);
-	if (node.active[MXC_COMPOSITOR_MODE_QUAD].count > 0) {
-		hasGfx = true;
+	/* Damage Tiles */
+	// Padded a tile each side like binning as clip rects are computed with the camera a node rendered with
+	ivec2 windowTileCt = IVEC2(MAX(windowExtent.x / GRID_TILE_SIZE, 1), MAX(windowExtent.y / GRID_TILE_SIZE, 1));
+	ivec4 damageTiles  = IVEC4(0, 0, windowTileCt.x, windowTileCt.y);
+	if (!damageAll) {
+		damageTiles.x = MAX((i32)(damage.ulUV.x * windowExtent.x) / GRID_TILE_SIZE - 1, 0);
+		damageTiles.y = MAX((i32)(damage.ulUV.y * windowExtent.y) / GRID_TILE_SIZE - 1, 0);
+		damageTiles.z = MIN((i32)(damage.lrUV.x * windowExtent.x) / GRID_TILE_SIZE + 2, windowTileCt.x);
+		damageTiles.w = MIN((i32)(damage.lrUV.y * windowExtent.y) / GRID_TILE_SIZE + 2, windowTileCt.y);
+	}
 
-		MxcActiveNodes* pActiveNodes = &node.active[MXC_COMPOSITOR_MODE_QUAD];
-		vk.CmdBindPipeline(gfxCmd, VK_PIPELINE_BIND_POINT_GRAPHICS, gfxQuadPipe);
-		vk.CmdBindVertexBuffers(gfxCmd, 0, 1, (VkBuffer[]){quadMeshBuf}, (VkDeviceSize[]){quadMeshOffsets.vertexOffset});
-		vk.CmdBindIndexBuffer(gfxCmd, quadMeshBuf, quadMeshOffsets.indexOffset, VK_INDEX_TYPE_UINT16);
+	// Tiles reaching the last row or column take the remainder of the window
+	VkRect2D damageArea = {
+		.offset = {.x = damageTiles.x * GRID_TILE_SIZE, .y = damageTiles.y * GRID_TILE_SIZE},
+		.extent = {
+			.width  = (damageTiles.z == windowTileCt.x ? windowExtent.x : damageTiles.z * GRID_TILE_SIZE) - damageTiles.x * GRID_TILE_SIZE,
+			.height = (damageTiles.w == windowTileCt.y ? windowExtent.y : damageTiles.w * GRID_TILE_SIZE) - damageTiles.y * GRID_TILE_SIZE,
+		},
+	};
 
-		for (u16 iActiveNode = 0; iActiveNode < pActiveNodes->count; ++iActiveNode) {
-			node_h hNode = pActiveNodes->handles[iActiveNode];
-			u16    iNode = HANDLE_INDEX(hNode);
-			vk.CmdPushConstants(gfxCmd, gfxPipeLayout, COMPOSITOR_AGGREGATE_STAGE_FLAGS, 0, sizeof(NodePush), &(NodePush){.nodeHandle = iNode});
-			vk.CmdDrawIndexed(gfxCmd, quadMeshOffsets.indexCount, 1, 0, 0, 0);
-		}
+	if (!isDamaged) {
+		// Nothing changed since the last composite so the retained framebuffers are blit as they are
+		vkTimelineSignal(device, baseCycleValue + MXC_CYCLE_COMPOSITOR_RECORD, compTimeline);
+		for (u32 iTimeQuery = TIME_QUERY_QUAD_RENDER_BEGIN; iTimeQuery < TIME_QUERY_COUNT; ++iTimeQuery)
+			vk.CmdWriteTimestamp2(gfxCmd, VK_PIPELINE_STAGE_2_NONE, timeQryPool, iQuery + iTimeQuery);
+		vk.EndCommandBuffer(gfxCmd);
+		submitCmds[submitCmdCt++] = gfxCmd;
+		goto BlitFramebuffer;
 	}
-	vk.CmdWriteTimestamp2(gfxCmd, VK_PIPELINE_STAGE_2_NONE, timeQryPool, TIME_QUERY_QUAD_RENDER_END);
-
-	/* Graphics Tesselation Node Commands */
-	vk.CmdWriteTimestamp2(gfxCmd, VK_PIPELINE_STAGE_2_NONE, timeQryPool, TIME_QUERY_TESS_RENDER_BEGIN);
-	atomic_thread_fence(memory_order_acquire);
-	if (node.active[MXC_COMPOSITOR_MODE_TESSELATION].count > 0) {
-		hasGfx = true;
 
-		MxcActiveNodes* pActiveNodes = &node.active[MXC_COMPOSITOR_MODE_TESSELATION];
-		vk.CmdBindPipeline(gfxCmd, VK_PIPELINE_BIND_POINT_GRAPHICS, gfxTessPipe);
-		vk.CmdBindVertexBuffers(gfxCmd, 0, 1, (VkBuffer[]){quadPatchBuf}, (VkDeviceSize[]){quadPatchOffsets.vertexOffset});
-		vk.CmdBindIndexBuffer(gfxCmd, quadPatchBuf, quadPatchOffsets.indexOffset, VK_INDEX_TYPE_UINT16);
+	hasComposited = true;
+	compositedCamPose = globCamPose;
+	compositedWindowExtent = windowExtent;
 
-		for (u16 iActiveNode = 0; iActiveNode < pActiveNodes->count; ++iActiveNode) {
-			node_h hNode = pActiveNodes->handles[iActiveNode];
-			u16    iNode = HANDLE_INDEX(hNode);
-			vk.CmdPushConstants(gfxCmd, gfxPipeLayout, COMPOSITOR_AGGREGATE_STAGE_FLAGS, 0, sizeof(NodePush), &(NodePush){.nodeHandle = iNode});
-			vk.CmdDrawIndexed(gfxCmd, quadPatchOffsets.indexCount, 1, 0, 0, 0); // this should use instancing instead of push on the node handle
-		}
+	u16 activeNodeCts[MXC_COMPOSITOR_MODE_COUNT] = {};
+	for (u32 iCstMode = MXC_COMPOSITOR_MODE_QUAD; iCstMode < MXC_COMPOSITOR_MODE_COUNT; ++iCstMode) {
+		atomic_thread_fence(memory_order_acquire);
+		activeNodeCts[iCstMode] = node.active[iCstMode].count;
+		compositedActiveNodes[iCstMode].count = activeNodeCts[iCstMode];
+		memcpy(compositedActiveNodes[iCstMode].handles, node.active[iCstMode].handles, sizeof(node_h) * activeNodeCts[iCstMode]);
 	}
-	vk.CmdWriteTimestamp2(gfxCmd, VK_PIPELINE_STAGE_2_NONE, timeQryPool, TIME_QUERY_TESS_RENDER_END);
-
-	/* Graphics Task Mesh Node Commands */
-	vk.CmdWriteTimestamp2(gfxCmd, VK_PIPELINE_STAGE_2_NONE, timeQryPool, TIME_QUERY_TASKMESH_RENDER_BEGIN);
-	atomic_thread_fence(memory_order_acquire);
-	if (node.active[MXC_COMPOSITOR_MODE_TASK_MESH].count > 0) {
-		hasGfx = true;
 
-		MxcActiveNodes* pActiveNodes = &node.active[MXC_COMPOSITOR_MODE_TASK_MESH];
-		vk.CmdBindPipeline(gfxCmd, VK_PIPELINE_BIND_POINT_GRAPHICS, nodeTaskMeshPipe);
+	// Lines are always drawn so the graphics framebuffer always has content
+	hasGfx = true;
+	hasComp = activeNodeCts[MXC_COMPOSITOR_MODE_COMPUTE] > 0;
+
+	/* Node Cull */
+	// Counts start at zero and the cull prepass appends each visible node
+	pNodeCullMapped->indirect = (MxcNodeIndirect){
+		.quad     = {.indexCount = quadMeshOffsets.indexCount,  .firstInstance = NODE_INDICES_BASE(MXC_COMPOSITOR_MODE_QUAD)},
+		.tess     = {.indexCount = quadPatchOffsets.indexCount, .firstInstance = NODE_INDICES_BASE(MXC_COMPOSITOR_MODE_TESSELATION)},
+		.taskMesh = {.groupCountY = 1, .groupCountZ = 1},
+		.compute  = {.x = 1, .y = windowGroupCt},
+		.computeTiles = {.x = 1, .z = 1},
+	};
+	pNodeCullMapped->damageTiles[0] = damageTiles.x;
+	pNodeCullMapped->damageTiles[1] = damageTiles.y;
+	pNodeCullMapped->damageTiles[2] = damageTiles.z;
+	pNodeCullMapped->damageTiles[3] = damageTiles.w;
 
-		for (u16 iActiveNode = 0; iActiveNode < pActiveNodes->count; ++iActiveNode) {
-			node_h hNode = pActiveNodes->handles[iActiveNode];
-			u16    iNode = HANDLE_INDEX(hNode);
-			vk.CmdPushConstants(gfxCmd, gfxPipeLayout, COMPOSITOR_AGGREGATE_STAGE_FLAGS, 0, sizeof(NodePush), &(NodePush){.nodeHandle = iNode});
-			vk.CmdDrawMeshTasksEXT(gfxCmd, 1, 1, 1);
-		}
+	for (u32 iCstMode = MXC_COMPOSITOR_MODE_QUAD; iCstMode < MXC_COMPOSITOR_MODE_COUNT; ++iCstMode) {
+		MxcActiveNodes* pActiveNodes = &compositedActiveNodes[iCstMode];
+		pNodeCullMapped->activeCounts[iCstMode] = activeNodeCts[iCstMode];
+		u32* pActiveNodeIndices = pNodeCullMapped->activeNodeIndices + NODE_INDICES_BASE(iCstMode);
+		for (u16 iActiveNode = 0; iActiveNode < activeNodeCts[iCstMode]; ++iActiveNode)
+			pActiveNodeIndices[iActiveNode] = HANDLE_INDEX(pActiveNodes->handles[iActiveNode]);
 	}
-	vk.CmdWriteTimestamp2(gfxCmd, VK_PIPELINE_STAGE_2_NONE, timeQryPool, TIME_QUERY_TASKMESH_RENDER_END);
-
-	/* Graphic Line Commands */
-	{
-		// TODO this could be another thread and run at a lower rate
-		hasGfx = true;
 
-		vk.CmdBindPipeline(gfxCmd, VK_PIPELINE_BIND_POINT_GRAPHICS, vk.context.linePipe);
-		vk.CmdBindDescriptorSets(gfxCmd, VK_PIPELINE_BIND_POINT_GRAPHICS, vk.context.linePipeLayout, VK_PIPE_SET_INDEX_LINE_GLOBAL, 1, &globalSet, 0, NULL);
+	vkTimelineSignal(device, baseCycleValue + MXC_CYCLE_COMPOSITOR_RECORD, compTimeline);
 
-		vkCmdSetLineWidth(gfxCmd, 1.0f);
+	vk.EndCommandBuffer(gfxCmd);
+	submitCmds[submitCmdCt++] = gfxCmd;
 
+	/* Frame Node State */
+	// Each frame holds its own copy of node state, so catch this frame's up to the latest node frames
+	{
 		u16 cubeCount = 0;
 		for (u16 iCstMode = MXC_COMPOSITOR_MODE_QUAD; iCstMode < MXC_COMPOSITOR_MODE_COUNT; ++iCstMode) {
-			atomic_thread_fence(memory_order_acquire);
-			u16 activeNodeCt = node.active[iCstMode].count;
-			if (activeNodeCt == 0)
-				continue;
-
-			MxcActiveNodes* pActiveNodes = &node.active[iCstMode];
-			for (u16 iActiveNode = 0; iActiveNode < activeNodeCt; ++iActiveNode) {
+			MxcActiveNodes* pActiveNodes = &compositedActiveNodes[iCstMode];
+			for (u16 iActiveNode = 0; iActiveNode < activeNodeCts[iCstMode]; ++iActiveNode) {
 				node_h hNode = pActiveNodes->handles[iActiveNode];
+				u16    iNode = HANDLE_INDEX(hNode);
 				MxcCompositorNodeData* pNodeCpst = ARRAY_PTR_H(cst.nodeData, hNode);
 				memcpy(pLineMapped + (cubeCount * MXC_CUBE_SEGMENT_COUNT), pNodeCpst->worldLineSegments, sizeof(VkLineVert) * MXC_CUBE_SEGMENT_COUNT);
 				cubeCount++;
+
+				if (pNodeCpst->frameTimelineValues[iFrame] == pNodeCpst->lastTimelineValue)
+					continue;
+
+				pNodeCpst->frameTimelineValues[iFrame] = pNodeCpst->lastTimelineValue;
+				memcpy(pFrame->pNodeSetMapped + iNode, &pNodeCpst->compositingNodeSetState, sizeof(MxcCompositorNodeSetState));
+				if (pNodeCpst->colorView == VK_NULL_HANDLE)
+					continue;
+
+				CMD_WRITE_SETS(device, {
+					BIND_WRITE_NODE_COLOR(nodeSet, iNode, vk.context.nearestSampler, pNodeCpst->colorView, pNodeCpst->viewLayout),
+					BIND_WRITE_NODE_GBUFFER(nodeSet, iNode, vk.context.nearestSampler, pNodeCpst->gbufferView, pNodeCpst->viewLayout),
+				});
 			}
 		}
-
-		vk.CmdBindVertexBuffers(gfxCmd, 0, 1, (VkBuffer[]){lineBuffer}, (VkDeviceSize[]){0});
-		vkCmdDraw(gfxCmd, cubeCount * MXC_CUBE_SEGMENT_COUNT, 1, 0, 0);
 	}
 
-	vk.CmdEndRenderPass(gfxCmd);
+	/* Composite Cmd */
+	// Everything varying per frame is read from the node cull, node set and line buffers
+	// so a composite is only recorded when its key is new, then resubmitted as is.
+	MxcCompositeCmdKey cstKey;
+	memset(&cstKey, 0, sizeof(cstKey));
+	memcpy(cstKey.activeNodeCts, activeNodeCts, sizeof(activeNodeCts));
+	cstKey.damageAll    = damageAll;
+	cstKey.damageArea   = damageArea;
+	cstKey.windowExtent = windowExtent;
+
+	MxcCompositeCmd* pCstCmd = FindCompositeCmd(pCompositeCmds[iFrame], &cstKey);
+	pCstCmd->lastUsedCycle = baseCycleValue;
+	VkCommandBuffer cstCmd = pCstCmd->cmd;
+	if (!pCstCmd->isRecorded) {
+		pCstCmd->isRecorded = true;
+		memcpy(&pCstCmd->key, &cstKey, sizeof(cstKey));
+		CmdResetBeginReusable(cstCmd);
+
+		vk.CmdBindPipeline(cstCmd, VK_PIPELINE_BIND_POINT_COMPUTE, nodeCullPipe);
+		vk.CmdBindDescriptorSets(cstCmd, VK_PIPELINE_BIND_POINT_COMPUTE, gfxPipeLayout, PIPE_SET_INDEX_NODE_GRAPHICS_GLOBAL, 1, &globalSet,    0, NULL);
+		vk.CmdBindDescriptorSets(cstCmd, VK_PIPELINE_BIND_POINT_COMPUTE, gfxPipeLayout, PIPE_SET_INDEX_NODE_GRAPHICS_NODE,   1, &nodeSet, 0, NULL);
+		vk.CmdDispatch(cstCmd, 1, MXC_COMPOSITOR_MODE_COUNT, 1);
+		vk.CmdPipelineBarrier2(cstCmd, &(VkDependencyInfo){
+			VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+			.memoryBarrierCount = 1,
+			.pMemoryBarriers    = &(VkMemoryBarrier2){
+				VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+				.srcStageMask  = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+				.srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+				.dstStageMask  = VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+				.dstAccessMask = VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT,
+			},
+		});
+
+		/* Graphics Pipe */
+		// Preserve pass clears and redraws only the damaged area, keeping the rest of the last composite
+		vk.CmdSetViewport(cstCmd, 0, 1, &(VkViewport){.width = windowExtent.x, .height = windowExtent.y, .maxDepth = 1.0f});
+		vk.CmdSetScissor(cstCmd,  0, 1, &damageArea);
+		CmdBeginDepthRenderPassArea(cstCmd, damageAll ? depthRenderPass : depthPreserveRenderPass, depthFramebuffer, VK_RENDER_PASS_CLEAR_COLOR, gfxFrameColorView, gfxFrameDepthView, damageAll ? (VkRect2D){.extent = {.width = DEFAULT_WIDTH, .height = DEFAULT_HEIGHT}} : damageArea);
+
+		vk.CmdBindDescriptorSets(cstCmd, VK_PIPELINE_BIND_POINT_GRAPHICS, gfxPipeLayout, PIPE_SET_INDEX_NODE_GRAPHICS_GLOBAL, 1, &globalSet,        0, NULL);
+		vk.CmdBindDescriptorSets(cstCmd, VK_PIPELINE_BIND_POINT_GRAPHICS, gfxPipeLayout, PIPE_SET_INDEX_NODE_GRAPHICS_NODE,   1, &nodeSet, 0, NULL);
+
+		/* Graphics Quad Node Commands */
+		vk.CmdWriteTimestamp2(cstCmd, VK_PIPELINE_STAGE_2_NONE, timeQryPool, iQuery + TIME_QUERY_QUAD_RENDER_BEGIN);
+		if (activeNodeCts[MXC_COMPOSITOR_MODE_QUAD] > 0) {
+			vk.CmdBindPipeline(cstCmd, VK_PIPELINE_BIND_POINT_GRAPHICS, gfxQuadPipe);
+			vk.CmdBindVertexBuffers(cstCmd, 0, 1, (VkBuffer[]){quadMeshBuf}, (VkDeviceSize[]){quadMeshOffsets.vertexOffset});
+			vk.CmdBindIndexBuffer(cstCmd, quadMeshBuf, quadMeshOffsets.indexOffset, VK_INDEX_TYPE_UINT16);
+			vk.CmdDrawIndexedIndirect(cstCmd, nodeCullBuf, offsetof(MxcNodeCullState, indirect.quad), 1, sizeof(VkDrawIndexedIndirectCommand));
+		}
+		vk.CmdWriteTimestamp2(cstCmd, VK_PIPELINE_STAGE_2_NONE, timeQryPool, iQuery + TIME_QUERY_QUAD_RENDER_END);
+
+		/* Graphics Tesselation Node Commands */
+		vk.CmdWriteTimestamp2(cstCmd, VK_PIPELINE_STAGE_2_NONE, timeQryPool, iQuery + TIME_QUERY_TESS_RENDER_BEGIN);
+		if (activeNodeCts[MXC_COMPOSITOR_MODE_TESSELATION] > 0) {
+			vk.CmdBindPipeline(cstCmd, VK_PIPELINE_BIND_POINT_GRAPHICS, gfxTessPipe);
+			vk.CmdBindVertexBuffers(cstCmd, 0, 1, (VkBuffer[]){quadPatchBuf}, (VkDeviceSize[]){quadPatchOffsets.vertexOffset});
+			vk.CmdBindIndexBuffer(cstCmd, quadPatchBuf, quadPatchOffsets.indexOffset, VK_INDEX_TYPE_UINT16);
+			vk.CmdDrawIndexedIndirect(cstCmd, nodeCullBuf, offsetof(MxcNodeCullState, indirect.tess), 1, sizeof(VkDrawIndexedIndirectCommand));
+		}
+		vk.CmdWriteTimestamp2(cstCmd, VK_PIPELINE_STAGE_2_NONE, timeQryPool, iQuery + TIME_QUERY_TESS_RENDER_END);
+
+		/* Graphics Task Mesh Node Commands */
+		vk.CmdWriteTimestamp2(cstCmd, VK_PIPELINE_STAGE_2_NONE, timeQryPool, iQuery + TIME_QUERY_TASKMESH_RENDER_BEGIN);
+		if (activeNodeCts[MXC_COMPOSITOR_MODE_TASK_MESH] > 0) {
+			vk.CmdBindPipeline(cstCmd, VK_PIPELINE_BIND_POINT_GRAPHICS, nodeTaskMeshPipe);
+			vk.CmdPushConstants(cstCmd, gfxPipeLayout, COMPOSITOR_AGGREGATE_STAGE_FLAGS, 0, sizeof(NodePush), &(NodePush){.nodeIndexBase = NODE_INDICES_BASE(MXC_COMPOSITOR_MODE_TASK_MESH)});
+			vk.CmdDrawMeshTasksIndirectEXT(cstCmd, nodeCullBuf, offsetof(MxcNodeCullState, indirect.taskMesh), 1, sizeof(VkDrawMeshTasksIndirectCommandEXT));
+		}
+		vk.CmdWriteTimestamp2(cstCmd, VK_PIPELINE_STAGE_2_NONE, timeQryPool, iQuery + TIME_QUERY_TASKMESH_RENDER_END);
 
-	/* Compute Recording Cycle */
-	vk.CmdWriteTimestamp2(gfxCmd, VK_PIPELINE_STAGE_2_NONE, timeQryPool, TIME_QUERY_COMPUTE_RENDER_BEGIN);
-	if (node.active[MXC_COMPOSITOR_MODE_COMPUTE].count > 0) {
-		hasComp = true;
+		/* Graphic Line Commands */
+		{
+			// TODO this could be another thread and run at a lower rate
+			u16 cubeCount = 0;
+			for (u32 iCstMode = MXC_COMPOSITOR_MODE_QUAD; iCstMode < MXC_COMPOSITOR_MODE_COUNT; ++iCstMode)
+				cubeCount += activeNodeCts[iCstMode];
 
-		vk.CmdBindPipeline(gfxCmd, VK_PIPELINE_BIND_POINT_COMPUTE, compPipe);
-		vk.CmdBindDescriptorSets(gfxCmd, VK_PIPELINE_BIND_POINT_COMPUTE, compPipeLayout, PIPE_SET_INDEX_NODE_COMPUTE_GLOBAL, 1, &globalSet,     0, NULL);
-		vk.CmdBindDescriptorSets(gfxCmd, VK_PIPELINE_BIND_POINT_COMPUTE, compPipeLayout, PIPE_SET_INDEX_NODE_COMPUTE_NODE,   1, &cst.nodeSet,   0, NULL);
-		vk.CmdBindDescriptorSets(gfxCmd, VK_PIPELINE_BIND_POINT_COMPUTE, compPipeLayout, PIPE_SET_INDEX_NODE_COMPUTE_OUTPUT, 1, &compOutputSet, 0, NULL);
+			vk.CmdBindPipeline(cstCmd, VK_PIPELINE_BIND_POINT_GRAPHICS, vk.context.linePipe);
+			vk.CmdBindDescriptorSets(cstCmd, VK_PIPELINE_BIND_POINT_GRAPHICS, vk.context.linePipeLayout, VK_PIPE_SET_INDEX_LINE_GLOBAL, 1, &globalSet, 0, NULL);
 
-		MxcActiveNodes* pActiveNodes = &node.active[MXC_COMPOSITOR_MODE_COMPUTE];
-		for (u16 iActiveNode = 0; iActiveNode < pActiveNodes->count; ++iActiveNode) {
-			node_h hNode = pActiveNodes->handles[iActiveNode];
-			u16    iNode = HANDLE_INDEX(hNode);
-			vk.CmdPushConstants(gfxCmd, compPipeLayout, COMPOSITOR_AGGREGATE_STAGE_FLAGS, 0, sizeof(NodePush), &(NodePush){.nodeHandle = iNode});
-			vk.CmdDispatch(gfxCmd, 1, windowGroupCt, 1);
+			vkCmdSetLineWidth(cstCmd, 1.0f);
+
+			vk.CmdBindVertexBuffers(cstCmd, 0, 1, (VkBuffer[]){lineBuffer}, (VkDeviceSize[]){0});
+			vkCmdDraw(cstCmd, cubeCount * MXC_CUBE_SEGMENT_COUNT, 1, 0, 0);
 		}
 
-		CMD_IMAGE_BARRIERS2(gfxCmd, {
-			{
-				VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
-				.image = compFrameAtomicImg,
-				VK_IMAGE_BARRIER_SRC_COMPUTE_READ_WRITE,
-				VK_IMAGE_BARRIER_DST_COMPUTE_READ_WRITE,
-				VK_IMAGE_BARRIER_QUEUE_FAMILY_IGNORED,
-				VK_IMAGE_BARRIER_COLOR_SUBRESOURCE_RANGE,
-			},
+		vk.CmdEndRenderPass(cstCmd);
+
+		/* Compute Recording Cycle */
+		vk.CmdWriteTimestamp2(cstCmd, VK_PIPELINE_STAGE_2_NONE, timeQryPool, iQuery + TIME_QUERY_COMPUTE_RENDER_BEGIN);
+		if (activeNodeCts[MXC_COMPOSITOR_MODE_COMPUTE] > 0) {
+			vk.CmdBindPipeline(cstCmd, VK_PIPELINE_BIND_POINT_COMPUTE, compBinPipe);
+			vk.CmdBindDescriptorSets(cstCmd, VK_PIPELINE_BIND_POINT_COMPUTE, compPipeLayout, PIPE_SET_INDEX_NODE_COMPUTE_GLOBAL, 1, &globalSet,     0, NULL);
+			vk.CmdBindDescriptorSets(cstCmd, VK_PIPELINE_BIND_POINT_COMPUTE, compPipeLayout, PIPE_SET_INDEX_NODE_COMPUTE_NODE,   1, &nodeSet,   0, NULL);
+			vk.CmdBindDescriptorSets(cstCmd, VK_PIPELINE_BIND_POINT_COMPUTE, compPipeLayout, PIPE_SET_INDEX_NODE_COMPUTE_OUTPUT, 1, &compOutputSet, 0, NULL);
+			vk.CmdPushConstants(cstCmd, compPipeLayout, COMPOSITOR_AGGREGATE_STAGE_FLAGS, 0, sizeof(NodePush), &(NodePush){.nodeIndexBase = NODE_INDICES_BASE(MXC_COMPOSITOR_MODE_COMPUTE)});
+
+			// Invocation per tile, appends a node tile for each visible node its clip rect overlaps
+			vk.CmdDispatch(cstCmd, (windowGroupCt + GRID_BIN_LOCAL_SIZE - 1) / GRID_BIN_LOCAL_SIZE, 1, 1);
+			vk.CmdPipelineBarrier2(cstCmd, &(VkDependencyInfo){
+				VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+				.memoryBarrierCount = 1,
+				.pMemoryBarriers    = &(VkMemoryBarrier2){
+					VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+					.srcStageMask  = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+					.srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+					.dstStageMask  = VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+					.dstAccessMask = VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT,
+				},
+			});
+
+			// Workgroup y is the node tile
+			vk.CmdBindPipeline(cstCmd, VK_PIPELINE_BIND_POINT_COMPUTE, compPipe);
+			vk.CmdDispatchIndirect(cstCmd, nodeCullBuf, offsetof(MxcNodeCullState, indirect.computeTiles));
+
+			CMD_IMAGE_BARRIERS2(cstCmd, {
+				{
+					VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+					.image = compFrameAtomicImg,
+					VK_IMAGE_BARRIER_SRC_COMPUTE_READ_WRITE,
+					VK_IMAGE_BARRIER_DST_COMPUTE_READ_WRITE,
+					VK_IMAGE_BARRIER_QUEUE_FAMILY_IGNORED,
+					VK_IMAGE_BARRIER_COLOR_SUBRESOURCE_RANGE,
+				},
+				{
+					VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+					.image = compFrameColorImg,
+					VK_IMAGE_BARRIER_SRC_COMPUTE_READ_WRITE,
+					VK_IMAGE_BARRIER_DST_COMPUTE_READ_WRITE,
+					VK_IMAGE_BARRIER_QUEUE_FAMILY_IGNORED,
+					VK_IMAGE_BARRIER_COLOR_SUBRESOURCE_RANGE,
+				},
+			});
+
+			vk.CmdBindPipeline(cstCmd, VK_PIPELINE_BIND_POINT_COMPUTE, postCompPipe);
+			vk.CmdDispatch(cstCmd, 1, windowGroupCt, 1);
+		}
+		vk.CmdWriteTimestamp2(cstCmd, VK_PIPELINE_STAGE_2_NONE, timeQryPool, iQuery + TIME_QUERY_COMPUTE_RENDER_END);
+
+		// Graphics framebuffer is left in GENERAL after the blit and stays there until the next composite
+		CMD_IMAGE_BARRIERS2(cstCmd, {
 			{
 				VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
-				.image = compFrameColorImg,
-				VK_IMAGE_BARRIER_SRC_COMPUTE_READ_WRITE,
-				VK_IMAGE_BARRIER_DST_COMPUTE_READ_WRITE,
+				.image = gfxFrameColorImg,
+				VK_IMAGE_BARRIER_SRC_COLOR_ATTACHMENT_WRITE,
+				VK_IMAGE_BARRIER_DST_COMPUTE_READ,
 				VK_IMAGE_BARRIER_QUEUE_FAMILY_IGNORED,
 				VK_IMAGE_BARRIER_COLOR_SUBRESOURCE_RANGE,
 			},
 		});
 
-		vk.CmdBindPipeline(gfxCmd, VK_PIPELINE_BIND_POINT_COMPUTE, postCompPipe);
-		vk.CmdDispatch(gfxCmd, 1, windowGroupCt, 1);
+		vk.EndCommandBuffer(cstCmd);
 	}
-	vk.CmdWriteTimestamp2(gfxCmd, VK_PIPELINE_STAGE_2_NONE, timeQryPool, TIME_QUERY_COMPUTE_RENDER_END);
 
-	/* Blit Framebuffer */
+	submitCmds[submitCmdCt++] = cstCmd;
+
+BlitFramebuffer:
 	{
 		u32 frameIdx;
 		CmdSwapAcquire(device, pSwapCtx, &frameIdx);
 		VkSwapFrame* pSwap = &pSwapCtx->frames[frameIdx];
 
-		CMD_IMAGE_BARRIERS2(gfxCmd, {
-			{
-				VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
-				.image = gfxFrameColorImg,
-				VK_IMAGE_BARRIER_SRC_COLOR_ATTACHMENT_WRITE,
-				VK_IMAGE_BARRIER_DST_COMPUTE_READ,
-				VK_IMAGE_BARRIER_QUEUE_FAMILY_IGNORED,
-				VK_IMAGE_BARRIER_COLOR_SUBRESOURCE_RANGE,
-			},
-			{
-				VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
-				.image = compFrameColorImg,
-				VK_IMAGE_BARRIER_SRC_COMPUTE_READ_WRITE,
-				VK_IMAGE_BARRIER_DST_COMPUTE_READ,
-				VK_IMAGE_BARRIER_QUEUE_FAMILY_IGNORED,
-				VK_IMAGE_BARRIER_COLOR_SUBRESOURCE_RANGE,
-			},
-			{
-				VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
-				.image = pSwap->image,
-				VK_IMAGE_BARRIER_SRC_COLOR_ATTACHMENT_UNDEFINED,
-				VK_IMAGE_BARRIER_DST_COMPUTE_WRITE,
-				VK_IMAGE_BARRIER_QUEUE_FAMILY_IGNORED,
-				VK_IMAGE_BARRIER_COLOR_SUBRESOURCE_RANGE,
-			},
-		});
+		// One blit per swap image and framebuffer combination, rerecorded when the window changes
+		MxcBlitCmd* pBlitCmd = &pBlitCmds[iFrame][frameIdx][hasGfx][hasComp];
+		VkCommandBuffer blitCmd = pBlitCmd->cmd;
+		if (pBlitCmd->windowExtent.x != windowExtent.x || pBlitCmd->windowExtent.y != windowExtent.y) {
+			pBlitCmd->windowExtent = windowExtent;
+			CmdResetBeginReusable(blitCmd);
 
-		vk.CmdBindPipeline(gfxCmd, VK_PIPELINE_BIND_POINT_COMPUTE, finalBlitPipe);
-		CMD_BIND_DESCRIPTOR_SETS(gfxCmd, VK_PIPELINE_BIND_POINT_COMPUTE, finalBlitPipeLayout, PIPE_SET_INDEX_FINAL_BLIT_GLOBAL, globalSet);
-		CMD_PUSH_DESCRIPTOR_SETS2(gfxCmd, VK_PIPELINE_BIND_POINT_COMPUTE, finalBlitPipeLayout, PIPE_SET_INDEX_FINAL_BLIT_INOUT, {
-			BIND_WRITE_FINAL_BLIT_SRC_GRAPHICS_FRAMEBUFFER(hasGfx ? gfxFrameColorView : VK_NULL_HANDLE, hasComp ? compFrameColorView : VK_NULL_HANDLE),
-			BIND_WRITE_FINAL_BLIT_DST(pSwap->view),
-		});
-		vk.CmdDispatch(gfxCmd, 1, windowGroupCt, 1);
+			CMD_IMAGE_BARRIERS2(blitCmd, {
+				{
+					VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+					.image = compFrameColorImg,
+					VK_IMAGE_BARRIER_SRC_COMPUTE_READ_WRITE,
+					VK_IMAGE_BARRIER_DST_COMPUTE_READ,
+					VK_IMAGE_BARRIER_QUEUE_FAMILY_IGNORED,
+					VK_IMAGE_BARRIER_COLOR_SUBRESOURCE_RANGE,
+				},
+				{
+					VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+					.image = pSwap->image,
+					VK_IMAGE_BARRIER_SRC_COLOR_ATTACHMENT_UNDEFINED,
+					VK_IMAGE_BARRIER_DST_COMPUTE_WRITE,
+					VK_IMAGE_BARRIER_QUEUE_FAMILY_IGNORED,
+					VK_IMAGE_BARRIER_COLOR_SUBRESOURCE_RANGE,
+				},
+			});
 
-		CMD_IMAGE_BARRIERS2(gfxCmd,{
-			{
-				VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
-				.image = pSwap->image,
-				VK_IMAGE_BARRIER_SRC_COMPUTE_WRITE,
-				VK_IMAGE_BARRIER_DST_PRESENT,
-				VK_IMAGE_BARRIER_QUEUE_FAMILY_IGNORED,
-				VK_IMAGE_BARRIER_COLOR_SUBRESOURCE_RANGE,
-			},
-			{
-				VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
-				.image = compFrameColorImg,
-				VK_IMAGE_BARRIER_SRC_COMPUTE_READ,
-				VK_IMAGE_BARRIER_DST_COMPUTE_READ_WRITE,
-				VK_IMAGE_BARRIER_QUEUE_FAMILY_IGNORED,
-				VK_IMAGE_BARRIER_COLOR_SUBRESOURCE_RANGE,
-			},
-		});
-	}
+			vk.CmdBindPipeline(blitCmd, VK_PIPELINE_BIND_POINT_COMPUTE, finalBlitPipe);
+			CMD_BIND_DESCRIPTOR_SETS(blitCmd, VK_PIPELINE_BIND_POINT_COMPUTE, finalBlitPipeLayout, PIPE_SET_INDEX_FINAL_BLIT_GLOBAL, globalSet);
+			CMD_PUSH_DESCRIPTOR_SETS2(blitCmd, VK_PIPELINE_BIND_POINT_COMPUTE, finalBlitPipeLayout, PIPE_SET_INDEX_FINAL_BLIT_INOUT, {
+				BIND_WRITE_FINAL_BLIT_SRC_GRAPHICS_FRAMEBUFFER(hasGfx ? gfxFrameColorView : VK_NULL_HANDLE, hasComp ? compFrameColorView : VK_NULL_HANDLE),
+				BIND_WRITE_FINAL_BLIT_DST(pSwap->view),
+			});
+			vk.CmdDispatch(blitCmd, 1, windowGroupCt, 1);
 
-	vk.EndCommandBuffer(gfxCmd);
+			CMD_IMAGE_BARRIERS2(blitCmd,{
+				{
+					VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+					.image = pSwap->image,
+					VK_IMAGE_BARRIER_SRC_COMPUTE_WRITE,
+					VK_IMAGE_BARRIER_DST_PRESENT,
+					VK_IMAGE_BARRIER_QUEUE_FAMILY_IGNORED,
+					VK_IMAGE_BARRIER_COLOR_SUBRESOURCE_RANGE,
+				},
+				{
+					VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+					.image = compFrameColorImg,
+					VK_IMAGE_BARRIER_SRC_COMPUTE_READ,
+					VK_IMAGE_BARRIER_DST_COMPUTE_READ_WRITE,
+					VK_IMAGE_BARRIER_QUEUE_FAMILY_IGNORED,
+					VK_IMAGE_BARRIER_COLOR_SUBRESOURCE_RANGE,
+				},
+			});
+
+			vk.EndCommandBuffer(blitCmd);
+		}
+
+		submitCmds[submitCmdCt++] = blitCmd;
+	}
 
 	/*
 	 * MXC_CYCLE_RENDER_COMPOSITE
 	 */
 	{
-		// Signal will submit gfxCmd on main
+		// Signal will submit the cycle's command buffers on main
+		memcpy(compositorContext.submitCmds, submitCmds, sizeof(VkCommandBuffer) * submitCmdCt);
+		compositorContext.submitCmdCt = submitCmdCt;
+		compositorContext.processCmd = hasProcess ? processCmd : VK_NULL_HANDLE;
+		frameHasProcess[iFrame] = hasProcess;
+		frameProcessSinglePass[iFrame] = gbufferProcessSinglePass;
+		atomic_thread_fence(memory_order_release);
 		vkTimelineSignal(device, baseCycleValue + MXC_CYCLE_RENDER_COMPOSITE, compTimeline);
 	}
 
+	/* Cycle Stats */
+	{
+		u64 nowUs = midQueryPerformanceCounter();
+		cycleRecordUs += nowUs - cycleRecordBeginUs;
+		if (++cycleStatsCt == MXC_CYCLE_STATS_LOG_INTERVAL) {
+			double wallMs = (double)(nowUs - cycleStatsBeginUs) / 1000.0;
+			double recordMs = (double)cycleRecordUs / 1000.0;
+			u32    activeNodeCt = 0;
+			for (u32 iCstMode = MXC_COMPOSITOR_MODE_QUAD; iCstMode < MXC_COMPOSITOR_MODE_COUNT; ++iCstMode)
+				activeNodeCt += node.active[iCstMode].count;
+			// GPU time lags recording by the frames in flight, which evens out over an interval
+			LOG("Cycle %.1fhz record %.3fms %.0f%% GPU %.3fms %.0f%% frames %d active nodes %u\n",
+			    cycleStatsCt * 1000.0 / wallMs,
+			    recordMs / cycleStatsCt, 100.0 * recordMs / wallMs,
+			    cycleGpuMs / cycleStatsCt, 100.0 * cycleGpuMs / wallMs,
+			    MXC_COMPOSITOR_FRAME_COUNT, activeNodeCt);
+			cycleStatsBeginUs = nowUs;
+			cycleRecordUs = 0;
+			cycleGpuMs = 0;
+			cycleStatsCt = 0;
+		}
+	}
+
 	/*
 	 * MXC_CYCLE_UPDATE_WINDOW_STATE
 	 */
 	{
+		// Signalled by main once the frame this cycle will reuse is free, not when this composite finishes
 		u64 nextUpdateWindowStateCycle = baseCycleValue + MXC_CYCLE_COUNT + MXC_CYCLE_UPDATE_WINDOW_STATE;
 		vkTimelineWait(device, nextUpdateWindowStateCycle, compTimeline);
-		u64 timestampsNS[TIME_QUERY_COUNT];
-		VK_CHECK(vk.GetQueryPoolResults(device, timeQryPool, 0, TIME_QUERY_COUNT, sizeof(u64) * TIME_QUERY_COUNT, timestampsNS, sizeof(u64), VK_QUERY_RESULT_64_BIT));
-		double timestampsMS[TIME_QUERY_COUNT];
-		for (u32 i = 0; i < TIME_QUERY_COUNT; ++i) timestampsMS[i] = (double)timestampsNS[i] / (double)1000000;  // ns to ms
-		timeQueryMs = timestampsMS[TIME_QUERY_COMPUTE_RENDER_END] - timestampsMS[TIME_QUERY_COMPUTE_RENDER_BEGIN];
 	}
 
 	CHECK_RUNNING;
@@ -1105,12 +1523,19 @@ static void Allocate(const MxcCompositorCreateInfo* pInfo, MxcCompositor* pCst)
 	if (pInfo->pEnabledCompositorModes[MXC_COMPOSITOR_MODE_COMPUTE]) {
 		CreateComputeOutputSetLayout(&pCst->compOutputSetLayout);
 		CreateNodeComputePipeLayout(COMPOSITOR_AGGREGATE_STAGE_FLAGS, pCst->nodeSetLayout, pCst->compOutputSetLayout, &pCst->compPipeLayout);
+		vkCreateComputePipe("./shaders/compositor_node_bin.comp.spv", pCst->compPipeLayout, &pCst->compBinPipe);
 		vkCreateComputePipe("./shaders/compute_compositor.comp.spv", pCst->compPipeLayout, &pCst->compPipe);
 		vkCreateComputePipe("./shaders/compute_post_compositor_basic.comp.spv", pCst->compPipeLayout, &pCst->postCompPipe);
+		VK_SET_DEBUG(pCst->compBinPipe);
 		VK_SET_DEBUG(pCst->compPipe);
 		VK_SET_DEBUG(pCst->postCompPipe);
 	}
 
+	///
+	/// Cull Pipe
+	vkCreateComputePipe("./shaders/compositor_node_cull.comp.spv", pCst->gfxPipeLayout, &pCst->nodeCullPipe);
+	VK_SET_DEBUG(pCst->nodeCullPipe);
+
 	///
 	/// Line Pipe
 	{
@@ -1122,7 +1547,8 @@ static void Allocate(const MxcCompositorCreateInfo* pInfo, MxcCompositor* pCst)
 			.locality  = VK_LOCALITY_CONTEXT,
 			.dedicated = VK_DEDICATED_MEMORY_FALSE,
 		};
-		vkCreateSharedBuffer(&lineRequest, &pCst->lineBuffer);
+		for (u32 iFrame = 0; iFrame < MXC_COMPOSITOR_FRAME_COUNT; ++iFrame)
+			vkCreateSharedBuffer(&lineRequest, &pCst->frames[iFrame].lineBuffer);
 	}
 
 	///
@@ -1131,7 +1557,7 @@ static void Allocate(const MxcCompositorCreateInfo* pInfo, MxcCompositor* pCst)
 		VkQueryPoolCreateInfo queryInfo = {
 			VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
 			.queryType  = VK_QUERY_TYPE_TIMESTAMP,
-			.queryCount = TIME_QUERY_COUNT,
+			.queryCount = TIME_QUERY_COUNT * MXC_COMPOSITOR_FRAME_COUNT,
 		};
 		VK_CHECK(vkCreateQueryPool(vk.context.device, &queryInfo, VK_ALLOC, &pCst->timeQryPool));
 
@@ -1139,11 +1565,12 @@ static void Allocate(const MxcCompositorCreateInfo* pInfo, MxcCompositor* pCst)
 			VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
 			.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT,
 			.maxSets = MXC_NODE_CAPACITY * 5,
-			.poolSizeCount = 3,
+			.poolSizeCount = 4,
 			.pPoolSizes = (VkDescriptorPoolSize[]){
-				{.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,         .descriptorCount = MXC_NODE_CAPACITY},
-				{.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = MXC_NODE_CAPACITY * 2},
+				{.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,         .descriptorCount = (MXC_NODE_CAPACITY + 1) * MXC_COMPOSITOR_FRAME_COUNT},
+				{.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = MXC_NODE_CAPACITY * 2 * MXC_COMPOSITOR_FRAME_COUNT},
 				{.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,          .descriptorCount = MXC_NODE_CAPACITY * 2},
+				{.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,         .descriptorCount = 3 * MXC_COMPOSITOR_FRAME_COUNT},
 			},
 		};
 		VK_CHECK(vkCreateDescriptorPool(vk.context.device, &poolInfo, VK_ALLOC, &threadContext.descriptorPool));
@@ -1151,14 +1578,14 @@ static void Allocate(const MxcCompositorCreateInfo* pInfo, MxcCompositor* pCst)
 
 	///
 	/// Global
-	{
-		vkAllocateDescriptorSet(threadContext.descriptorPool, &vk.context.globalSetLayout, &pCst->globalSet);
+	for (u32 iFrame = 0; iFrame < MXC_COMPOSITOR_FRAME_COUNT; ++iFrame) {
+		vkAllocateDescriptorSet(threadContext.descriptorPool, &vk.context.globalSetLayout, &pCst->frames[iFrame].globalSet);
 		VkRequestAllocationInfo requestInfo = {
 			.memoryPropertyFlags = VK_MEMORY_LOCAL_HOST_VISIBLE_COHERENT,
 			.size                = sizeof(VkGlobalSetState),
 			.usage               = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
 		};
-		vkCreateSharedBuffer(&requestInfo, &pCst->globalBuffer);
+		vkCreateSharedBuffer(&requestInfo, &pCst->frames[iFrame].globalBuffer);
 	}
 
 	///
@@ -1173,20 +1600,47 @@ static void Allocate(const MxcCompositorCreateInfo* pInfo, MxcCompositor* pCst)
 
 	///
 	/// Node Sets
-	vkCreateSharedBuffer(&(VkRequestAllocationInfo){
-			.memoryPropertyFlags = VK_MEMORY_LOCAL_HOST_VISIBLE_COHERENT,
-			.size = sizeof(MxcCompositorNodeSetState) * MXC_NODE_CAPACITY,
-			.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-		}, &cst.nodeSetBuffer);
-	VK_SET_DEBUG(cst.nodeSetBuffer.buffer);
+	for (u32 iFrame = 0; iFrame < MXC_COMPOSITOR_FRAME_COUNT; ++iFrame) {
+		MxcCompositorFrame* pFrame = &pCst->frames[iFrame];
+
+		vkCreateSharedBuffer(&(VkRequestAllocationInfo){
+				.memoryPropertyFlags = VK_MEMORY_LOCAL_HOST_VISIBLE_COHERENT,
+				.size = sizeof(MxcCompositorNodeSetState) * MXC_NODE_CAPACITY,
+				.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+			}, &pFrame->nodeSetBuffer);
+		VK_SET_DEBUG(pFrame->nodeSetBuffer.buffer);
+
+		vkCreateSharedBuffer(&(VkRequestAllocationInfo){
+				.memoryPropertyFlags = VK_MEMORY_LOCAL_HOST_VISIBLE_COHERENT,
+				.size = sizeof(u32) * MXC_NODE_CAPACITY * MXC_COMPOSITOR_MODE_COUNT,
+				.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			}, &pFrame->nodeIndicesBuffer);
+		VK_SET_DEBUG(pFrame->nodeIndicesBuffer.buffer);
+
+		vkCreateSharedBuffer(&(VkRequestAllocationInfo){
+				.memoryPropertyFlags = VK_MEMORY_LOCAL_HOST_VISIBLE_COHERENT,
+				.size = sizeof(MxcNodeCullState),
+				.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+			}, &pFrame->nodeCullBuffer);
+		VK_SET_DEBUG(pFrame->nodeCullBuffer.buffer);
+
+		if (pInfo->pEnabledCompositorModes[MXC_COMPOSITOR_MODE_COMPUTE]) {
+			vkCreateSharedBuffer(&(VkRequestAllocationInfo){
+					.memoryPropertyFlags = VK_MEMORY_LOCAL_HOST_VISIBLE_COHERENT,
+					.size = sizeof(u32) * GRID_TILE_CAPACITY * MXC_NODE_CAPACITY,
+					.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				}, &pFrame->nodeTileBuffer);
+			VK_SET_DEBUG(pFrame->nodeTileBuffer.buffer);
+		}
 
-	vkAllocateDescriptorSets(vk.context.device, &(VkDescriptorSetAllocateInfo){
-			VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
-			.descriptorPool     = threadContext.descriptorPool,
-			.descriptorSetCount = 1,
-			.pSetLayouts        = &pCst->nodeSetLayout,
-		}, &cst.nodeSet);
-	VK_SET_DEBUG(cst.nodeSet);
+		vkAllocateDescriptorSets(vk.context.device, &(VkDescriptorSetAllocateInfo){
+				VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+				.descriptorPool     = threadContext.descriptorPool,
+				.descriptorSetCount = 1,
+				.pSetLayouts        = &pCst->nodeSetLayout,
+			}, &pFrame->nodeSet);
+		VK_SET_DEBUG(pFrame->nodeSet);
+	}
 
 	// for (int i = 0; i < MXC_NODE_CAPACITY; ++i) {
 	// 	// Preallocate all Node Set buffers. MxcNodeCompositorSetState * 256 = 130 kb. Small price to pay to ensure contiguous memory on GPU
@@ -1218,10 +1672,8 @@ static void Allocate(const MxcCompositorCreateInfo* pInfo, MxcCompositor* pCst)
 		vkCreateDepthFramebufferTextures(&framebufferTextureInfo, &pCst->framebufferTexture);
 		VK_SET_DEBUG(pCst->framebufferTexture.color.view);
 		VK_SET_DEBUG(pCst->framebufferTexture.color.image);
-		VK_SET_DEBUG(pCst->framebufferTexture.color.memory);
 		VK_SET_DEBUG(pCst->framebufferTexture.depth.view);
 		VK_SET_DEBUG(pCst->framebufferTexture.depth.image);
-		VK_SET_DEBUG(pCst->framebufferTexture.depth.memory);
 	}
 
 	int arr[] = { 1, 2, 3};
@@ -1246,7 +1698,6 @@ static void Allocate(const MxcCompositorCreateInfo* pInfo, MxcCompositor* pCst)
 		vkCreateDedicatedTexture(&atomicCreateInfo, &pCst->compFrameAtomicTex);
 		VK_SET_DEBUG(pCst->compFrameAtomicTex.image);
 		VK_SET_DEBUG(pCst->compFrameAtomicTex.view);
-		VK_SET_DEBUG(pCst->compFrameAtomicTex.memory);
 
 		VkDedicatedTextureCreateInfo colorCreateInfo = {
 			.pImageCreateInfo =	&(VkImageCreateInfo){
@@ -1265,7 +1716,6 @@ static void Allocate(const MxcCompositorCreateInfo* pInfo, MxcCompositor* pCst)
 		vkCreateDedicatedTexture(&colorCreateInfo, &pCst->compFrameColorTex);
 		VK_SET_DEBUG(pCst->compFrameColorTex.image);
 		VK_SET_DEBUG(pCst->compFrameColorTex.view);
-		VK_SET_DEBUG(pCst->compFrameColorTex.memory);
 
 		VkDescriptorSetAllocateInfo setInfo = {
 			VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
@@ -1312,67 +1762,119 @@ static void Bind(const MxcCompositorCreateInfo* pInfo, MxcCompositor* pCst) {
 	if (pInfo->pEnabledCompositorModes[MXC_COMPOSITOR_MODE_TASK_MESH]) {}
 	if (pInfo->pEnabledCompositorModes[MXC_COMPOSITOR_MODE_COMPUTE]) {}
 
-	vkBindSharedBuffer(&pCst->lineBuffer);
-	pCst->pLineMapped = vkSharedBufferPtr(pCst->lineBuffer);
+	for (u32 iFrame = 0; iFrame < MXC_COMPOSITOR_FRAME_COUNT; ++iFrame) {
+		MxcCompositorFrame* pFrame = &pCst->frames[iFrame];
 
-	vkBindSharedBuffer(&pCst->globalBuffer);
-	VK_UPDATE_DESCRIPTOR_SETS(VK_BIND_WRITE_GLOBAL_BUFFER(pCst->globalSet, pCst->globalBuffer.buffer));
+		vkBindSharedBuffer(&pFrame->lineBuffer);
+		pFrame->pLineMapped = vkSharedBufferPtr(pFrame->lineBuffer);
 
-	vkBindSharedBuffer(&cst.nodeSetBuffer);
-	cst.pNodeSetMapped = vkSharedBufferPtr(cst.nodeSetBuffer);
-	memset(cst.pNodeSetMapped, 0, sizeof(MxcCompositorNodeSetState) * MXC_NODE_CAPACITY);
+		vkBindSharedBuffer(&pFrame->globalBuffer);
+		VK_UPDATE_DESCRIPTOR_SETS(VK_BIND_WRITE_GLOBAL_BUFFER(pFrame->globalSet, pFrame->globalBuffer.buffer));
 
-	VkDescriptorBufferInfo bufferInfos[MXC_NODE_CAPACITY];
-	VkDescriptorImageInfo  colorInfos[MXC_NODE_CAPACITY];
-	VkDescriptorImageInfo  gbufferInfos[MXC_NODE_CAPACITY];
+		vkBindSharedBuffer(&pFrame->nodeSetBuffer);
+		pFrame->pNodeSetMapped = vkSharedBufferPtr(pFrame->nodeSetBuffer);
+		memset(pFrame->pNodeSetMapped, 0, sizeof(MxcCompositorNodeSetState) * MXC_NODE_CAPACITY);
 
-	for (int i = 0; i < MXC_NODE_CAPACITY; ++i) {
-		bufferInfos[i] = (VkDescriptorBufferInfo){
-			.buffer      = cst.nodeSetBuffer.buffer,
-			.offset      = i * sizeof(MxcCompositorNodeSetState),
-			.range       = sizeof(MxcCompositorNodeSetState),
-		};
-		colorInfos[i] = (VkDescriptorImageInfo){
-			.sampler     = vk.context.nearestSampler,
-			.imageView   = VK_NULL_HANDLE,
-			.imageLayout = VK_IMAGE_LAYOUT_GENERAL,
-		};
-		gbufferInfos[i] = (VkDescriptorImageInfo){
-			.sampler     = vk.context.nearestSampler,
-			.imageView   = VK_NULL_HANDLE,
-			.imageLayout = VK_IMAGE_LAYOUT_GENERAL,
-		};
-	}
+		vkBindSharedBuffer(&pFrame->nodeIndicesBuffer);
 
-	VK_UPDATE_DESCRIPTOR_SETS2({
-		{
-			VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-			.dstSet = cst.nodeSet,
-			.dstBinding = SET_BIND_INDEX_NODE_STATE,
-			.dstArrayElement = 0,
-			.descriptorCount = MXC_NODE_CAPACITY,
-			.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-			.pBufferInfo = bufferInfos,
-		},
-		{
-			VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-			.dstSet = cst.nodeSet,
-			.dstBinding = SET_BIND_INDEX_NODE_COLOR,
-			.dstArrayElement = 0,
-			.descriptorCount = MXC_NODE_CAPACITY,
-			.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-			.pImageInfo = colorInfos,
-		},
-		{
-			VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-			.dstSet = cst.nodeSet,
-			.dstBinding = SET_BIND_INDEX_NODE_GBUFFER,
-			.dstArrayElement = 0,
-			.descriptorCount = MXC_NODE_CAPACITY,
-			.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-			.pImageInfo = gbufferInfos,
-		},
-	});
+		vkBindSharedBuffer(&pFrame->nodeCullBuffer);
+		pFrame->pNodeCullMapped = vkSharedBufferPtr(pFrame->nodeCullBuffer);
+		memset(pFrame->pNodeCullMapped, 0, sizeof(MxcNodeCullState));
+
+		VkDescriptorBufferInfo bufferInfos[MXC_NODE_CAPACITY];
+		VkDescriptorImageInfo  colorInfos[MXC_NODE_CAPACITY];
+		VkDescriptorImageInfo  gbufferInfos[MXC_NODE_CAPACITY];
+
+		for (int i = 0; i < MXC_NODE_CAPACITY; ++i) {
+			bufferInfos[i] = (VkDescriptorBufferInfo){
+				.buffer      = pFrame->nodeSetBuffer.buffer,
+				.offset      = i * sizeof(MxcCompositorNodeSetState),
+				.range       = sizeof(MxcCompositorNodeSetState),
+			};
+			colorInfos[i] = (VkDescriptorImageInfo){
+				.sampler     = vk.context.nearestSampler,
+				.imageView   = VK_NULL_HANDLE,
+				.imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+			};
+			gbufferInfos[i] = (VkDescriptorImageInfo){
+				.sampler     = vk.context.nearestSampler,
+				.imageView   = VK_NULL_HANDLE,
+				.imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+			};
+		}
+
+		VK_UPDATE_DESCRIPTOR_SETS2({
+			{
+				VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+				.dstSet = pFrame->nodeSet,
+				.dstBinding = SET_BIND_INDEX_NODE_STATE,
+				.dstArrayElement = 0,
+				.descriptorCount = MXC_NODE_CAPACITY,
+				.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+				.pBufferInfo = bufferInfos,
+			},
+			{
+				VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+				.dstSet = pFrame->nodeSet,
+				.dstBinding = SET_BIND_INDEX_NODE_COLOR,
+				.dstArrayElement = 0,
+				.descriptorCount = MXC_NODE_CAPACITY,
+				.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+				.pImageInfo = colorInfos,
+			},
+			{
+				VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+				.dstSet = pFrame->nodeSet,
+				.dstBinding = SET_BIND_INDEX_NODE_GBUFFER,
+				.dstArrayElement = 0,
+				.descriptorCount = MXC_NODE_CAPACITY,
+				.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+				.pImageInfo = gbufferInfos,
+			},
+			{
+				VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+				.dstSet = pFrame->nodeSet,
+				.dstBinding = SET_BIND_INDEX_NODE_INDICES,
+				.dstArrayElement = 0,
+				.descriptorCount = 1,
+				.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				.pBufferInfo = &(VkDescriptorBufferInfo){
+					.buffer = pFrame->nodeIndicesBuffer.buffer,
+					.range  = VK_WHOLE_SIZE,
+				},
+			},
+			{
+				VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+				.dstSet = pFrame->nodeSet,
+				.dstBinding = SET_BIND_INDEX_NODE_CULL,
+				.dstArrayElement = 0,
+				.descriptorCount = 1,
+				.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				.pBufferInfo = &(VkDescriptorBufferInfo){
+					.buffer = pFrame->nodeCullBuffer.buffer,
+					.range  = VK_WHOLE_SIZE,
+				},
+			},
+		});
+
+		if (pInfo->pEnabledCompositorModes[MXC_COMPOSITOR_MODE_COMPUTE]) {
+			vkBindSharedBuffer(&pFrame->nodeTileBuffer);
+			VK_UPDATE_DESCRIPTOR_SETS2({
+				{
+					VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+					.dstSet = pFrame->nodeSet,
+					.dstBinding = SET_BIND_INDEX_NODE_TILES,
+					.dstArrayElement = 0,
+					.descriptorCount = 1,
+					.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+					.pBufferInfo = &(VkDescriptorBufferInfo){
+						.buffer = pFrame->nodeTileBuffer.buffer,
+						.range  = VK_WHOLE_SIZE,
+					},
+				},
+			});
+		}
+	}
 }
 
 static void* CompositorThread(void* pData)
@@ -1390,8 +1892,12 @@ static void* CompositorThread(void* pData)
 	Allocate(&info, &cst);
 	vkEndAllocationRequests();
 	Bind(&info, &cst);
+	// Meshes staged by Allocate and Bind go to the transfer queue as one batch
+	vkWaitStagingUpload(vkFlushStagingUploads());
 
 	CompositorRun(&compositorContext, &cst);
+
+	vkDestroyThreadContext();
 	return NULL;
 }
 
@@ -1405,6 +1911,18 @@ void mxcCreateAndRunCompositorThread(VkSurfaceKHR surface)
 	compositorContext.timelineHandle = vkGetSemaphoreExternalHandle(compositorContext.timeline);
 	VK_SET_DEBUG(compositorContext.timeline);
 
+	vkCreateSemaphoreExt(&(vkSemaphoreCreateInfoExt){
+		.locality = VK_LOCALITY_CONTEXT,
+		.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+	}, &compositorContext.frameTimeline);
+	VK_SET_DEBUG(compositorContext.frameTimeline);
+
+	vkCreateSemaphoreExt(&(vkSemaphoreCreateInfoExt){
+		.locality = VK_LOCALITY_CONTEXT,
+		.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+	}, &compositorContext.processTimeline);
+	VK_SET_DEBUG(compositorContext.processTimeline);
+
 	vkCreateSwapContext(surface, VK_QUEUE_FAMILY_TYPE_MAIN_GRAPHICS, &compositorContext.swapCtx);
 
 	VkCommandPoolCreateInfo graphicsCommandPoolCreateInfo = {
@@ -1419,8 +1937,37 @@ void mxcCreateAndRunCompositorThread(VkSurfaceKHR surface)
 		.commandPool = compositorContext.gfxPool,
 		.commandBufferCount = 1,
 	};
-	VK_CHECK(vkAllocateCommandBuffers(vk.context.device, &commandBufferAllocateInfo, &compositorContext.gfxCmd));
-	VK_SET_DEBUG(compositorContext.gfxCmd);
+	for (u32 iFrame = 0; iFrame < MXC_COMPOSITOR_FRAME_COUNT; ++iFrame) {
+		VK_CHECK(vkAllocateCommandBuffers(vk.context.device, &commandBufferAllocateInfo, &compositorContext.gfxCmds[iFrame]));
+		VK_SET_DEBUG(compositorContext.gfxCmds[iFrame]);
+	}
+
+	VK_CHECK(vkCreateCommandPool(vk.context.device, &(VkCommandPoolCreateInfo){
+		VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+		.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+		.queueFamilyIndex = vk.context.queueFamilies[VK_QUEUE_FAMILY_TYPE_DEDICATED_COMPUTE].index,
+	}, VK_ALLOC, &compositorContext.processPool));
+	VK_SET_DEBUG(compositorContext.processPool);
+	for (u32 iFrame = 0; iFrame < MXC_COMPOSITOR_FRAME_COUNT; ++iFrame) {
+		VK_CHECK(vkAllocateCommandBuffers(vk.context.device, &(VkCommandBufferAllocateInfo){
+			VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+			.commandPool = compositorContext.processPool,
+			.commandBufferCount = 1,
+		}, &compositorContext.processCmds[iFrame]));
+		VK_SET_DEBUG(compositorContext.processCmds[iFrame]);
+	}
+
+	MxcCompositeCmd* pCompositeCmds = &compositorContext.compositeCmds[0][0];
+	for (u32 iCmd = 0; iCmd < sizeof(compositorContext.compositeCmds) / sizeof(MxcCompositeCmd); ++iCmd) {
+		VK_CHECK(vkAllocateCommandBuffers(vk.context.device, &commandBufferAllocateInfo, &pCompositeCmds[iCmd].cmd));
+		VK_SET_DEBUG(pCompositeCmds[iCmd].cmd);
+	}
+
+	MxcBlitCmd* pBlitCmds = &compositorContext.blitCmds[0][0][0][0];
+	for (u32 iCmd = 0; iCmd < sizeof(compositorContext.blitCmds) / sizeof(MxcBlitCmd); ++iCmd) {
+		VK_CHECK(vkAllocateCommandBuffers(vk.context.device, &commandBufferAllocateInfo, &pBlitCmds[iCmd].cmd));
+		VK_SET_DEBUG(pBlitCmds[iCmd].cmd);
+	}
 
 	CHECK(pthread_create(&compositorContext.threadId, NULL, (void* (*)(void*))CompositorThread, NULL), "Compositor Node thread creation failed!");
 
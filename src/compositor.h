@@ -17,13 +17,28 @@ typedef struct MxcCompositorNodeData {
 
 	u64 lastTimelineValue;
 
+	// Node swap views acquired at lastTimelineValue and the node timeline value each frame's node set holds
+	VkImageView   colorView;
+	VkImageView   gbufferView;
+	VkImageLayout viewLayout;
+	u64           frameTimelineValues[MXC_COMPOSITOR_FRAME_COUNT];
+
+	// What the node looked like when last composited. Any change damages the clip rect it covered and the one it covers now.
+	struct {
+		MidPose                 rootPose;
+		MxcNodeInteractionState interactionState;
+		MxcClip                 clip;
+	} composited;
+
 	// NodeSet which node is actively using to render
 	MxcCompositorNodeSetState renderingNodeSetState;
 	MxcCompositorNodeSetState compositingNodeSetState;
 
 	MxcNodeSwap swaps[XR_SWAPCHAIN_CAPACITY][XR_SWAPCHAIN_IMAGE_COUNT];
 
-	MxcNodeGBuffer gbuffer[XR_MAX_VIEW_COUNT];
+	// Gbuffer the next new node frame is processed into
+	u8             iGBuffer;
+	MxcNodeGBuffer gbuffer[MXC_NODE_GBUFFER_COUNT][XR_MAX_VIEW_COUNT];
 
 	// this should go a UI thread node
 	VkLineVert worldLineSegments[MXC_CUBE_SEGMENT_COUNT];
@@ -32,6 +47,46 @@ typedef struct MxcCompositorNodeData {
 
 } MxcCompositorNodeData;
 
+// Indirect commands the cull prepass appends visible nodes to. Layout mirrored in compute_compositor_binding.glsl
+typedef struct MxcNodeIndirect {
+	VkDrawIndexedIndirectCommand      quad;
+	VkDrawIndexedIndirectCommand      tess;
+	VkDrawMeshTasksIndirectCommandEXT taskMesh;
+	VkDispatchIndirectCommand         compute;      // y window tile count, z visible node count. Input to binning
+	VkDispatchIndirectCommand         computeTiles; // y node tiles binned by compositor_node_bin.comp
+} MxcNodeIndirect;
+
+typedef struct MxcNodeCullState {
+	MxcNodeIndirect indirect;
+	u32             activeCounts[MXC_COMPOSITOR_MODE_COUNT];
+	u32             damageTiles[4]; // First damaged tile xy, one past the last zw
+	u32             activeNodeIndices[MXC_COMPOSITOR_MODE_COUNT * MXC_NODE_CAPACITY];
+} MxcNodeCullState;
+
+// Everything the host writes or the GPU rebuilds each cycle. Ringed so recording a cycle
+// never touches what a composite still in flight reads.
+typedef struct MxcCompositorFrame {
+	VkSharedBuffer  globalBuffer;
+	VkDescriptorSet globalSet;
+
+	MxcCompositorNodeSetState* pNodeSetMapped;
+	VkSharedBuffer             nodeSetBuffer;
+	VkDescriptorSet            nodeSet;
+
+	// Node index of each drawn instance, MXC_NODE_CAPACITY per compositor mode. Written by the cull prepass.
+	VkSharedBuffer nodeIndicesBuffer;
+
+	// Active nodes read by the cull prepass and the indirect commands it writes. Rebuilt each frame from node.active.
+	MxcNodeCullState* pNodeCullMapped;
+	VkSharedBuffer    nodeCullBuffer;
+
+	// Tile and node of each compute compositor workgroup. Only allocated for MXC_COMPOSITOR_MODE_COMPUTE.
+	VkSharedBuffer nodeTileBuffer;
+
+	VkSharedBuffer lineBuffer;
+	VkLineVert*    pLineMapped;
+} MxcCompositorFrame;
+
 typedef struct MxcCompositor {
 
 	MxcCompositorNodeData nodeData[MXC_NODE_CAPACITY];
@@ -45,19 +100,17 @@ typedef struct MxcCompositor {
 
 	VkDescriptorSetLayout compOutputSetLayout;
 	VkPipelineLayout      compPipeLayout;
+	VkPipeline            compBinPipe;
 	VkPipeline            compPipe;
 	VkPipeline            postCompPipe;
 
+	VkPipeline            nodeCullPipe;
+
 	VkDescriptorSetLayout finalBlitSetLayout;
 	VkPipelineLayout      finalBlitPipeLayout;
 	VkPipeline            finalBlitPipe;
 
-	VkSharedBuffer  globalBuffer;
-	VkDescriptorSet globalSet;
-
-	MxcCompositorNodeSetState* pNodeSetMapped;
-	VkSharedBuffer             nodeSetBuffer;
-	VkDescriptorSet            nodeSet;
+	MxcCompositorFrame frames[MXC_COMPOSITOR_FRAME_COUNT];
 
 	VkMesh       quadMesh;
 	VkSharedMesh quadPatchMesh;
@@ -68,31 +121,71 @@ typedef struct MxcCompositor {
 	VkDedicatedTexture compFrameColorTex;
 	VkDescriptorSet    compOutputSet;
 
+	// TIME_QUERY_COUNT queries per frame
 	VkQueryPool timeQryPool;
 
-	VkSharedBuffer lineBuffer;
-	int            lineCapacity;
-	VkLineVert*    pLineMapped;
+	int lineCapacity;
 
 	struct {
-		BLOCK_T_N(MxcSwapTexture, MXC_NODE_CAPACITY) swap;
+		BLOCK32_T_N(MxcSwapTexture, MXC_NODE_CAPACITY) swap;
 	} block;
 
 } MxcCompositor;
 
 // Should CompositorContext and Compositor merge into one!? probably
 
+#define MXC_COMPOSITE_CMD_CAPACITY     8
+#define MXC_COMPOSITOR_SUBMIT_CAPACITY 3
+
+// Everything a recorded composite depends on. Zeroed before filling so it compares with memcmp.
+typedef struct MxcCompositeCmdKey {
+	u16      activeNodeCts[MXC_COMPOSITOR_MODE_COUNT];
+	bool     damageAll;
+	VkRect2D damageArea;
+	ivec2    windowExtent;
+} MxcCompositeCmdKey;
+
+typedef struct MxcCompositeCmd {
+	VkCommandBuffer    cmd;
+	MxcCompositeCmdKey key;
+	u64                lastUsedCycle;
+	bool               isRecorded;
+} MxcCompositeCmd;
+
+// Swap blit for one swap image and framebuffer combination. Rerecorded when windowExtent changes.
+typedef struct MxcBlitCmd {
+	VkCommandBuffer cmd;
+	ivec2           windowExtent;
+} MxcBlitCmd;
+
 typedef struct MxcCompositorContext {
 	// read by multiple threads
-	VkCommandBuffer gfxCmd;
+	VkCommandBuffer submitCmds[MXC_COMPOSITOR_SUBMIT_CAPACITY];
+	u32             submitCmdCt;
 	u64             baseCycleValue;
 	VkSemaphore     timeline;
 	VkSwapContext   swapCtx;
 
+	// Signalled by the GPU with the baseCycleValue each composite was submitted for
+	VkSemaphore frameTimeline;
+
+	// Gbuffer processing for new node frames, submitted to the dedicated compute queue ahead of the
+	// composite which waits on processTimeline. VK_NULL_HANDLE when no node had a new frame.
+	VkCommandBuffer processCmd;
+	VkSemaphore     processTimeline;
+
 	// cold data
 	VkCommandPool gfxPool;
+	VkCommandPool processPool;
 	pthread_t     threadId;
 
+	// Per frame so a command buffer is never resubmitted while still pending
+	VkCommandBuffer gfxCmds[MXC_COMPOSITOR_FRAME_COUNT];
+	VkCommandBuffer processCmds[MXC_COMPOSITOR_FRAME_COUNT];
+	MxcCompositeCmd compositeCmds[MXC_COMPOSITOR_FRAME_COUNT][MXC_COMPOSITE_CMD_CAPACITY];
+	// Indexed by frame, swap image, then whether the graphics and compute framebuffers are blit
+	MxcBlitCmd      blitCmds[MXC_COMPOSITOR_FRAME_COUNT][VK_SWAP_COUNT][2][2];
+
 	HANDLE timelineHandle;
 
 	_Atomic bool isReady;
@@ -9,6 +9,14 @@
 #include "mid_vulkan.h"
 #include "mid_window.h"
 
+// Thread nodes started with the compositor when TEST_NODE is defined
+#ifndef MXC_TEST_NODE_COUNT
+#define MXC_TEST_NODE_COUNT 2
+#endif
+
+// Cycles per log of main thread time
+#define MXC_MAIN_STATS_LOG_INTERVAL 256
+
 MxcView compositorView = MXC_VIEW_STEREO;
 bool isCompositor = true;
 _Atomic bool isRunning = true;
@@ -76,13 +84,13 @@ int main(void)
 
 #define TEST_NODE
 #ifdef TEST_NODE
-		node_h hTestNode; mxcRequestNodeThread(mxcRunNodeThread, &hTestNode);
-		MxcNodeShared* pTestNodeShrd = ARRAY_H(node.pShared, hTestNode);
-		pTestNodeShrd->compositorCycleSkip = 8;
-
-		node_h hTestNode2; mxcRequestNodeThread(mxcRunNodeThread, &hTestNode2);
-        MxcNodeShared* pTestNode2Shrd = ARRAY_H(node.pShared, hTestNode2);
-        pTestNode2Shrd->compositorCycleSkip = 24;
+		// Raise to load the compositor with many thread nodes, alternating between the two cycle skips
+		static_assert(MXC_TEST_NODE_COUNT <= MXC_NODE_CAPACITY, "More test nodes than the compositor can hold.");
+		for (int i = 0; i < MXC_TEST_NODE_COUNT; ++i) {
+			node_h hTestNode; mxcRequestNodeThread(mxcRunNodeThread, &hTestNode);
+			MxcNodeShared* pTestNodeShrd = ARRAY_H(node.pShared, hTestNode);
+			pTestNodeShrd->compositorCycleSkip = i % 2 ? 24 : 8;
+		}
 #endif
 
 #elif defined(MOXAIC_NODE)
@@ -99,15 +107,26 @@ int main(void)
 
 		VkDevice device = vk.context.device;
 		VkQueue  graphicsQueue = vk.context.queueFamilies[VK_QUEUE_FAMILY_TYPE_MAIN_GRAPHICS].queue;
+		VkQueue  computeQueue = vk.context.queueFamilies[VK_QUEUE_FAMILY_TYPE_DEDICATED_COMPUTE].queue;
+
+		// Main thread time per cycle outside the cycle waits, and how much of it draining queued command buffers takes
+		u64 mainBusyUs = 0;
+		u64 mainSubmitUs = 0;
+		u32 mainStatsCt = 0;
 		while (isRunning) {
 
 			/* MXC_CYCLE_UPDATE_WINDOW_STATE */
 			vkTimelineWait(device, compositorContext.baseCycleValue + MXC_CYCLE_UPDATE_WINDOW_STATE, compositorContext.timeline);
+			// Nothing composited so hold the cycle until a node sends IPC, window input is still pumped every MXC_NODE_IDLE_WAIT_MS.
+			mxcNodeInterprocessWait(MXC_NODE_IDLE_WAIT_MS);
+			u64 busyBeginUs = midQueryPerformanceCounter();
 			ATOMIC_FENCE_SCOPE {
 				// This needs to be after a wait, and before a signal, as it will poll the IPC Message queue
 				// and those may make changes to active nodes, or other, which subsequent states will rely on
 				mxcNodeInterprocessPoll();
+				u64 submitBeginUs = midQueryPerformanceCounter();
 				vkSubmitQueuedCommandBuffers();
+				mainSubmitUs += midQueryPerformanceCounter() - submitBeginUs;
 
 				midUpdateWindowInput();
 				mxcProcessWindowInput();
@@ -115,6 +134,7 @@ int main(void)
 			}
 
 			vkTimelineSignal(device, compositorContext.baseCycleValue + MXC_CYCLE_PROCESS_INPUT, compositorContext.timeline);
+			mainBusyUs += midQueryPerformanceCounter() - busyBeginUs;
 			/* MXC_CYCLE_PROCESS_INPUT */
 
 			/* MXC_CYCLE_UPDATE_NODE_STATES */
@@ -123,16 +143,53 @@ int main(void)
 
 			/* MXC_CYCLE_RENDER_COMPOSITE */
 			vkTimelineWait(device, compositorContext.baseCycleValue + MXC_CYCLE_RENDER_COMPOSITE, compositorContext.timeline);
+			busyBeginUs = midQueryPerformanceCounter();
 			ATOMIC_FENCE_SCOPE {
 				atomic_thread_fence(memory_order_acquire);
 				compositorContext.baseCycleValue += MXC_CYCLE_COUNT;
+
+				// Gbuffer processing goes to the compute queue first. The composite only waits on it where gbuffers are read.
+				VkSemaphore processTimeline = VK_NULL_HANDLE;
+				if (compositorContext.processCmd != VK_NULL_HANDLE) {
+					processTimeline = compositorContext.processTimeline;
+					CmdSubmit(compositorContext.processCmd, computeQueue, processTimeline, compositorContext.baseCycleValue);
+				}
+
 				CmdSubmitPresent(
-						compositorContext.gfxCmd,
+						compositorContext.submitCmdCt,
+						compositorContext.submitCmds,
 						VK_QUEUE_FAMILY_TYPE_MAIN_GRAPHICS,
 						compositorContext.swapCtx,
-						compositorContext.timeline,
-						compositorContext.baseCycleValue + MXC_CYCLE_UPDATE_WINDOW_STATE);
+						processTimeline,
+						compositorContext.baseCycleValue,
+						VK_PIPELINE_STAGE_2_VERTEX_INPUT_BIT |
+						VK_PIPELINE_STAGE_2_TESSELLATION_CONTROL_SHADER_BIT |
+						VK_PIPELINE_STAGE_2_TESSELLATION_EVALUATION_SHADER_BIT |
+						VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT |
+						VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+						compositorContext.frameTimeline,
+						compositorContext.baseCycleValue);
+				u64 submitBeginUs = midQueryPerformanceCounter();
 				vkSubmitQueuedCommandBuffers();
+				u64 submitEndUs = midQueryPerformanceCounter();
+				mainSubmitUs += submitEndUs - submitBeginUs;
+				mainBusyUs += submitEndUs - busyBeginUs;
+				if (++mainStatsCt == MXC_MAIN_STATS_LOG_INTERVAL) {
+					LOG("Main %.3fms per cycle, queued submit %.3fms, nodes %d\n",
+					    (double)mainBusyUs / 1000.0 / mainStatsCt,
+					    (double)mainSubmitUs / 1000.0 / mainStatsCt,
+					    BLOCK_COUNT(node.context));
+					mainBusyUs = 0;
+					mainSubmitUs = 0;
+					mainStatsCt = 0;
+				}
+
+				// Next cycle can begin once the composite last submitted with its frame is done,
+				// leaving MXC_COMPOSITOR_FRAME_COUNT - 1 composites running behind recording.
+				u64 frameLag = (MXC_COMPOSITOR_FRAME_COUNT - 1) * MXC_CYCLE_COUNT;
+				if (compositorContext.baseCycleValue > frameLag)
+					vkTimelineWait(device, compositorContext.baseCycleValue - frameLag, compositorContext.frameTimeline);
+				vkTimelineSignal(device, compositorContext.baseCycleValue + MXC_CYCLE_UPDATE_WINDOW_STATE, compositorContext.timeline);
 			}
 
 		}
@@ -147,9 +204,9 @@ int main(void)
 			midUpdateWindowInput();
 			isRunning = midWindow.running;
 
-			// I guess technically we just want to go as fast as possible in a node, but we would probably need to process and send input here first at some point?
-			// we probably want to signal and wait on semaphore here
-			// but we don't want this running if we aren't even using vulkan!
+			// Sleep until a thread enqueues command buffers rather than spin.
+			// Window input still gets pumped every MXC_NODE_IDLE_WAIT_MS when idle.
+			vkWaitQueuedCommandBuffers(MXC_NODE_IDLE_WAIT_MS);
 			vkSubmitQueuedCommandBuffers();
 		}
 
@@ -168,5 +225,10 @@ int main(void)
 	mxcShutdownInterprocessNode();
 #endif
 
+	vkDeviceWaitIdle(vk.context.device);
+	vkSavePipelineCache();
+	vkLogMemoryStats();
+	vkDestroyMemoryBlocks();
+
 	return EXIT_SUCCESS;
 }
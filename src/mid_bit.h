@@ -1,6 +1,7 @@
 #pragma once
 
 #include <limits.h>
+#include <stdint.h>
 
 typedef unsigned char bitset_t;
 
@@ -49,12 +50,95 @@ static_assert(sizeof(bitset512_t) == 64, "");
 #define BIT_COUNT_ONES(_) __builtin_popcount(_)
 #endif
 
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "Word scans rely on bit i of a bitset being bit i of its words.");
+
+typedef uint64_t bitword_t;
+#define BITWORD_SIZE sizeof(bitword_t)
+#define BITWORD_BIT  (BITWORD_SIZE * CHAR_BIT)
+
+// Chunks of words tested at once before scanning into the words. 256 with AVX2, otherwise 128.
+#ifdef __AVX2__
+#define BITCHUNK_SIZE 32
+#else
+#define BITCHUNK_SIZE 16
+#endif
+typedef bitword_t bitchunk_t __attribute__((vector_size(BITCHUNK_SIZE), aligned(1)));
+#define BITCHUNK_WORDS (BITCHUNK_SIZE / BITWORD_SIZE)
+
+#ifdef MID_IDE_ANALYSIS
+#define TRAILING_ZEROS_WORD(_) 0
+#define BIT_COUNT_ONES_WORD(_) 0
+#else
+#define TRAILING_ZEROS_WORD(_) ((int)__builtin_ctzll(_))
+#define BIT_COUNT_ONES_WORD(_) __builtin_popcountll(_)
+#endif
+
+// True if every bit in the chunk equals every bit in _fill. Vector compare then reduce the lanes.
+static inline bool BitChunkAll(const bitset_t* pChunk, bitword_t fill)
+{
+	bitchunk_t chunk = *(const bitchunk_t*)pChunk;
+	bitchunk_t eq = chunk == fill;
+	bitword_t all = eq[0];
+	for (int i = 1; i < (int)BITCHUNK_WORDS; ++i) all &= eq[i];
+	return all != 0;
+}
+
+/*
+ * Scans take byteCapacity as sizeof the bitset so after inlining the path is picked at compile time.
+ * Chunk path for sizes that are a multiple of BITCHUNK_SIZE, word path for multiples of 8, otherwise bytes.
+ * _invert is ~0 to scan for zeros, 0 to scan for ones.
+ */
+static inline int BitScanFirst(int byteCapacity, const bitset_t* pSet, bitword_t invert, int startBit)
+{
+	if (byteCapacity % BITWORD_SIZE == 0) {
+		int wordCount = byteCapacity / BITWORD_SIZE;
+		const bitword_t* pWords = (const bitword_t*)pSet;
+		int iWord = startBit / BITWORD_BIT;
+		if (iWord >= wordCount) return -1;
+
+		// Mask off bits before startBit in the first word.
+		bitword_t word = (pWords[iWord] ^ invert) & (~(bitword_t)0 << (startBit % BITWORD_BIT));
+		if (word != 0) return TRAILING_ZEROS_WORD(word) + (iWord * BITWORD_BIT);
+		iWord++;
+
+		if (byteCapacity % BITCHUNK_SIZE == 0) {
+			for (; iWord < wordCount && iWord % BITCHUNK_WORDS != 0; ++iWord) {
+				word = pWords[iWord] ^ invert;
+				if (word != 0) return TRAILING_ZEROS_WORD(word) + (iWord * BITWORD_BIT);
+			}
+			for (; iWord < wordCount; iWord += BITCHUNK_WORDS)
+				if (!BitChunkAll((const bitset_t*)&pWords[iWord], invert)) break;
+		}
+
+		for (; iWord < wordCount; ++iWord) {
+			word = pWords[iWord] ^ invert;
+			if (word != 0) return TRAILING_ZEROS_WORD(word) + (iWord * BITWORD_BIT);
+		}
+		return -1;
+	}
+
+	for (int i = startBit / CHAR_BIT; i < byteCapacity; ++i) {
+		unsigned int byte = (pSet[i] ^ (bitset_t)invert) & 0xFF;
+		if (i == startBit / CHAR_BIT) byte &= 0xFFu << (startBit % CHAR_BIT);
+		if (byte != 0) return __builtin_ctz(byte) + (i * CHAR_BIT);
+	}
+	return -1;
+}
+
 static inline int BitScanFirstZero(int byteCapacity, bitset_t* pSet)
 {
-	int i = 0;
-	for (; i < byteCapacity; ++i)
-		if (pSet[i] != 0xFF) break;
-	return i == byteCapacity ? -1 : TRAILING_ONES(pSet[i]) + (i * CHAR_BIT);
+	return BitScanFirst(byteCapacity, pSet, ~(bitword_t)0, 0);
+}
+
+static inline int BitScanFirstOne(int byteCapacity, bitset_t* pSet)
+{
+	return BitScanFirst(byteCapacity, pSet, 0, 0);
+}
+
+// First one at or after startBit, -1 if none.
+static inline int BitScanNextOne(int byteCapacity, bitset_t* pSet, int startBit)
+{
+	return BitScanFirst(byteCapacity, pSet, 0, startBit);
 }
 
 static inline int BitClaimFirstZero(int byteCapacity, bitset_t* pSet)
@@ -64,13 +148,66 @@ static inline int BitClaimFirstZero(int byteCapacity, bitset_t* pSet)
 	return i;
 }
 
+/*
+ * Atomic claim and clear so threads can share a set without a lock. Word sized sets use word atomics,
+ * smaller sets use byte atomics. Don't mix these with the plain BITSET/BITCLEAR on the same set.
+ * Claim is acquire and clear is release so writes made while a bit was held are seen by its next owner.
+ */
+static inline int BitClaimFirstZeroAtomic(int byteCapacity, bitset_t* pSet)
+{
+	if (byteCapacity % BITWORD_SIZE == 0) {
+		bitword_t* pWords = (bitword_t*)pSet;
+		for (int iWord = 0; iWord < byteCapacity / (int)BITWORD_SIZE; ++iWord) {
+			bitword_t word = __atomic_load_n(&pWords[iWord], __ATOMIC_RELAXED);
+			while (word != ~(bitword_t)0) {
+				bitword_t bit = ~word & (word + 1);
+				word = __atomic_fetch_or(&pWords[iWord], bit, __ATOMIC_ACQUIRE);
+				if (!(word & bit)) return TRAILING_ZEROS_WORD(bit) + (iWord * BITWORD_BIT);
+			}
+		}
+		return -1;
+	}
+
+	for (int i = 0; i < byteCapacity; ++i) {
+		bitset_t byte = __atomic_load_n(&pSet[i], __ATOMIC_RELAXED);
+		while (byte != 0xFF) {
+			bitset_t bit = ~byte & (byte + 1);
+			byte = __atomic_fetch_or(&pSet[i], bit, __ATOMIC_ACQUIRE);
+			if (!(byte & bit)) return __builtin_ctz(bit) + (i * CHAR_BIT);
+		}
+	}
+	return -1;
+}
+
+static inline void BitClearAtomic(int byteCapacity, bitset_t* pSet, int bit)
+{
+	if (byteCapacity % BITWORD_SIZE == 0) {
+		bitword_t* pWords = (bitword_t*)pSet;
+		__atomic_fetch_and(&pWords[bit / BITWORD_BIT], ~((bitword_t)1 << (bit % BITWORD_BIT)), __ATOMIC_RELEASE);
+		return;
+	}
+	__atomic_fetch_and(&pSet[BITSLOT(bit)], (bitset_t)~BITMASK(bit), __ATOMIC_RELEASE);
+}
+
 static inline int BitCountOnes(int byteCapacity, bitset_t* pSet)
 {
 	int count = 0;
+	if (byteCapacity % BITWORD_SIZE == 0) {
+		const bitword_t* pWords = (const bitword_t*)pSet;
+		for (int i = 0; i < byteCapacity / (int)BITWORD_SIZE; ++i)
+			count += BIT_COUNT_ONES_WORD(pWords[i]);
+		return count;
+	}
+
 	for (int i = 0; i < byteCapacity; ++i)
 		count += BIT_COUNT_ONES(pSet[i]);
 	return count;
 }
 
+// Iterate the index of every set bit in order.
+#define BIT_FOR_EACH_ONE(_byteCapacity, _pSet, _i)                    \
+	for (int _i = BitScanNextOne(_byteCapacity, _pSet, 0); _i != -1; \
+		 _i = BitScanNextOne(_byteCapacity, _pSet, _i + 1))
+
 //typedef unsigned char nibset_t;
 //#define NIBSET_DECL
\ No newline at end of file
@@ -16,14 +16,14 @@ typedef block_handle block_h; // TODO lets go to this
 #define HANDLE_INDEX_MASK      0x0FFF
 #define HANDLE_INDEX_MAX       ((1u << HANDLE_INDEX_BIT_COUNT) - 1)
 
-#define HANDLE_INDEX(handle)            (handle & HANDLE_INDEX_MASK)
+#define HANDLE_INDEX(handle)            ((int)(HANDLE_BITS(handle) & _Generic((handle), block_handle32: HANDLE32_INDEX_MASK, default: HANDLE_INDEX_MASK)))
 #define HANDLE_INDEX_SET(handle, value) ((handle & HANDLE_GENERATION_MASK) | (value & HANDLE_INDEX_MASK))
 
 #define HANDLE_GENERATION_BIT_COUNT 4
 #define HANDLE_GENERATION_MASK      0xF000
 #define HANDLE_GENERATION_MAX       ((1u << HANDLE_GENERATION_BIT_COUNT) - 1)
 
-#define HANDLE_GENERATION(handle)            ((handle & HANDLE_GENERATION_MASK) >> HANDLE_INDEX_BIT_COUNT)
+#define HANDLE_GENERATION(handle)            ((int)((HANDLE_BITS(handle) & _Generic((handle), block_handle32: HANDLE32_GENERATION_MASK, default: HANDLE_GENERATION_MASK)) >> _Generic((handle), block_handle32: HANDLE32_INDEX_BIT_COUNT, default: HANDLE_INDEX_BIT_COUNT)))
 #define HANDLE_GENERATION_SET(handle, value) (value << HANDLE_INDEX_BIT_COUNT) | HANDLE_INDEX(handle)
 
 // Generation 0 to signify it as invalid. Max index to make it assert errors if still used.
@@ -46,39 +46,177 @@ typedef block_handle block_h; // TODO lets go to this
 		return error;	\
 	}
 
+// Wide handle for pools with heavy churn so a stale handle takes 4095 reuses of its slot to revalidate.
+// A struct so a plain u32 index or id never passes as one, build one from an id with HANDLE32.
+typedef struct block_handle32 {
+	u32 id;
+} block_handle32;
+
+#define HANDLE32(_id) ((block_handle32){(u32)(_id)})
+
+#define HANDLE32_INDEX_BIT_COUNT 20
+#define HANDLE32_INDEX_MASK      0x000FFFFF
+#define HANDLE32_INDEX(handle)   ((int)((handle).id & HANDLE32_INDEX_MASK))
+
+#define HANDLE32_GENERATION_BIT_COUNT 12
+#define HANDLE32_GENERATION_MASK      0xFFF00000
+#define HANDLE32_GENERATION_MAX       ((1u << HANDLE32_GENERATION_BIT_COUNT) - 1)
+#define HANDLE32_GENERATION(handle)   ((int)(((handle).id & HANDLE32_GENERATION_MASK) >> HANDLE32_INDEX_BIT_COUNT))
+
+#define HANDLE32_DEFAULT HANDLE32(HANDLE32_INDEX_MASK)
+
+#define HANDLE32_EQUAL(_a, _b) ((_a).id == (_b).id)
+
+// Raw bits of either handle width. Every _Generic branch has to compile for both, so the struct is only unwrapped in a function.
+static inline u32 HandleBits(u32 handle) { return handle; }
+static inline u32 Handle32Bits(block_handle32 handle) { return handle.id; }
+#define HANDLE_BITS(handle) _Generic((handle), block_handle32: Handle32Bits, default: HandleBits)(handle)
+
+#define IS_HANDLE(_h) _Generic((_h), block_handle: 1, block_handle32: 1, default: 0)
+
 typedef struct block_handle2 { // do this? yes probably
 	u16 index      : HANDLE_INDEX_BIT_COUNT;
 	u16 generation : HANDLE_GENERATION_BIT_COUNT;
 }block_handle2;
 
+/*
+ * Key Index
+ * Linear probe table of slot + 1 keyed by block_key with 0 as empty so a zeroed table is valid.
+ * Sized at twice the slot count so there is always an empty entry to end a probe on.
+ */
+typedef u16 key_index_t;
+
+#define KEY_INDEX_CAPACITY(_n) ((_n) * 2)
+
+// Keys are mostly DJB2 hashes which have weak low bits so mix before masking.
+static inline u32 KeyIndexHome(int indexCapacity, block_key key)
+{
+	key ^= key >> 16;
+	key *= 0x45D9F3Bu;
+	key ^= key >> 16;
+	return key & (indexCapacity - 1);
+}
+
+static inline int KeyIndexFind(int indexCapacity, const key_index_t* pIndex, const block_key* pKeys, block_key key)
+{
+	u32 mask = indexCapacity - 1;
+	for (u32 i = KeyIndexHome(indexCapacity, key);; i = (i + 1) & mask) {
+		int slot = pIndex[i] - 1;
+		if (slot < 0) return -1;
+		if (pKeys[slot] == key) return slot;
+	}
+}
+
+static inline void KeyIndexInsert(int indexCapacity, key_index_t* pIndex, block_key key, int slot)
+{
+	if (key == 0) return;
+	u32 mask = indexCapacity - 1;
+	u32 i = KeyIndexHome(indexCapacity, key);
+	while (pIndex[i] != 0) i = (i + 1) & mask;
+	pIndex[i] = slot + 1;
+}
+
+static inline void KeyIndexRemove(int indexCapacity, key_index_t* pIndex, const block_key* pKeys, int slot)
+{
+	if (pKeys[slot] == 0) return;
+	u32 mask = indexCapacity - 1;
+	u32 i = KeyIndexHome(indexCapacity, pKeys[slot]);
+	while (pIndex[i] != slot + 1) {
+		if (pIndex[i] == 0) return;
+		i = (i + 1) & mask;
+	}
+
+	// Shift the rest of the run back over the hole unless an entry would move before its home.
+	for (u32 j = (i + 1) & mask; pIndex[j] != 0; j = (j + 1) & mask) {
+		u32 home = KeyIndexHome(indexCapacity, pKeys[pIndex[j] - 1]);
+		if (((j - home) & mask) < ((j - i) & mask)) continue;
+		pIndex[i] = pIndex[j];
+		i = j;
+	}
+	pIndex[i] = 0;
+}
+
 /*
  * Block
  */
-#define BLOCK_T_N(_type, _n) \
+
+// FIFO of released indices linked through freeNext. Slots never claimed are handed out in order
+// before the list is used so a zeroed block needs no init.
+typedef struct BlockFreeList {
+	u16 head;
+	u16 tail;
+	u16 count;
+	u16 unclaimed;
+} BlockFreeList;
+
+#define BLOCK_T_N_IMPL(_type, _n, _freeList, _generation) \
 	struct { \
-		BITSET_N(_n) occupied; \
-		block_key    keys[_n]; \
-		_type        blocks[_n]; \
-		u8           generations[_n]; \
+		BITSET_N(_n)  occupied; \
+		block_key     keys[_n]; \
+		_type         blocks[_n]; \
+		_generation   generations[_n]; \
+		key_index_t   keyIndex[KEY_INDEX_CAPACITY(_n)]; \
+		BlockFreeList freeList[_freeList]; \
+		u16           freeNext[_freeList ? _n : 0]; \
+		static_assert(((_n) & ((_n) - 1)) == 0, "Block capacity must be a power of two for the key index."); \
 	}
 
-// these should go in implementation
-static block_h BlockClaim(int occupiedByteCapacity, bitset_t* pOccupiedSet, block_key* pKeys, uint8_t* pGenerations, uint32_t key)
+#define BLOCK_T_N(_type, _n) BLOCK_T_N_IMPL(_type, _n, 0, u8)
+
+// O(1) claim and release through a free list instead of scanning occupied.
+// Released slots are reused last so generation increments spread over the whole block.
+#define BLOCK_FIFO_T_N(_type, _n) BLOCK_T_N_IMPL(_type, _n, 1, u8)
+
+// Blocks handing out block_handle32 with 12 bit generations.
+#define BLOCK32_T_N(_type, _n)      BLOCK_T_N_IMPL(_type, _n, 0, u16)
+#define BLOCK32_FIFO_T_N(_type, _n) BLOCK_T_N_IMPL(_type, _n, 1, u16)
+
+// Handle width is picked by the generation width of the block.
+#define BLOCK_IS_32(_block)                 (sizeof(_block.generations[0]) == sizeof(u16))
+#define BLOCK_HANDLE_T(_block)              typeof(_Generic(&_block.generations[0], u16*: HANDLE32(0), default: (block_handle)0))
+#define BLOCK_HANDLE_DEFAULT(_block)        _Generic(&_block.generations[0], u16*: HANDLE32_DEFAULT, default: (block_handle)HANDLE_DEFAULT)
+#define BLOCK_GENERATION_MAX(_block)        (BLOCK_IS_32(_block) ? HANDLE32_GENERATION_MAX : HANDLE_GENERATION_MAX)
+#define BLOCK_HANDLE_MAKE(_block, _index)                                                                            \
+	_Generic(&_block.generations[0],                                                                                 \
+		u16*: HANDLE32(((u32)_block.generations[_index] << HANDLE32_INDEX_BIT_COUNT) | (u32)(_index)),               \
+		default: (block_handle)(((u32)_block.generations[_index] << HANDLE_INDEX_BIT_COUNT) | (u32)(_index)))
+
+#define BLOCK_FREE_LIST(_block) (sizeof(_block.freeList) ? (BlockFreeList*)_block.freeList : NULL)
+
+static inline int BlockFreeListPop(int capacity, BlockFreeList* pFreeList, u16* pFreeNext)
 {
-	int i = BitClaimFirstZero(occupiedByteCapacity, pOccupiedSet);
-	if (i == -1) return HANDLE_DEFAULT;
-	pKeys[i] = key;
-	pGenerations[i] = pGenerations[i] == HANDLE_GENERATION_MAX ? 1 : (pGenerations[i] + 1) & 0xF;
-	return HANDLE_GENERATION_SET(i, pGenerations[i]);
+	if (pFreeList->unclaimed < capacity)
+		return pFreeList->unclaimed++;
+	if (pFreeList->count > 0) {
+		int i = pFreeList->head;
+		pFreeList->head = pFreeNext[i];
+		pFreeList->count--;
+		return i;
+	}
+	return -1;
 }
 
-static block_h BlockFindByHash(int hashCapacity, block_key* pHashes, uint8_t* pGenerations, block_key hash)
+static inline void BlockFreeListPush(BlockFreeList* pFreeList, u16* pFreeNext, int i)
 {
-	for (int i = 0; i < hashCapacity; ++i) {
-		if (pHashes[i] == hash)
-			return HANDLE_GENERATION_SET(i, pGenerations[i]);
-	}
-	return HANDLE_DEFAULT;
+	if (pFreeList->count == 0) pFreeList->head = i;
+	else pFreeNext[pFreeList->tail] = i;
+	pFreeList->tail = i;
+	pFreeList->count++;
+}
+
+// these should go in implementation
+static int BlockClaimIndex(int capacity, bitset_t* pOccupiedSet, block_key* pKeys, key_index_t* pKeyIndex, BlockFreeList* pFreeList, u16* pFreeNext, uint32_t key)
+{
+	int i;
+	if (pFreeList != NULL) {
+		i = BlockFreeListPop(capacity, pFreeList, pFreeNext);
+		if (i != -1) BITSET(pOccupiedSet, i);
+	} else
+		i = BitClaimFirstZero(BITNBYTES(capacity), pOccupiedSet);
+	if (i == -1) return -1;
+	pKeys[i] = key;
+	KeyIndexInsert(KEY_INDEX_CAPACITY(capacity), pKeyIndex, key, i);
+	return i;
 }
 
 #define IS_TYPE(_var, _type) _Generic((_var), _type: 1, default: 0)
@@ -92,36 +230,64 @@ static block_h BlockFindByHash(int hashCapacity, block_key* pHashes, uint8_t* pG
 // someway these should take ptrs... or should this be static block? STATIC_BLOCK_CLAIM ?
 #define BLOCK_CLAIM(_block, _key) \
 	({ \
-		block_h _h = BlockClaim(sizeof(_block.occupied), (bitset_t*)&_block.occupied, _block.keys, _block.generations, _key); \
-		(block_handle)_h; \
+		int _i = BlockClaimIndex(COUNT(_block.blocks), (bitset_t*)&_block.occupied, _block.keys, _block.keyIndex, BLOCK_FREE_LIST(_block), _block.freeNext, _key); \
+		if (_i != -1) _block.generations[_i] = _block.generations[_i] >= BLOCK_GENERATION_MAX(_block) ? 1 : _block.generations[_i] + 1; \
+		_i == -1 ? BLOCK_HANDLE_DEFAULT(_block) : BLOCK_HANDLE_MAKE(_block, _i); \
 	})
 
 #define XBLOCK_CLAIM(_block, _key) \
 	({ \
-		block_h _h = BlockClaim(sizeof(_block.occupied), (bitset_t*)&_block.occupied, _block.keys, _block.generations, _key); \
+		BLOCK_HANDLE_T(_block) _h = BLOCK_CLAIM(_block, _key); \
 		REQUIRE(HANDLE_VALID(_h), #_block ": Claiming handle. Out of capacity."); \
-		(block_handle)_h; \
+		_h; \
 	})
 
 #define BLOCK_RELEASE(_, _handle) \
 	({ \
-		STATIC_ASSERT_TYPE(_handle, block_handle); \
+		STATIC_ASSERT_TYPE(_handle, BLOCK_HANDLE_T(_)); \
 		ASSERT(HANDLE_INDEX(_handle) >= 0 && HANDLE_INDEX(_handle) < COUNT(_.blocks), #_ ": Releasing block handle. Out of range."); \
 		ASSERT(BITTEST(_.occupied, HANDLE_INDEX(_handle)), #_ ": Releasing block handle Should be occupied."); \
 		BITCLEAR(_.occupied, (int)HANDLE_INDEX(_handle)); \
+		KeyIndexRemove(COUNT(_.keyIndex), _.keyIndex, _.keys, HANDLE_INDEX(_handle)); \
+		if (sizeof(_.freeList)) BlockFreeListPush(BLOCK_FREE_LIST(_), _.freeNext, HANDLE_INDEX(_handle)); \
 		&_.blocks[HANDLE_INDEX(_handle)]; \
 	})
 
+/*
+ * Atomic claim and release so threads can share a block without a lock. Only for blocks without a free list,
+ * and every claim and release on the block must go through these. Claimed slots get key 0 and are not indexed.
+ * Finish with the slot before releasing it as it can be claimed by another thread immediately after.
+ */
+#define BLOCK_CLAIM_ATOMIC(_block) \
+	({ \
+		static_assert(sizeof(_block.freeList) == 0, #_block ": Atomic claim on a block with a free list."); \
+		int _i = BitClaimFirstZeroAtomic(sizeof(_block.occupied), (bitset_t*)&_block.occupied); \
+		if (_i != -1) { \
+			_block.keys[_i] = 0; \
+			__atomic_store_n(&_block.generations[_i], _block.generations[_i] >= BLOCK_GENERATION_MAX(_block) ? 1 : _block.generations[_i] + 1, __ATOMIC_RELEASE); \
+		} \
+		_i == -1 ? BLOCK_HANDLE_DEFAULT(_block) : BLOCK_HANDLE_MAKE(_block, _i); \
+	})
+
+#define BLOCK_RELEASE_ATOMIC(_, _handle) \
+	({ \
+		STATIC_ASSERT_TYPE(_handle, BLOCK_HANDLE_T(_)); \
+		ASSERT(HANDLE_INDEX(_handle) >= 0 && HANDLE_INDEX(_handle) < COUNT(_.blocks), #_ ": Releasing block handle. Out of range."); \
+		ASSERT(BITTEST(_.occupied, HANDLE_INDEX(_handle)), #_ ": Releasing block handle Should be occupied."); \
+		BitClearAtomic(sizeof(_.occupied), (bitset_t*)&_.occupied, HANDLE_INDEX(_handle)); \
+	})
+
 #define BLOCK_FIND(_, _hash)                                           \
 	({                                                                 \
 		ASSERT(_hash != 0, "Trying to search for 0 hash!");            \
-		BlockFindByHash(sizeof(_.keys), _.keys, _.generations, _hash); \
+		int _i = KeyIndexFind(COUNT(_.keyIndex), _.keyIndex, _.keys, _hash); \
+		_i == -1 ? BLOCK_HANDLE_DEFAULT(_) : BLOCK_HANDLE_MAKE(_, _i); \
 	})
 
 #define BLOCK_HANDLE(_block, _p) \
 	({ \
 		ASSERT(_p >= _block.blocks && _p < _block.blocks + COUNT(_block.blocks), #_block ": Getting block handle. Out of range."); \
-		(block_handle)(HANDLE_GENERATION_SET((_p - _block.blocks), _block.generations[(_p - _block.blocks)])); \
+		BLOCK_HANDLE_MAKE(_block, (_p - _block.blocks)); \
 	  })
 
 #define BLOCK_HANDLE_VALID(_block, _handle) \
@@ -133,7 +299,7 @@ static block_h BlockFindByHash(int hashCapacity, block_key* pHashes, uint8_t* pG
 #define BLOCK_HANDLE_INDEX(_block, _index)                                                        \
 	({                                                                                            \
 		ASSERT((_index) < COUNT(_block.blocks), #_block ": Getting block handle. Out of range."); \
-		(block_handle)(HANDLE_GENERATION_SET((_index), _block.generations[(_index)]));            \
+		BLOCK_HANDLE_MAKE(_block, (_index));                                                      \
 	})
 
 #define BLOCK_KEY(_block, _p)                                                                                                   \
@@ -144,7 +310,7 @@ static block_h BlockFindByHash(int hashCapacity, block_key* pHashes, uint8_t* pG
 
 #define BLOCK_KEY_H(_block, _handle)                                                                     \
 	({                                                                                                   \
-		STATIC_ASSERT_TYPE(_handle, block_handle);                                                       \
+		STATIC_ASSERT_TYPE(_handle, BLOCK_HANDLE_T(_block));                                             \
 		ASSERT_HANDLE_BLOCK_RANGE(_block, _handle, #_block ": Getting block ptr. Handle out of range."); \
 		(block_key)(_block.keys[HANDLE_INDEX(_handle)]);                                                 \
 	})
@@ -152,7 +318,7 @@ static block_h BlockFindByHash(int hashCapacity, block_key* pHashes, uint8_t* pG
 	// Block Ptr from Handle
 #define BLOCK_PTR_H(_block, _handle) \
 	({ \
-		STATIC_ASSERT_TYPE(_handle, block_handle); \
+		STATIC_ASSERT_TYPE(_handle, BLOCK_HANDLE_T(_block)); \
 		STATIC_ASSERT_HAS_FIELD(typeof(_block), blocks, #_block ": is not a block type!"); \
 		ASSERT_HANDLE_BLOCK_RANGE(_block, _handle, #_block ": Getting block ptr. Hande out of range."); \
 		&_block.blocks[HANDLE_INDEX(_handle)];	\
@@ -161,14 +327,14 @@ static block_h BlockFindByHash(int hashCapacity, block_key* pHashes, uint8_t* pG
 // Array Value from Handle
 #define ARRAY_PTR_H(_array, _handle) \
     ({ \
-        STATIC_ASSERT_TYPE(_handle, block_handle); \
+        static_assert(IS_HANDLE(_handle), #_handle " is not a handle"); \
         &_array[HANDLE_INDEX(_handle)]; \
     })
 
 	// Array Value from Handle
 #define ARRAY_H(_array, _handle) \
     ({ \
-        STATIC_ASSERT_TYPE(_handle, block_handle); \
+        static_assert(IS_HANDLE(_handle), #_handle " is not a handle"); \
         ASSERT_HANDLE_ARRAY_RANGE(_array, _handle, #_array ": Handle out of array range."), \
         _array[HANDLE_INDEX(_handle)]; \
     })
@@ -176,11 +342,14 @@ static block_h BlockFindByHash(int hashCapacity, block_key* pHashes, uint8_t* pG
 
 #define BLOCK_OCCUPIED(_block, _handle)                                                                 \
 	({                                                                                                  \
-		STATIC_ASSERT_TYPE(_handle, block_handle);                                                      \
+		STATIC_ASSERT_TYPE(_handle, BLOCK_HANDLE_T(_block));                                            \
 		ASSERT_HANDLE_BLOCK_RANGE(_block, _handle, #_block ": Checking block occupied. Out of range."); \
 		BITTEST(_block.occupied, HANDLE_INDEX(_handle));                                                \
 	})
 
+// Occupied and of the current generation. BLOCK_HANDLE_VALID alone still passes a released handle until its slot is claimed again.
+#define BLOCK_HANDLE_LIVE(_block, _handle) (BLOCK_OCCUPIED(_block, _handle) && BLOCK_HANDLE_VALID(_block, _handle))
+
 #define BLOCK_COUNT(_) BitCountOnes(sizeof(_.occupied), (bitset_t*)&_.occupied)
 
 /*
@@ -193,11 +362,13 @@ typedef struct MapBase {
 	//	block_handle handles[];
 } MapBase;
 
-#define MAP_DECL(n)              \
-	struct {                     \
-		u32          count;      \
-		block_key    keys[n];    \
-		block_handle handles[n]; \
+#define MAP_DECL(n)                                   \
+	struct {                                          \
+		u32          count;                           \
+		block_key    keys[n];                         \
+		block_handle handles[n];                      \
+		key_index_t  keyIndex[KEY_INDEX_CAPACITY(n)]; \
+		static_assert(((n) & ((n) - 1)) == 0, "Map capacity must be a power of two for the key index."); \
 	}
 
 static inline block_handle* MapHandles(int capacity, MapBase* pMap)
@@ -205,6 +376,11 @@ static inline block_handle* MapHandles(int capacity, MapBase* pMap)
 	return (block_handle*)(pMap->keys + capacity);
 }
 
+static inline key_index_t* MapKeyIndex(int capacity, MapBase* pMap)
+{
+	return (key_index_t*)(MapHandles(capacity, pMap) + capacity);
+}
+
 // these could be implementation
 static inline map_handle MapAdd(int capacity, MapBase* pMap, block_handle handle, block_key key)
 {
@@ -214,6 +390,7 @@ static inline map_handle MapAdd(int capacity, MapBase* pMap, block_handle handle
 
 	MapHandles(capacity, pMap)[i] = handle;
 	pMap->keys[i] = key;
+	KeyIndexInsert(KEY_INDEX_CAPACITY(capacity), MapKeyIndex(capacity, pMap), key, i);
 	pMap->count++;
 
 	return HANDLE_GENERATION_INCREMENT(i);
@@ -221,12 +398,9 @@ static inline map_handle MapAdd(int capacity, MapBase* pMap, block_handle handle
 
 static inline block_handle MapFind(int capacity, MapBase* pMap, block_key key)
 {
-	for (u32 i = 0; i < pMap->count; ++i) {
-		if (pMap->keys[i] == key)
-			return MapHandles(capacity, pMap)[i];
-	}
-
-	return HANDLE_DEFAULT;
+	int i = KeyIndexFind(KEY_INDEX_CAPACITY(capacity), MapKeyIndex(capacity, pMap), pMap->keys, key);
+	if (i == -1) return HANDLE_DEFAULT;
+	return MapHandles(capacity, pMap)[i];
 }
 
 #define MAP_ADD(map, handle, key) MapAdd(COUNT(map.keys), (MapBase*)&map, handle, key)
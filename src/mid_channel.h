@@ -3,47 +3,265 @@
  *
  * IPC channel based on ring queue.
  * Requires -fno-strict-aliasing and -fwrapv.
+ *
+ * Rings are declared per index width (8/16/32) so a queue only pays for the index it needs.
+ * The width caps capacity at 1 << bits. Indices run unmasked and wrap on overflow of their own type.
+ * All MID_CHANNEL_* macros dispatch on the ring type so call sites don't name the width.
  */
 #ifndef MID_CHANNEL_H
 #define MID_CHANNEL_H
 
+#include <limits.h>
 #include <stdatomic.h>
 #include "mid_common.h"
 
-typedef u8 channel_ring_h;
-#define MID_QRING_CAPACITY (1 << (sizeof(channel_ring_h) * CHAR_BIT))
+#define MID_QRING_CAPACITY_N(_bits) (1ull << (_bits))
+
+#define MID_CHANNEL_RING_DECL(_bits)                                                  \
+	typedef volatile struct MidChannelRing##_bits {                                   \
+		u##_bits head;                                                                \
+		u##_bits tail;                                                                \
+	} MidChannelRing##_bits;                                                          \
+	/* Ring with head and tail on separate cache lines so the producer and consumer   \
+	 * don't invalidate each other. Each side keeps a copy of the opposite index and  \
+	 * only reloads the shared one when the ring looks full or empty. The copy sits   \
+	 * on the owning side's line so it is never written by the other side, which also \
+	 * holds across processes. wake/waiting back Wait, only SendWake touches them so \
+	 * plain sends never pay for it. */                                              \
+	typedef volatile struct CACHE_ALIGN MidChannelAlignedRing##_bits {                \
+		struct CACHE_ALIGN {                                                          \
+			u##_bits head;                                                            \
+			u##_bits cachedTail;                                                      \
+			u32      wake;                                                            \
+		} send;                                                                       \
+		struct CACHE_ALIGN {                                                          \
+			u##_bits tail;                                                            \
+			u##_bits cachedHead;                                                      \
+			u32      waiting;                                                         \
+		} recv;                                                                       \
+	} MidChannelAlignedRing##_bits;                                                   \
+	static_assert(sizeof(MidChannelAlignedRing##_bits) == 128, "MidChannelAlignedRing should be two cache lines.");
+
+MID_CHANNEL_RING_DECL(8);
+MID_CHANNEL_RING_DECL(16);
+MID_CHANNEL_RING_DECL(32);
+
+// u8 is the default for queues that don't need more than 256.
+typedef u8                     channel_ring_h;
+typedef MidChannelRing8        MidChannelRing;
+typedef MidChannelAlignedRing8 MidChannelAlignedRing;
+#define MID_QRING_CAPACITY MID_QRING_CAPACITY_N(sizeof(channel_ring_h) * CHAR_BIT)
+
+#define MID_CHANNEL_FUNC_DECL(_Ring, _func, _bits)                                                                                                             \
+	/* Send/Receive by memcpy of value. */                                                                                                                     \
+	MidResult _func##Send##_bits(_Ring##_bits* pRing, int valueSize, int capacity, volatile void* pValues, void* pValue);                                     \
+	MidResult _func##Recv##_bits(_Ring##_bits* pRing, int valueSize, int capacity, volatile void* pValues, void* pValue);                                     \
+	/* Send by writing to directly to a ptr. */                                                                                                                \
+	MidResult _func##SendBegin##_bits(_Ring##_bits* pRing, int valueSize, int capacity, volatile void* pValues, volatile void** ppValue);                      \
+	MidResult _func##SendEnd##_bits(_Ring##_bits* pRing);                                                                                                     \
+	/* Send/Receive a span of values with a single atomic on head or tail.                                                                                     \
+	 * Reserve/Peek return how many of count are contiguous from *ppValues up to the wrap point,                                                               \
+	 * so call again after Commit/Consume to get the remainder. SendN/RecvN memcpy across the wrap. */                                                         \
+	int  _func##SendReserve##_bits(_Ring##_bits* pRing, int valueSize, int capacity, volatile void* pValues, int count, volatile void** ppValues);             \
+	void _func##SendCommit##_bits(_Ring##_bits* pRing, int count);                                                                                            \
+	int  _func##RecvPeek##_bits(_Ring##_bits* pRing, int valueSize, int capacity, volatile void* pValues, int count, volatile void** ppValues);                \
+	void _func##RecvConsume##_bits(_Ring##_bits* pRing, int count);                                                                                           \
+	int  _func##SendN##_bits(_Ring##_bits* pRing, int valueSize, int capacity, volatile void* pValues, int count, void* pSrcValues);                           \
+	int  _func##RecvN##_bits(_Ring##_bits* pRing, int valueSize, int capacity, volatile void* pValues, int count, void* pDstValues);
+
+MID_CHANNEL_FUNC_DECL(MidChannelRing, midChannel, 8);
+MID_CHANNEL_FUNC_DECL(MidChannelRing, midChannel, 16);
+MID_CHANNEL_FUNC_DECL(MidChannelRing, midChannel, 32);
+MID_CHANNEL_FUNC_DECL(MidChannelAlignedRing, midChannelAligned, 8);
+MID_CHANNEL_FUNC_DECL(MidChannelAlignedRing, midChannelAligned, 16);
+MID_CHANNEL_FUNC_DECL(MidChannelAlignedRing, midChannelAligned, 32);
+
+// Pick the implementation by ring type so the same macros work on any layout and width.
+#define MID_CHANNEL_FUNC(_pRing, _name)                   \
+	_Generic((_pRing),                                    \
+		MidChannelRing8*: midChannel##_name##8,           \
+		MidChannelRing16*: midChannel##_name##16,         \
+		MidChannelRing32*: midChannel##_name##32,         \
+		MidChannelAlignedRing8*: midChannelAligned##_name##8,   \
+		MidChannelAlignedRing16*: midChannelAligned##_name##16, \
+		MidChannelAlignedRing32*: midChannelAligned##_name##32)
 
-typedef volatile struct MidChannelRing {
-	channel_ring_h head;
-	channel_ring_h tail;
-} MidChannelRing;
+#define MID_CHANNEL_RING_CAPACITY(_pRing)    \
+	_Generic((_pRing),                       \
+		MidChannelRing8*: MID_QRING_CAPACITY_N(8),         \
+		MidChannelRing16*: MID_QRING_CAPACITY_N(16),       \
+		MidChannelRing32*: MID_QRING_CAPACITY_N(32),       \
+		MidChannelAlignedRing8*: MID_QRING_CAPACITY_N(8),  \
+		MidChannelAlignedRing16*: MID_QRING_CAPACITY_N(16), \
+		MidChannelAlignedRing32*: MID_QRING_CAPACITY_N(32))
+
+#define MID_CHANNEL_STATIC_ASSERT(_pRing, _pValues, _pValue)                                                                   \
+	STATIC_ASSERT(TYPES_EQUAL(*_pValues, *_pValue), "Value array does not match value type!");                                 \
+	STATIC_ASSERT(IS_POWER_OF_2(COUNT(_pValues)), "Value array size is not power of 2!");                                      \
+	STATIC_ASSERT(COUNT(_pValues) <= MID_CHANNEL_RING_CAPACITY(_pRing), "Array size greater than ring index width capacity!")
 
-/* Send/Receive by memcpy of value. */
-MidResult midChannelSend(volatile MidChannelRing* pRing, int valueSize, int capacity, volatile void* pValues, void* pValue);
-MidResult midChannelRecv(volatile MidChannelRing* pRing, int valueSize, int capacity, volatile void* pValues, void* pValue);
 #define MID_CHANNEL_SEND(_pRing, _pValues, _pValue) ({ \
-	STATIC_ASSERT(TYPES_EQUAL(*_pValues, *_pValue), "Array does not match value type!"); \
-	STATIC_ASSERT(IS_POWER_OF_2(COUNT(_pValues)), "Array size is not power of 2!"); \
-	STATIC_ASSERT(COUNT(_pValues) <= MID_QRING_CAPACITY, "Array size greater than MID_QRING_CAPACITY!"); \
-	midChannelSend(_pRing, sizeof(_pValues[0]), COUNT(_pValues), _pValues, _pValue); \
+	MID_CHANNEL_STATIC_ASSERT(_pRing, _pValues, _pValue); \
+	MID_CHANNEL_FUNC(_pRing, Send)(_pRing, sizeof(_pValues[0]), COUNT(_pValues), _pValues, _pValue); \
 })
 #define MID_CHANNEL_RECV(_pRing, _pValues, _pValue) ({ \
-	STATIC_ASSERT(TYPES_EQUAL(*_pValues, *_pValue), "Value array does not match value type!"); \
-    STATIC_ASSERT(IS_POWER_OF_2(COUNT(_pValues)), "Value array size is not power of 2!"); \
-    STATIC_ASSERT(COUNT(_pValues) <= MID_QRING_CAPACITY, "Array size greater than MID_QRING_CAPACITY!"); \
-	midChannelRecv(_pRing, sizeof(_pValues[0]), COUNT(_pValues), _pValues, _pValue); \
+	MID_CHANNEL_STATIC_ASSERT(_pRing, _pValues, _pValue); \
+	MID_CHANNEL_FUNC(_pRing, Recv)(_pRing, sizeof(_pValues[0]), COUNT(_pValues), _pValues, _pValue); \
 })
 
-/* Send by writing to directly to a ptr. */
-MidResult midChannelSendBegin(volatile MidChannelRing* pRing, int valueSize, int capacity, volatile void* pValues, volatile void** ppValue);
-MidResult midChannelSendEnd(volatile MidChannelRing* pRing);
 #define MID_CHANNEL_SEND_SCOPE(_pRing, _pValues, _pValue) \
-	STATIC_ASSERT(TYPES_EQUAL(*_pValues, *_pValue), "Value array does not match value type!"); \
-    STATIC_ASSERT(IS_POWER_OF_2(COUNT(_pValues)), "Value array size is not power of 2!"); \
-    STATIC_ASSERT(COUNT(_pValues) <= MID_QRING_CAPACITY, "Array size greater than MID_QRING_CAPACITY!"); \
-	for (MidResult result = midChannelSendBegin(_pRing, sizeof(_pValues[0]), COUNT(_pValues), _pValues, (volatile void**)&_pValue); \
+	MID_CHANNEL_STATIC_ASSERT(_pRing, _pValues, _pValue); \
+	for (MidResult result = MID_CHANNEL_FUNC(_pRing, SendBegin)(_pRing, sizeof(_pValues[0]), COUNT(_pValues), _pValues, (volatile void**)&_pValue); \
 		result == MID_SUCCESS; \
-		result = midChannelSendEnd(_pRing))
+		result = MID_CHANNEL_FUNC(_pRing, SendEnd)(_pRing))
+
+#define MID_CHANNEL_SEND_N(_pRing, _pValues, _pSrcValues, _count) ({ \
+	MID_CHANNEL_STATIC_ASSERT(_pRing, _pValues, _pSrcValues); \
+	MID_CHANNEL_FUNC(_pRing, SendN)(_pRing, sizeof(_pValues[0]), COUNT(_pValues), _pValues, _count, _pSrcValues); \
+})
+#define MID_CHANNEL_RECV_N(_pRing, _pValues, _pDstValues, _count) ({ \
+	MID_CHANNEL_STATIC_ASSERT(_pRing, _pValues, _pDstValues); \
+	MID_CHANNEL_FUNC(_pRing, RecvN)(_pRing, sizeof(_pValues[0]), COUNT(_pValues), _pValues, _count, _pDstValues); \
+})
+#define MID_CHANNEL_RECV_PEEK(_pRing, _pValues, _ppValues, _count) ({ \
+	MID_CHANNEL_STATIC_ASSERT(_pRing, _pValues, *_ppValues); \
+	MID_CHANNEL_FUNC(_pRing, RecvPeek)(_pRing, sizeof(_pValues[0]), COUNT(_pValues), _pValues, _count, (volatile void**)_ppValues); \
+})
+#define MID_CHANNEL_RECV_CONSUME(_pRing, _count) MID_CHANNEL_FUNC(_pRing, RecvConsume)(_pRing, _count)
+
+/*
+ * Blocking receive for aligned rings. Wait sleeps the receiver up to timeoutMs until the ring is not empty,
+ * returning MID_EMPTY on timeout. Only sends made with SendWake wake it, and only the one that takes the ring
+ * from empty while the receiver is flagged waiting makes the wake call.
+ * Futex on Linux works across processes. WaitOnAddress on Windows only wakes within a process,
+ * so a cross process receiver there still picks up sends at the timeout.
+ */
+MidResult midChannelAlignedSendWake8(MidChannelAlignedRing8* pRing, int valueSize, int capacity, volatile void* pValues, void* pValue);
+MidResult midChannelAlignedSendWake16(MidChannelAlignedRing16* pRing, int valueSize, int capacity, volatile void* pValues, void* pValue);
+MidResult midChannelAlignedSendWake32(MidChannelAlignedRing32* pRing, int valueSize, int capacity, volatile void* pValues, void* pValue);
+MidResult midChannelAlignedWait8(MidChannelAlignedRing8* pRing, u32 timeoutMs);
+MidResult midChannelAlignedWait16(MidChannelAlignedRing16* pRing, u32 timeoutMs);
+MidResult midChannelAlignedWait32(MidChannelAlignedRing32* pRing, u32 timeoutMs);
+#define MID_CHANNEL_ALIGNED_FUNC(_pRing, _name)                 \
+	_Generic((_pRing),                                          \
+		MidChannelAlignedRing8*: midChannelAligned##_name##8,   \
+		MidChannelAlignedRing16*: midChannelAligned##_name##16, \
+		MidChannelAlignedRing32*: midChannelAligned##_name##32)
+#define MID_CHANNEL_SEND_WAKE(_pRing, _pValues, _pValue) ({ \
+	MID_CHANNEL_STATIC_ASSERT(_pRing, _pValues, _pValue); \
+	MID_CHANNEL_ALIGNED_FUNC(_pRing, SendWake)(_pRing, sizeof(_pValues[0]), COUNT(_pValues), _pValues, _pValue); \
+})
+#define MID_CHANNEL_WAIT(_pRing, _timeoutMs) MID_CHANNEL_ALIGNED_FUNC(_pRing, Wait)(_pRing, _timeoutMs)
+#define MID_CHANNEL_RECV_WAIT(_pRing, _pValues, _pValue, _timeoutMs) ({ \
+	MidResult _result = MID_CHANNEL_RECV(_pRing, _pValues, _pValue); \
+	if (_result == MID_EMPTY && MID_CHANNEL_WAIT(_pRing, _timeoutMs) == MID_SUCCESS) \
+		_result = MID_CHANNEL_RECV(_pRing, _pValues, _pValue); \
+	_result; \
+})
+
+/*
+ * Multi-producer single-consumer ring. Producers claim a position with CAS on head, then publish
+ * the slot through its sequence so the consumer never reads a slot that is claimed but not yet written.
+ * Sequences are stored relative to the slot index so a zeroed ring and sequence array is ready to use.
+ */
+typedef volatile struct CACHE_ALIGN MidChannelMpscRing {
+	struct CACHE_ALIGN {
+		u32 head;
+		u32 wake;
+		u32 waiting;
+	} send;
+	struct CACHE_ALIGN {
+		u32 tail;
+	} recv;
+} MidChannelMpscRing;
+
+MidResult midChannelMpscSend(MidChannelMpscRing* pRing, volatile u32* pSequences, int valueSize, int capacity, volatile void* pValues, void* pValue);
+MidResult midChannelMpscRecv(MidChannelMpscRing* pRing, volatile u32* pSequences, int valueSize, int capacity, volatile void* pValues, void* pValue);
+bool      midChannelMpscEmpty(MidChannelMpscRing* pRing, volatile u32* pSequences, int capacity);
+/* Sleep the consumer up to timeoutMs until the ring is not empty, or Notify is called. Returns MID_EMPTY on timeout. */
+MidResult midChannelMpscWait(MidChannelMpscRing* pRing, volatile u32* pSequences, int capacity, u32 timeoutMs);
+/*
+ * Wait split in two so one consumer can sleep on pRing while draining several rings whose producers Notify pRing.
+ * Between Begin and End the consumer must check every ring it drains and pass whether all were empty,
+ * otherwise a send landing before Begin is missed until the timeout.
+ */
+u32  midChannelMpscWaitBegin(MidChannelMpscRing* pRing);
+void midChannelMpscWaitEnd(MidChannelMpscRing* pRing, u32 wake, bool empty, u32 timeoutMs);
+/* Wake a consumer sleeping in Wait without sending. */
+void midChannelMpscNotify(MidChannelMpscRing* pRing);
+#define MID_CHANNEL_MPSC_STATIC_ASSERT(_pSequences, _pValues, _pValue)                                \
+	STATIC_ASSERT(TYPES_EQUAL(*_pValues, *_pValue), "Value array does not match value type!");        \
+	STATIC_ASSERT(IS_POWER_OF_2(COUNT(_pValues)), "Value array size is not power of 2!");             \
+	STATIC_ASSERT(COUNT(_pSequences) == COUNT(_pValues), "Sequence array size does not match values!"); \
+	STATIC_ASSERT(sizeof(_pSequences[0]) == sizeof(u32), "Sequence array is not u32!")
+#define MID_CHANNEL_MPSC_SEND(_pRing, _pSequences, _pValues, _pValue) ({ \
+	MID_CHANNEL_MPSC_STATIC_ASSERT(_pSequences, _pValues, _pValue); \
+	midChannelMpscSend(_pRing, _pSequences, sizeof(_pValues[0]), COUNT(_pValues), _pValues, _pValue); \
+})
+#define MID_CHANNEL_MPSC_RECV(_pRing, _pSequences, _pValues, _pValue) ({ \
+	MID_CHANNEL_MPSC_STATIC_ASSERT(_pSequences, _pValues, _pValue); \
+	midChannelMpscRecv(_pRing, _pSequences, sizeof(_pValues[0]), COUNT(_pValues), _pValues, _pValue); \
+})
+#define MID_CHANNEL_MPSC_WAIT(_pRing, _pSequences, _pValues, _timeoutMs) ({ \
+	STATIC_ASSERT(COUNT(_pSequences) == COUNT(_pValues), "Sequence array size does not match values!"); \
+	midChannelMpscWait(_pRing, _pSequences, COUNT(_pValues), _timeoutMs); \
+})
+#define MID_CHANNEL_MPSC_EMPTY(_pRing, _pSequences, _pValues) ({ \
+	STATIC_ASSERT(COUNT(_pSequences) == COUNT(_pValues), "Sequence array size does not match values!"); \
+	midChannelMpscEmpty(_pRing, _pSequences, COUNT(_pValues)); \
+})
+
+/*
+ * Single-producer single-consumer ring of variable length records over a byte array.
+ * Each record is a MidChannelRecordHeader then its payload, padded to MID_CHANNEL_RECORD_ALIGN.
+ * A record never straddles the end, the remainder is skipped with a wrap header published along with the record.
+ * Indices count bytes so full is h - t == capacity and no slot is kept open.
+ */
+#define MID_CHANNEL_RECORD_ALIGN 8
+#define MID_CHANNEL_RECORD_WRAP  UINT32_MAX
+
+typedef struct MidChannelRecordHeader {
+	u32 size;
+	u32 reserved;
+} MidChannelRecordHeader;
+static_assert(sizeof(MidChannelRecordHeader) == MID_CHANNEL_RECORD_ALIGN, "MidChannelRecordHeader must keep payload aligned.");
+
+typedef volatile struct CACHE_ALIGN MidChannelRecordRing {
+	struct CACHE_ALIGN {
+		u32 head;
+		u32 cachedTail;
+		u32 pendingHead;
+	} send;
+	struct CACHE_ALIGN {
+		u32 tail;
+		u32 cachedHead;
+	} recv;
+} MidChannelRecordRing;
+
+MidResult midChannelRecordSend(MidChannelRecordRing* pRing, int capacity, volatile u8* pBytes, int size, void* pRecord);
+MidResult midChannelRecordRecv(MidChannelRecordRing* pRing, int capacity, volatile u8* pBytes, int maxSize, void* pRecord, int* pSize);
+MidResult midChannelRecordSendBegin(MidChannelRecordRing* pRing, int capacity, volatile u8* pBytes, int size, volatile void** ppRecord);
+MidResult midChannelRecordSendEnd(MidChannelRecordRing* pRing);
+#define MID_CHANNEL_RECORD_STATIC_ASSERT(_pBytes)                                                                 \
+	STATIC_ASSERT(sizeof(_pBytes[0]) == 1, "Record array is not bytes!");                                       \
+	STATIC_ASSERT(IS_POWER_OF_2(COUNT(_pBytes)), "Record array size is not power of 2!");                       \
+	STATIC_ASSERT(COUNT(_pBytes) >= MID_CHANNEL_RECORD_ALIGN * 2, "Record array size too small!");              \
+	STATIC_ASSERT(__alignof__(_pBytes) >= MID_CHANNEL_RECORD_ALIGN, "Record array must be aligned to MID_CHANNEL_RECORD_ALIGN!")
+#define MID_CHANNEL_RECORD_SEND(_pRing, _pBytes, _pRecord) ({ \
+	MID_CHANNEL_RECORD_STATIC_ASSERT(_pBytes); \
+	midChannelRecordSend(_pRing, COUNT(_pBytes), _pBytes, sizeof(*_pRecord), _pRecord); \
+})
+/* Receive into a buffer of _maxSize bytes. _pSize gets the record size. */
+#define MID_CHANNEL_RECORD_RECV(_pRing, _pBytes, _pRecord, _maxSize, _pSize) ({ \
+	MID_CHANNEL_RECORD_STATIC_ASSERT(_pBytes); \
+	midChannelRecordRecv(_pRing, COUNT(_pBytes), _pBytes, _maxSize, _pRecord, _pSize); \
+})
+/* Send by writing directly into the ring. Record size is sizeof(*_pRecord). */
+#define MID_CHANNEL_RECORD_SEND_SCOPE(_pRing, _pBytes, _pRecord) \
+	MID_CHANNEL_RECORD_STATIC_ASSERT(_pBytes); \
+	for (MidResult result = midChannelRecordSendBegin(_pRing, COUNT(_pBytes), _pBytes, sizeof(*_pRecord), (volatile void**)&_pRecord); \
+		result == MID_SUCCESS; \
+		result = midChannelRecordSendEnd(_pRing))
 
 #endif // MID_CHANNEL_H
 
@@ -53,42 +271,372 @@ MidResult midChannelSendEnd(volatile MidChannelRing* pRing);
 #if defined(MID_QRING_IMPLEMENTATION) || defined(MID_IDE_ANALYSIS)
 #undef MID_QRING_IMPLEMENTATION
 
-MidResult midChannelSendBegin(volatile MidChannelRing* pRing, int valueSize, int capacity, volatile void* pValues, volatile void** ppValue)
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+/*
+ * Sleep while *pWord == expected. Not FUTEX_PRIVATE so it works on shared memory across processes.
+ */
+static void ChannelFutexWait(volatile u32* pWord, u32 expected, u32 timeoutMs)
+{
+#if defined(_WIN32)
+	WaitOnAddress((volatile void*)pWord, &expected, sizeof(u32), timeoutMs);
+#elif defined(__linux__)
+	struct timespec timeout = {.tv_sec = timeoutMs / 1000, .tv_nsec = (timeoutMs % 1000) * 1000000};
+	syscall(SYS_futex, pWord, FUTEX_WAIT, expected, &timeout, NULL, 0);
+#endif
+}
+
+static void ChannelFutexWake(volatile u32* pWord)
+{
+#if defined(_WIN32)
+	WakeByAddressAll((void*)pWord);
+#elif defined(__linux__)
+	syscall(SYS_futex, pWord, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+#endif
+}
+
+// Sender side, after publishing. The fence pairs with the one in ChannelWaitBegin so either the sender sees waiting or the receiver sees the send.
+INLINE void ChannelNotify(volatile u32* pWake, volatile u32* pWaiting)
+{
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (LIKELY(!__atomic_load_n(pWaiting, __ATOMIC_RELAXED))) return;
+	__atomic_fetch_add(pWake, 1, __ATOMIC_RELEASE);
+	ChannelFutexWake(pWake);
+}
+
+// Receiver side. Take the wake value then flag waiting, the caller must check empty again before ChannelWaitEnd.
+INLINE u32 ChannelWaitBegin(volatile u32* pWake, volatile u32* pWaiting)
 {
-	__atomic_thread_fence(__ATOMIC_ACQUIRE);
-	channel_ring_h h = pRing->head & (capacity - 1);
-	channel_ring_h t = pRing->tail & (capacity - 1);
-	if (h + 1 == t) return MID_LIMIT_REACHED;
-	*ppValue = pValues + (h * valueSize);
-	__atomic_thread_fence(__ATOMIC_RELEASE);
+	u32 wake = __atomic_load_n(pWake, __ATOMIC_ACQUIRE);
+	__atomic_store_n(pWaiting, 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	return wake;
+}
+
+INLINE void ChannelWaitEnd(volatile u32* pWake, volatile u32* pWaiting, u32 wake, bool empty, u32 timeoutMs)
+{
+	if (empty) ChannelFutexWait(pWake, wake, timeoutMs);
+	__atomic_store_n(pWaiting, 0, __ATOMIC_RELAXED);
+}
+
+/*
+ * Per layout index access. SendTail/RecvHead return the opposite index, at least as new
+ * as needed to see need free/used slots if they are there.
+ */
+#define MID_CHANNEL_RING_ACCESS_IMPL(_bits)                                                                     \
+	INLINE u##_bits volatile* ChannelHead##_bits(MidChannelRing##_bits* pRing) { return &pRing->head; }        \
+	INLINE u##_bits volatile* ChannelTail##_bits(MidChannelRing##_bits* pRing) { return &pRing->tail; }        \
+	INLINE u##_bits ChannelSendTail##_bits(MidChannelRing##_bits* pRing, u##_bits h, int capacity, int need)    \
+	{                                                                                                           \
+		return __atomic_load_n(&pRing->tail, __ATOMIC_ACQUIRE);                                                 \
+	}                                                                                                           \
+	INLINE u##_bits ChannelRecvHead##_bits(MidChannelRing##_bits* pRing, u##_bits t, int need)                  \
+	{                                                                                                           \
+		return __atomic_load_n(&pRing->head, __ATOMIC_ACQUIRE);                                                 \
+	}                                                                                                           \
+	INLINE u##_bits volatile* AlignedChannelHead##_bits(MidChannelAlignedRing##_bits* pRing) { return &pRing->send.head; } \
+	INLINE u##_bits volatile* AlignedChannelTail##_bits(MidChannelAlignedRing##_bits* pRing) { return &pRing->recv.tail; } \
+	INLINE u##_bits AlignedChannelSendTail##_bits(MidChannelAlignedRing##_bits* pRing, u##_bits h, int capacity, int need) \
+	{                                                                                                           \
+		if (capacity - 1 - (int)(u##_bits)(h - pRing->send.cachedTail) < need)                                       \
+			pRing->send.cachedTail = __atomic_load_n(&pRing->recv.tail, __ATOMIC_ACQUIRE);                      \
+		return pRing->send.cachedTail;                                                                          \
+	}                                                                                                           \
+	INLINE u##_bits AlignedChannelRecvHead##_bits(MidChannelAlignedRing##_bits* pRing, u##_bits t, int need)    \
+	{                                                                                                           \
+		if ((int)(u##_bits)(pRing->recv.cachedHead - t) < need)                                                      \
+			pRing->recv.cachedHead = __atomic_load_n(&pRing->send.head, __ATOMIC_ACQUIRE);                      \
+		return pRing->recv.cachedHead;                                                                          \
+	}
+
+MID_CHANNEL_RING_ACCESS_IMPL(8);
+MID_CHANNEL_RING_ACCESS_IMPL(16);
+MID_CHANNEL_RING_ACCESS_IMPL(32);
+
+/*
+ * Count is taken on the unmasked indices so it stays correct across the index wrap.
+ * One slot is kept open so h == t is always empty.
+ */
+#define MID_CHANNEL_FUNC_IMPL(_Ring, _func, _Access, _bits)                                                                                      \
+	MidResult _func##SendBegin##_bits(_Ring##_bits* pRing, int valueSize, int capacity, volatile void* pValues, volatile void** ppValue)         \
+	{                                                                                                                                            \
+		u##_bits h = __atomic_load_n(_Access##Head##_bits(pRing), __ATOMIC_RELAXED);                                                             \
+		u##_bits t = _Access##SendTail##_bits(pRing, h, capacity, 1);                                                                            \
+		if (capacity - 1 - (int)(u##_bits)(h - t) == 0) return MID_LIMIT_REACHED;                                                                     \
+		*ppValue = pValues + ((h & (capacity - 1)) * valueSize);                                                                                 \
+		return MID_SUCCESS;                                                                                                                      \
+	}                                                                                                                                            \
+                                                                                                                                                 \
+	MidResult _func##SendEnd##_bits(_Ring##_bits* pRing)                                                                                        \
+	{                                                                                                                                            \
+		__atomic_fetch_add(_Access##Head##_bits(pRing), 1, __ATOMIC_RELEASE);                                                                    \
+		return MID_RESULT_FINALIZED;                                                                                                             \
+	}                                                                                                                                            \
+                                                                                                                                                 \
+	MidResult _func##Send##_bits(_Ring##_bits* pRing, int valueSize, int capacity, volatile void* pValues, void* pValue)                        \
+	{                                                                                                                                            \
+		u##_bits h = __atomic_load_n(_Access##Head##_bits(pRing), __ATOMIC_RELAXED);                                                             \
+		u##_bits t = _Access##SendTail##_bits(pRing, h, capacity, 1);                                                                            \
+		if (capacity - 1 - (int)(u##_bits)(h - t) == 0) return MID_LIMIT_REACHED;                                                                     \
+		memcpy((void*)pValues + ((h & (capacity - 1)) * valueSize), pValue, valueSize);                                                          \
+		__atomic_store_n(_Access##Head##_bits(pRing), (u##_bits)(h + 1), __ATOMIC_RELEASE);                                                      \
+		return MID_SUCCESS;                                                                                                                      \
+	}                                                                                                                                            \
+                                                                                                                                                 \
+	MidResult _func##Recv##_bits(_Ring##_bits* pRing, int valueSize, int capacity, volatile void* pValues, void* pValue)                        \
+	{                                                                                                                                            \
+		u##_bits t = __atomic_load_n(_Access##Tail##_bits(pRing), __ATOMIC_RELAXED);                                                             \
+		u##_bits h = _Access##RecvHead##_bits(pRing, t, 1);                                                                                      \
+		if (h == t) return MID_EMPTY;                                                                                                            \
+		memcpy(pValue, (void*)pValues + ((t & (capacity - 1)) * valueSize), valueSize);                                                          \
+		__atomic_store_n(_Access##Tail##_bits(pRing), (u##_bits)(t + 1), __ATOMIC_RELEASE);                                                      \
+		return MID_SUCCESS;                                                                                                                      \
+	}                                                                                                                                            \
+                                                                                                                                                 \
+	int _func##SendReserve##_bits(_Ring##_bits* pRing, int valueSize, int capacity, volatile void* pValues, int count, volatile void** ppValues) \
+	{                                                                                                                                            \
+		u##_bits h = __atomic_load_n(_Access##Head##_bits(pRing), __ATOMIC_RELAXED);                                                             \
+		u##_bits t = _Access##SendTail##_bits(pRing, h, capacity, count);                                                                        \
+		int free = capacity - 1 - (int)(u##_bits)(h - t);                                                                                             \
+		int iHead = h & (capacity - 1);                                                                                                          \
+		int contiguous = capacity - iHead;                                                                                                       \
+		count = count < free ? count : free;                                                                                                     \
+		count = count < contiguous ? count : contiguous;                                                                                         \
+		*ppValues = pValues + (iHead * valueSize);                                                                                               \
+		return count;                                                                                                                            \
+	}                                                                                                                                            \
+                                                                                                                                                 \
+	void _func##SendCommit##_bits(_Ring##_bits* pRing, int count)                                                                               \
+	{                                                                                                                                            \
+		__atomic_fetch_add(_Access##Head##_bits(pRing), count, __ATOMIC_RELEASE);                                                                \
+	}                                                                                                                                            \
+                                                                                                                                                 \
+	int _func##RecvPeek##_bits(_Ring##_bits* pRing, int valueSize, int capacity, volatile void* pValues, int count, volatile void** ppValues)    \
+	{                                                                                                                                            \
+		u##_bits t = __atomic_load_n(_Access##Tail##_bits(pRing), __ATOMIC_RELAXED);                                                             \
+		u##_bits h = _Access##RecvHead##_bits(pRing, t, count);                                                                                  \
+		int used = (int)(u##_bits)(h - t);                                                                                                            \
+		int iTail = t & (capacity - 1);                                                                                                          \
+		int contiguous = capacity - iTail;                                                                                                       \
+		count = count < used ? count : used;                                                                                                     \
+		count = count < contiguous ? count : contiguous;                                                                                         \
+		*ppValues = pValues + (iTail * valueSize);                                                                                               \
+		return count;                                                                                                                            \
+	}                                                                                                                                            \
+                                                                                                                                                 \
+	void _func##RecvConsume##_bits(_Ring##_bits* pRing, int count)                                                                              \
+	{                                                                                                                                            \
+		__atomic_fetch_add(_Access##Tail##_bits(pRing), count, __ATOMIC_RELEASE);                                                                \
+	}                                                                                                                                            \
+                                                                                                                                                 \
+	int _func##SendN##_bits(_Ring##_bits* pRing, int valueSize, int capacity, volatile void* pValues, int count, void* pSrcValues)              \
+	{                                                                                                                                            \
+		u##_bits h = __atomic_load_n(_Access##Head##_bits(pRing), __ATOMIC_RELAXED);                                                             \
+		u##_bits t = _Access##SendTail##_bits(pRing, h, capacity, count);                                                                        \
+		int free = capacity - 1 - (int)(u##_bits)(h - t);                                                                                             \
+		count = count < free ? count : free;                                                                                                     \
+		if (count == 0) return 0;                                                                                                                \
+		int iHead = h & (capacity - 1);                                                                                                          \
+		int firstCount = capacity - iHead < count ? capacity - iHead : count;                                                                    \
+		memcpy((void*)pValues + (iHead * valueSize), pSrcValues, firstCount * valueSize);                                                        \
+		memcpy((void*)pValues, pSrcValues + (firstCount * valueSize), (count - firstCount) * valueSize);                                         \
+		__atomic_store_n(_Access##Head##_bits(pRing), (u##_bits)(h + count), __ATOMIC_RELEASE);                                                  \
+		return count;                                                                                                                            \
+	}                                                                                                                                            \
+                                                                                                                                                 \
+	int _func##RecvN##_bits(_Ring##_bits* pRing, int valueSize, int capacity, volatile void* pValues, int count, void* pDstValues)              \
+	{                                                                                                                                            \
+		u##_bits t = __atomic_load_n(_Access##Tail##_bits(pRing), __ATOMIC_RELAXED);                                                             \
+		u##_bits h = _Access##RecvHead##_bits(pRing, t, count);                                                                                  \
+		int used = (int)(u##_bits)(h - t);                                                                                                            \
+		count = count < used ? count : used;                                                                                                     \
+		if (count == 0) return 0;                                                                                                                \
+		int iTail = t & (capacity - 1);                                                                                                          \
+		int firstCount = capacity - iTail < count ? capacity - iTail : count;                                                                    \
+		memcpy(pDstValues, (void*)pValues + (iTail * valueSize), firstCount * valueSize);                                                        \
+		memcpy(pDstValues + (firstCount * valueSize), (void*)pValues, (count - firstCount) * valueSize);                                         \
+		__atomic_store_n(_Access##Tail##_bits(pRing), (u##_bits)(t + count), __ATOMIC_RELEASE);                                                  \
+		return count;                                                                                                                            \
+	}
+
+MID_CHANNEL_FUNC_IMPL(MidChannelRing, midChannel, Channel, 8);
+MID_CHANNEL_FUNC_IMPL(MidChannelRing, midChannel, Channel, 16);
+MID_CHANNEL_FUNC_IMPL(MidChannelRing, midChannel, Channel, 32);
+MID_CHANNEL_FUNC_IMPL(MidChannelAlignedRing, midChannelAligned, AlignedChannel, 8);
+MID_CHANNEL_FUNC_IMPL(MidChannelAlignedRing, midChannelAligned, AlignedChannel, 16);
+MID_CHANNEL_FUNC_IMPL(MidChannelAlignedRing, midChannelAligned, AlignedChannel, 32);
+
+/*
+ * The receiver only sleeps on an empty ring, so only the send that found tail == h can have a sleeper to wake.
+ * The fence still has to come before reading tail and waiting. Without it the loads can pass the head store,
+ * and a receiver that drains and flags waiting in that window sleeps through the send until the timeout.
+ */
+#define MID_CHANNEL_WAIT_IMPL(_bits)                                                                                                                  \
+	MidResult midChannelAlignedSendWake##_bits(MidChannelAlignedRing##_bits* pRing, int valueSize, int capacity, volatile void* pValues, void* pValue) \
+	{                                                                                                                                                 \
+		u##_bits h = __atomic_load_n(&pRing->send.head, __ATOMIC_RELAXED);                                                                           \
+		MidResult result = midChannelAlignedSend##_bits(pRing, valueSize, capacity, pValues, pValue);                                               \
+		if (result != MID_SUCCESS) return result;                                                                                                    \
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);                                                                                                     \
+		if (__atomic_load_n(&pRing->recv.tail, __ATOMIC_RELAXED) != h) return result;                                                              \
+		if (LIKELY(!__atomic_load_n(&pRing->recv.waiting, __ATOMIC_RELAXED))) return result;                                                       \
+		__atomic_fetch_add(&pRing->send.wake, 1, __ATOMIC_RELEASE);                                                                                  \
+		ChannelFutexWake(&pRing->send.wake);                                                                                                         \
+		return result;                                                                                                                               \
+	}                                                                                                                                                 \
+                                                                                                                                                      \
+	MidResult midChannelAlignedWait##_bits(MidChannelAlignedRing##_bits* pRing, u32 timeoutMs)                                                       \
+	{                                                                                                                                                 \
+		u##_bits t = __atomic_load_n(&pRing->recv.tail, __ATOMIC_RELAXED);                                                                          \
+		if (AlignedChannelRecvHead##_bits(pRing, t, 1) != t) return MID_SUCCESS;                                                                     \
+		u32 wake = ChannelWaitBegin(&pRing->send.wake, &pRing->recv.waiting);                                                                        \
+		bool empty = __atomic_load_n(&pRing->send.head, __ATOMIC_ACQUIRE) == t;                                                                      \
+		ChannelWaitEnd(&pRing->send.wake, &pRing->recv.waiting, wake, empty, timeoutMs);                                                            \
+		return AlignedChannelRecvHead##_bits(pRing, t, 1) != t ? MID_SUCCESS : MID_EMPTY;                                                            \
+	}
+
+MID_CHANNEL_WAIT_IMPL(8);
+MID_CHANNEL_WAIT_IMPL(16);
+MID_CHANNEL_WAIT_IMPL(32);
+
+/*
+ * The sequence of slot i is (lap * capacity) relative to its index when free for position pos,
+ * lap base + 1 when written, and next lap base once consumed. Lap base is pos & ~(capacity - 1).
+ */
+MidResult midChannelMpscSend(MidChannelMpscRing* pRing, volatile u32* pSequences, int valueSize, int capacity, volatile void* pValues, void* pValue)
+{
+	u32 mask = capacity - 1;
+	u32 pos = __atomic_load_n(&pRing->send.head, __ATOMIC_RELAXED);
+	while (true) {
+		u32 seq = __atomic_load_n(&pSequences[pos & mask], __ATOMIC_ACQUIRE);
+		i32 diff = (i32)(seq - (pos & ~mask));
+		if (diff == 0) {
+			if (__atomic_compare_exchange_n(&pRing->send.head, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+				break;
+		}
+		else if (diff < 0) return MID_LIMIT_REACHED; // Slot from the previous lap not consumed yet
+		else pos = __atomic_load_n(&pRing->send.head, __ATOMIC_RELAXED); // Another producer took pos
+	}
+	memcpy((void*)pValues + ((pos & mask) * valueSize), pValue, valueSize);
+	__atomic_store_n(&pSequences[pos & mask], (pos & ~mask) + 1, __ATOMIC_RELEASE);
+	ChannelNotify(&pRing->send.wake, &pRing->send.waiting);
+	return MID_SUCCESS;
+}
+
+MidResult midChannelMpscRecv(MidChannelMpscRing* pRing, volatile u32* pSequences, int valueSize, int capacity, volatile void* pValues, void* pValue)
+{
+	u32 mask = capacity - 1;
+	u32 pos = __atomic_load_n(&pRing->recv.tail, __ATOMIC_RELAXED);
+	u32 seq = __atomic_load_n(&pSequences[pos & mask], __ATOMIC_ACQUIRE);
+	if ((i32)(seq - ((pos & ~mask) + 1)) < 0) return MID_EMPTY;
+	memcpy(pValue, (void*)pValues + ((pos & mask) * valueSize), valueSize);
+	__atomic_store_n(&pSequences[pos & mask], (pos & ~mask) + capacity, __ATOMIC_RELEASE);
+	__atomic_store_n(&pRing->recv.tail, pos + 1, __ATOMIC_RELAXED);
+	return MID_SUCCESS;
+}
+
+bool midChannelMpscEmpty(MidChannelMpscRing* pRing, volatile u32* pSequences, int capacity)
+{
+	u32 mask = capacity - 1;
+	u32 pos = __atomic_load_n(&pRing->recv.tail, __ATOMIC_RELAXED);
+	u32 seq = __atomic_load_n(&pSequences[pos & mask], __ATOMIC_ACQUIRE);
+	return (i32)(seq - ((pos & ~mask) + 1)) < 0;
+}
+
+u32 midChannelMpscWaitBegin(MidChannelMpscRing* pRing)
+{
+	return ChannelWaitBegin(&pRing->send.wake, &pRing->send.waiting);
+}
+
+void midChannelMpscWaitEnd(MidChannelMpscRing* pRing, u32 wake, bool empty, u32 timeoutMs)
+{
+	ChannelWaitEnd(&pRing->send.wake, &pRing->send.waiting, wake, empty, timeoutMs);
+}
+
+MidResult midChannelMpscWait(MidChannelMpscRing* pRing, volatile u32* pSequences, int capacity, u32 timeoutMs)
+{
+	if (!midChannelMpscEmpty(pRing, pSequences, capacity)) return MID_SUCCESS;
+	u32 wake = midChannelMpscWaitBegin(pRing);
+	midChannelMpscWaitEnd(pRing, wake, midChannelMpscEmpty(pRing, pSequences, capacity), timeoutMs);
+	return midChannelMpscEmpty(pRing, pSequences, capacity) ? MID_EMPTY : MID_SUCCESS;
+}
+
+void midChannelMpscNotify(MidChannelMpscRing* pRing)
+{
+	ChannelNotify(&pRing->send.wake, &pRing->send.waiting);
+}
+
+#define RECORD_ALIGN_UP(_size) (((_size) + MID_CHANNEL_RECORD_ALIGN - 1) & ~(MID_CHANNEL_RECORD_ALIGN - 1))
+
+MidResult midChannelRecordSendBegin(MidChannelRecordRing* pRing, int capacity, volatile u8* pBytes, int size, volatile void** ppRecord)
+{
+	u32 recordSize = RECORD_ALIGN_UP(sizeof(MidChannelRecordHeader) + size);
+	u32 h = __atomic_load_n(&pRing->send.head, __ATOMIC_RELAXED);
+	u32 iHead = h & (capacity - 1);
+	u32 contiguous = capacity - iHead;
+	u32 need = recordSize + (contiguous < recordSize ? contiguous : 0);
+	if (UNLIKELY(need > (u32)capacity)) return MID_LIMIT_REACHED;
+
+	if (capacity - (h - pRing->send.cachedTail) < need) {
+		pRing->send.cachedTail = __atomic_load_n(&pRing->recv.tail, __ATOMIC_ACQUIRE);
+		if (capacity - (h - pRing->send.cachedTail) < need) return MID_LIMIT_REACHED;
+	}
+
+	if (contiguous < recordSize) {
+		((MidChannelRecordHeader*)(pBytes + iHead))->size = MID_CHANNEL_RECORD_WRAP;
+		iHead = 0;
+	}
+
+	((MidChannelRecordHeader*)(pBytes + iHead))->size = size;
+	*ppRecord = pBytes + iHead + sizeof(MidChannelRecordHeader);
+	pRing->send.pendingHead = h + need;
 	return MID_SUCCESS;
 }
 
-MidResult midChannelSendEnd(volatile MidChannelRing* pRing)
+MidResult midChannelRecordSendEnd(MidChannelRecordRing* pRing)
 {
-	__atomic_fetch_add(&pRing->head, 1, __ATOMIC_ACQUIRE); // Automatically wrap u8 to 0 at 256
+	__atomic_store_n(&pRing->send.head, pRing->send.pendingHead, __ATOMIC_RELEASE);
 	return MID_RESULT_FINALIZED;
 }
 
-MidResult midChannelSend(volatile MidChannelRing* pRing, int valueSize, int capacity, volatile void* pValues, void* pValue)
+MidResult midChannelRecordSend(MidChannelRecordRing* pRing, int capacity, volatile u8* pBytes, int size, void* pRecord)
 {
-	__atomic_thread_fence(__ATOMIC_ACQUIRE);
-	channel_ring_h h = pRing->head & (capacity - 1);
-	channel_ring_h t = pRing->tail & (capacity - 1);
-	if (h + 1 == t) return MID_LIMIT_REACHED;
-    memcpy((void*)pValues + (h * valueSize), pValue, valueSize);
-	__atomic_fetch_add(&pRing->head, 1, __ATOMIC_RELEASE); // Automatically wrap u8 to 0 at 256
+	volatile void* pDst;
+	MidResult result = midChannelRecordSendBegin(pRing, capacity, pBytes, size, &pDst);
+	if (result != MID_SUCCESS) return result;
+	memcpy((void*)pDst, pRecord, size);
+	midChannelRecordSendEnd(pRing);
 	return MID_SUCCESS;
 }
 
-MidResult midChannelRecv(volatile MidChannelRing* pRing, int valueSize, int capacity, volatile void* pValues, void* pValue)
+MidResult midChannelRecordRecv(MidChannelRecordRing* pRing, int capacity, volatile u8* pBytes, int maxSize, void* pRecord, int* pSize)
 {
-	__atomic_thread_fence(__ATOMIC_ACQUIRE);
-	channel_ring_h h = pRing->head & (capacity - 1);
-	channel_ring_h t = pRing->tail & (capacity - 1);
-	if (h == t) return MID_EMPTY;
-	memcpy(pValue, (void*)pValues + (t * valueSize), valueSize);
-	__atomic_fetch_add(&pRing->tail, 1, __ATOMIC_RELEASE); // Automatically wrap u8 to 0 at 256
+	u32 t = __atomic_load_n(&pRing->recv.tail, __ATOMIC_RELAXED);
+	if (t == pRing->recv.cachedHead) {
+		pRing->recv.cachedHead = __atomic_load_n(&pRing->send.head, __ATOMIC_ACQUIRE);
+		if (t == pRing->recv.cachedHead) return MID_EMPTY;
+	}
+
+	// Wrap header is always published with the record after it so there is no need to check empty again.
+	u32 iTail = t & (capacity - 1);
+	u32 size = ((MidChannelRecordHeader*)(pBytes + iTail))->size;
+	if (size == MID_CHANNEL_RECORD_WRAP) {
+		t += capacity - iTail;
+		iTail = 0;
+		size = ((MidChannelRecordHeader*)pBytes)->size;
+	}
+
+	ASSERT(size <= (u32)maxSize, "Record larger than receive buffer!");
+	memcpy(pRecord, (void*)pBytes + iTail + sizeof(MidChannelRecordHeader), size < (u32)maxSize ? size : (u32)maxSize);
+	if (pSize != NULL) *pSize = size;
+	__atomic_store_n(&pRing->recv.tail, t + RECORD_ALIGN_UP(sizeof(MidChannelRecordHeader) + size), __ATOMIC_RELEASE);
 	return MID_SUCCESS;
 }
 
@@ -108,6 +108,21 @@ typedef _Atomic uint64_t a_u64;
 	REQUIRE(_p, #_p " XMALLOC Fail!"); \
 	ZERO_STRUCT_P(_p);
 
+// For types with CACHE_ALIGN members, plain malloc only guarantees 16.
+#ifdef _WIN32
+#define ALIGNED_MALLOC(_align, _size) _aligned_malloc(_size, _align)
+#define ALIGNED_FREE(_p)              _aligned_free(_p)
+#else
+// aligned_alloc requires size to be a multiple of align
+#define ALIGNED_MALLOC(_align, _size) aligned_alloc(_align, ((_size) + (_align) - 1) & ~((size_t)(_align) - 1))
+#define ALIGNED_FREE(_p)              free(_p)
+#endif
+
+#define XMALLOC_ALIGNED_ZERO_P(_p) \
+	_p = ALIGNED_MALLOC(_Alignof(typeof(*_p)), sizeof(*_p)); \
+	REQUIRE(_p, #_p " XMALLOC Fail!"); \
+	ZERO_STRUCT_P(_p);
+
 #define CONTAINS(_array, _count, _)        \
 	({                                     \
 		bool found = false;                \
@@ -248,7 +248,7 @@ typedef struct XrEventDataSpaceBoundsChanged {
 	XR_SPACE_LOCATION_ORIENTATION_TRACKED_BIT | \
 	XR_SPACE_LOCATION_POSITION_TRACKED_BIT
 
-typedef u16 session_i; // session could probably be sessionId since it being contiguous on other side doesn't matter
+typedef block_handle32 session_i; // The session's node handle, generation included so a released session id fails
 typedef u16 swap_i;
 typedef u8  view_i;
 
@@ -266,7 +266,7 @@ void xrGetReferenceSpaceBounds(session_i iSession, XrExtent2Df* pBounds);
 XrResult xrCreateSwapchainImages(session_i iSession, swap_i iSwap, const XrSwapInfo* pSwapInfo);
 void xrGetSwapchainImportedImage(session_i iSession, swap_i iSwap, u32 iImg, HANDLE* pHandle);
 XrResult xrDestroySwapchainImages(session_i iSession, swap_i iSwap);
-void xrSetColorSwapId(session_i iSession, XrViewId viewId, swap_i iSwap, u32 iImg);
+void xrSetColorSwapId(session_i iSession, XrViewId viewId, swap_i iSwap, u32 iImg, XrRect2Di imageRect);
 void xrSetDepthSwapId(session_i iSession, XrViewId viewId, swap_i iSwap, u32 iImg);
 void xrSetDepthInfo(session_i iSession, float minDepth, float maxDepth, float nearZ, float farZ);
 
@@ -363,7 +363,7 @@ typedef struct SetBase {
  * OpenXR Types
  */
 
-typedef block_handle swap_h;
+typedef block_handle32 swap_h;
 typedef block_handle space_h;
 typedef block_handle session_h;
 typedef block_handle profile_h;
@@ -557,6 +557,9 @@ typedef union XrEventDataUnion {
 	XrEventDataUserPresenceChangedEXT      userPresenceChanged;
 } XrEventDataUnion;
 
+// Events are queued as variable length records so each only takes its own size.
+#define XR_EVENT_DATA_QUEUE_SIZE 16384
+
 typedef struct Instance {
 	/* System */
 	XrApplicationInfo applicationInfo;
@@ -577,8 +580,8 @@ typedef struct Instance {
 	} graphics;
 
 	/* Events */
-	MidChannelRing         eventDataQueue;
-	XrEventDataUnion queuedEventDataBuffers[MID_QRING_CAPACITY];
+	MidChannelRecordRing eventDataQueue;
+	ALIGN(MID_CHANNEL_RECORD_ALIGN) u8 queuedEventData[XR_EVENT_DATA_QUEUE_SIZE];
 
 } Instance;
 
@@ -594,14 +597,14 @@ static struct {
 
 	struct {
 		BLOCK_T_N(Session, XR_SESSIONS_CAPACITY)                       session;
-		BLOCK_T_N(Path, XR_PATH_CAPACITY)                              path;
-		BLOCK_T_N(Binding, XR_BINDINGS_CAPACITY)                       binding;
+		BLOCK_FIFO_T_N(Path, XR_PATH_CAPACITY)                         path;
+		BLOCK_FIFO_T_N(Binding, XR_BINDINGS_CAPACITY)                  binding;
 		BLOCK_T_N(InteractionProfile, XR_INTERACTION_PROFILE_CAPACITY) profile;
 		BLOCK_T_N(ActionSet, XR_ACTION_SET_CAPACITY)                   actionSet;
 		BLOCK_T_N(Action, XR_ACTION_CAPACITY)                          action;
-		BLOCK_T_N(SubactionState, XR_SUBACTION_CAPACITY)               state;
+		BLOCK_FIFO_T_N(SubactionState, XR_SUBACTION_CAPACITY)          state;
 		BLOCK_T_N(Space, XR_SPACE_CAPACITY)                            space;
-		BLOCK_T_N(Swapchain, XR_SWAPCHAIN_CAPACITY)                    swap;
+		BLOCK32_FIFO_T_N(Swapchain, XR_SWAPCHAIN_CAPACITY)             swap;
 	} block;
 
 } xr;
@@ -886,7 +889,7 @@ xrStructureTypeToString(XrInstance instance, XrStructureType value, char buffer[
  * ================================================================
  */
 #define XR_EVENT_ENQUEUE_SCOPE(_pData) \
-	MID_CHANNEL_SEND_SCOPE(&xr.instance.eventDataQueue, xr.instance.queuedEventDataBuffers, _pData)
+	MID_CHANNEL_RECORD_SEND_SCOPE(&xr.instance.eventDataQueue, xr.instance.queuedEventData, _pData)
 
 static void
 EnqueueEventDataSessionStateChanged(session_h hSession, XrSessionState sessionState)
@@ -895,9 +898,9 @@ EnqueueEventDataSessionStateChanged(session_h hSession, XrSessionState sessionSt
 	pSession->activeSessionState = sessionState;
 
 	XrSession session = XR_TO_OPAQUE_H(XrSession, hSession);
-	XrEventDataUnion* pEventData;
+	XrEventDataSessionStateChanged* pEventData;
 	XR_EVENT_ENQUEUE_SCOPE(pEventData) {
-		pEventData->sessionStateChanged = (XrEventDataSessionStateChanged){
+		*pEventData = (XrEventDataSessionStateChanged){
 			.type = XR_TYPE_EVENT_DATA_SESSION_STATE_CHANGED,
 			.session = session,
 			.state = sessionState,
@@ -918,9 +921,9 @@ EnqueueEventDataReferenceSpaceChangePending(session_h            hSession,
 	Session* pSession = BLOCK_PTR_H(xr.block.session, hSession);
 	pSession->hActiveReferenceSpace = hSpace;
 
-	XrEventDataUnion* pSpaceEventData;
+	XrEventDataReferenceSpaceChangePending* pSpaceEventData;
 	XR_EVENT_ENQUEUE_SCOPE(pSpaceEventData)	{
-		pSpaceEventData->referenceSpaceChangePending = (XrEventDataReferenceSpaceChangePending){
+		*pSpaceEventData = (XrEventDataReferenceSpaceChangePending){
 			.type = XR_TYPE_EVENT_DATA_REFERENCE_SPACE_CHANGE_PENDING,
 			.session = XR_TO_OPAQUE_H(XrSession, hSession),
 			.referenceSpaceType = referenceSpaceType,
@@ -940,9 +943,9 @@ EnqueueEventDataInteractionProfileChanged(session_h hSession, profile_h hProfile
 	Session* pSession = BLOCK_PTR_H(xr.block.session, hSession);
 	pSession->hActiveInteractionProfile = hProfile;
 
-	XrEventDataUnion* pEventData;
+	XrEventDataInteractionProfileChanged* pEventData;
 	XR_EVENT_ENQUEUE_SCOPE(pEventData) {
-		pEventData->interactionProfileChanged = (XrEventDataInteractionProfileChanged){
+		*pEventData = (XrEventDataInteractionProfileChanged){
 			.type = XR_TYPE_EVENT_DATA_INTERACTION_PROFILE_CHANGED,
 			.session = XR_TO_OPAQUE_H(XrSession, hSession),
 		};
@@ -958,9 +961,9 @@ EnqueueEventDataUserPresenceChanged(session_h hSession, XrBool32 isUserPresent)
 	Session* pSession = BLOCK_PTR_H(xr.block.session, hSession);
 	pSession->activeIsUserPresent = isUserPresent;
 
-	XrEventDataUnion* pEventData;
+	XrEventDataUserPresenceChangedEXT* pEventData;
 	XR_EVENT_ENQUEUE_SCOPE(pEventData) {
-		pEventData->userPresenceChanged = (XrEventDataUserPresenceChangedEXT){
+		*pEventData = (XrEventDataUserPresenceChangedEXT){
 			.type = XR_TYPE_EVENT_DATA_USER_PRESENCE_CHANGED_EXT,
 			.session = XR_TO_OPAQUE_H(XrSession, hSession),
 			.isUserPresent = isUserPresent,
@@ -1018,11 +1021,9 @@ RegisterBinding(XrInstance instance,
 	Path*               pBindPath    = BLOCK_PTR_H(xr.block.path, hBindPath);
 	block_key           bindPathHash = BLOCK_KEY(xr.block.path,    pBindPath);
 
-	for (u32 i = 0; i < pProfile->bindings.count; ++i) {
-		if (pProfile->bindings.keys[i] == bindPathHash) {
-			LOG_ERROR("Trying to register path hash twice! %s %d\n", pBindPath->string, bindPathHash);
-			return XR_ERROR_PATH_INVALID;
-		}
+	if (HANDLE_VALID(MAP_FIND(pProfile->bindings, bindPathHash))) {
+		LOG_ERROR("Trying to register path hash twice! %s %d\n", pBindPath->string, bindPathHash);
+		return XR_ERROR_PATH_INVALID;
 	}
 
 	bind_h   hBind = BLOCK_CLAIM(xr.block.binding, bindPathHash);
@@ -1429,7 +1430,7 @@ xrPollEvent(XrInstance instance, XrEventDataBuffer* eventData)
 
 	XrEventDataUnion* pEventData = (XrEventDataUnion*)eventData;
 	pEventData->dataBuffer.type = 0;
-	MID_CHANNEL_RECV(&xr.instance.eventDataQueue, xr.instance.queuedEventDataBuffers, pEventData);
+	MID_CHANNEL_RECORD_RECV(&xr.instance.eventDataQueue, xr.instance.queuedEventData, pEventData, sizeof(XrEventDataBuffer), NULL);
 	switch(pEventData->dataBuffer.type)
 	{
 		case XR_TYPE_EVENT_DATA_SESSION_STATE_CHANGED: {
@@ -1597,9 +1598,9 @@ xrCreateSession(XrInstance instance, const XrSessionCreateInfo* createInfo, XrSe
 		LOG_ERROR("%s\n", string_XrResult(claimResult));
 		return claimResult;
 	}
-	LOG("Claimed iSession %d\n", iSession);
+	LOG("Claimed iSession %d\n", HANDLE_INDEX(iSession));
 
-	session_h hSession = BLOCK_CLAIM(xr.block.session, iSession);
+	session_h hSession = BLOCK_CLAIM(xr.block.session, iSession.id);
 	Session*  pSession = BLOCK_PTR_H(xr.block.session, hSession);
 	memset(pSession, 0, sizeof(Session));
 	pSession->index = iSession;
@@ -2508,7 +2509,7 @@ XR_PROC xrDestroySwapchain(XrSwapchain swapchain)
 	LOG_METHOD(xrDestroySwapchain);
 	auto_t    pSwap    = (Swapchain*)swapchain;
 	Session*  pSession = BLOCK_PTR_H(B.session, pSwap->hSession);
-	session_i iSession = HANDLE_INDEX( pSwap->hSession);
+	session_i iSession = pSession->index;
 
 	switch (xr.instance.graphicsApi) {
 
@@ -2975,7 +2976,7 @@ XR_PROC xrEndFrame(XrSession session,
 						    EXPAND_STRUCT(XrOffset2Di, pView->subImage.imageRect.offset),
 						    EXPAND_STRUCT(XrExtent2Di, pView->subImage.imageRect.extent));
 
-						xrSetColorSwapId(pSession->index, iView, iColorSwap, iColorSwapImg);
+						xrSetColorSwapId(pSession->index, iView, iColorSwap, iColorSwapImg, pView->subImage.imageRect);
 					}
 
 					switch (pView->next != NULL ? *(XrStructureType*)pView->next : 0) {
@@ -3266,14 +3267,14 @@ xrStringToPath(XrInstance instance, const char* pathString, XrPath* path)
 	}
 
 	u32 pathHash = CalcDJB2(pathString, XR_MAX_PATH_LENGTH);
-	for (u32 i = 0; i < XR_PATH_CAPACITY; ++i) {
-		if (xr.block.path.keys[i] != pathHash) continue;
-		if (strncmp(xr.block.path.blocks[i].string, pathString, XR_MAX_PATH_LENGTH)) {
-			LOG_ERROR("Path Hash Collision! %s | %s\n", xr.block.path.blocks[i].string, pathString);
+	path_h hFoundPath = BLOCK_FIND(xr.block.path, pathHash);
+	if (HANDLE_VALID(hFoundPath)) {
+		Path* pFoundPath = BLOCK_PTR_H(xr.block.path, hFoundPath);
+		if (strncmp(pFoundPath->string, pathString, XR_MAX_PATH_LENGTH)) {
+			LOG_ERROR("Path Hash Collision! %s | %s\n", pFoundPath->string, pathString);
 			return XR_ERROR_PATH_COUNT_EXCEEDED;
 		}
-		LOG_VERBOSE("Path Handle Found: %d\n    %s\n", i, xr.block.path.blocks[i].string);
-		path_h hFoundPath = BLOCK_HANDLE(xr.block.path, xr.block.path.blocks + i);
+		LOG_VERBOSE("Path Handle Found: %d\n    %s\n", HANDLE_INDEX(hFoundPath), pFoundPath->string);
 		*path = XR_TO_ATOM(XR_ATOM_TYPE_PATH, hFoundPath);
 		return XR_SUCCESS;
 	}
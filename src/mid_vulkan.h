@@ -47,36 +47,39 @@
 // move everything to this
 #ifndef PFN_FUNCS
 
-#define PFN_FUNCS                      \
-	PFN_FUNC(WaitSemaphores)           \
-	PFN_FUNC(ResetCommandBuffer)       \
-	PFN_FUNC(BeginCommandBuffer)       \
-	PFN_FUNC(CmdSetViewport)           \
-	PFN_FUNC(CmdBeginRenderPass)       \
-	PFN_FUNC(CmdSetScissor)            \
-	PFN_FUNC(CmdBindPipeline)          \
-	PFN_FUNC(CmdDispatch)              \
-	PFN_FUNC(CmdBindDescriptorSets)    \
-	PFN_FUNC(CmdBindVertexBuffers)     \
-	PFN_FUNC(CmdBindIndexBuffer)       \
-	PFN_FUNC(CmdDrawIndexed)           \
-	PFN_FUNC(CmdEndRenderPass)         \
-	PFN_FUNC(EndCommandBuffer)         \
-	PFN_FUNC(CmdPipelineBarrier2)      \
-	PFN_FUNC(CmdPushDescriptorSetKHR)  \
-	PFN_FUNC(CmdPushConstants)         \
-	PFN_FUNC(CmdClearColorImage)       \
-	PFN_FUNC(ResetQueryPool)           \
-	PFN_FUNC(GetQueryPoolResults)      \
-	PFN_FUNC(CmdWriteTimestamp2)       \
-	PFN_FUNC(CmdBlitImage)             \
-	PFN_FUNC(AcquireNextImageKHR)      \
-	PFN_FUNC(CmdDrawMeshTasksEXT)      \
-	PFN_FUNC(SignalSemaphore)          \
-	PFN_FUNC(QueueSubmit2)             \
-	PFN_FUNC(QueuePresentKHR)          \
-	PFN_FUNC(UpdateDescriptorSets)     \
-	PFN_FUNC(GetSemaphoreCounterValue) \
+#define PFN_FUNCS                         \
+	PFN_FUNC(WaitSemaphores)              \
+	PFN_FUNC(ResetCommandBuffer)          \
+	PFN_FUNC(BeginCommandBuffer)          \
+	PFN_FUNC(CmdSetViewport)              \
+	PFN_FUNC(CmdBeginRenderPass)          \
+	PFN_FUNC(CmdSetScissor)               \
+	PFN_FUNC(CmdBindPipeline)             \
+	PFN_FUNC(CmdDispatch)                 \
+	PFN_FUNC(CmdBindDescriptorSets)       \
+	PFN_FUNC(CmdBindVertexBuffers)        \
+	PFN_FUNC(CmdBindIndexBuffer)          \
+	PFN_FUNC(CmdDrawIndexed)              \
+	PFN_FUNC(CmdDrawIndexedIndirect)      \
+	PFN_FUNC(CmdDispatchIndirect)         \
+	PFN_FUNC(CmdEndRenderPass)            \
+	PFN_FUNC(EndCommandBuffer)            \
+	PFN_FUNC(CmdPipelineBarrier2)         \
+	PFN_FUNC(CmdPushDescriptorSetKHR)     \
+	PFN_FUNC(CmdPushConstants)            \
+	PFN_FUNC(CmdClearColorImage)          \
+	PFN_FUNC(ResetQueryPool)              \
+	PFN_FUNC(GetQueryPoolResults)         \
+	PFN_FUNC(CmdWriteTimestamp2)          \
+	PFN_FUNC(CmdBlitImage)                \
+	PFN_FUNC(AcquireNextImageKHR)         \
+	PFN_FUNC(CmdDrawMeshTasksEXT)         \
+	PFN_FUNC(CmdDrawMeshTasksIndirectEXT) \
+	PFN_FUNC(SignalSemaphore)             \
+	PFN_FUNC(QueueSubmit2)                \
+	PFN_FUNC(QueuePresentKHR)             \
+	PFN_FUNC(UpdateDescriptorSets)        \
+	PFN_FUNC(GetSemaphoreCounterValue)    \
 	PFN_FUNC(SetDebugUtilsObjectNameEXT)
 
 #endif
@@ -217,6 +220,7 @@ typedef struct VkDedicatedTexture {
 	VkImage        image;
 	VkImageView    view;
 	VkDeviceMemory memory;
+	VkDeviceSize   memoryOffset; // Into memory when sub-allocated from a block
 } VkDedicatedTexture;
 
 typedef struct VkMeshOffsets {
@@ -228,6 +232,7 @@ typedef struct VkMeshOffsets {
 
 typedef struct VkMesh {
 	VkDeviceMemory mem;
+	VkDeviceSize   memOffset;
 	VkBuffer       buf;
 	VkMeshOffsets  offsets;
 } VkMesh;
@@ -273,6 +278,8 @@ static const char* string_VkQueueFamilyType[] = {
 	[VK_QUEUE_FAMILY_TYPE_DEDICATED_TRANSFER] = "VK_QUEUE_FAMILY_TYPE_DEDICATED_TRANSFER",
 };
 
+#define VK_QUEUED_COMMAND_BUFFER_CAPACITY 128
+
 typedef struct VkQueuedCommandBuffer {
 	VkCommandBuffer cmd;
 	VkSemaphore     timeline;
@@ -283,8 +290,10 @@ typedef struct VkQueueFamily {
 	u32     index;
 	VkQueue queue;
 
-	MidChannelRing              cmdQueue;
-	VkQueuedCommandBuffer queuedCmds[128];
+	// Any thread may enqueue, only the context thread drains
+	MidChannelMpscRing    cmdQueue;
+	u32                   queuedCmdSequences[VK_QUEUED_COMMAND_BUFFER_CAPACITY];
+	VkQueuedCommandBuffer queuedCmds[VK_QUEUED_COMMAND_BUFFER_CAPACITY];
 
 	VkSemaphore   immediateTimeline;
 	a_u64   immediateTimelineValue;
@@ -312,6 +321,7 @@ typedef struct VkContext {
 	VkDescriptorSetLayout materialPushSetLayout;
 
 	VkRenderPass  depthRenderPass;
+	VkRenderPass  depthPreserveRenderPass; // Compatible with depthRenderPass. Clears and redraws only the render area.
 	VkFramebuffer depthFramebuffer;
 
 	VkPipelineLayout trianglePipeLayout;
@@ -323,6 +333,9 @@ typedef struct VkContext {
 	VkSampler nearestSampler;
 	VkSampler linearSampler;
 
+	// Loaded from VK_PIPELINE_CACHE_PATH on context creation and shared by every pipeline created
+	VkPipelineCache pipelineCache;
+
 } VkContext;
 
 #define VK_IS_CONTEXT_THREAD (vk.context.threadId == pthread_self())
@@ -342,9 +355,56 @@ typedef struct CACHE_ALIGN Vk {
 extern Vk vk;
 
 
+// Bytes of host visible memory each thread stages uploads through
+#ifndef VK_STAGING_RING_SIZE
+#define VK_STAGING_RING_SIZE (16 * 1024 * 1024)
+#endif
+#define VK_STAGING_BATCH_CAPACITY 8
+// Every copy source starts on a 16 byte boundary
+#define VK_STAGING_ALIGN(_size) (((_size) + 15) & ~(VkDeviceSize)15)
+
+// Transfer command buffer and the end of the ring bytes it copies from
+typedef struct VkStagingBatch {
+	VkCommandBuffer cmd;
+	u64             end;
+	u64             timelineValue;
+} VkStagingBatch;
+
+// Persistently mapped upload ring on the dedicated transfer family. Head and tail count every byte
+// written and reclaimed so head - tail is what batches still in flight or recording hold.
+typedef struct VkStagingRing {
+	VkDeviceMemory memory;
+	VkDeviceSize   memoryOffset;
+	VkBuffer       buffer;
+	u8*            pMapped;
+	u64            head;
+	u64            tail;
+
+	VkCommandPool  pool;
+	VkSemaphore    timeline;
+	u64            timelineValue; // Signalled by the last submitted batch
+	VkStagingBatch batches[VK_STAGING_BATCH_CAPACITY];
+	u32            iBatchHead; // Recording, or next to record
+	u32            iBatchTail; // Oldest in flight
+	bool           isRecording;
+} VkStagingRing;
+
+// Immediate command buffers are recycled round robin once the immediateTimeline value they last signalled is reached
+#ifndef VK_IMMEDIATE_COMMAND_BUFFER_CAPACITY
+#define VK_IMMEDIATE_COMMAND_BUFFER_CAPACITY 8
+#endif
+
+typedef struct VkImmediateRing {
+	VkCommandPool   pool;
+	VkCommandBuffer cmds[VK_IMMEDIATE_COMMAND_BUFFER_CAPACITY];
+	u64             signalValues[VK_IMMEDIATE_COMMAND_BUFFER_CAPACITY]; // 0 if never submitted
+	u32             iNext;
+} VkImmediateRing;
+
 typedef struct VkThreadContext {
 	VkDescriptorPool descriptorPool;
-	VkCommandPool    immediatePools[VK_QUEUE_FAMILY_TYPE_COUNT];
+	VkImmediateRing  immediateRings[VK_QUEUE_FAMILY_TYPE_COUNT];
+	VkStagingRing    stagingRing;
 } VkThreadContext;
 extern __thread VkThreadContext threadContext;
 
@@ -652,6 +712,12 @@ enum {
 		cmd != VK_NULL_HANDLE;                                              \
 		vkEndImmediateCommandBuffer(familyType, cmd), cmd = VK_NULL_HANDLE)
 
+// Submits without waiting and stores the immediateTimeline value it signals in signalValue
+#define VK_IMMEDIATE_COMMAND_BUFFER_ASYNC_CONTEXT(familyType, signalValue)                      \
+	for (VkCommandBuffer cmd = vkBeginImmediateCommandBuffer(familyType);                       \
+		cmd != VK_NULL_HANDLE;                                                                  \
+		signalValue = vkEndImmediateCommandBufferAsync(familyType, cmd), cmd = VK_NULL_HANDLE)
+
 INLINE void CmdPipelineImageBarriers2(VkCommandBuffer cmd, uint32_t imageMemoryBarrierCount, const VkImageMemoryBarrier2* pImageMemoryBarriers) {
 	vk.CmdPipelineBarrier2(cmd, &(VkDependencyInfo){VK_STRUCTURE_TYPE_DEPENDENCY_INFO, .imageMemoryBarrierCount = imageMemoryBarrierCount, .pImageMemoryBarriers = pImageMemoryBarriers});
 }
@@ -670,13 +736,14 @@ INLINE void CmdBlitImageFullScreen(VkCommandBuffer cmd, VkImage srcImage, VkImag
 		}, VK_FILTER_NEAREST);
 }
 
-INLINE void CmdBeginDepthRenderPass(
+INLINE void CmdBeginDepthRenderPassArea(
 	VkCommandBuffer   cmd,
 	VkRenderPass      renderPass,
 	VkFramebuffer     framebuffer,
 	VkClearColorValue clearColor,
 	VkImageView       colorView,
-	VkImageView       depthView)
+	VkImageView       depthView,
+	VkRect2D          renderArea)
 {
 	vk.CmdBeginRenderPass(cmd, &(VkRenderPassBeginInfo){
 			VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
@@ -690,7 +757,7 @@ INLINE void CmdBeginDepthRenderPass(
 			},
 			.renderPass = renderPass,
 			.framebuffer = framebuffer,
-			.renderArea = {.extent = {.width = DEFAULT_WIDTH, .height = DEFAULT_HEIGHT}},
+			.renderArea = renderArea,
 			.clearValueCount = VK_RENDER_PASS_ATTACHMENT_INDEX_COUNT,
 			.pClearValues = (VkClearValue[]){
 				[VK_RENDER_PASS_ATTACHMENT_INDEX_COLOR] = {.color        = clearColor},
@@ -699,6 +766,18 @@ INLINE void CmdBeginDepthRenderPass(
 		}, VK_SUBPASS_CONTENTS_INLINE);
 }
 
+INLINE void CmdBeginDepthRenderPass(
+	VkCommandBuffer   cmd,
+	VkRenderPass      renderPass,
+	VkFramebuffer     framebuffer,
+	VkClearColorValue clearColor,
+	VkImageView       colorView,
+	VkImageView       depthView)
+{
+	VkRect2D renderArea = {.extent = {.width = DEFAULT_WIDTH, .height = DEFAULT_HEIGHT}};
+	CmdBeginDepthRenderPassArea(cmd, renderPass, framebuffer, clearColor, colorView, depthView, renderArea);
+}
+
 //INLINE void CmdBeginDepthNormalRenderPass(
 //	VkCommandBuffer   cmd,
 //	VkRenderPass      renderPass,
@@ -736,6 +815,13 @@ INLINE void CmdResetBegin(VkCommandBuffer cmd)
 	VK_ASSERT(vk.BeginCommandBuffer(cmd, &(VkCommandBufferBeginInfo){.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO, .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT}));
 }
 
+// For command buffers recorded once and submitted again each time their inputs are unchanged
+INLINE void CmdResetBeginReusable(VkCommandBuffer cmd)
+{
+	VK_ASSERT(vk.ResetCommandBuffer(cmd, VK_COMMAND_BUFFER_RESET_RELEASE_RESOURCES_BIT));
+	VK_ASSERT(vk.BeginCommandBuffer(cmd, &(VkCommandBufferBeginInfo){.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO}));
+}
+
 INLINE void CmdSwapAcquire(VkDevice device, VkSwapContext* pSwapCtx, u32* pFrameIdx)
 {
 	pSwapCtx->acquireIdx = (pSwapCtx->acquireIdx + 1) % VK_SWAP_COUNT;
@@ -745,27 +831,34 @@ INLINE void CmdSwapAcquire(VkDevice device, VkSwapContext* pSwapCtx, u32* pFrame
 }
 
 INLINE void CmdSubmitPresent(
-	VkCommandBuffer   cmd,
-	VkQueueFamilyType queueFamilyType,
-	VkSwapContext     swapCtx,
-	VkSemaphore       timeline,
-	uint64_t          timelineSignalValue)
-{
+	u32                    cmdCount,
+	const VkCommandBuffer* pCmds,
+	VkQueueFamilyType      queueFamilyType,
+	VkSwapContext          swapCtx,
+	VkSemaphore            waitTimeline, // Optional
+	uint64_t               timelineWaitValue,
+	VkPipelineStageFlags2  timelineWaitStageMask,
+	VkSemaphore            timeline,
+	uint64_t               timelineSignalValue)
+{
+	VkCommandBufferSubmitInfo cmdInfos[cmdCount];
+	for (u32 iCmd = 0; iCmd < cmdCount; ++iCmd)
+		cmdInfos[iCmd] = (VkCommandBufferSubmitInfo){VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO, .commandBuffer = pCmds[iCmd]};
+
 	VkSubmitInfo2 submitInfo = {
 		VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
-		.waitSemaphoreInfoCount = 1,
+		.waitSemaphoreInfoCount = waitTimeline != VK_NULL_HANDLE ? 2 : 1,
 		.pWaitSemaphoreInfos = (VkSemaphoreSubmitInfo[]){
 			{VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
 				.semaphore = swapCtx.acquireSemaphores[swapCtx.acquireIdx],
 				.stageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT},
+			{VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+				.value = timelineWaitValue,
+				.semaphore = waitTimeline,
+				.stageMask = timelineWaitStageMask},
 		},
-		.commandBufferInfoCount = 1,
-		.pCommandBufferInfos = (VkCommandBufferSubmitInfo[]){
-			{
-				VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
-				.commandBuffer = cmd,
-			},
-		},
+		.commandBufferInfoCount = cmdCount,
+		.pCommandBufferInfos = cmdInfos,
 		.signalSemaphoreInfoCount = 2,
 		.pSignalSemaphoreInfos = (VkSemaphoreSubmitInfo[]){
 			{
@@ -932,9 +1025,44 @@ typedef struct VkRequestAllocationInfo {
 } VkRequestAllocationInfo;
 void vkAllocateDescriptorSet(VkDescriptorPool descriptorPool, const VkDescriptorSetLayout* pSetLayout, VkDescriptorSet* pSet);
 void vkCreateAllocateBindMapBuffer(VkMemoryPropertyFlags memPropFlags, VkDeviceSize bufferSize, VkBufferUsageFlags usage, VkLocality locality, VkDeviceMemory* pDeviceMem, VkBuffer* pBuffer, void** ppMapped);
-void vkUpdateBufferViaStaging(const void* srcData, VkDeviceSize dstOffset, VkDeviceSize bufferSize, VkBuffer buffer);
+// Uploads go through the calling thread's staging ring and are batched into one transfer submit.
+// Returns the ticket, a value on the ring's timeline, the upload completes at. Only blocks when the ring is full.
+u64  vkUpdateBufferViaStaging(const void* srcData, VkDeviceSize dstOffset, VkDeviceSize bufferSize, VkBuffer buffer);
+u64  vkFlushStagingUploads();
+void vkWaitStagingUpload(u64 ticket);
 void vkCreateSharedBuffer(const VkRequestAllocationInfo* pRequest, VkSharedBuffer* pBuffer);
 
+// Context local memory is sub-allocated buddy style from VK_MEMORY_BLOCK_SIZE blocks each memory type grows on demand.
+// Freed buddies merge back so blocks are reused without defragmenting. External memory, allocations the driver
+// requires be dedicated and anything larger than a block get their own VkDeviceMemory.
+#ifndef VK_MEMORY_BLOCK_ORDER
+#define VK_MEMORY_BLOCK_ORDER 26 // 64MB
+#endif
+#define VK_MEMORY_BLOCK_MIN_ORDER     12 // 4KB
+#define VK_MEMORY_BLOCK_SIZE          (1ull << VK_MEMORY_BLOCK_ORDER)
+#define VK_MEMORY_BLOCK_CAPACITY      32
+#define VK_MEMORY_DEDICATED_CAPACITY  256
+
+typedef struct VkMemoryTypeStats {
+	u32          blockCount;
+	VkDeviceSize blockBytes;
+	u32          allocationCount;
+	VkDeviceSize allocatedBytes; // Rounded up to the buddy each allocation was given
+	VkDeviceSize requestedBytes;
+	u32          dedicatedCount;
+	VkDeviceSize dedicatedBytes;
+} VkMemoryTypeStats;
+
+typedef struct VkMemoryStats {
+	VkMemoryTypeStats types[VK_MAX_MEMORY_TYPES];
+} VkMemoryStats;
+
+void vkFreeMemoryAllocation(VkDeviceMemory memory, VkDeviceSize offset);
+void vkGetMemoryStats(VkMemoryStats* pStats);
+void vkLogMemoryStats();
+// Unmaps and frees every block. Only at shutdown once the device is idle, anything still sub-allocated is lost.
+void vkDestroyMemoryBlocks();
+
 typedef struct VkMeshCreateInfo {
 	uint32_t        indexCount;
 	uint32_t        vertexCount;
@@ -993,6 +1121,12 @@ typedef struct VkContextCreateInfo {
 } VkContextCreateInfo;
 void vkCreateContext(const VkContextCreateInfo* pContextCreateInfo);
 
+#ifndef VK_PIPELINE_CACHE_PATH
+#define VK_PIPELINE_CACHE_PATH "./pipeline.cache"
+#endif
+// Writes vk.context.pipelineCache to VK_PIPELINE_CACHE_PATH so the next launch skips compiling from SPIR-V
+void vkSavePipelineCache();
+
 void vkCreateShaderModuleFromPath(const char* pShaderPath, VkShaderModule* pShaderModule);
 
 // these might be VkDepthNormal instead of Basic?
@@ -1120,9 +1254,15 @@ void vkSetDebugName(VkObjectType objectType, uint64_t objectHandle, const char*
 
 VkCommandBuffer vkBeginImmediateCommandBuffer(VkQueueFamilyType queueFamilyType);
 void            vkEndImmediateCommandBuffer(VkQueueFamilyType queueFamilyType, VkCommandBuffer cmd);
+u64             vkEndImmediateCommandBufferAsync(VkQueueFamilyType queueFamilyType, VkCommandBuffer cmd);
+void            vkWaitImmediateCommandBuffer(VkQueueFamilyType queueFamilyType, u64 signalValue);
+
+// Waits on and releases everything the calling thread created in threadContext
+void vkDestroyThreadContext();
 
 void vkEnqueueCommandBuffer(VkQueueFamilyType iFamilyType, VkQueuedCommandBuffer queuedCmd);
 void vkSubmitQueuedCommandBuffers();
+void vkWaitQueuedCommandBuffers(u32 timeoutMs);
 
 #ifdef _WIN32
 typedef struct VkExternalPlatformTexture {
@@ -1193,18 +1333,66 @@ static VkBool32 VkmDebugUtilsCallback(
 void vkEnqueueCommandBuffer(VkQueueFamilyType iFamilyType, VkQueuedCommandBuffer queuedCmd)
 {
 	auto_t pFamily = &vk.context.queueFamilies[iFamilyType];
-	if (MID_CHANNEL_SEND(&pFamily->cmdQueue, pFamily->queuedCmds, &queuedCmd) == MID_LIMIT_REACHED)
+	if (MID_CHANNEL_MPSC_SEND(&pFamily->cmdQueue, pFamily->queuedCmdSequences, pFamily->queuedCmds, &queuedCmd) == MID_LIMIT_REACHED)
 		LOG_ERROR("%s CommandBuffer Queue reached limit!\n", string_VkQueueFamilyType[iFamilyType]);
+
+	// Context thread only sleeps on the graphics queue so wake it for the others.
+	if (iFamilyType != VK_QUEUE_FAMILY_TYPE_MAIN_GRAPHICS)
+		midChannelMpscNotify(&vk.context.queueFamilies[VK_QUEUE_FAMILY_TYPE_MAIN_GRAPHICS].cmdQueue);
 }
 
+// Everything pending on a family goes in one vkQueueSubmit2. Each command buffer keeps its own
+// VkSubmitInfo2 and timeline signal, and batches within a submit execute in order.
 void vkSubmitQueuedCommandBuffers()
 {
+	VkCommandBufferSubmitInfo cmdInfos[VK_QUEUED_COMMAND_BUFFER_CAPACITY];
+	VkSemaphoreSubmitInfo     signalInfos[VK_QUEUED_COMMAND_BUFFER_CAPACITY];
+	VkSubmitInfo2             submitInfos[VK_QUEUED_COMMAND_BUFFER_CAPACITY];
+
 	for (int iFamilyType = 0; iFamilyType < VK_QUEUE_FAMILY_TYPE_COUNT; ++iFamilyType) {
 		VkQueueFamily* pFamily = &vk.context.queueFamilies[iFamilyType];
+
+		u32 submitCount = 0;
 		VkQueuedCommandBuffer queuedCmd;
-		while (MID_CHANNEL_RECV(&pFamily->cmdQueue, pFamily->queuedCmds, &queuedCmd) == MID_SUCCESS)
-			CmdSubmit(queuedCmd.cmd, pFamily->queue, queuedCmd.timeline, queuedCmd.timelineSignalValue);
+		while (submitCount < VK_QUEUED_COMMAND_BUFFER_CAPACITY &&
+			   MID_CHANNEL_MPSC_RECV(&pFamily->cmdQueue, pFamily->queuedCmdSequences, pFamily->queuedCmds, &queuedCmd) == MID_SUCCESS) {
+			cmdInfos[submitCount] = (VkCommandBufferSubmitInfo){
+				VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
+				.commandBuffer = queuedCmd.cmd,
+			};
+			signalInfos[submitCount] = (VkSemaphoreSubmitInfo){
+				VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+				.value = queuedCmd.timelineSignalValue,
+				.semaphore = queuedCmd.timeline,
+				.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+			};
+			submitInfos[submitCount] = (VkSubmitInfo2){
+				VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
+				.commandBufferInfoCount = 1,
+				.pCommandBufferInfos = &cmdInfos[submitCount],
+				.signalSemaphoreInfoCount = 1,
+				.pSignalSemaphoreInfos = &signalInfos[submitCount],
+			};
+			submitCount++;
+		}
+
+		if (submitCount > 0)
+			VK_CHECK(vk.QueueSubmit2(pFamily->queue, submitCount, submitInfos, VK_NULL_HANDLE));
+	}
+}
+
+// Sleep the context thread until any thread enqueues a command buffer, or timeout.
+// Sleeps on the graphics queue which every family notifies, but must find all of them empty to sleep.
+void vkWaitQueuedCommandBuffers(u32 timeoutMs)
+{
+	MidChannelMpscRing* pWakeQueue = &vk.context.queueFamilies[VK_QUEUE_FAMILY_TYPE_MAIN_GRAPHICS].cmdQueue;
+	u32  wake = midChannelMpscWaitBegin(pWakeQueue);
+	bool empty = true;
+	for (int iFamilyType = 0; iFamilyType < VK_QUEUE_FAMILY_TYPE_COUNT && empty; ++iFamilyType) {
+		VkQueueFamily* pFamily = &vk.context.queueFamilies[iFamilyType];
+		empty = MID_CHANNEL_MPSC_EMPTY(&pFamily->cmdQueue, pFamily->queuedCmdSequences, pFamily->queuedCmds);
 	}
+	midChannelMpscWaitEnd(pWakeQueue, wake, empty, timeoutMs);
 }
 
 ////
@@ -1213,28 +1401,40 @@ void vkSubmitQueuedCommandBuffers()
 
 
 
-VkCommandBuffer vkBeginImmediateCommandBuffer(VkQueueFamilyType iFamilyType)
+static void ImmediateRingCreate(VkQueueFamilyType iFamilyType, VkImmediateRing* pRing)
 {
 	auto_t pFamily = &vk.context.queueFamilies[iFamilyType];
 
-	// TODO we need to clean this up on thread end
-	if (threadContext.immediatePools[iFamilyType] == VK_NULL_HANDLE) {
-		VK_CHECK(vkCreateCommandPool(vk.context.device, &(VkCommandPoolCreateInfo){
-			VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
-			.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
-			.queueFamilyIndex = pFamily->index,
-		}, VK_ALLOC, &threadContext.immediatePools[iFamilyType]));
-		VK_SET_DEBUG_NAME(threadContext.immediatePools[iFamilyType], "Immediate CommandPool %s", string_VkQueueFamilyType[iFamilyType]);
-	}
+	VK_CHECK(vkCreateCommandPool(vk.context.device, &(VkCommandPoolCreateInfo){
+		VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+		.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+		.queueFamilyIndex = pFamily->index,
+	}, VK_ALLOC, &pRing->pool));
+	VK_SET_DEBUG_NAME(pRing->pool, "Immediate CommandPool %s", string_VkQueueFamilyType[iFamilyType]);
 
-	VkCommandBuffer cmd;
 	VK_CHECK(vkAllocateCommandBuffers(vk.context.device, &(VkCommandBufferAllocateInfo){
 		VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-		.commandPool = threadContext.immediatePools[iFamilyType],
-		.commandBufferCount = 1,
-	}, &cmd));
-	VK_SET_DEBUG_NAME(cmd, "Immediate Command Buffer %s", string_VkQueueFamilyType[iFamilyType]);
+		.commandPool = pRing->pool,
+		.commandBufferCount = VK_IMMEDIATE_COMMAND_BUFFER_CAPACITY,
+	}, pRing->cmds));
+	for (int i = 0; i < VK_IMMEDIATE_COMMAND_BUFFER_CAPACITY; ++i)
+		VK_SET_DEBUG_NAME(pRing->cmds[i], "Immediate Command Buffer %s %d", string_VkQueueFamilyType[iFamilyType], i);
+}
+
+VkCommandBuffer vkBeginImmediateCommandBuffer(VkQueueFamilyType iFamilyType)
+{
+	auto_t pFamily = &vk.context.queueFamilies[iFamilyType];
+	auto_t pRing = &threadContext.immediateRings[iFamilyType];
+
+	if (pRing->pool == VK_NULL_HANDLE)
+		ImmediateRingCreate(iFamilyType, pRing);
 
+	// Oldest command buffer in the ring must finish before it is rerecorded
+	u32 iCmd = pRing->iNext++ % VK_IMMEDIATE_COMMAND_BUFFER_CAPACITY;
+	if (pRing->signalValues[iCmd] != 0)
+		vkTimelineWait(vk.context.device, pRing->signalValues[iCmd], pFamily->immediateTimeline);
+
+	VkCommandBuffer cmd = pRing->cmds[iCmd];
 	VK_CHECK(vkBeginCommandBuffer(cmd, &(VkCommandBufferBeginInfo){
 		VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
 		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
@@ -1243,19 +1443,40 @@ VkCommandBuffer vkBeginImmediateCommandBuffer(VkQueueFamilyType iFamilyType)
 	return cmd;
 }
 
-void vkEndImmediateCommandBuffer(VkQueueFamilyType iFamilyType, VkCommandBuffer cmd)
+u64 vkEndImmediateCommandBufferAsync(VkQueueFamilyType iFamilyType, VkCommandBuffer cmd)
 {
 	VK_CHECK(vkEndCommandBuffer(cmd));
 	auto_t pFamily = &vk.context.queueFamilies[iFamilyType];
+	auto_t pRing = &threadContext.immediateRings[iFamilyType];
+
 	u64 signalValue = atomic_fetch_add(&pFamily->immediateTimelineValue, 1) + 1;
+	for (int i = 0; i < VK_IMMEDIATE_COMMAND_BUFFER_CAPACITY; ++i) {
+		if (pRing->cmds[i] != cmd) continue;
+		pRing->signalValues[i] = signalValue;
+		break;
+	}
+
 	if (VK_IS_CONTEXT_THREAD) CmdSubmit(cmd, pFamily->queue, pFamily->immediateTimeline, signalValue);
 	else vkEnqueueCommandBuffer(iFamilyType, (VkQueuedCommandBuffer){
 			.cmd = cmd,
 			.timeline = pFamily->immediateTimeline,
 			.timelineSignalValue = signalValue,
 		});
-	vkTimelineWait(vk.context.device, signalValue, pFamily->immediateTimeline);
-	vkFreeCommandBuffers(vk.context.device, threadContext.immediatePools[iFamilyType], 1, &cmd);
+
+	return signalValue;
+}
+
+void vkWaitImmediateCommandBuffer(VkQueueFamilyType iFamilyType, u64 signalValue)
+{
+	if (signalValue == 0)
+		return;
+
+	vkTimelineWait(vk.context.device, signalValue, vk.context.queueFamilies[iFamilyType].immediateTimeline);
+}
+
+void vkEndImmediateCommandBuffer(VkQueueFamilyType iFamilyType, VkCommandBuffer cmd)
+{
+	vkWaitImmediateCommandBuffer(iFamilyType, vkEndImmediateCommandBufferAsync(iFamilyType, cmd));
 }
 
 //////////////
@@ -1278,7 +1499,9 @@ void vkCreateShaderModuleFromPath(const char* pShaderPath, VkShaderModule* pShad
 	free(pCode);
 }
 
-static void CreateDepthRenderPass()
+// Preserve passes expect the color framebuffer in GENERAL after being read by compute and keep
+// everything outside the render area, so only a damaged rect of the framebuffer is cleared and redrawn.
+static void CreateDepthRenderPass(bool preserve, VkRenderPass* pRenderPass)
 {
 	VkRenderPassCreateInfo2 renderPassCreateInfo2 = {
 		VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO_2,
@@ -1292,7 +1515,7 @@ static void CreateDepthRenderPass()
 				.storeOp        = VK_ATTACHMENT_STORE_OP_STORE,
 				.stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
 				.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
-				.initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED,
+				.initialLayout  = preserve ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_UNDEFINED,
 				.finalLayout    = VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL,
 			},
 			[VK_RENDER_PASS_ATTACHMENT_INDEX_DEPTH] = {
@@ -1303,7 +1526,7 @@ static void CreateDepthRenderPass()
 				.storeOp        = VK_ATTACHMENT_STORE_OP_STORE,
 				.stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
 				.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
-				.initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED,
+				.initialLayout  = preserve ? VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED,
 				.finalLayout    = VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL,
 			},
 		},
@@ -1335,9 +1558,10 @@ static void CreateDepthRenderPass()
 	    		VK_STRUCTURE_TYPE_SUBPASS_DEPENDENCY_2,
 				.srcSubpass      = VK_SUBPASS_EXTERNAL,
 				.dstSubpass      = 0,
-				.srcStageMask    = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+				// Prior frame still in flight may be copying, blitting or depth testing the attachments
+				.srcStageMask    = VK_PIPELINE_STAGE_2_TRANSFER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
 				.dstStageMask    = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
-				.srcAccessMask   = VK_ACCESS_2_TRANSFER_READ_BIT,
+				.srcAccessMask   = VK_ACCESS_2_TRANSFER_READ_BIT | VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
 				.dstAccessMask   = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
 				.dependencyFlags = 0,
 			},
@@ -1353,8 +1577,8 @@ static void CreateDepthRenderPass()
 			},
 		},
 	};
-	VK_CHECK(vkCreateRenderPass2(vk.context.device, &renderPassCreateInfo2, VK_ALLOC, &vk.context.depthRenderPass));
-	VK_SET_DEBUG(vk.context.depthRenderPass);
+	VK_CHECK(vkCreateRenderPass2(vk.context.device, &renderPassCreateInfo2, VK_ALLOC, pRenderPass));
+	VK_SET_DEBUG_NAME(*pRenderPass, preserve ? "DepthPreserveRenderPass" : "DepthRenderPass");
 }
 
 static void CreateSamplers()
@@ -1639,7 +1863,7 @@ void vkCreateTrianglePipe(const char* vertShaderPath, const char* fragShaderPath
 		.layout = layout,
 		.renderPass = renderPass,
 	};
-	VK_CHECK(vkCreateGraphicsPipelines(vk.context.device, VK_NULL_HANDLE, 1, &pipelineInfo, VK_ALLOC, pPipe));
+	VK_CHECK(vkCreateGraphicsPipelines(vk.context.device, vk.context.pipelineCache, 1, &pipelineInfo, VK_ALLOC, pPipe));
 	vkDestroyShaderModule(vk.context.device, fragShader, VK_ALLOC);
 	vkDestroyShaderModule(vk.context.device, vertShader, VK_ALLOC);
 }
@@ -1705,7 +1929,7 @@ void vkCreateTessellationPipe(const char* vertShaderPath, const char* tescShader
 		.layout = layout,
 		.renderPass = renderPass,
 	};
-	VK_CHECK(vkCreateGraphicsPipelines(vk.context.device, VK_NULL_HANDLE, 1, &pipelineInfo, VK_ALLOC, pPipe));
+	VK_CHECK(vkCreateGraphicsPipelines(vk.context.device, vk.context.pipelineCache, 1, &pipelineInfo, VK_ALLOC, pPipe));
 	vkDestroyShaderModule(vk.context.device, fragShader, VK_ALLOC);
 	vkDestroyShaderModule(vk.context.device, tescShader, VK_ALLOC);
 	vkDestroyShaderModule(vk.context.device, teseShader, VK_ALLOC);
@@ -1756,7 +1980,7 @@ void vkCreateTaskMeshPipe(const char* taskShaderPath, const char* meshShaderPath
 		.layout = layout,
 		.renderPass = renderPass,
 	};
-	VK_CHECK(vkCreateGraphicsPipelines(vk.context.device, VK_NULL_HANDLE, 1, &pipelineInfo, VK_ALLOC, pPipe));
+	VK_CHECK(vkCreateGraphicsPipelines(vk.context.device, vk.context.pipelineCache, 1, &pipelineInfo, VK_ALLOC, pPipe));
 	vkDestroyShaderModule(vk.context.device, fragShader, VK_ALLOC);
 	vkDestroyShaderModule(vk.context.device, taskShader, VK_ALLOC);
 	vkDestroyShaderModule(vk.context.device, meshShader, VK_ALLOC);
@@ -1884,7 +2108,7 @@ void vkCreateLinePipe(const char* vertShaderPath, const char* fragShaderPath, Vk
 		.layout = layout,
 		.renderPass = renderPass,
 	};
-	VK_CHECK(vkCreateGraphicsPipelines(vk.context.device, VK_NULL_HANDLE, 1, &pipelineInfo, VK_ALLOC, pPipe));
+	VK_CHECK(vkCreateGraphicsPipelines(vk.context.device, vk.context.pipelineCache, 1, &pipelineInfo, VK_ALLOC, pPipe));
 
 	vkDestroyShaderModule(vk.context.device, fragShader, VK_ALLOC);
 	vkDestroyShaderModule(vk.context.device, vertShader, VK_ALLOC);
@@ -1905,14 +2129,15 @@ void vkCreateComputePipe(const char* shaderPath, VkPipelineLayout layout, VkPipe
 		},
 		.layout = layout,
 	};
-	VK_CHECK(vkCreateComputePipelines(vk.context.device, VK_NULL_HANDLE, 1, &pipelineInfo, VK_ALLOC, pPipe));
+	VK_CHECK(vkCreateComputePipelines(vk.context.device, vk.context.pipelineCache, 1, &pipelineInfo, VK_ALLOC, pPipe));
 	vkDestroyShaderModule(vk.context.device, shader, VK_ALLOC);
 }
 
 void vkCreateGraphics()
 {
 	CreateSamplers();
-	CreateDepthRenderPass();
+	CreateDepthRenderPass(false, &vk.context.depthRenderPass);
+	CreateDepthRenderPass(true, &vk.context.depthPreserveRenderPass);
 
 	VkDepthFramebufferCreateInfo framebufferInfo = {
 		.width = DEFAULT_WIDTH,
@@ -2051,12 +2276,289 @@ void vkEndAllocationRequests()
 	}
 }
 
-static void AllocateMemory(const VkMemoryRequirements* pMemReqs, VkMemoryPropertyFlags propFlags, VkLocality locality, VkExternalMemoryHandleTypeFlagBits importHandleType, HANDLE importHandle, const VkMemoryDedicatedAllocateInfo* pDedicatedAllocInfo, VkDeviceMemory* pDeviceMemory)
+////
+//// Memory Sub-Allocation
+////
+#define VK_MEMORY_BLOCK_LEAF_COUNT (1u << (VK_MEMORY_BLOCK_ORDER - VK_MEMORY_BLOCK_MIN_ORDER))
+
+typedef struct VkMemoryBlock {
+	VkDeviceMemory memory;
+	u8*            pMapped; // Persistently mapped when host visible as memory can only be mapped once
+	// Free buddies as a binary heap. Node 1 is the whole block and node n splits into 2n and 2n + 1.
+	u64            freeNodes[(2 * VK_MEMORY_BLOCK_LEAF_COUNT) / 64];
+	// Order of the allocation starting at each leaf. Requested size is kept for stats.
+	u8             leafOrders[VK_MEMORY_BLOCK_LEAF_COUNT];
+	VkDeviceSize   leafRequestedSizes[VK_MEMORY_BLOCK_LEAF_COUNT];
+} VkMemoryBlock;
+
+static struct {
+	pthread_mutex_t   lock;
+	VkDeviceSize      granularity;
+	VkMemoryBlock*    pBlocks[VK_MAX_MEMORY_TYPES][VK_MEMORY_BLOCK_CAPACITY];
+	VkMemoryTypeStats stats[VK_MAX_MEMORY_TYPES];
+
+	u32 dedicatedCount;
+	struct {
+		VkDeviceMemory memory;
+		VkDeviceSize   size;
+		u32            iType;
+	} dedicated[VK_MEMORY_DEDICATED_CAPACITY];
+} memoryAllocator = {.lock = PTHREAD_MUTEX_INITIALIZER};
+
+static bool BuddyIsFree(const VkMemoryBlock* pBlock, u32 node)
+{
+	return (pBlock->freeNodes[node / 64] >> (node % 64)) & 1;
+}
+
+static void BuddySetFree(VkMemoryBlock* pBlock, u32 node, bool isFree)
+{
+	if (isFree) pBlock->freeNodes[node / 64] |= 1ull << (node % 64);
+	else pBlock->freeNodes[node / 64] &= ~(1ull << (node % 64));
+}
+
+// First free node at depth, or 0 if none
+static u32 BuddyFindFree(const VkMemoryBlock* pBlock, int depth)
+{
+	u32 end = 2u << depth;
+	for (u32 node = 1u << depth; node < end;) {
+		u32 bitCount = MIN(64 - node % 64, end - node);
+		u64 word = pBlock->freeNodes[node / 64] >> (node % 64);
+		if (bitCount < 64)
+			word &= (1ull << bitCount) - 1;
+		if (word != 0)
+			return node + __builtin_ctzll(word);
+		node += bitCount;
+	}
+	return 0;
+}
+
+// Splits the smallest free buddy that fits down to order. Returns false if the block is full.
+static bool BuddyAlloc(VkMemoryBlock* pBlock, int order, VkDeviceSize* pOffset)
+{
+	int depth = VK_MEMORY_BLOCK_ORDER - order;
+	for (int freeDepth = depth; freeDepth >= 0; --freeDepth) {
+		u32 node = BuddyFindFree(pBlock, freeDepth);
+		if (node == 0)
+			continue;
+
+		BuddySetFree(pBlock, node, false);
+		for (int splitDepth = freeDepth; splitDepth < depth; ++splitDepth) {
+			node *= 2;
+			BuddySetFree(pBlock, node + 1, true);
+		}
+
+		*pOffset = (VkDeviceSize)(node - (1u << depth)) << order;
+		pBlock->leafOrders[*pOffset >> VK_MEMORY_BLOCK_MIN_ORDER] = order;
+		return true;
+	}
+	return false;
+}
+
+// Frees and merges the allocation at offset with its free buddies. Returns its order.
+static int BuddyFree(VkMemoryBlock* pBlock, VkDeviceSize offset)
+{
+	u32 iLeaf = offset >> VK_MEMORY_BLOCK_MIN_ORDER;
+	int order = pBlock->leafOrders[iLeaf];
+	CHECK(order == 0, "Freeing memory which is not allocated!");
+	pBlock->leafOrders[iLeaf] = 0;
+
+	u32 node = (1u << (VK_MEMORY_BLOCK_ORDER - order)) + (u32)(offset >> order);
+	while (node > 1 && BuddyIsFree(pBlock, node ^ 1)) {
+		BuddySetFree(pBlock, node ^ 1, false);
+		node /= 2;
+	}
+	BuddySetFree(pBlock, node, true);
+	return order;
+}
+
+static VkMemoryBlock* CreateMemoryBlock(u32 iType)
+{
+	VkPhysicalDeviceMemoryProperties memProps;
+	vkGetPhysicalDeviceMemoryProperties(vk.context.physicalDevice, &memProps);
+
+	VkMemoryBlock* pBlock = calloc(1, sizeof(VkMemoryBlock));
+	VK_CHECK(vkAllocateMemory(vk.context.device, &(VkMemoryAllocateInfo){
+		VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+		.allocationSize = VK_MEMORY_BLOCK_SIZE,
+		.memoryTypeIndex = iType,
+	}, VK_ALLOC, &pBlock->memory));
+	VK_SET_DEBUG_NAME(pBlock->memory, "Memory Block Type %d", iType);
+
+	if (memProps.memoryTypes[iType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+		VK_CHECK(vkMapMemory(vk.context.device, pBlock->memory, 0, VK_WHOLE_SIZE, 0, (void**)&pBlock->pMapped));
+
+	BuddySetFree(pBlock, 1, true);
+
+#ifdef VK_DEBUG_MEMORY_ALLOC
+	printf("Block MemoryType: %d Allocated: %llu ", iType, VK_MEMORY_BLOCK_SIZE);
+	PrintMemoryPropertyFlags(memProps.memoryTypes[iType].propertyFlags);
+#endif
+	return pBlock;
+}
+
+// Returns false if size does not fit a block so the caller allocates it dedicated
+static bool SubAllocateMemory(u32 iType, const VkMemoryRequirements* pMemReqs, VkDeviceMemory* pDeviceMemory, VkDeviceSize* pOffset)
+{
+	pthread_mutex_lock(&memoryAllocator.lock);
+
+	if (memoryAllocator.granularity == 0) {
+		VkPhysicalDeviceProperties physicalDeviceProperties;
+		vkGetPhysicalDeviceProperties(vk.context.physicalDevice, &physicalDeviceProperties);
+		memoryAllocator.granularity = MAX(physicalDeviceProperties.limits.bufferImageGranularity, 1);
+	}
+
+	// Buddies are aligned to their size. Granularity keeps linear and optimal resources off the same page.
+	VkDeviceSize size = MAX(pMemReqs->size, MAX(pMemReqs->alignment, memoryAllocator.granularity));
+	// Anything up to a leaf is a leaf, which also keeps clz off size - 1 == 0 where it is undefined.
+	int          order = size <= (1ull << VK_MEMORY_BLOCK_MIN_ORDER) ? VK_MEMORY_BLOCK_MIN_ORDER : 64 - __builtin_clzll(size - 1);
+	bool         isAllocated = false;
+	if (order <= VK_MEMORY_BLOCK_ORDER) {
+		VkMemoryBlock** ppBlocks = memoryAllocator.pBlocks[iType];
+		for (int iBlock = 0; iBlock < VK_MEMORY_BLOCK_CAPACITY && !isAllocated; ++iBlock) {
+			if (ppBlocks[iBlock] == NULL) {
+				ppBlocks[iBlock] = CreateMemoryBlock(iType);
+				memoryAllocator.stats[iType].blockCount++;
+				memoryAllocator.stats[iType].blockBytes += VK_MEMORY_BLOCK_SIZE;
+			}
+
+			if (BuddyAlloc(ppBlocks[iBlock], order, pOffset)) {
+				ppBlocks[iBlock]->leafRequestedSizes[*pOffset >> VK_MEMORY_BLOCK_MIN_ORDER] = pMemReqs->size;
+				*pDeviceMemory = ppBlocks[iBlock]->memory;
+				isAllocated = true;
+			}
+		}
+	}
+
+	if (isAllocated) {
+		memoryAllocator.stats[iType].allocationCount++;
+		memoryAllocator.stats[iType].allocatedBytes += 1ull << order;
+		memoryAllocator.stats[iType].requestedBytes += pMemReqs->size;
+	}
+
+	pthread_mutex_unlock(&memoryAllocator.lock);
+	return isAllocated;
+}
+
+// Host pointer to offset if memory is a persistently mapped block, otherwise NULL
+static void* MemoryBlockPtr(VkDeviceMemory memory, VkDeviceSize offset)
+{
+	void* ptr = NULL;
+	pthread_mutex_lock(&memoryAllocator.lock);
+	for (int iType = 0; iType < VK_MAX_MEMORY_TYPES && ptr == NULL; ++iType) {
+		for (int iBlock = 0; iBlock < VK_MEMORY_BLOCK_CAPACITY; ++iBlock) {
+			VkMemoryBlock* pBlock = memoryAllocator.pBlocks[iType][iBlock];
+			if (pBlock == NULL) break;
+			if (pBlock->memory != memory) continue;
+			ptr = pBlock->pMapped != NULL ? pBlock->pMapped + offset : NULL;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&memoryAllocator.lock);
+	return ptr;
+}
+
+static void* MapMemoryAllocation(VkDeviceMemory memory, VkDeviceSize offset, VkDeviceSize size)
+{
+	void* ptr = MemoryBlockPtr(memory, offset);
+	if (ptr == NULL)
+		VK_CHECK(vkMapMemory(vk.context.device, memory, offset, size, 0, &ptr));
+	return ptr;
+}
+
+void vkFreeMemoryAllocation(VkDeviceMemory memory, VkDeviceSize offset)
+{
+	pthread_mutex_lock(&memoryAllocator.lock);
+
+	for (int iType = 0; iType < VK_MAX_MEMORY_TYPES; ++iType) {
+		for (int iBlock = 0; iBlock < VK_MEMORY_BLOCK_CAPACITY; ++iBlock) {
+			VkMemoryBlock* pBlock = memoryAllocator.pBlocks[iType][iBlock];
+			if (pBlock == NULL) break;
+			if (pBlock->memory != memory) continue;
+
+			VkDeviceSize requestedSize = pBlock->leafRequestedSizes[offset >> VK_MEMORY_BLOCK_MIN_ORDER];
+			int          order = BuddyFree(pBlock, offset);
+			memoryAllocator.stats[iType].allocationCount--;
+			memoryAllocator.stats[iType].allocatedBytes -= 1ull << order;
+			memoryAllocator.stats[iType].requestedBytes -= requestedSize;
+
+			pthread_mutex_unlock(&memoryAllocator.lock);
+			return;
+		}
+	}
+
+	for (u32 i = 0; i < memoryAllocator.dedicatedCount; ++i) {
+		if (memoryAllocator.dedicated[i].memory != memory) continue;
+		u32 iType = memoryAllocator.dedicated[i].iType;
+		memoryAllocator.stats[iType].dedicatedCount--;
+		memoryAllocator.stats[iType].dedicatedBytes -= memoryAllocator.dedicated[i].size;
+		memoryAllocator.dedicated[i] = memoryAllocator.dedicated[--memoryAllocator.dedicatedCount];
+		break;
+	}
+
+	pthread_mutex_unlock(&memoryAllocator.lock);
+	vkFreeMemory(vk.context.device, memory, VK_ALLOC);
+}
+
+void vkGetMemoryStats(VkMemoryStats* pStats)
+{
+	pthread_mutex_lock(&memoryAllocator.lock);
+	memcpy(pStats->types, memoryAllocator.stats, sizeof(pStats->types));
+	pthread_mutex_unlock(&memoryAllocator.lock);
+}
+
+void vkDestroyMemoryBlocks()
+{
+	pthread_mutex_lock(&memoryAllocator.lock);
+	for (int iType = 0; iType < VK_MAX_MEMORY_TYPES; ++iType) {
+		if (memoryAllocator.stats[iType].allocationCount > 0)
+			LOG("MemoryType: %d Freeing blocks with %u allocations still live.\n", iType, memoryAllocator.stats[iType].allocationCount);
+
+		for (int iBlock = 0; iBlock < VK_MEMORY_BLOCK_CAPACITY; ++iBlock) {
+			VkMemoryBlock* pBlock = memoryAllocator.pBlocks[iType][iBlock];
+			if (pBlock == NULL) break;
+			if (pBlock->pMapped != NULL)
+				vkUnmapMemory(vk.context.device, pBlock->memory);
+			vkFreeMemory(vk.context.device, pBlock->memory, VK_ALLOC);
+			free(pBlock);
+			memoryAllocator.pBlocks[iType][iBlock] = NULL;
+		}
+
+		memoryAllocator.stats[iType].blockCount = 0;
+		memoryAllocator.stats[iType].blockBytes = 0;
+		memoryAllocator.stats[iType].allocationCount = 0;
+		memoryAllocator.stats[iType].allocatedBytes = 0;
+		memoryAllocator.stats[iType].requestedBytes = 0;
+	}
+	pthread_mutex_unlock(&memoryAllocator.lock);
+}
+
+void vkLogMemoryStats()
+{
+	VkMemoryStats stats;
+	vkGetMemoryStats(&stats);
+	for (int iType = 0; iType < VK_MAX_MEMORY_TYPES; ++iType) {
+		VkMemoryTypeStats* pType = &stats.types[iType];
+		if (pType->blockCount == 0 && pType->dedicatedCount == 0) continue;
+		LOG("MemoryType: %d Blocks: %u %llu Allocations: %u %llu Requested: %llu Dedicated: %u %llu\n",
+		    iType,
+		    pType->blockCount, pType->blockBytes,
+		    pType->allocationCount, pType->allocatedBytes,
+		    pType->requestedBytes,
+		    pType->dedicatedCount, pType->dedicatedBytes);
+	}
+}
+
+static void AllocateMemory(const VkMemoryRequirements* pMemReqs, VkMemoryPropertyFlags propFlags, VkLocality locality, VkExternalMemoryHandleTypeFlagBits importHandleType, HANDLE importHandle, const VkMemoryDedicatedAllocateInfo* pDedicatedAllocInfo, VkDeviceMemory* pDeviceMemory, VkDeviceSize* pOffset)
 {
 	VkPhysicalDeviceMemoryProperties memProps;
 	vkGetPhysicalDeviceMemoryProperties(vk.context.physicalDevice, &memProps);
 	uint32_t memTypeIndex = FindMemoryTypeIndex(memProps.memoryTypeCount, memProps.memoryTypes, pMemReqs->memoryTypeBits, propFlags);
 
+	// External memory is exported or imported whole
+	if (!VK_LOCALITY_INTERPROCESS(locality) && pDedicatedAllocInfo == NULL && SubAllocateMemory(memTypeIndex, pMemReqs, pDeviceMemory, pOffset))
+		return;
+	*pOffset = 0;
+
 #if _WIN32
 	VkExportMemoryWin32HandleInfoKHR exportMemPlatformInfo = {
 		.sType = VK_STRUCTURE_TYPE_EXPORT_MEMORY_WIN32_HANDLE_INFO_KHR,
@@ -2087,13 +2589,22 @@ static void AllocateMemory(const VkMemoryRequirements* pMemReqs, VkMemoryPropert
 	};
 	VK_CHECK(vkAllocateMemory(vk.context.device, &memAllocInfo, VK_ALLOC, pDeviceMemory));
 
+	pthread_mutex_lock(&memoryAllocator.lock);
+	memoryAllocator.stats[memTypeIndex].dedicatedCount++;
+	memoryAllocator.stats[memTypeIndex].dedicatedBytes += pMemReqs->size;
+	if (memoryAllocator.dedicatedCount < VK_MEMORY_DEDICATED_CAPACITY)
+		memoryAllocator.dedicated[memoryAllocator.dedicatedCount++] = (typeof(memoryAllocator.dedicated[0])){*pDeviceMemory, pMemReqs->size, memTypeIndex};
+	else
+		LOG_ERROR("Dedicated memory tracking capacity reached!\n");
+	pthread_mutex_unlock(&memoryAllocator.lock);
+
 #ifdef VK_DEBUG_MEMORY_ALLOC
 	printf("%sMemoryType: %d Allocated: %zu ", pDedicatedAllocInfo != NULL ? "Dedicated " : "", memTypeIndex, pMemReqs->size);
 	PrintMemoryPropertyFlags(propFlags);
 #endif
 }
 
-static void CreateAllocBuffer(VkMemoryPropertyFlags memPropFlags, VkDeviceSize bufferSize, VkBufferUsageFlags usage, VkLocality locality, VkDeviceMemory* pMemory, VkBuffer* pBuffer)
+static void CreateAllocBuffer(VkMemoryPropertyFlags memPropFlags, VkDeviceSize bufferSize, VkBufferUsageFlags usage, VkLocality locality, VkDeviceMemory* pMemory, VkDeviceSize* pOffset, VkBuffer* pBuffer)
 {
 	VkBufferCreateInfo bufferCreateInfo = {
 		.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
@@ -2120,19 +2631,20 @@ static void CreateAllocBuffer(VkMemoryPropertyFlags memPropFlags, VkDeviceSize b
 	//	AllocateMemory(&memReqs2.memoryRequirements, memPropFlags, locality, NULL,
 	//				   (requiresDedicated || prefersDedicated) && !MID_LOCALITY_INTERPROCESS(locality) ? &dedicatedAllocInfo : NULL,
 	//				   pDeviceMem);
-	AllocateMemory(&memReqs2.memoryRequirements, memPropFlags, locality, 0, NULL, requiresDedicated ? &dedicatedAllocInfo : NULL, pMemory);
+	AllocateMemory(&memReqs2.memoryRequirements, memPropFlags, locality, 0, NULL, requiresDedicated ? &dedicatedAllocInfo : NULL, pMemory, pOffset);
 }
 
-static void CreateAllocBindBuffer(VkMemoryPropertyFlags memPropFlags, VkDeviceSize bufferSize, VkBufferUsageFlags usage, VkLocality locality, VkDeviceMemory* pDeviceMem, VkBuffer* pBuffer)
+static void CreateAllocBindBuffer(VkMemoryPropertyFlags memPropFlags, VkDeviceSize bufferSize, VkBufferUsageFlags usage, VkLocality locality, VkDeviceMemory* pDeviceMem, VkDeviceSize* pOffset, VkBuffer* pBuffer)
 {
-	CreateAllocBuffer(memPropFlags, bufferSize, usage, locality, pDeviceMem, pBuffer);
-	VK_CHECK(vkBindBufferMemory(vk.context.device, *pBuffer, *pDeviceMem, 0));
+	CreateAllocBuffer(memPropFlags, bufferSize, usage, locality, pDeviceMem, pOffset, pBuffer);
+	VK_CHECK(vkBindBufferMemory(vk.context.device, *pBuffer, *pDeviceMem, *pOffset));
 }
 
 void vkCreateAllocateBindMapBuffer(VkMemoryPropertyFlags memPropFlags, VkDeviceSize bufferSize, VkBufferUsageFlags usage, VkLocality locality, VkDeviceMemory* pDeviceMem, VkBuffer* pBuffer, void** ppMapped)
 {
-	CreateAllocBindBuffer(memPropFlags, bufferSize, usage, locality, pDeviceMem, pBuffer);
-	VK_CHECK(vkMapMemory(vk.context.device, *pDeviceMem, 0, bufferSize, 0, ppMapped));
+	VkDeviceSize offset;
+	CreateAllocBindBuffer(memPropFlags, bufferSize, usage, locality, pDeviceMem, &offset, pBuffer);
+	*ppMapped = MapMemoryAllocation(*pDeviceMem, offset, bufferSize);
 }
 
 void vkCreateSharedBuffer(const VkRequestAllocationInfo* pRequest, VkSharedBuffer* pBuffer)
@@ -2174,24 +2686,201 @@ void vkCreateSharedBuffer(const VkRequestAllocationInfo* pRequest, VkSharedBuffe
 #endif
 }
 
-static void CreateStagingBuffer(const void* srcData, VkDeviceSize bufferSize, VkDeviceMemory* pStagingMemory, VkBuffer* pStagingBuffer)
+static void CreateStagingBuffer(const void* srcData, VkDeviceSize bufferSize, VkDeviceMemory* pStagingMemory, VkDeviceSize* pStagingOffset, VkBuffer* pStagingBuffer)
 {
-	void* dstData;
-	CreateAllocBindBuffer(VK_MEMORY_HOST_VISIBLE_COHERENT, bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_LOCALITY_CONTEXT, pStagingMemory, pStagingBuffer);
+	CreateAllocBindBuffer(VK_MEMORY_HOST_VISIBLE_COHERENT, bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_LOCALITY_CONTEXT, pStagingMemory, pStagingOffset, pStagingBuffer);
+	void* dstData = MemoryBlockPtr(*pStagingMemory, *pStagingOffset);
+	if (dstData != NULL) {
+		memcpy(dstData, srcData, bufferSize);
+		return;
+	}
 	VK_CHECK(vkMapMemory(vk.context.device, *pStagingMemory, 0, bufferSize, 0, &dstData));
 	memcpy(dstData, srcData, bufferSize);
 	vkUnmapMemory(vk.context.device, *pStagingMemory);
 }
-void vkUpdateBufferViaStaging(const void* srcData, VkDeviceSize dstOffset, VkDeviceSize bufferSize, VkBuffer buffer)
+
+////
+//// Staging Ring
+////
+static void StagingRingCreate(VkStagingRing* pRing)
+{
+	auto_t pFamily = &vk.context.queueFamilies[VK_QUEUE_FAMILY_TYPE_DEDICATED_TRANSFER];
+
+	CreateAllocBindBuffer(VK_MEMORY_HOST_VISIBLE_COHERENT, VK_STAGING_RING_SIZE, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_LOCALITY_CONTEXT, &pRing->memory, &pRing->memoryOffset, &pRing->buffer);
+	pRing->pMapped = MapMemoryAllocation(pRing->memory, pRing->memoryOffset, VK_STAGING_RING_SIZE);
+	VK_SET_DEBUG_NAME(pRing->buffer, "Staging Ring Buffer");
+
+	VK_CHECK(vkCreateCommandPool(vk.context.device, &(VkCommandPoolCreateInfo){
+		VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+		.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+		.queueFamilyIndex = pFamily->index,
+	}, VK_ALLOC, &pRing->pool));
+	VK_SET_DEBUG_NAME(pRing->pool, "Staging Ring CommandPool");
+
+	for (int i = 0; i < VK_STAGING_BATCH_CAPACITY; ++i) {
+		VK_CHECK(vkAllocateCommandBuffers(vk.context.device, &(VkCommandBufferAllocateInfo){
+			VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+			.commandPool = pRing->pool,
+			.commandBufferCount = 1,
+		}, &pRing->batches[i].cmd));
+		VK_SET_DEBUG_NAME(pRing->batches[i].cmd, "Staging Ring Command Buffer %d", i);
+	}
+
+	VK_CHECK(vkCreateSemaphore(vk.context.device, &(VkSemaphoreCreateInfo){
+		VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+		.pNext = &(VkSemaphoreTypeCreateInfo){
+			VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+			.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+		},
+	}, VK_ALLOC, &pRing->timeline));
+	VK_SET_DEBUG_NAME(pRing->timeline, "Staging Ring Timeline");
+}
+
+// Reclaim every batch the transfer timeline has passed. Optionally wait on the oldest first.
+static void StagingRingReclaim(VkStagingRing* pRing, bool waitOldest)
 {
-	VkBuffer       stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
-	CreateStagingBuffer(srcData, bufferSize, &stagingBufferMemory, &stagingBuffer);
-	VkCommandBuffer commandBuffer = vkBeginImmediateCommandBuffer(VK_QUEUE_FAMILY_TYPE_DEDICATED_TRANSFER);
-	vkCmdCopyBuffer(commandBuffer, stagingBuffer, buffer, 1, &(VkBufferCopy){.dstOffset = dstOffset, .size = bufferSize});
-	vkEndImmediateCommandBuffer(VK_QUEUE_FAMILY_TYPE_DEDICATED_TRANSFER, commandBuffer);
-	vkFreeMemory(vk.context.device, stagingBufferMemory, VK_ALLOC);
-	vkDestroyBuffer(vk.context.device, stagingBuffer, VK_ALLOC);
+	if (pRing->iBatchTail == pRing->iBatchHead)
+		return;
+
+	if (waitOldest)
+		vkTimelineWait(vk.context.device, pRing->batches[pRing->iBatchTail % VK_STAGING_BATCH_CAPACITY].timelineValue, pRing->timeline);
+
+	u64 completedValue;
+	VK_CHECK(vk.GetSemaphoreCounterValue(vk.context.device, pRing->timeline, &completedValue));
+	for (; pRing->iBatchTail != pRing->iBatchHead; ++pRing->iBatchTail) {
+		VkStagingBatch* pBatch = &pRing->batches[pRing->iBatchTail % VK_STAGING_BATCH_CAPACITY];
+		if (pBatch->timelineValue > completedValue)
+			break;
+		pRing->tail = pBatch->end;
+	}
+}
+
+u64 vkFlushStagingUploads()
+{
+	VkStagingRing* pRing = &threadContext.stagingRing;
+	if (!pRing->isRecording)
+		return pRing->timelineValue;
+
+	VkStagingBatch* pBatch = &pRing->batches[pRing->iBatchHead % VK_STAGING_BATCH_CAPACITY];
+	VK_CHECK(vkEndCommandBuffer(pBatch->cmd));
+	pBatch->end = pRing->head;
+	pBatch->timelineValue = ++pRing->timelineValue;
+
+	auto_t pFamily = &vk.context.queueFamilies[VK_QUEUE_FAMILY_TYPE_DEDICATED_TRANSFER];
+	if (VK_IS_CONTEXT_THREAD) CmdSubmit(pBatch->cmd, pFamily->queue, pRing->timeline, pBatch->timelineValue);
+	else vkEnqueueCommandBuffer(VK_QUEUE_FAMILY_TYPE_DEDICATED_TRANSFER, (VkQueuedCommandBuffer){
+			.cmd = pBatch->cmd,
+			.timeline = pRing->timeline,
+			.timelineSignalValue = pBatch->timelineValue,
+		});
+
+	pRing->isRecording = false;
+	pRing->iBatchHead++;
+	return pBatch->timelineValue;
+}
+
+void vkWaitStagingUpload(u64 ticket)
+{
+	VkStagingRing* pRing = &threadContext.stagingRing;
+	if (ticket > pRing->timelineValue)
+		vkFlushStagingUploads();
+	vkTimelineWait(vk.context.device, ticket, pRing->timeline);
+	StagingRingReclaim(pRing, false);
+}
+
+// Returns the ring offset of size contiguous bytes, waiting on batches in flight until they fit
+static VkDeviceSize StagingRingAlloc(VkStagingRing* pRing, VkDeviceSize size)
+{
+	VkDeviceSize pos = pRing->head % VK_STAGING_RING_SIZE;
+	VkDeviceSize skip = pos + size > VK_STAGING_RING_SIZE ? VK_STAGING_RING_SIZE - pos : 0;
+
+	StagingRingReclaim(pRing, false);
+	while (pRing->head + skip + size - pRing->tail > VK_STAGING_RING_SIZE) {
+		if (pRing->iBatchTail == pRing->iBatchHead) {
+			// Nothing in flight or recording so the whole ring is free
+			if (!pRing->isRecording) {
+				pRing->tail = pRing->head + skip;
+				break;
+			}
+			vkFlushStagingUploads();
+		}
+		StagingRingReclaim(pRing, true);
+	}
+
+	pRing->head += skip;
+	VkDeviceSize offset = pRing->head % VK_STAGING_RING_SIZE;
+	pRing->head += size;
+	return offset;
+}
+
+static void StagingBatchBegin(VkStagingRing* pRing)
+{
+	// Batch slots are recycled oldest first
+	if (pRing->iBatchHead - pRing->iBatchTail == VK_STAGING_BATCH_CAPACITY)
+		StagingRingReclaim(pRing, true);
+
+	VkStagingBatch* pBatch = &pRing->batches[pRing->iBatchHead % VK_STAGING_BATCH_CAPACITY];
+	VK_CHECK(vkResetCommandBuffer(pBatch->cmd, 0));
+	VK_CHECK(vkBeginCommandBuffer(pBatch->cmd, &(VkCommandBufferBeginInfo){
+		VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+	}));
+	pRing->isRecording = true;
+}
+
+u64 vkUpdateBufferViaStaging(const void* srcData, VkDeviceSize dstOffset, VkDeviceSize bufferSize, VkBuffer buffer)
+{
+	VkStagingRing* pRing = &threadContext.stagingRing;
+
+	if (pRing->buffer == VK_NULL_HANDLE)
+		StagingRingCreate(pRing);
+
+	// Uploads larger than the ring go through in ring sized chunks
+	for (VkDeviceSize copied = 0; copied < bufferSize;) {
+		VkDeviceSize copySize = MIN(bufferSize - copied, VK_STAGING_RING_SIZE);
+		// Allocating may flush the batch recording to make room so it begins after
+		VkDeviceSize srcOffset = StagingRingAlloc(pRing, VK_STAGING_ALIGN(copySize));
+		if (!pRing->isRecording)
+			StagingBatchBegin(pRing);
+
+		memcpy(pRing->pMapped + srcOffset, (const u8*)srcData + copied, copySize);
+		vkCmdCopyBuffer(pRing->batches[pRing->iBatchHead % VK_STAGING_BATCH_CAPACITY].cmd, pRing->buffer, buffer, 1, &(VkBufferCopy){
+			.srcOffset = srcOffset,
+			.dstOffset = dstOffset + copied,
+			.size = copySize,
+		});
+		copied += copySize;
+	}
+
+	// The batch recording signals one past the last submitted
+	return pRing->isRecording ? pRing->timelineValue + 1 : pRing->timelineValue;
+}
+
+void vkDestroyThreadContext()
+{
+	for (int iFamilyType = 0; iFamilyType < VK_QUEUE_FAMILY_TYPE_COUNT; ++iFamilyType) {
+		auto_t pRing = &threadContext.immediateRings[iFamilyType];
+		if (pRing->pool == VK_NULL_HANDLE) continue;
+
+		u64 lastSignalValue = 0;
+		for (int i = 0; i < VK_IMMEDIATE_COMMAND_BUFFER_CAPACITY; ++i)
+			lastSignalValue = MAX(lastSignalValue, pRing->signalValues[i]);
+		vkWaitImmediateCommandBuffer(iFamilyType, lastSignalValue);
+
+		vkDestroyCommandPool(vk.context.device, pRing->pool, VK_ALLOC);
+		*pRing = (VkImmediateRing){};
+	}
+
+	VkStagingRing* pStagingRing = &threadContext.stagingRing;
+	if (pStagingRing->buffer != VK_NULL_HANDLE) {
+		vkWaitStagingUpload(vkFlushStagingUploads());
+
+		vkDestroyCommandPool(vk.context.device, pStagingRing->pool, VK_ALLOC);
+		vkDestroySemaphore(vk.context.device, pStagingRing->timeline, VK_ALLOC);
+		vkDestroyBuffer(vk.context.device, pStagingRing->buffer, VK_ALLOC);
+		vkFreeMemoryAllocation(pStagingRing->memory, pStagingRing->memoryOffset);
+		*pStagingRing = (VkStagingRing){};
+	}
 }
 void vkCreateSharedMesh(const VkMeshCreateInfo* pCreateInfo, VkSharedMesh* pMesh)
 {
@@ -2235,7 +2924,7 @@ void vkCreateMesh(const VkMeshCreateInfo* pCreateInfo, VkMesh* pMesh)
 	pMesh->offsets.indexOffset = 0;
 	pMesh->offsets.vertexOffset = indexBufferSize + (indexBufferSize % sizeof(vert));
 
-	CreateAllocBindBuffer(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, pMesh->offsets.vertexOffset + vertexBufferSize, VK_BUFFER_USAGE_MESH, VK_LOCALITY_CONTEXT, &pMesh->mem, &pMesh->buf);
+	CreateAllocBindBuffer(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, pMesh->offsets.vertexOffset + vertexBufferSize, VK_BUFFER_USAGE_MESH, VK_LOCALITY_CONTEXT, &pMesh->mem, &pMesh->memOffset, &pMesh->buf);
 	vkUpdateBufferViaStaging(pCreateInfo->pIndices, pMesh->offsets.indexOffset, indexBufferSize, pMesh->buf);
 	vkUpdateBufferViaStaging(pCreateInfo->pVertices, pMesh->offsets.vertexOffset, vertexBufferSize, pMesh->buf);
 }
@@ -2333,12 +3022,13 @@ static void CreateAllocImage(const VkDedicatedTextureCreateInfo* pCreateInfo, Vk
 		pCreateInfo->handleType,
 		pCreateInfo->importHandle,
 		requiresDedicated || requiresExternalDedicated ? &dedicatedAllocInfo : NULL,
-		&pTexture->memory);
+		&pTexture->memory,
+		&pTexture->memoryOffset);
 }
 static void CreateAllocBindImage(const VkDedicatedTextureCreateInfo* pCreateInfo, VkDedicatedTexture* pTexture)
 {
 	CreateAllocImage(pCreateInfo, pTexture);
-	VK_CHECK(vkBindImageMemory(vk.context.device, pTexture->image, pTexture->memory, 0));
+	VK_CHECK(vkBindImageMemory(vk.context.device, pTexture->image, pTexture->memory, pTexture->memoryOffset));
 }
 static void CreateAllocateBindImageView(const VkDedicatedTextureCreateInfo* pCreateInfo, VkDedicatedTexture* pTexture)
 {
@@ -2375,7 +3065,8 @@ void vkCreateDedicatedTextureFromFile(const char* pPath, VkDedicatedTexture* pTe
 	VkDeviceSize   imageBufferSize = width * height * 4;
 	VkBuffer       stagingBuffer;
 	VkDeviceMemory stagingBufferMemory;
-	CreateStagingBuffer(pImagePixels, imageBufferSize, &stagingBufferMemory, &stagingBuffer);
+	VkDeviceSize   stagingBufferOffset;
+	CreateStagingBuffer(pImagePixels, imageBufferSize, &stagingBufferMemory, &stagingBufferOffset, &stagingBuffer);
 	stbi_image_free(pImagePixels);
 
 	VkCommandBuffer commandBuffer = vkBeginImmediateCommandBuffer(VK_QUEUE_FAMILY_TYPE_DEDICATED_TRANSFER);
@@ -2410,8 +3101,8 @@ void vkCreateDedicatedTextureFromFile(const char* pPath, VkDedicatedTexture* pTe
 
 	vkEndImmediateCommandBuffer(VK_QUEUE_FAMILY_TYPE_DEDICATED_TRANSFER, commandBuffer);
 
-	vkFreeMemory(vk.context.device, stagingBufferMemory, VK_ALLOC);
 	vkDestroyBuffer(vk.context.device, stagingBuffer, VK_ALLOC);
+	vkFreeMemoryAllocation(stagingBufferMemory, stagingBufferOffset);
 }
 
 void vkDestroyDedicatedTexture(VkDedicatedTexture* pTexture)
@@ -2423,7 +3114,7 @@ void vkDestroyDedicatedTexture(VkDedicatedTexture* pTexture)
 	REQUIRE_NOT_EQUAL(pTexture->memory, NULL);
 	vkDestroyImageView(vk.context.device, pTexture->view, VK_ALLOC);
 	vkDestroyImage(vk.context.device, pTexture->image, VK_ALLOC);
-	vkFreeMemory(vk.context.device, pTexture->memory, VK_ALLOC);
+	vkFreeMemoryAllocation(pTexture->memory, pTexture->memoryOffset);
 	pTexture->view = NULL;
 	pTexture->image = NULL;
 	pTexture->memory = NULL;
@@ -2817,6 +3508,78 @@ void vkInitializeInstance()
 	}
 }
 
+////
+//// Pipeline Cache
+////
+// Returns cache data read from VK_PIPELINE_CACHE_PATH, or NULL if there is none or it was written by
+// another device or driver. Drivers should reject mismatched data themselves but not all do so safely.
+static void* LoadPipelineCacheData(size_t* pDataSize)
+{
+	FILE* file = fopen(VK_PIPELINE_CACHE_PATH, "rb");
+	if (file == NULL)
+		return NULL;
+
+	fseek(file, 0, SEEK_END);
+	*pDataSize = ftell(file);
+	rewind(file);
+
+	void* pData = NULL;
+	if (*pDataSize >= sizeof(VkPipelineCacheHeaderVersionOne)) {
+		pData = malloc(*pDataSize);
+		if (fread(pData, *pDataSize, 1, file) != 1) {
+			free(pData);
+			pData = NULL;
+		}
+	}
+	fclose(file);
+
+	if (pData == NULL) {
+		LOG_ERROR("Failed to read %s\n", VK_PIPELINE_CACHE_PATH);
+		return NULL;
+	}
+
+	VkPhysicalDeviceProperties physicalDeviceProperties;
+	vkGetPhysicalDeviceProperties(vk.context.physicalDevice, &physicalDeviceProperties);
+
+	const VkPipelineCacheHeaderVersionOne* pHeader = pData;
+	bool isValid = pHeader->headerSize >= sizeof(VkPipelineCacheHeaderVersionOne) &&
+				   pHeader->headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+				   pHeader->vendorID == physicalDeviceProperties.vendorID &&
+				   pHeader->deviceID == physicalDeviceProperties.deviceID &&
+				   memcmp(pHeader->pipelineCacheUUID, physicalDeviceProperties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+	if (!isValid) {
+		LOG("Discarding %s from another device or driver.\n", VK_PIPELINE_CACHE_PATH);
+		free(pData);
+		return NULL;
+	}
+
+	return pData;
+}
+
+void vkSavePipelineCache()
+{
+	if (vk.context.pipelineCache == VK_NULL_HANDLE)
+		return;
+
+	size_t dataSize = 0;
+	VK_CHECK(vkGetPipelineCacheData(vk.context.device, vk.context.pipelineCache, &dataSize, NULL));
+	void* pData = malloc(dataSize);
+	VK_CHECK(vkGetPipelineCacheData(vk.context.device, vk.context.pipelineCache, &dataSize, pData));
+
+	FILE* file = fopen(VK_PIPELINE_CACHE_PATH, "wb");
+	if (file == NULL) {
+		LOG_ERROR("Failed to open %s for writing!\n", VK_PIPELINE_CACHE_PATH);
+		free(pData);
+		return;
+	}
+	if (fwrite(pData, dataSize, 1, file) != 1)
+		LOG_ERROR("Failed to write %s!\n", VK_PIPELINE_CACHE_PATH);
+	fclose(file);
+	free(pData);
+
+	LOG("Saved %zu bytes to %s\n", dataSize, VK_PIPELINE_CACHE_PATH);
+}
+
 void vkCreateContext(const VkContextCreateInfo* pContextCreateInfo)
 {
 	///
@@ -2973,7 +3736,10 @@ void vkCreateContext(const VkContextCreateInfo* pContextCreateInfo)
 			.imagelessFramebuffer = VK_TRUE,
 			.timelineSemaphore = VK_TRUE,
 			.descriptorBindingPartiallyBound = VK_TRUE,
+			.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE,
 			.runtimeDescriptorArray = VK_TRUE,
+			.shaderUniformBufferArrayNonUniformIndexing = VK_TRUE,
+			.shaderSampledImageArrayNonUniformIndexing = VK_TRUE,
 		};
 		VkPhysicalDeviceVulkan11Features physicalDeviceVulkan11Features = {
 			VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES,
@@ -2987,6 +3753,7 @@ void vkCreateContext(const VkContextCreateInfo* pContextCreateInfo)
 				.tessellationShader = VK_TRUE,
 				.robustBufferAccess = VK_TRUE,
 				.shaderImageGatherExtended = VK_TRUE,
+				.shaderStorageImageArrayDynamicIndexing = VK_TRUE,
 #ifdef VKM_DEBUG_WIREFRAME
 				.fillModeNonSolid = VK_TRUE,
 #endif
@@ -3064,6 +3831,20 @@ void vkCreateContext(const VkContextCreateInfo* pContextCreateInfo)
 #undef PFN_FUNC
 	}
 
+	///
+	/// Create Pipeline Cache
+	{
+		size_t initialDataSize = 0;
+		void*  pInitialData = LoadPipelineCacheData(&initialDataSize);
+		VK_CHECK(vkCreatePipelineCache(vk.context.device, &(VkPipelineCacheCreateInfo){
+			VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+			.initialDataSize = pInitialData != NULL ? initialDataSize : 0,
+			.pInitialData = pInitialData,
+		}, VK_ALLOC, &vk.context.pipelineCache));
+		VK_SET_DEBUG(vk.context.pipelineCache);
+		free(pInitialData);
+	}
+
 	///
 	/// Create Queue Families
 	for (int iFamilyType = 0; iFamilyType < VK_QUEUE_FAMILY_TYPE_COUNT; ++iFamilyType) {
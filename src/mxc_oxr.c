@@ -25,6 +25,14 @@ void xrGetViewConfigurationView(XrSystemId systemId, XrViewConfigurationView *pV
 	pView->maxSwapchainSampleCount = 1;
 }
 
+// Session ids are node handles. A released session fails the occupied check, one whose slot was claimed again fails the generation.
+#define SESSION_NODE_H(_hNode, _iSession, ...)                                        \
+	node_h _hNode = _iSession;                                                        \
+	if (!BLOCK_HANDLE_LIVE(node.context, _hNode)) {                                   \
+		LOG_ERROR("Session %d is released!\n", HANDLE_INDEX(_hNode));               \
+		return __VA_ARGS__;                                                           \
+	}
+
 // maybe should be external handle?
 XrResult xrClaimSessionId(session_i* pSessionIndex)
 {
@@ -49,7 +57,7 @@ XrResult xrClaimSessionId(session_i* pSessionIndex)
 	MxcNodeShared* pNodeShrd  = ARRAY_H(node.pShared, hNode);
 	pNodeShrd->compositorMode = MXC_COMPOSITOR_MODE_TESSELATION;
 	
-	*pSessionIndex = hNode; // openxr sessionId == moxaic node handle
+	*pSessionIndex = hNode; // openxr sessionId == moxaic node handle, all 32 bits of it
 
 	mxcIpcFuncEnqueue(hNode, MXC_INTERPROCESS_TARGET_NODE_OPENED);
 	
@@ -58,24 +66,24 @@ XrResult xrClaimSessionId(session_i* pSessionIndex)
 
 void xrReleaseSessionId(session_i iSession)
 {
-	node_h hNode = iSession;
+	SESSION_NODE_H(hNode, iSession);
 	mxcIpcFuncEnqueue(hNode, MXC_INTERPROCESS_TARGET_NODE_CLOSED);
     ReleaseNodeHandle(hNode);
 }
 
 XrResult xrSharedPollEvent(session_i iSession, XrEventDataUnion* pEventData)
 {
-	node_h hNode = iSession;
+	SESSION_NODE_H(hNode, iSession, XR_ERROR_HANDLE_INVALID);
 	MxcNodeContext* pNodeCtxt = BLOCK_PTR_H(node.context, hNode);
 	MxcNodeShared*  pNodeShrd = ARRAY_H(node.pShared, hNode);
 
-	return MID_CHANNEL_RECV(&pNodeShrd->eventDataQueue, pNodeShrd->queuedEventDataBuffers, pEventData) == MID_SUCCESS ?
+	return MID_CHANNEL_RECORD_RECV(&pNodeShrd->eventDataQueue, pNodeShrd->queuedEventData, pEventData, sizeof(XrEventDataUnion), NULL) == MID_SUCCESS ?
 	       XR_SUCCESS : XR_EVENT_UNAVAILABLE;
 }
 
 void xrGetReferenceSpaceBounds(session_i iSession, XrExtent2Df* pBounds)
 {
-	node_h hNode = iSession;
+	SESSION_NODE_H(hNode, iSession);
 	MxcNodeContext* pNodeCtxt = BLOCK_PTR_H(node.context, hNode);
 	MxcNodeShared*  pNodeShrd = ARRAY_H(node.pShared, hNode);
 
@@ -87,7 +95,7 @@ void xrGetReferenceSpaceBounds(session_i iSession, XrExtent2Df* pBounds)
 
 void xrGetSessionTimeline(session_i iSession, HANDLE* pHandle)
 {
-	node_h hNode = iSession;
+	SESSION_NODE_H(hNode, iSession);
 	MxcNodeContext* pNodeCtxt = BLOCK_PTR_H(node.context, hNode);
 	*pHandle = pNodeCtxt->imported.nodeTimelineHandle;
 }
@@ -96,7 +104,7 @@ void xrGetSessionTimeline(session_i iSession, HANDLE* pHandle)
 // should this be finish frame? and merged with SetColorSwapId and SetDepthSwapid? Probably
 void xrSetSessionTimelineValue(session_i iSession, uint64_t timelineValue)
 {
-	node_h hNode = iSession;
+	SESSION_NODE_H(hNode, iSession);
 	MxcNodeContext* pNodeCtxt = BLOCK_PTR_H(node.context, hNode);
 	MxcNodeShared*  pNodeShrd = ARRAY_H(node.pShared, hNode);
 	atomic_store_explicit(&pNodeShrd->timelineValue, timelineValue, memory_order_release);
@@ -104,14 +112,14 @@ void xrSetSessionTimelineValue(session_i iSession, uint64_t timelineValue)
 
 void xrGetCompositorTimeline(session_i iSession, HANDLE* pHandle)
 {
-	node_h hNode = iSession;
+	SESSION_NODE_H(hNode, iSession);
 	MxcNodeContext* pNodeCtxt = BLOCK_PTR_H(node.context, hNode);
 	*pHandle = pNodeCtxt->imported.compositorTimelineHandle;
 }
 
 XrResult xrCreateSwapchainImages(session_i iSession, swap_i iSwap, const XrSwapInfo* pInfo)
 {
-	node_h hNode = iSession;
+	SESSION_NODE_H(hNode, iSession, XR_ERROR_HANDLE_INVALID);
 	MxcNodeContext* pNodeCtxt = BLOCK_PTR_H(node.context, hNode);
 	MxcNodeShared*  pNodeShrd = ARRAY_H(node.pShared, hNode);
 
@@ -143,7 +151,7 @@ XrResult xrCreateSwapchainImages(session_i iSession, swap_i iSwap, const XrSwapI
 
 void xrGetSwapchainImportedImage(session_i iSession, swap_i iSwap, u32 iImg, HANDLE* pHandle)
 {
-	node_h hNode = iSession;
+	SESSION_NODE_H(hNode, iSession);
 //	MxcNodeContext* pNodeCtxt = BLOCK_PTR_H(node.context, hNode);
 	MxcNodeShared*  pNodeShrd = ARRAY_H(node.pShared, hNode);
 	MxcNodeImports* pImports = &pImportedExternalMemory->imports;
@@ -153,7 +161,7 @@ void xrGetSwapchainImportedImage(session_i iSession, swap_i iSwap, u32 iImg, HAN
 
 XrResult xrDestroySwapchainImages(session_i iSession, swap_i iSwap)
 {
-	node_h hNode = iSession;
+	SESSION_NODE_H(hNode, iSession, XR_ERROR_HANDLE_INVALID);
 	MxcNodeContext* pNodeCtxt = BLOCK_PTR_H(node.context, hNode);
 	MxcNodeShared*  pNodeShrd = ARRAY_H(node.pShared, hNode);
 
@@ -186,19 +194,20 @@ XrResult xrDestroySwapchainImages(session_i iSession, swap_i iSwap)
 	return XR_SUCCESS;
 }
 
-void xrSetColorSwapId(session_i iSession, XrViewId viewId, swap_i iSwap, u32 iImg)
+void xrSetColorSwapId(session_i iSession, XrViewId viewId, swap_i iSwap, u32 iImg, XrRect2Di imageRect)
 {
-	node_h hNode = iSession;
+	SESSION_NODE_H(hNode, iSession);
 	MxcNodeContext* pNodeCtxt = BLOCK_PTR_H(node.context, hNode);
 	MxcNodeShared*  pNodeShrd = ARRAY_H(node.pShared, hNode);
 	pNodeShrd->viewSwaps[viewId].iColorSwap = iSwap;
 	pNodeShrd->viewSwaps[viewId].iColorImg = iImg;
+	pNodeShrd->viewSwaps[viewId].imageRect = imageRect;
 	atomic_thread_fence(memory_order_release);
 }
 
 void xrSetDepthSwapId(session_i iSession, XrViewId viewId, swap_i iSwap, u32 iImg)
 {
-	node_h hNode = iSession;
+	SESSION_NODE_H(hNode, iSession);
 	MxcNodeContext* pNodeCtxt = BLOCK_PTR_H(node.context, hNode);
 	MxcNodeShared*  pNodeShrd = ARRAY_H(node.pShared, hNode);
 	pNodeShrd->viewSwaps[viewId].iDepthSwap = iSwap;
@@ -208,7 +217,7 @@ void xrSetDepthSwapId(session_i iSession, XrViewId viewId, swap_i iSwap, u32 iIm
 
 void xrSetDepthInfo(session_i iSession, float minDepth, float maxDepth, float nearZ, float farZ)
 {
-	node_h hNode = iSession;
+	SESSION_NODE_H(hNode, iSession);
 	MxcNodeContext* pNodeCtxt = BLOCK_PTR_H(node.context, hNode);
 	MxcNodeShared*  pNodeShrd = ARRAY_H(node.pShared, hNode);
 	// pNodeShrd->processState.minDepth = minDepth;
@@ -219,7 +228,7 @@ void xrSetDepthInfo(session_i iSession, float minDepth, float maxDepth, float ne
 
 void xrSetInitialCompositorTimelineValue(session_i iSession, uint64_t timelineValue)
 {
-	node_h hNode = iSession;
+	SESSION_NODE_H(hNode, iSession);
 	MxcNodeContext* pNodeCtxt = BLOCK_PTR_H(node.context, hNode);
 	MxcNodeShared*  pNodeShrd = ARRAY_H(node.pShared, hNode);
 
@@ -231,7 +240,7 @@ void xrSetInitialCompositorTimelineValue(session_i iSession, uint64_t timelineVa
 
 void xrGetCompositorTimelineValue(session_i iSession, uint64_t* pTimelineValue)
 {
-	node_h hNode = iSession;
+	SESSION_NODE_H(hNode, iSession);
 	MxcNodeContext* pNodeCtxt = BLOCK_PTR_H(node.context, hNode);
 	MxcNodeShared*  pNodeShrd = ARRAY_H(node.pShared, hNode);
 
@@ -240,7 +249,7 @@ void xrGetCompositorTimelineValue(session_i iSession, uint64_t* pTimelineValue)
 
 void xrProgressCompositorTimelineValue(session_i iSession, uint64_t timelineValue)
 {
-	node_h hNode = iSession;
+	SESSION_NODE_H(hNode, iSession);
 	MxcNodeContext* pNodeCtxt = BLOCK_PTR_H(node.context, hNode);
 	MxcNodeShared*  pNodeShrd = ARRAY_H(node.pShared, hNode);
 
@@ -249,7 +258,7 @@ void xrProgressCompositorTimelineValue(session_i iSession, uint64_t timelineValu
 
 XrTime xrGetFrameInterval(session_i iSession)
 {
-	node_h hNode = iSession;
+	SESSION_NODE_H(hNode, iSession, 0);
 	MxcNodeContext* pNodeCtxt = BLOCK_PTR_H(node.context, hNode);
 	MxcNodeShared*  pNodeShrd = ARRAY_H(node.pShared, hNode);
 
@@ -261,7 +270,7 @@ XrTime xrGetFrameInterval(session_i iSession)
 
 void xrGetHeadPose(session_i iSession, MidEulerPose* pPose)
 {
-	node_h hNode = iSession;
+	SESSION_NODE_H(hNode, iSession);
 	MxcNodeContext* pNodeCtxt = BLOCK_PTR_H(node.context, hNode);
 	MxcNodeShared*  pNodeShrd = ARRAY_H(node.pShared, hNode);
 
@@ -271,7 +280,7 @@ void xrGetHeadPose(session_i iSession, MidEulerPose* pPose)
 
 void xrGetEyeView(session_i iSession, view_i iView, XrEyeView *pEyeView)
 {
-	node_h hNode = iSession;
+	SESSION_NODE_H(hNode, iSession);
 	MxcNodeContext* pNodeCtxt = BLOCK_PTR_H(node.context, hNode);
 	MxcNodeShared*  pNodeShrd = ARRAY_H(node.pShared, hNode);
 
@@ -289,7 +298,8 @@ void xrGetEyeView(session_i iSession, view_i iView, XrEyeView *pEyeView)
 
 #define UPDATE_CLICK(button, chirality) \
     ({ \
-        MxcNodeShared* pNodeShrd = ARRAY_H(node.pShared, (node_h)sessionId); \
+        SESSION_NODE_H(hNode, sessionId, 0); \
+        MxcNodeShared* pNodeShrd = ARRAY_H(node.pShared, hNode); \
         atomic_thread_fence(memory_order_acquire); \
         volatile MxcController* pController = &pNodeShrd->chirality; \
         bool changed = pState->isActive  != pController->active || \
@@ -361,7 +371,8 @@ int xrInputMenuClick_Right(session_i sessionId, SubactionState* pState)
 
 #define UPDATE_POSE(pose, chirality) \
 	({ \
-        MxcNodeShared* pNodeShrd = ARRAY_H(node.pShared, (node_h)sessionId); \
+        SESSION_NODE_H(hNode, sessionId, 0); \
+        MxcNodeShared* pNodeShrd = ARRAY_H(node.pShared, hNode); \
 		atomic_thread_fence(memory_order_acquire); \
 		volatile MxcController* pController = &pNodeShrd->chirality; \
 		bool changed = pState->isActive != pController->active || \
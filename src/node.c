@@ -21,7 +21,26 @@ struct Node node;
 ////
 //// Swap Pool
 ////
-void mxcNodeGBufferProcessDepth(VkCommandBuffer gfxCmd, ProcessState* pProcessState, MxcNodeSwap* pDepthSwap, MxcNodeGBuffer* pGBuffer, ivec2 swapExtent)
+// Pushes the rect of iMip covering the mip 0 rect and dispatches over it
+static void GBufferProcessDispatchRect(VkCommandBuffer cmd, const ProcessState* pProcessState, ivec2 rectOffset, ivec2 rectExtent, int iMip)
+{
+	EXTRACT_FIELD(&node, gbufferProcessPipeLayout);
+
+	int   mipScale = 1 << iMip;
+	ivec2 mipMin = {.vec = rectOffset.vec >> iMip};
+	ivec2 mipMax = {.vec = (rectOffset.vec + rectExtent.vec + mipScale - 1) >> iMip};
+	GBufferProcessPush push = {
+		.state = *pProcessState,
+		.rectOffset = mipMin,
+		.rectExtent = {.vec = mipMax.vec - mipMin.vec},
+	};
+	vk.CmdPushConstants(cmd, gbufferProcessPipeLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(GBufferProcessPush), &push);
+
+	ivec2 groupCount = iVec2Min(iVec2CeiDivide(push.rectExtent, 32), 1);
+	vk.CmdDispatch(cmd, groupCount.x, groupCount.y, 1);
+}
+
+static void GBufferProcessDepthMultiDispatch(VkCommandBuffer gfxCmd, ProcessState* pProcessState, MxcNodeSwap* pDepthSwap, MxcNodeGBuffer* pGBuffer, ivec2 rectOffset, ivec2 rectExtent)
 {
 	EXTRACT_FIELD(&node, gbufferProcessDownPipe);
 	EXTRACT_FIELD(&node, gbufferProcessUpPipe);
@@ -34,15 +53,13 @@ void mxcNodeGBufferProcessDepth(VkCommandBuffer gfxCmd, ProcessState* pProcessSt
 		.cameraFarZ = 1,
 		.cameraNearZ = 0,
 	};
-	vk.CmdPushConstants(gfxCmd, gbufferProcessPipeLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ProcessState), &emptyProcessState);
 
 	{
 		CMD_PUSH_SETS(gfxCmd, VK_PIPELINE_BIND_POINT_COMPUTE, gbufferProcessPipeLayout,	PIPE_SET_INDEX_GBUFFER_PROCESS_INOUT,
 			BIND_WRITE_GBUFFER_PROCESS_SRC_DEPTH(pDepthSwap->view),
 			BIND_WRITE_GBUFFER_PROCESS_DST_GBUFFER(pGBuffer->mipViews[1]));
 
-		ivec2 groupCount = iVec2Min(iVec2CeiDivide(swapExtent.vec >> 1, 32), 1);
-		vk.CmdDispatch(gfxCmd, groupCount.x, groupCount.y, 1);
+		GBufferProcessDispatchRect(gfxCmd, &emptyProcessState, rectOffset, rectExtent, 1);
 	}
 
 	/* Blit Down Depth Mips */
@@ -79,8 +96,7 @@ void mxcNodeGBufferProcessDepth(VkCommandBuffer gfxCmd, ProcessState* pProcessSt
 			BIND_WRITE_GBUFFER_PROCESS_SRC_DEPTH(pGBuffer->mipViews[iMip - 1]),
 			BIND_WRITE_GBUFFER_PROCESS_DST_GBUFFER(pGBuffer->mipViews[iMip]));
 
-		ivec2 groupCount = iVec2Min(iVec2CeiDivide(swapExtent.vec >> iMip, 32), 1);
-		vk.CmdDispatch(gfxCmd, groupCount.x, groupCount.y, 1);
+		GBufferProcessDispatchRect(gfxCmd, &emptyProcessState, rectOffset, rectExtent, iMip);
 	}
 
 	/* Blit Up Depth Mips */
@@ -120,8 +136,7 @@ void mxcNodeGBufferProcessDepth(VkCommandBuffer gfxCmd, ProcessState* pProcessSt
 			BIND_WRITE_GBUFFER_PROCESS_SRC_GBUFFER(pGBuffer->mipViews[iMip]),
 			BIND_WRITE_GBUFFER_PROCESS_DST_GBUFFER(pGBuffer->mipViews[iMip]));
 
-		ivec2 groupCount = iVec2Min(iVec2CeiDivide(swapExtent.vec >> iMip, 32), 1);
-		vk.CmdDispatch(gfxCmd, groupCount.x, groupCount.y, 1);
+		GBufferProcessDispatchRect(gfxCmd, &emptyProcessState, rectOffset, rectExtent, iMip);
 	}
 
 	/* Final Depth Up Blit */
@@ -153,17 +168,98 @@ void mxcNodeGBufferProcessDepth(VkCommandBuffer gfxCmd, ProcessState* pProcessSt
 			VK_IMAGE_BARRIER_QUEUE_FAMILY_IGNORED,
 		});
 
-		vk.CmdPushConstants(gfxCmd, gbufferProcessPipeLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ProcessState), pProcessState);
 		CMD_PUSH_SETS(gfxCmd, VK_PIPELINE_BIND_POINT_COMPUTE, gbufferProcessPipeLayout, PIPE_SET_INDEX_GBUFFER_PROCESS_INOUT,
 			BIND_WRITE_GBUFFER_PROCESS_SRC_DEPTH(pGBuffer->mipViews[1]),
 			BIND_WRITE_GBUFFER_PROCESS_SRC_GBUFFER(pDepthSwap->view),
 			BIND_WRITE_GBUFFER_PROCESS_DST_GBUFFER(pGBuffer->mipViews[0]));
 
-		ivec2 groupCount = iVec2Min(iVec2CeiDivide(swapExtent, 32), 1);
-		vk.CmdDispatch(gfxCmd, groupCount.x, groupCount.y, 1);
+		GBufferProcessDispatchRect(gfxCmd, pProcessState, rectOffset, rectExtent, 0);
 	}
 }
 
+static void GBufferProcessDepthSinglePass(VkCommandBuffer cmd, ProcessState* pProcessState, MxcNodeSwap* pDepthSwap, MxcNodeGBuffer* pGBuffer, ivec2 rectOffset, ivec2 rectExtent)
+{
+	EXTRACT_FIELD(&node, gbufferProcessDownSinglePassPipe);
+	EXTRACT_FIELD(&node, gbufferProcessUpSinglePassPipe);
+	EXTRACT_FIELD(&node, gbufferProcessPipeLayout);
+	EXTRACT_FIELD(&node, gbufferProcessCounterBuffer);
+
+	/* Down */
+	// Counter is shared by every gbuffer so wait on whichever last workgroup reset it
+	vk.CmdPipelineBarrier2(cmd, &(VkDependencyInfo){
+		VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+		.bufferMemoryBarrierCount = 1,
+		.pBufferMemoryBarriers    = &(VkBufferMemoryBarrier2){
+			VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+			.srcStageMask  = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			.srcAccessMask = VK_ACCESS_2_SHADER_WRITE_BIT,
+			.dstStageMask  = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			.dstAccessMask = VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT,
+			VK_IMAGE_BARRIER_QUEUE_FAMILY_IGNORED,
+			.buffer        = gbufferProcessCounterBuffer,
+			.size          = VK_WHOLE_SIZE,
+		},
+	});
+
+	// Slots past the last mip are never written but must still be valid
+	VkDescriptorImageInfo mipInfos[GBUFFER_PROCESS_MAX_MIP_COUNT];
+	for (int iMip = 0; iMip < GBUFFER_PROCESS_MAX_MIP_COUNT; ++iMip)
+		mipInfos[iMip] = (VkDescriptorImageInfo){
+			.imageView = pGBuffer->mipViews[MIN(iMip, pGBuffer->mipViewCount - 1)],
+			.imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+		};
+
+	vk.CmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, gbufferProcessDownSinglePassPipe);
+	CMD_PUSH_SETS(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, gbufferProcessPipeLayout, PIPE_SET_INDEX_GBUFFER_PROCESS_INOUT,
+		BIND_WRITE_GBUFFER_PROCESS_SRC_DEPTH(pDepthSwap->view),
+		BIND_WRITE_GBUFFER_PROCESS_DST_GBUFFER_MIPS(mipInfos),
+		BIND_WRITE_GBUFFER_PROCESS_COUNTER(gbufferProcessCounterBuffer));
+
+	// Both passes take the mip 0 rect. Down covers the 64 texel tiles it touches.
+	GBufferProcessPush push = {
+		.state = *pProcessState,
+		.rectOffset = rectOffset,
+		.rectExtent = rectExtent,
+	};
+	vk.CmdPushConstants(cmd, gbufferProcessPipeLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(GBufferProcessPush), &push);
+
+	int   tileSize = GBUFFER_PROCESS_LOCAL_SIZE * 2;
+	ivec2 tileMin = {.vec = rectOffset.vec / tileSize};
+	ivec2 tileMax = iVec2CeiDivide((ivec2){.vec = rectOffset.vec + rectExtent.vec}, tileSize);
+	ivec2 downGroupCount = iVec2Min((ivec2){.vec = tileMax.vec - tileMin.vec}, 1);
+	vk.CmdDispatch(cmd, downGroupCount.x, downGroupCount.y, 1);
+
+	/* Up */
+	CMD_IMAGE_BARRIERS(cmd, {
+		VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+		.image = pGBuffer->image,
+		.subresourceRange = {
+			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+			.baseMipLevel = 1,
+			.levelCount = VK_REMAINING_MIP_LEVELS,
+			.layerCount = VK_REMAINING_ARRAY_LAYERS
+		},
+		VK_IMAGE_BARRIER_SRC_COMPUTE_WRITE,
+		VK_IMAGE_BARRIER_DST_COMPUTE_READ,
+		VK_IMAGE_BARRIER_QUEUE_FAMILY_IGNORED,
+	});
+
+	vk.CmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, gbufferProcessUpSinglePassPipe);
+	CMD_PUSH_SETS(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, gbufferProcessPipeLayout, PIPE_SET_INDEX_GBUFFER_PROCESS_INOUT,
+		BIND_WRITE_GBUFFER_PROCESS_SRC_DEPTH(pDepthSwap->view),
+		BIND_WRITE_GBUFFER_PROCESS_SRC_GBUFFER(pGBuffer->pyramidView),
+		BIND_WRITE_GBUFFER_PROCESS_DST_GBUFFER(pGBuffer->mipViews[0]));
+
+	ivec2 upGroupCount = iVec2Min(iVec2CeiDivide(rectExtent, 32), 1);
+	vk.CmdDispatch(cmd, upGroupCount.x, upGroupCount.y, 1);
+}
+
+void mxcNodeGBufferProcessDepth(VkCommandBuffer cmd, bool singlePass, ProcessState* pProcessState, MxcNodeSwap* pDepthSwap, MxcNodeGBuffer* pGBuffer, ivec2 rectOffset, ivec2 rectExtent)
+{
+	if (singlePass) GBufferProcessDepthSinglePass(cmd, pProcessState, pDepthSwap, pGBuffer, rectOffset, rectExtent);
+	else            GBufferProcessDepthMultiDispatch(cmd, pProcessState, pDepthSwap, pGBuffer, rectOffset, rectExtent);
+}
+
 
 // this couild go in mid vk
 static void CreateColorSwapTexture(const XrSwapInfo* pInfo, VkExternalTexture* pSwapTexture)
@@ -261,64 +357,83 @@ static void CreateNodeGBuffer(node_h hNode)
 	int mipLevelCount = VK_MIP_LEVEL_COUNT(pNodeShrd->swapMaxWidth, pNodeShrd->swapMaxHeight);
 	ASSERT(mipLevelCount < MXC_NODE_GBUFFER_MAX_MIP_COUNT, "Max gbuffer mip count exceeded.");
 
-	for (int iView = 0; iView < XR_MAX_VIEW_COUNT; ++iView) {
-		vkCreateDedicatedTexture(&(VkDedicatedTextureCreateInfo){
-				.pImageCreateInfo = &(VkImageCreateInfo){
-					VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
-					.imageType = VK_IMAGE_TYPE_2D,
+	// Layout transitions are submitted without waiting so they overlap the remaining gbuffer creation
+	u64 transitionValue = 0;
+	for (int iGBuffer = 0; iGBuffer < MXC_NODE_GBUFFER_COUNT; ++iGBuffer) {
+		for (int iView = 0; iView < XR_MAX_VIEW_COUNT; ++iView) {
+			vkCreateDedicatedTexture(&(VkDedicatedTextureCreateInfo){
+					.pImageCreateInfo = &(VkImageCreateInfo){
+						VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+						.imageType = VK_IMAGE_TYPE_2D,
+						.format = MXC_NODE_GBUFFER_FORMAT,
+						.extent = {
+							pNodeShrd->swapMaxWidth,
+							pNodeShrd->swapMaxHeight,
+							1,
+						},
+						.mipLevels = mipLevelCount,
+						.arrayLayers = 1,
+						.samples = VK_SAMPLE_COUNT_1_BIT,
+						.usage = MXC_NODE_GBUFFER_USAGE,
+					},
+					.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+					.locality = VK_LOCALITY_CONTEXT},
+				&pNodeCtxt->gbuffer[iGBuffer][iView]);
+			VK_SET_DEBUG_NAME(pNodeCtxt->gbuffer[iGBuffer][iView].image, "NodeGBufferImage%d View%d", iGBuffer, iView);
+			VK_SET_DEBUG_NAME(pNodeCtxt->gbuffer[iGBuffer][iView].view, "NodeGBufferView%d View%d", iGBuffer, iView);
+			VK_SET_DEBUG_NAME(pNodeCtxt->gbuffer[iGBuffer][iView].image, "NodeGBufferMemory%d View%d", iGBuffer, iView);
+
+			// Pack data for compositor hot access
+			pNodeCpst->gbuffer[iGBuffer][iView].image = pNodeCtxt->gbuffer[iGBuffer][iView].image;
+			pNodeCpst->gbuffer[iGBuffer][iView].mipViewCount = mipLevelCount;
+
+			// Generate views for mip access
+			for (int iMip = 0; iMip < mipLevelCount; ++iMip) {
+				VkImageViewCreateInfo imageViewCreateInfo = {
+					VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+					.image = pNodeCtxt->gbuffer[iGBuffer][iView].image,
+					.viewType = VK_IMAGE_VIEW_TYPE_2D,
 					.format = MXC_NODE_GBUFFER_FORMAT,
-					.extent = {
-						pNodeShrd->swapMaxWidth,
-						pNodeShrd->swapMaxHeight,
-						1,
+					.subresourceRange = {
+						.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+						.baseMipLevel = iMip,
+						.levelCount = 1,
+						.layerCount = 1,
 					},
-					.mipLevels = mipLevelCount,
-					.arrayLayers = 1,
-					.samples = VK_SAMPLE_COUNT_1_BIT,
-					.usage = MXC_NODE_GBUFFER_USAGE,
-				},
-				.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-				.locality = VK_LOCALITY_CONTEXT},
-			&pNodeCtxt->gbuffer[iView]);
-		VK_SET_DEBUG_NAME(pNodeCtxt->gbuffer[iView].image, "NodeGBufferImage%d", iView);
-		VK_SET_DEBUG_NAME(pNodeCtxt->gbuffer[iView].view, "NodeGBufferView%d", iView);
-		VK_SET_DEBUG_NAME(pNodeCtxt->gbuffer[iView].image, "NodeGBufferMemory%d", iView);
-
-		// Pack data for compositor hot access
-		pNodeCpst->gbuffer[iView].image = pNodeCtxt->gbuffer[iView].image;
-		pNodeCpst->gbuffer[iView].mipViewCount = mipLevelCount;
-
-		// Generate views for mip access
-		for (int iMip = 0; iMip < mipLevelCount; ++iMip) {
-			VkImageViewCreateInfo imageViewCreateInfo = {
+				};
+				VkImageView view;
+				VK_CHECK(vkCreateImageView(vk.context.device, &imageViewCreateInfo, VK_ALLOC, &view));
+				pNodeCpst->gbuffer[iGBuffer][iView].mipViews[iMip] = view;
+				VK_SET_DEBUG_NAME(pNodeCpst->gbuffer[iGBuffer][iView].mipViews[iMip], "NodeGBufferView%d View%d Mip%d", iGBuffer, iView, iMip);
+			}
+
+			VK_CHECK(vkCreateImageView(vk.context.device, &(VkImageViewCreateInfo){
 				VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
-				.image = pNodeCtxt->gbuffer[iView].image,
+				.image = pNodeCtxt->gbuffer[iGBuffer][iView].image,
 				.viewType = VK_IMAGE_VIEW_TYPE_2D,
 				.format = MXC_NODE_GBUFFER_FORMAT,
 				.subresourceRange = {
 					.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-					.baseMipLevel = iMip,
-					.levelCount = 1,
+					.baseMipLevel = 1,
+					.levelCount = mipLevelCount - 1,
 					.layerCount = 1,
 				},
-			};
-			VkImageView view;
-			VK_CHECK(vkCreateImageView(vk.context.device, &imageViewCreateInfo, VK_ALLOC, &view));
-			pNodeCpst->gbuffer[iView].mipViews[iMip] = view;
-			VK_SET_DEBUG_NAME(pNodeCpst->gbuffer[iView].mipViews[iMip], "NodeGBufferView%d Mip%d", iView, iMip);
-		}
-
-		VK_IMMEDIATE_COMMAND_BUFFER_CONTEXT(VK_QUEUE_FAMILY_TYPE_MAIN_GRAPHICS) {
-			CMD_IMAGE_BARRIERS(cmd,	{
-				VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
-				.image = pNodeCtxt->gbuffer[iView].image,
-				.subresourceRange = VK_COLOR_SUBRESOURCE_RANGE,
-				VK_IMAGE_BARRIER_SRC_UNDEFINED,
-				VK_IMAGE_BARRIER_DST_COMPUTE_NONE,
-				VK_IMAGE_BARRIER_QUEUE_FAMILY_IGNORED,
-			});
+			}, VK_ALLOC, &pNodeCpst->gbuffer[iGBuffer][iView].pyramidView));
+			VK_SET_DEBUG_NAME(pNodeCpst->gbuffer[iGBuffer][iView].pyramidView, "NodeGBufferView%d View%d Pyramid", iGBuffer, iView);
+
+			VK_IMMEDIATE_COMMAND_BUFFER_ASYNC_CONTEXT(VK_QUEUE_FAMILY_TYPE_MAIN_GRAPHICS, transitionValue) {
+				CMD_IMAGE_BARRIERS(cmd,	{
+					VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+					.image = pNodeCtxt->gbuffer[iGBuffer][iView].image,
+					.subresourceRange = VK_COLOR_SUBRESOURCE_RANGE,
+					VK_IMAGE_BARRIER_SRC_UNDEFINED,
+					VK_IMAGE_BARRIER_DST_COMPUTE_NONE,
+					VK_IMAGE_BARRIER_QUEUE_FAMILY_IGNORED,
+				});
+			}
 		}
 	}
+	vkWaitImmediateCommandBuffer(VK_QUEUE_FAMILY_TYPE_MAIN_GRAPHICS, transitionValue);
 #endif
 }
 
@@ -336,7 +451,7 @@ static void mxcDestroySwapTexture(MxcSwapTexture* pSwap)
  */
 node_h RequestLocalNodeHandle()
 {
-	node_h hNode = BLOCK_CLAIM(node.context, 0);
+	node_h hNode = BLOCK_CLAIM_ATOMIC(node.context);
 	LOG("Requested Local Node Handle %d.\n", HANDLE_INDEX(hNode));
 
 	MxcNodeContext* pNodeCtxt = BLOCK_PTR_H(node.context, hNode);
@@ -344,7 +459,7 @@ node_h RequestLocalNodeHandle()
 
 	MxcNodeShared** ppNodeShrd = ARRAY_PTR_H(node.pShared, hNode);
 	ASSERT(*ppNodeShrd == NULL);
-	XMALLOC_ZERO_P(*ppNodeShrd);
+	XMALLOC_ALIGNED_ZERO_P(*ppNodeShrd);
 
 #if defined(MOXAIC_COMPOSITOR)
 	MxcCompositorNodeData* pNodeCpst = ARRAY_PTR_H(cst.nodeData, hNode);
@@ -356,7 +471,7 @@ node_h RequestLocalNodeHandle()
 
 MidResult RequestExternalNodeHandle(MxcNodeShared* pNodeShared, node_h* pNode_h)
 {
-	node_h hNode = BLOCK_CLAIM(node.context, 0);
+	node_h hNode = BLOCK_CLAIM_ATOMIC(node.context);
 	if (HANDLE_INVALID(hNode)) return MID_LIMIT_REACHED;
 	LOG("Claimed External Node Handle %d.\n", HANDLE_INDEX(hNode));
 
@@ -378,7 +493,7 @@ MidResult RequestExternalNodeHandle(MxcNodeShared* pNodeShared, node_h* pNode_h)
 
 void ReleaseNodeHandle(node_h hNode)
 {
-	MxcNodeContext* pNodeCtxt = BLOCK_RELEASE(node.context, hNode);
+	MxcNodeContext* pNodeCtxt = BLOCK_PTR_H(node.context, hNode);
 	ASSERT(!IS_STRUCT_P_ZEROED(pNodeCtxt), "MxcNodeContext zeroed!");
 	ZERO_STRUCT_P(pNodeCtxt);
 
@@ -392,6 +507,8 @@ void ReleaseNodeHandle(node_h hNode)
 	ZERO_STRUCT_P(pNodeCpst);
 #endif
 
+	// Release last so a thread claiming this slot sees it cleared.
+	BLOCK_RELEASE_ATOMIC(node.context, hNode);
 	LOG("Released Node Handle %d.\n", HANDLE_INDEX(hNode));
 }
 
@@ -447,7 +564,7 @@ void ReleaseCompositorNodeActive(node_h hNode)
 	u16 count = atomic_fetch_sub(&pActiveNodes->count, 1);
 	ATOMIC_FENCE_SCOPE	{
 		u16 i = 0;
-		for (; i < count; ++i) if (pActiveNodes->handles[i] == hNode) break;
+		for (; i < count; ++i) if (HANDLE32_EQUAL(pActiveNodes->handles[i], hNode)) break;
 		for (; i < count - 1; ++i) pActiveNodes->handles[i] = pActiveNodes->handles[i + 1];
 	}
 #endif
@@ -476,11 +593,13 @@ static int CleanupNode(node_h hNode)
 			if (result != 0) {
 				perror("Thread join failed");
 			}
-			free((void*)pNodeShrd);
+			ALIGNED_FREE(pNodeShrd);
 			break;
 		}
 		case MXC_NODE_INTERPROCESS_MODE_EXPORTED: {
 #if defined(MOXAIC_COMPOSITOR)
+			// Composites still in flight may sample the swaps and gbuffer
+			vkTimelineWait(vk.context.device, compositorContext.baseCycleValue, compositorContext.frameTimeline);
 			 mxcClearNodeDescriptorSet(hNode);
 
 			// We are fully destroying swaps and gbuffer but may want to retain them someday
@@ -488,12 +607,24 @@ static int CleanupNode(node_h hNode)
 				swap_h hSwap = pNodeCtxt->hSwaps[iNodeSwap];
 				if (!HANDLE_VALID(hSwap)) continue;
 
-				MxcSwapTexture* pSwap = BLOCK_RELEASE(cst.block.swap, hSwap);
+				MxcSwapTexture* pSwap = BLOCK_PTR_H(cst.block.swap, hSwap);
 				mxcDestroySwapTexture(pSwap);
+				BLOCK_RELEASE_ATOMIC(cst.block.swap, hSwap);
 			}
-			for (int iView = 0; iView < XR_MAX_VIEW_COUNT; ++iView) {
-				if (pNodeCtxt->gbuffer[iView].view == NULL) continue;
-				vkDestroyDedicatedTexture(&pNodeCtxt->gbuffer[iView]);
+			MxcCompositorNodeData* pNodeCpst = ARRAY_PTR_H(cst.nodeData, hNode);
+			for (int iGBuffer = 0; iGBuffer < MXC_NODE_GBUFFER_COUNT; ++iGBuffer) {
+				for (int iView = 0; iView < XR_MAX_VIEW_COUNT; ++iView) {
+					if (pNodeCtxt->gbuffer[iGBuffer][iView].view == NULL) continue;
+
+					// Views onto the gbuffer image must go before it does
+					MxcNodeGBuffer* pGBuffer = &pNodeCpst->gbuffer[iGBuffer][iView];
+					for (int iMip = 0; iMip < pGBuffer->mipViewCount; ++iMip)
+						vkDestroyImageView(vk.context.device, pGBuffer->mipViews[iMip], VK_ALLOC);
+					vkDestroyImageView(vk.context.device, pGBuffer->pyramidView, VK_ALLOC);
+					*pGBuffer = (MxcNodeGBuffer){};
+
+					vkDestroyDedicatedTexture(&pNodeCtxt->gbuffer[iGBuffer][iView]);
+				}
 			}
 
 			CLOSE_HANDLE(pNodeCtxt->exported.nodeTimelineHandle);
@@ -565,6 +696,7 @@ void mxcRequestNodeThread(void* (*runFunc)(void*), node_h* pNodeHandle)
 		// and maybe better way to signify frame has been set
 		pNodeShrd->viewSwaps[i].iColorSwap = CHAR_MAX;
 		pNodeShrd->viewSwaps[i].iDepthSwap = CHAR_MAX;
+		pNodeShrd->viewSwaps[i].imageRect = (XrRect2Di){};
 	}
 
 	vkSemaphoreCreateInfoExt semaphoreCreateInfo = {
@@ -591,7 +723,7 @@ void mxcRequestNodeThread(void* (*runFunc)(void*), node_h* pNodeHandle)
 
 	*pNodeHandle = hNode;
 
-	CHECK(pthread_create(&pNodeCtxt->thread.threadId, NULL, (void* (*)(void*))runFunc, (void*)(u64)hNode), "Node thread creation failed!");
+	CHECK(pthread_create(&pNodeCtxt->thread.threadId, NULL, (void* (*)(void*))runFunc, (void*)(u64)hNode.id), "Node thread creation failed!");
 
 	// Add to COMPOSITOR_MODE_NONE initially to start processing
 	MID_CHANNEL_SEND(&node.newConnectionQueue, node.queuedNewConnections, &hNode);
@@ -717,6 +849,7 @@ static void ServerInterprocessAcceptNodeConnection()
 			// and maybe better way to signify frame has been set
 			pNodeShrd->viewSwaps[i].iColorSwap = CHAR_MAX;
 			pNodeShrd->viewSwaps[i].iDepthSwap = CHAR_MAX;
+			pNodeShrd->viewSwaps[i].imageRect = (XrRect2Di){};
 		}
 
 		vkSemaphoreCreateInfoExt semaphoreCreateInfo = {
@@ -1021,6 +1154,7 @@ static void ipcFuncNodeOpened(node_h hNode)
 {
 	LOG("Node Opened %d\n", HANDLE_INDEX(hNode));
 	CreateNodeGBuffer(hNode);
+	vkLogMemoryStats();
 
 	// Move out of COMPOSITOR_MODE_NONE and set to current COMPOSITOR_MODE to begin compositing
 	ReleaseCompositorNodeActive(hNode);
@@ -1055,7 +1189,7 @@ static void ipcFuncClaimSwap(node_h hNode)
 		switch (pNodeShrd->nodeSwapStates[iNodeSwap])
 		{
 			case XR_SWAP_STATE_REQUESTED: {
-				block_h hSwap = BLOCK_CLAIM(cst.block.swap, 0); // key should be hash of swap info to find recycled swaps
+				swap_h hSwap = BLOCK_CLAIM_ATOMIC(cst.block.swap); // key should be hash of swap info to find recycled swaps
 				if (!HANDLE_VALID(hSwap)) {
 					LOG_ERROR("Fail to claim SwapImage!\n");
 					pNodeShrd->nodeSwapStates[iNodeSwap] = XR_SWAP_STATE_ERROR;
@@ -1116,10 +1250,11 @@ static void ipcFuncClaimSwap(node_h hNode)
 				swap_h hSwap = pNodeCtxt->hSwaps[iNodeSwap];
 				if (!HANDLE_VALID(hSwap)) continue;
 
-				MxcSwapTexture* pSwap = BLOCK_RELEASE(cst.block.swap, hSwap);
+				MxcSwapTexture* pSwap = BLOCK_PTR_H(cst.block.swap, hSwap);
 				mxcDestroySwapTexture(pSwap);
+				BLOCK_RELEASE_ATOMIC(cst.block.swap, hSwap);
 
-				pNodeCtxt->hSwaps[iNodeSwap] = HANDLE_DEFAULT;
+				pNodeCtxt->hSwaps[iNodeSwap] = HANDLE32_DEFAULT;
 				pNodeShrd->nodeSwapStates[iNodeSwap] = XR_SWAP_STATE_UNITIALIZED;
 				ZERO_STRUCT_P(&pNodeShrd->nodeSwapInfos[iNodeSwap]);
 
@@ -1152,7 +1287,7 @@ const MxcIpcFuncPtr MXC_IPC_FUNCS[] = {
 
 int mxcIpcFuncEnqueue(node_h hNode, MxcIpcFunc target) {
 	MxcNodeShared* pNodeShrd = ARRAY_H(node.pShared, hNode);
-	return MID_CHANNEL_SEND(&pNodeShrd->ipcFuncQueue, pNodeShrd->queuedIpcFuncs, &target);
+	return MID_CHANNEL_SEND_WAKE(&pNodeShrd->ipcFuncQueue, pNodeShrd->queuedIpcFuncs, &target);
 }
 
 void mxcIpcFuncDequeue(node_h hNode)
@@ -1168,6 +1303,16 @@ void mxcInitializeNode() {
 	CreateGBufferProcessPipeLayout(node.gbufferProcessSetLayout, &node.gbufferProcessPipeLayout);
 	vkCreateComputePipe("./shaders/compositor_gbuffer_process_down.comp.spv", node.gbufferProcessPipeLayout, &node.gbufferProcessDownPipe);
 	vkCreateComputePipe("./shaders/compositor_gbuffer_process_up.comp.spv",   node.gbufferProcessPipeLayout, &node.gbufferProcessUpPipe);
+	vkCreateComputePipe("./shaders/compositor_gbuffer_process_down_single_pass.comp.spv", node.gbufferProcessPipeLayout, &node.gbufferProcessDownSinglePassPipe);
+	vkCreateComputePipe("./shaders/compositor_gbuffer_process_up_single_pass.comp.spv",   node.gbufferProcessPipeLayout, &node.gbufferProcessUpSinglePassPipe);
 	VK_SET_DEBUG(node.gbufferProcessDownPipe);
 	VK_SET_DEBUG(node.gbufferProcessUpPipe);
+	VK_SET_DEBUG(node.gbufferProcessDownSinglePassPipe);
+	VK_SET_DEBUG(node.gbufferProcessUpSinglePassPipe);
+
+	u32* pCounterMapped;
+	vkCreateAllocateBindMapBuffer(VK_MEMORY_LOCAL_HOST_VISIBLE_COHERENT, sizeof(u32), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_LOCALITY_CONTEXT,
+		&node.gbufferProcessCounterMemory, &node.gbufferProcessCounterBuffer, (void**)&pCounterMapped);
+	VK_SET_DEBUG(node.gbufferProcessCounterBuffer);
+	*pCounterMapped = 0;
 }
\ No newline at end of file
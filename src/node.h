@@ -19,17 +19,45 @@
  * Constants
  */
 
+// Cycles the compositor may record ahead of the GPU. 1 waits on every composite before recording the next.
+#ifndef MXC_COMPOSITOR_FRAME_COUNT
+#define MXC_COMPOSITOR_FRAME_COUNT 2
+#endif
+
 // The number of mip levels flattened to one image by compositor_gbuffer_blit_mip_step.comp
-#define MXC_NODE_GBUFFER_MAX_MIP_COUNT 12
+#define MXC_NODE_GBUFFER_MAX_MIP_COUNT GBUFFER_PROCESS_MAX_MIP_COUNT
 #define MXC_NODE_GBUFFER_FORMAT VK_FORMAT_R16G16B16A16_SFLOAT
 #define MXC_NODE_GBUFFER_USAGE  VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT
+// Gbuffers are processed on the compute queue while composites in flight still sample the prior one,
+// so each node rotates through one per compositor frame.
+#define MXC_NODE_GBUFFER_COUNT  MXC_COMPOSITOR_FRAME_COUNT
+
+// Build the gbuffer depth pyramid with one dispatch down and one up rather than one per mip each way.
+// gbuffer_test checks it matches the multi dispatch path. It also stops holes near the edge of an offset rect
+// filling from mip texels outside the rect. It only ran about 6x slower on SwiftShader, the one device it has
+// been timed on, so it stays off until gbuffer_test or MXC_NODE_GBUFFER_PROCESS_COMPARE shows it faster on a GPU.
+#ifndef MXC_NODE_GBUFFER_PROCESS_SINGLE_PASS
+#define MXC_NODE_GBUFFER_PROCESS_SINGLE_PASS 0
+#endif
+// Alternate both gbuffer process paths each log interval so their times are logged side by side
+#ifndef MXC_NODE_GBUFFER_PROCESS_COMPARE
+#define MXC_NODE_GBUFFER_PROCESS_COMPARE 0
+#endif
 #define MXC_NODE_CLEAR_COLOR (VkClearColorValue) { 0.0f, 0.0f, 0.0f, 0.0f }
 #define MXC_EXTERNAL_FRAMEBUFFER_HANDLE_TYPE VK_EXTERNAL_MEMORY_HANDLE_TYPE_D3D12_RESOURCE_BIT
 
+// Chosen per queue. Must be power of 2 and fit the index width of the queue's ring.
+#define MXC_IPC_FUNC_QUEUE_CAPACITY       1024
+#define MXC_EVENT_DATA_QUEUE_SIZE         16384 // Bytes, events are variable length records
+#define MXC_NEW_CONNECTION_QUEUE_CAPACITY 128
+
+// Longest a node main loop sleeps waiting on queued command buffers before pumping window input.
+#define MXC_NODE_IDLE_WAIT_MS 8
+
 /*
  * Shared Types
  */
-typedef block_handle node_h;
+typedef block_handle32 node_h;
 
 typedef enum PACKED MxcNodeInterprocessMode {
 	MXC_NODE_INTERPROCESS_MODE_NONE,
@@ -107,6 +135,8 @@ typedef volatile struct MxcNodeShared {
 		u32    iColorImg;
 		swap_i iDepthSwap;
 		u32    iDepthImg;
+		// Region of the swap the view was rendered into. Zero extent is the whole swap.
+		XrRect2Di imageRect;
 	} viewSwaps[XR_MAX_VIEW_COUNT];
 
 	XrSwapState     nodeSwapStates[XR_SWAPCHAIN_CAPACITY];
@@ -121,12 +151,12 @@ typedef volatile struct MxcNodeShared {
 	MxcCompositorMode compositorMode;
 
 	// Interprocess
-	MidChannelRing ipcFuncQueue;
-	MxcIpcFunc queuedIpcFuncs[MID_QRING_CAPACITY];
+	MidChannelAlignedRing16 ipcFuncQueue;
+	MxcIpcFunc              queuedIpcFuncs[MXC_IPC_FUNC_QUEUE_CAPACITY];
 
 	/* Events */
-	MidChannelRing eventDataQueue;
-	XrEventDataUnion queuedEventDataBuffers[MID_QRING_CAPACITY];
+	MidChannelRecordRing eventDataQueue;
+	ALIGN(MID_CHANNEL_RECORD_ALIGN) u8 queuedEventData[MXC_EVENT_DATA_QUEUE_SIZE];
 
 } MxcNodeShared; //MxcSharedNodeData to reflect MxcCompositorNodeData?
 
@@ -169,6 +199,13 @@ typedef struct MxcCompositorNodeSetState {
 	vec2 ulUV;
 	vec2 lrUV;
 
+	// Rendered imageRect in node swap UV. Clip UV maps across this.
+	vec2 swapULUV;
+	vec2 swapLRUV;
+
+	// Half extent of the node bounds cube
+	f32 compositorRadius;
+
 } MxcCompositorNodeSetState;
 
 typedef enum PACKED MxcCubeCorners {
@@ -212,6 +249,7 @@ typedef struct MxcNodeGBuffer {
 	VkImage     image;
 	int         mipViewCount;
 	VkImageView mipViews[MXC_NODE_GBUFFER_MAX_MIP_COUNT];
+	VkImageView pyramidView; // Mip 1 onwards. Sampled by the single pass up while it writes mip 0.
 } MxcNodeGBuffer;
 
 typedef struct MxcNodeSwap {
@@ -230,7 +268,7 @@ typedef struct MxcNodeContext {
 	HANDLE swapsSyncedHandle;
 	swap_h hSwaps[MXC_NODE_SWAP_CAPACITY];
 
-	VkDedicatedTexture gbuffer[XR_MAX_VIEW_COUNT];
+	VkDedicatedTexture gbuffer[MXC_NODE_GBUFFER_COUNT][XR_MAX_VIEW_COUNT];
 
 	union {
 		// MXC_NODE_INTERPROCESS_MODE_THREAD
@@ -293,17 +331,23 @@ extern MxcExternalNodeMemory* pImportedExternalMemory;
 
 extern struct Node {
 	MidChannelRing newConnectionQueue;
-	node_h 	 queuedNewConnections[MID_QRING_CAPACITY];
+	node_h 	 queuedNewConnections[MXC_NEW_CONNECTION_QUEUE_CAPACITY];
 
 	MxcActiveNodes active[MXC_COMPOSITOR_MODE_COUNT];
 
-	BLOCK_T_N(MxcNodeContext, MXC_NODE_CAPACITY) context;
+	BLOCK32_T_N(MxcNodeContext, MXC_NODE_CAPACITY) context;
 	MxcNodeShared* pShared[MXC_NODE_CAPACITY];
 
 	VkDescriptorSetLayout gbufferProcessSetLayout;
 	VkPipelineLayout      gbufferProcessPipeLayout;
 	VkPipeline            gbufferProcessDownPipe;
 	VkPipeline            gbufferProcessUpPipe;
+	VkPipeline            gbufferProcessDownSinglePassPipe;
+	VkPipeline            gbufferProcessUpSinglePassPipe;
+
+	// Workgroups of the single pass down which have finished. Reset by the last one.
+	VkDeviceMemory gbufferProcessCounterMemory;
+	VkBuffer       gbufferProcessCounterBuffer;
 
 #if defined(MOXAIC_NODE)
 
@@ -325,7 +369,7 @@ MidResult RequestExternalNodeHandle(MxcNodeShared* pNodeShared, node_h* pNode_h)
 void ReleaseNodeHandle(node_h hNode);
 
 void mxcRequestNodeThread(void* (*runFunc)(void*), node_h* pNodeHandle);
-void mxcNodeGBufferProcessDepth(VkCommandBuffer gfxCmd, ProcessState* pProcessState, MxcNodeSwap* pDepthSwap, MxcNodeGBuffer* pGBuffer, ivec2 nodeSwapExtent);
+void mxcNodeGBufferProcessDepth(VkCommandBuffer cmd, bool singlePass, ProcessState* pProcessState, MxcNodeSwap* pDepthSwap, MxcNodeGBuffer* pGBuffer, ivec2 rectOffset, ivec2 rectExtent);
 void mxcRegisterActiveNode(node_h hNode);
 
 /*
@@ -340,7 +384,10 @@ void mxcShutdownInterprocessNode();
  * Process IPC Funcs
  */
 typedef void (*MxcIpcFuncPtr)(const node_h);
-static_assert(MXC_INTERPROCESS_TARGET_COUNT <= MID_QRING_CAPACITY, "IPC targets larger than ring buffer size.");
+static_assert(MXC_INTERPROCESS_TARGET_COUNT <= UINT8_MAX, "IPC targets larger than MxcIpcFunc size.");
+static_assert(IS_POWER_OF_2(MXC_IPC_FUNC_QUEUE_CAPACITY) && MXC_IPC_FUNC_QUEUE_CAPACITY <= MID_QRING_CAPACITY_N(16), "MXC_IPC_FUNC_QUEUE_CAPACITY does not fit ipcFuncQueue.");
+static_assert(IS_POWER_OF_2(MXC_EVENT_DATA_QUEUE_SIZE) && MXC_EVENT_DATA_QUEUE_SIZE >= sizeof(XrEventDataUnion), "MXC_EVENT_DATA_QUEUE_SIZE must fit the largest event.");
+static_assert(MXC_NODE_CAPACITY < MXC_NEW_CONNECTION_QUEUE_CAPACITY, "newConnectionQueue can't hold a connection for every node.");
 extern const MxcIpcFuncPtr MXC_IPC_FUNCS[];
 
 int mxcIpcFuncEnqueue(node_h hNode, MxcIpcFunc target);
@@ -348,9 +395,11 @@ void mxcIpcFuncDequeue(node_h hNode);
 
 static inline void mxcNodeInterprocessPoll()
 {
-	node_h hNewNode;
-	while (MID_CHANNEL_RECV(&node.newConnectionQueue, node.queuedNewConnections, &hNewNode) == MID_SUCCESS)
-		mxcRegisterActiveNode(hNewNode);
+	node_h hNewNodes[MXC_NODE_CAPACITY];
+	int    newNodeCt;
+	while ((newNodeCt = MID_CHANNEL_RECV_N(&node.newConnectionQueue, node.queuedNewConnections, hNewNodes, COUNT(hNewNodes))) > 0)
+		for (int i = 0; i < newNodeCt; ++i)
+			mxcRegisterActiveNode(hNewNodes[i]);
 
 	// We still want to poll MXC_COMPOSITOR_MODE_NONE so it can send events when not being composited.
 	for (u32 iCpstMode = MXC_COMPOSITOR_MODE_NONE; iCpstMode < MXC_COMPOSITOR_MODE_COUNT; ++iCpstMode) {
@@ -365,3 +414,18 @@ static inline void mxcNodeInterprocessPoll()
 		}
 	}
 }
+
+// Sleep up to timeoutMs while no node is composited, until the first uncomposited node sends an IPC func.
+// Others, and new connections, are picked up at the timeout.
+static inline void mxcNodeInterprocessWait(u32 timeoutMs)
+{
+	for (u32 iCpstMode = MXC_COMPOSITOR_MODE_NONE + 1; iCpstMode < MXC_COMPOSITOR_MODE_COUNT; ++iCpstMode)
+		if (atomic_load_explicit(&node.active[iCpstMode].count, memory_order_acquire) > 0)
+			return;
+
+	if (atomic_load_explicit(&node.active[MXC_COMPOSITOR_MODE_NONE].count, memory_order_acquire) == 0)
+		return;
+
+	MxcNodeShared* pNodeShrd = ARRAY_H(node.pShared, node.active[MXC_COMPOSITOR_MODE_NONE].handles[0]);
+	MID_CHANNEL_WAIT(&pNodeShrd->ipcFuncQueue, timeoutMs);
+}
@@ -13,9 +13,8 @@
  */
 void mxcTestNodeRun(node_h hNode, MxcNodeThread* pNode)
 {
-	LOG("Running Thread Node %d\n", hNode);
+	LOG("Running Thread Node %d\n", HANDLE_INDEX(hNode));
 
-	u16 iNode = HANDLE_INDEX(hNode);
 	MxcNodeContext* pNodeCtx  = BLOCK_PTR_H(node.context, hNode);
 	MxcNodeShared*  pNodeShrd = ARRAY_H(node.pShared, hNode);
 
@@ -92,7 +91,7 @@ void mxcTestNodeRun(node_h hNode, MxcNodeThread* pNode)
 			.mipCount     = 1,
 		};
 		// I think I want this to be a thread_node and not go through openxr constructs at all
-		xrCreateSwapchainImages(iNode, iColorSwap, &colorInfo);
+		xrCreateSwapchainImages(hNode, iColorSwap, &colorInfo);
 		pNodeShrd->viewSwaps[XR_VIEW_ID_CENTER_MONO].iColorSwap = iColorSwap;
 
 		const u8 iDepthSwap = 1;
@@ -110,7 +109,7 @@ void mxcTestNodeRun(node_h hNode, MxcNodeThread* pNode)
 			.arraySize    = 1,
 			.mipCount     = 1,
 		};
-		xrCreateSwapchainImages(iNode, iDepthSwap, &depthInfo);
+		xrCreateSwapchainImages(hNode, iDepthSwap, &depthInfo);
 		pNodeShrd->viewSwaps[XR_VIEW_ID_CENTER_MONO].iDepthSwap = iDepthSwap;
 
 		ASSERT(pNodeShrd->nodeSwapStates[iColorSwap] == XR_SWAP_STATE_READY, "Color swap not created!");
@@ -183,6 +182,7 @@ NodeLoop:
 	int iSwapImg = nodeTimelineValue % VK_SWAP_COUNT;
 	pNodeShrd->viewSwaps[XR_VIEW_ID_CENTER_MONO].iColorImg = iSwapImg;
 	pNodeShrd->viewSwaps[XR_VIEW_ID_CENTER_MONO].iDepthImg = iSwapImg;
+	pNodeShrd->viewSwaps[XR_VIEW_ID_CENTER_MONO].imageRect = (XrRect2Di){.extent = {DEFAULT_WIDTH, DEFAULT_HEIGHT}};
 
 	/* Acquire Swap Barrier */
 	CMD_IMAGE_BARRIERS2(gfxCmd, {
@@ -274,7 +274,9 @@ NodeLoop:
 			.image = swaps[iSwapImg].depthImage,
 			VK_IMAGE_BARRIER_SRC_GENERAL_TRANSFER_WRITE,
 			VK_IMAGE_BARRIER_DST_COMPUTE_RELEASE,
-			VK_IMAGE_BARRIER_QUEUE_FAMILY_IGNORED,
+			// Compositor processes depth on the dedicated compute queue
+			.srcQueueFamilyIndex = vk.context.queueFamilies[VK_QUEUE_FAMILY_TYPE_MAIN_GRAPHICS].index,
+			.dstQueueFamilyIndex = vk.context.queueFamilies[VK_QUEUE_FAMILY_TYPE_DEDICATED_COMPUTE].index,
 			VK_IMAGE_BARRIER_COLOR_SUBRESOURCE_RANGE,
 		},
 	});
@@ -309,7 +311,7 @@ NodeLoop:
  */
 static void Create(node_h hNode, MxcNodeThread* pNode)
 {
-	LOG("Creating Thread Node %d\n", hNode);
+	LOG("Creating Thread Node %d\n", HANDLE_INDEX(hNode));
 
 	// Pools
 	// This is way too many descriptors... optimize this
@@ -376,12 +378,11 @@ static void Create(node_h hNode, MxcNodeThread* pNode)
 	vkCreateDedicatedTexture(&depthCreateInfo, &pNode->depthFramebufferTexture);
 	VK_SET_DEBUG(pNode->depthFramebufferTexture.image);
 	VK_SET_DEBUG(pNode->depthFramebufferTexture.view);
-	VK_SET_DEBUG(pNode->depthFramebufferTexture.memory);
 }
 
 static void Bind(node_h hNode, MxcNodeThread* pNode)
 {
-	LOG("Binding Thread Node %d\n", hNode);
+	LOG("Binding Thread Node %d\n", HANDLE_INDEX(hNode));
 
 	vkBindSharedBuffer(&pNode->globalBuffer);
 	VK_UPDATE_DESCRIPTOR_SETS(VK_BIND_WRITE_GLOBAL_BUFFER(pNode->globalSet, pNode->globalBuffer.buffer));
@@ -390,8 +391,8 @@ static void Bind(node_h hNode, MxcNodeThread* pNode)
 
 void* mxcRunNodeThread(void* nodeHandle)
 {
-	node_h hNode = (node_h)(u64)nodeHandle;
-	LOG("Initializing Thread Node: %d\n", hNode);
+	node_h hNode = HANDLE32((u64)nodeHandle);
+	LOG("Initializing Thread Node: %d\n", HANDLE_INDEX(hNode));
 
 	MxcNodeThread* pTestNode;
 	MALLOC_SCOPE_ZEROED(pTestNode) {;
@@ -400,10 +401,13 @@ void* mxcRunNodeThread(void* nodeHandle)
 		vkEndAllocationRequests();
 
 		Bind(hNode, pTestNode);
+		// Meshes staged by Create and Bind go to the transfer queue as one batch
+		vkWaitStagingUpload(vkFlushStagingUploads());
 
 		mxcTestNodeRun(hNode, pTestNode);
 	}
 
+	vkDestroyThreadContext();
 	return NULL;
 }
 
@@ -2,6 +2,9 @@
 
 #include "mid_vulkan.h"
 
+// Mirrored in gbuffer_process_binding.glsl
+#define GBUFFER_PROCESS_MAX_MIP_COUNT 12
+
 typedef struct ProcessState{
 	float depthNearZ;
 	float depthFarZ;
@@ -9,10 +12,20 @@ typedef struct ProcessState{
 	float cameraFarZ;
 }ProcessState;
 
+// Mirrored by Push in gbuffer_process_binding.glsl
+typedef struct GBufferProcessPush {
+	ProcessState state;
+	// Texel rect of the level being written. Single pass shaders get mip 0 and derive each level.
+	ivec2        rectOffset;
+	ivec2        rectExtent;
+} GBufferProcessPush;
+
 enum {
 	SET_BIND_INDEX_GBUFFER_PROCESS_SRC_DEPTH,
 	SET_BIND_INDEX_GBUFFER_PROCESS_SRC_GBUFFER,
 	SET_BIND_INDEX_GBUFFER_PROCESS_DST_GBUFFER,
+	SET_BIND_INDEX_GBUFFER_PROCESS_DST_GBUFFER_MIPS,
+	SET_BIND_INDEX_GBUFFER_PROCESS_COUNTER,
 	SET_BIND_INDEX_GBUFFER_PROCESS_COUNT
 };
 
@@ -52,6 +65,28 @@ enum {
 		},                                                        \
 	}
 
+// GBUFFER_PROCESS_MAX_MIP_COUNT image infos
+#define BIND_WRITE_GBUFFER_PROCESS_DST_GBUFFER_MIPS(_pImageInfos)      \
+	(VkWriteDescriptorSet) {                                           \
+		VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,                        \
+		.dstBinding = SET_BIND_INDEX_GBUFFER_PROCESS_DST_GBUFFER_MIPS, \
+		.descriptorCount = GBUFFER_PROCESS_MAX_MIP_COUNT,              \
+		.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,            \
+		.pImageInfo = _pImageInfos,                                    \
+	}
+
+#define BIND_WRITE_GBUFFER_PROCESS_COUNTER(_buffer)             \
+	(VkWriteDescriptorSet) {                                    \
+		VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,                 \
+		.dstBinding = SET_BIND_INDEX_GBUFFER_PROCESS_COUNTER,   \
+		.descriptorCount = 1,                                   \
+		.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,    \
+		.pBufferInfo = &(VkDescriptorBufferInfo){               \
+			.buffer = _buffer,                                  \
+			.range = VK_WHOLE_SIZE,                             \
+		},                                                      \
+	}
+
 static void CreateGBufferProcessSetLayout(VkDescriptorSetLayout* pLayout)
 {
 	VK_CHECK(vkCreateDescriptorSetLayout(vk.context.device, &(VkDescriptorSetLayoutCreateInfo){
@@ -79,6 +114,18 @@ static void CreateGBufferProcessSetLayout(VkDescriptorSetLayout* pLayout)
 				.descriptorCount = 1,
 				.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
 			},
+			[SET_BIND_INDEX_GBUFFER_PROCESS_DST_GBUFFER_MIPS] = {
+				.binding = SET_BIND_INDEX_GBUFFER_PROCESS_DST_GBUFFER_MIPS,
+				.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+				.descriptorCount = GBUFFER_PROCESS_MAX_MIP_COUNT,
+				.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+			},
+			[SET_BIND_INDEX_GBUFFER_PROCESS_COUNTER] = {
+				.binding = SET_BIND_INDEX_GBUFFER_PROCESS_COUNTER,
+				.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				.descriptorCount = 1,
+				.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+			},
 		},
 	}, VK_ALLOC, pLayout));
 }
@@ -99,7 +146,7 @@ static void CreateGBufferProcessPipeLayout(VkDescriptorSetLayout layout, VkPipel
 		.pushConstantRangeCount = 1,
 		.pPushConstantRanges = &(VkPushConstantRange){
 			.offset = 0,
-			.size = sizeof(ProcessState),
+			.size = sizeof(GBufferProcessPush),
 			.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
 		},
 	}, VK_ALLOC, pPipeLayout));
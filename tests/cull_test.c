@@ -0,0 +1,610 @@
+/*
+ * Cull Test
+ *
+ * Runs compositor_node_cull.comp headless over synthetic node layouts and checks the visible nodes
+ * and indirect counts it writes for each compositor mode. Any device with a compute queue works,
+ * a CPU device such as lavapipe is picked when present so it runs without a GPU.
+ * Takes the compiled shader path as the only argument. Exits with CULL_TEST_SKIP when there is no device.
+ */
+#include <stdlib.h>
+#include <vulkan/vulkan.h>
+
+#define MID_COMMON_IMPLEMENTATION
+#include "mid_common.h"
+#include "mid_math.h"
+
+#ifndef _WIN32
+// ASSERT calls the mingw assert hook
+void _assert(const char* message, const char* file, unsigned line)
+{
+	fprintf(stderr, "%s:%u %s\n", file, line, message);
+	abort();
+}
+#endif
+
+// ctest SKIP_RETURN_CODE
+#define CULL_TEST_SKIP 77
+
+#define VK_CHECK(_command)                 \
+	({                                     \
+		VkResult _result = _command;       \
+		CHECK(_result, #_command " failed"); \
+	})
+
+#define TEST_CHECK(_condition, _format, ...)                               \
+	if (UNLIKELY(!(_condition))) {                                         \
+		LOG_ERROR("Failed: " #_condition " " _format "\n", ##__VA_ARGS__); \
+		return false;                                                      \
+	}
+
+////
+//// Shader Layouts
+////
+// Must match compute_compositor_binding.glsl and compositor_node_cull.comp
+#define NODE_CAPACITY         64
+#define COMPOSITOR_MODE_COUNT 5
+#define INDIRECT_COUNT        19
+
+enum {
+	MODE_NONE,
+	MODE_QUAD,
+	MODE_TESS,
+	MODE_TASK_MESH,
+	MODE_COMPUTE,
+};
+
+static const u32 INDIRECT_COUNT_OFFSETS[COMPOSITOR_MODE_COUNT] = {
+	[MODE_NONE]      = 0,
+	[MODE_QUAD]      = 1,
+	[MODE_TESS]      = 6,
+	[MODE_TASK_MESH] = 10,
+	[MODE_COMPUTE]   = 15,
+};
+
+// GlobalUBO in global_binding.glsl
+typedef struct CullGlobalState {
+	mat4 view;
+	mat4 proj;
+	mat4 viewProj;
+	mat4 invView;
+	mat4 invProj;
+	mat4 invViewProj;
+	i32  screenSize[2];
+} CullGlobalState;
+
+// NodeState in binding_node.glsl, only model and compositorRadius are read by the cull
+typedef struct CullNodeState {
+	mat4 model;
+	mat4 globalState[6];
+	i32  framebufferSize[2];
+	f32  clipUVs[8];
+	f32  compositorRadius;
+} CullNodeState;
+static_assert(offsetof(CullNodeState, compositorRadius) == 488, "compositorRadius must be at its std140 offset in binding_node.glsl");
+// Max minUniformBufferOffsetAlignment a device can have so each node can be bound at its stride
+static_assert(sizeof(CullNodeState) % 256 == 0, "CullNodeState must be bindable at any uniform buffer alignment");
+
+// NodeCull in compute_compositor_binding.glsl
+typedef struct CullState {
+	u32 indirect[INDIRECT_COUNT];
+	u32 activeCounts[COMPOSITOR_MODE_COUNT];
+	u32 damageTiles[4];
+	u32 activeNodeIndices[COMPOSITOR_MODE_COUNT * NODE_CAPACITY];
+} CullState;
+static_assert(offsetof(CullState, damageTiles) == sizeof(u32) * 24, "damageTiles must be at its std430 uvec4 offset");
+
+typedef struct CullNodeIndices {
+	u32 nodeIndices[COMPOSITOR_MODE_COUNT * NODE_CAPACITY];
+} CullNodeIndices;
+
+////
+//// Layouts
+////
+#define CAMERA_Y_FOV  RAD_FROM_DEG(90.0f)
+#define CAMERA_Z_NEAR 0.1f
+#define CAMERA_Z_FAR  100.0f
+
+typedef struct CullNode {
+	const char* name;
+	vec3        pos;
+	f32         radius;
+	u32         mode;
+	bool        visible;
+} CullNode;
+
+// Camera sits at the origin looking down -Z with a square 90 degree frustum, so at depth d it spans -d..d
+static const CullNode handLayout[] = {
+	{"InFront",       {{0, 0, -5}},     0.5f,  MODE_QUAD,      true},
+	{"Behind",        {{0, 0, 5}},      0.5f,  MODE_QUAD,      false},
+	{"NearerThanNear",{{0, 0, -0.05f}}, 0.01f, MODE_QUAD,      false},
+	{"StraddleFar",   {{0, 0, -100}},   0.5f,  MODE_QUAD,      true},
+	{"Left",          {{-20, 0, -5}},   0.5f,  MODE_TESS,      false},
+	{"StraddleLeft",  {{-5.2f, 0, -5}}, 0.5f,  MODE_TESS,      true},
+	{"Above",         {{0, 20, -5}},    0.5f,  MODE_TASK_MESH, false},
+	{"StraddleTop",   {{0, 5.2f, -5}},  0.5f,  MODE_TASK_MESH, true},
+	{"BeyondFar",     {{0, 0, -200}},   0.5f,  MODE_COMPUTE,   false},
+	{"AroundCamera",  {{0, 0, 0}},      0.5f,  MODE_COMPUTE,   true},
+	{"LargeLeft",     {{-20, 0, -5}},   30.0f, MODE_COMPUTE,   true},
+};
+
+#define RING_RADIUS      5.0f
+#define RING_NODE_RADIUS 0.3f
+
+// Every node slot filled by one mode in a ring around the camera so only the ones ahead survive
+static void RingLayout(CullNode* pNodes)
+{
+	for (int i = 0; i < NODE_CAPACITY; ++i) {
+		f32 angle = (2.0f * PI * i) / NODE_CAPACITY;
+		pNodes[i] = (CullNode){
+			.name   = "Ring",
+			.pos    = VEC3(RING_RADIUS * sinf(angle), 0, -RING_RADIUS * cosf(angle)),
+			.radius = RING_NODE_RADIUS,
+			.mode   = MODE_COMPUTE,
+		};
+	}
+}
+
+// Same test as CubeOutsideFrustum in compositor_node_cull.comp
+static bool CubeOutsideFrustum(mat4 modelViewProj, f32 radius)
+{
+	u32 outsideMask = 0x3F;
+	for (u32 i = 0; i < 8; ++i) {
+		vec4 corner = VEC4((i & 1) ? radius : -radius, (i & 2) ? radius : -radius, (i & 4) ? radius : -radius, 1);
+		vec4 clip = vec4MulMat4(modelViewProj, corner);
+		u32  cornerMask = 0;
+		cornerMask |= clip.x < -clip.w ? 0x01 : 0;
+		cornerMask |= clip.x > clip.w ? 0x02 : 0;
+		cornerMask |= clip.y < -clip.w ? 0x04 : 0;
+		cornerMask |= clip.y > clip.w ? 0x08 : 0;
+		cornerMask |= clip.z < 0 ? 0x10 : 0;
+		cornerMask |= clip.z > clip.w ? 0x20 : 0;
+		outsideMask &= cornerMask;
+	}
+	return outsideMask != 0;
+}
+
+////
+//// Vulkan
+////
+typedef struct CullBuffer {
+	VkBuffer       buffer;
+	VkDeviceMemory memory;
+	void*          pMapped;
+	VkDeviceSize   size;
+} CullBuffer;
+
+static struct {
+	VkInstance       instance;
+	VkPhysicalDevice physicalDevice;
+	VkDevice         device;
+	VkQueue          queue;
+	u32              queueFamilyIndex;
+
+	VkDescriptorSetLayout globalSetLayout;
+	VkDescriptorSetLayout nodeSetLayout;
+	VkPipelineLayout      pipeLayout;
+	VkPipeline            pipe;
+	VkDescriptorPool      descriptorPool;
+	VkDescriptorSet       globalSet;
+	VkDescriptorSet       nodeSet;
+	VkCommandPool         commandPool;
+	VkCommandBuffer       cmd;
+
+	CullBuffer globalBuffer;
+	CullBuffer nodeStateBuffer;
+	CullBuffer nodeIndicesBuffer;
+	CullBuffer cullBuffer;
+} cull;
+
+// Returns false when there is no usable device so the test can be skipped
+static bool CreateContext()
+{
+	VkResult result = vkCreateInstance(&(VkInstanceCreateInfo){
+		VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
+		.pApplicationInfo = &(VkApplicationInfo){
+			VK_STRUCTURE_TYPE_APPLICATION_INFO,
+			.pApplicationName = "cull_test",
+			.apiVersion       = VK_API_VERSION_1_2,
+		},
+	}, NULL, &cull.instance);
+	if (result != VK_SUCCESS) {
+		LOG("No Vulkan instance %d\n", result);
+		return false;
+	}
+
+	u32 deviceCount = 0;
+	vkEnumeratePhysicalDevices(cull.instance, &deviceCount, NULL);
+	VkPhysicalDevice devices[deviceCount + 1];
+	vkEnumeratePhysicalDevices(cull.instance, &deviceCount, devices);
+	if (deviceCount == 0) {
+		LOG("No Vulkan device\n");
+		return false;
+	}
+
+	cull.physicalDevice = devices[0];
+	for (u32 i = 0; i < deviceCount; ++i) {
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(devices[i], &properties);
+		if (properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_CPU) {
+			cull.physicalDevice = devices[i];
+			break;
+		}
+	}
+
+	// Driver and header versions so a result says which ICD and SDK it came from
+	VkPhysicalDeviceDriverProperties driverProperties = {.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DRIVER_PROPERTIES};
+	VkPhysicalDeviceProperties2      properties = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2, .pNext = &driverProperties};
+	vkGetPhysicalDeviceProperties2(cull.physicalDevice, &properties);
+	LOG("Device %s driver %s %s headers 1.%u.%u\n", properties.properties.deviceName, driverProperties.driverName,
+	    driverProperties.driverInfo, VK_API_VERSION_MINOR(VK_HEADER_VERSION_COMPLETE), VK_HEADER_VERSION);
+
+	VkPhysicalDeviceDescriptorIndexingFeatures indexingFeatures = {.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES};
+	vkGetPhysicalDeviceFeatures2(cull.physicalDevice, &(VkPhysicalDeviceFeatures2){
+		VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+		.pNext = &indexingFeatures,
+	});
+	if (!indexingFeatures.shaderUniformBufferArrayNonUniformIndexing || !indexingFeatures.runtimeDescriptorArray) {
+		LOG("Device lacks non uniform uniform buffer indexing\n");
+		return false;
+	}
+
+	u32 queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(cull.physicalDevice, &queueFamilyCount, NULL);
+	VkQueueFamilyProperties queueFamilies[queueFamilyCount + 1];
+	vkGetPhysicalDeviceQueueFamilyProperties(cull.physicalDevice, &queueFamilyCount, queueFamilies);
+	cull.queueFamilyIndex = UINT32_MAX;
+	for (u32 i = 0; i < queueFamilyCount && cull.queueFamilyIndex == UINT32_MAX; ++i)
+		if (queueFamilies[i].queueFlags & VK_QUEUE_COMPUTE_BIT) cull.queueFamilyIndex = i;
+	if (cull.queueFamilyIndex == UINT32_MAX) {
+		LOG("Device has no compute queue\n");
+		return false;
+	}
+
+	VK_CHECK(vkCreateDevice(cull.physicalDevice, &(VkDeviceCreateInfo){
+		VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+		.pNext = &(VkPhysicalDeviceDescriptorIndexingFeatures){
+			VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES,
+			.shaderUniformBufferArrayNonUniformIndexing = VK_TRUE,
+			.runtimeDescriptorArray                     = VK_TRUE,
+		},
+		.queueCreateInfoCount = 1,
+		.pQueueCreateInfos = &(VkDeviceQueueCreateInfo){
+			VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+			.queueFamilyIndex = cull.queueFamilyIndex,
+			.queueCount       = 1,
+			.pQueuePriorities = (f32[]){1.0f},
+		},
+	}, NULL, &cull.device));
+	vkGetDeviceQueue(cull.device, cull.queueFamilyIndex, 0, &cull.queue);
+	return true;
+}
+
+static void CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, CullBuffer* pBuffer)
+{
+	pBuffer->size = size;
+	VK_CHECK(vkCreateBuffer(cull.device, &(VkBufferCreateInfo){
+		VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+		.size  = size,
+		.usage = usage,
+	}, NULL, &pBuffer->buffer));
+
+	VkMemoryRequirements memReqs;
+	vkGetBufferMemoryRequirements(cull.device, pBuffer->buffer, &memReqs);
+	VkPhysicalDeviceMemoryProperties memProps;
+	vkGetPhysicalDeviceMemoryProperties(cull.physicalDevice, &memProps);
+	VkMemoryPropertyFlags propFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	u32 memTypeIndex = UINT32_MAX;
+	for (u32 i = 0; i < memProps.memoryTypeCount && memTypeIndex == UINT32_MAX; ++i)
+		if ((memReqs.memoryTypeBits & (1u << i)) && (memProps.memoryTypes[i].propertyFlags & propFlags) == propFlags) memTypeIndex = i;
+	REQUIRE(memTypeIndex != UINT32_MAX, "No host visible coherent memory!");
+
+	VK_CHECK(vkAllocateMemory(cull.device, &(VkMemoryAllocateInfo){
+		VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+		.allocationSize  = memReqs.size,
+		.memoryTypeIndex = memTypeIndex,
+	}, NULL, &pBuffer->memory));
+	VK_CHECK(vkBindBufferMemory(cull.device, pBuffer->buffer, pBuffer->memory, 0));
+	VK_CHECK(vkMapMemory(cull.device, pBuffer->memory, 0, VK_WHOLE_SIZE, 0, &pBuffer->pMapped));
+	memset(pBuffer->pMapped, 0, size);
+}
+
+static void DestroyBuffer(CullBuffer* pBuffer)
+{
+	vkUnmapMemory(cull.device, pBuffer->memory);
+	vkDestroyBuffer(cull.device, pBuffer->buffer, NULL);
+	vkFreeMemory(cull.device, pBuffer->memory, NULL);
+}
+
+static void* ReadFile(const char* path, size_t* pSize)
+{
+	FILE* pFile = fopen(path, "rb");
+	REQUIRE(pFile != NULL, "Can't open shader!");
+	fseek(pFile, 0, SEEK_END);
+	*pSize = ftell(pFile);
+	fseek(pFile, 0, SEEK_SET);
+	void* pCode = malloc(*pSize);
+	REQUIRE(fread(pCode, 1, *pSize, pFile) == *pSize, "Can't read shader!");
+	fclose(pFile);
+	return pCode;
+}
+
+// Only the bindings the cull reads. Same set and binding numbers as the compositor's global and node sets.
+static void CreatePipe(const char* shaderPath)
+{
+	VK_CHECK(vkCreateDescriptorSetLayout(cull.device, &(VkDescriptorSetLayoutCreateInfo){
+		VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+		.bindingCount = 1,
+		.pBindings = &(VkDescriptorSetLayoutBinding){
+			.binding         = 0,
+			.descriptorType  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+			.descriptorCount = 1,
+			.stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT,
+		},
+	}, NULL, &cull.globalSetLayout));
+
+	VK_CHECK(vkCreateDescriptorSetLayout(cull.device, &(VkDescriptorSetLayoutCreateInfo){
+		VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+		.bindingCount = 3,
+		.pBindings = (VkDescriptorSetLayoutBinding[]){
+			{
+				.binding         = 0, // NodeState
+				.descriptorType  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+				.descriptorCount = NODE_CAPACITY,
+				.stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT,
+			},
+			{
+				.binding         = 3, // NodeIndices
+				.descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				.descriptorCount = 1,
+				.stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT,
+			},
+			{
+				.binding         = 4, // NodeCull
+				.descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				.descriptorCount = 1,
+				.stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT,
+			},
+		},
+	}, NULL, &cull.nodeSetLayout));
+
+	VK_CHECK(vkCreatePipelineLayout(cull.device, &(VkPipelineLayoutCreateInfo){
+		VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+		.setLayoutCount = 2,
+		.pSetLayouts    = (VkDescriptorSetLayout[]){cull.globalSetLayout, cull.nodeSetLayout},
+		.pushConstantRangeCount = 1,
+		.pPushConstantRanges = &(VkPushConstantRange){
+			.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+			.size       = sizeof(u32),
+		},
+	}, NULL, &cull.pipeLayout));
+
+	size_t codeSize;
+	void*  pCode = ReadFile(shaderPath, &codeSize);
+	VkShaderModule shader;
+	VK_CHECK(vkCreateShaderModule(cull.device, &(VkShaderModuleCreateInfo){
+		VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+		.codeSize = codeSize,
+		.pCode    = pCode,
+	}, NULL, &shader));
+	free(pCode);
+
+	VK_CHECK(vkCreateComputePipelines(cull.device, VK_NULL_HANDLE, 1, &(VkComputePipelineCreateInfo){
+		VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+		.stage = {
+			VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+			.stage  = VK_SHADER_STAGE_COMPUTE_BIT,
+			.module = shader,
+			.pName  = "main",
+		},
+		.layout = cull.pipeLayout,
+	}, NULL, &cull.pipe));
+	vkDestroyShaderModule(cull.device, shader, NULL);
+}
+
+static void CreateSets()
+{
+	CreateBuffer(sizeof(CullGlobalState), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, &cull.globalBuffer);
+	CreateBuffer(sizeof(CullNodeState) * NODE_CAPACITY, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, &cull.nodeStateBuffer);
+	CreateBuffer(sizeof(CullNodeIndices), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, &cull.nodeIndicesBuffer);
+	CreateBuffer(sizeof(CullState), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, &cull.cullBuffer);
+
+	VK_CHECK(vkCreateDescriptorPool(cull.device, &(VkDescriptorPoolCreateInfo){
+		VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+		.maxSets       = 2,
+		.poolSizeCount = 2,
+		.pPoolSizes = (VkDescriptorPoolSize[]){
+			{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1 + NODE_CAPACITY},
+			{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2},
+		},
+	}, NULL, &cull.descriptorPool));
+	VkDescriptorSet sets[2];
+	VK_CHECK(vkAllocateDescriptorSets(cull.device, &(VkDescriptorSetAllocateInfo){
+		VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+		.descriptorPool     = cull.descriptorPool,
+		.descriptorSetCount = 2,
+		.pSetLayouts        = (VkDescriptorSetLayout[]){cull.globalSetLayout, cull.nodeSetLayout},
+	}, sets));
+	cull.globalSet = sets[0];
+	cull.nodeSet = sets[1];
+
+	VkDescriptorBufferInfo nodeStateInfos[NODE_CAPACITY];
+	for (int i = 0; i < NODE_CAPACITY; ++i)
+		nodeStateInfos[i] = (VkDescriptorBufferInfo){cull.nodeStateBuffer.buffer, i * sizeof(CullNodeState), sizeof(CullNodeState)};
+
+	vkUpdateDescriptorSets(cull.device, 4, (VkWriteDescriptorSet[]){
+		{
+			VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			.dstSet          = cull.globalSet,
+			.dstBinding      = 0,
+			.descriptorCount = 1,
+			.descriptorType  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+			.pBufferInfo     = &(VkDescriptorBufferInfo){cull.globalBuffer.buffer, 0, VK_WHOLE_SIZE},
+		},
+		{
+			VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			.dstSet          = cull.nodeSet,
+			.dstBinding      = 0,
+			.descriptorCount = NODE_CAPACITY,
+			.descriptorType  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+			.pBufferInfo     = nodeStateInfos,
+		},
+		{
+			VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			.dstSet          = cull.nodeSet,
+			.dstBinding      = 3,
+			.descriptorCount = 1,
+			.descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.pBufferInfo     = &(VkDescriptorBufferInfo){cull.nodeIndicesBuffer.buffer, 0, VK_WHOLE_SIZE},
+		},
+		{
+			VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			.dstSet          = cull.nodeSet,
+			.dstBinding      = 4,
+			.descriptorCount = 1,
+			.descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.pBufferInfo     = &(VkDescriptorBufferInfo){cull.cullBuffer.buffer, 0, VK_WHOLE_SIZE},
+		},
+	}, 0, NULL);
+
+	VK_CHECK(vkCreateCommandPool(cull.device, &(VkCommandPoolCreateInfo){
+		VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+		.flags            = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+		.queueFamilyIndex = cull.queueFamilyIndex,
+	}, NULL, &cull.commandPool));
+	VK_CHECK(vkAllocateCommandBuffers(cull.device, &(VkCommandBufferAllocateInfo){
+		VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+		.commandPool        = cull.commandPool,
+		.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+		.commandBufferCount = 1,
+	}, &cull.cmd));
+}
+
+static void DestroyContext()
+{
+	vkDestroyCommandPool(cull.device, cull.commandPool, NULL);
+	vkDestroyDescriptorPool(cull.device, cull.descriptorPool, NULL);
+	DestroyBuffer(&cull.globalBuffer);
+	DestroyBuffer(&cull.nodeStateBuffer);
+	DestroyBuffer(&cull.nodeIndicesBuffer);
+	DestroyBuffer(&cull.cullBuffer);
+	vkDestroyPipeline(cull.device, cull.pipe, NULL);
+	vkDestroyPipelineLayout(cull.device, cull.pipeLayout, NULL);
+	vkDestroyDescriptorSetLayout(cull.device, cull.nodeSetLayout, NULL);
+	vkDestroyDescriptorSetLayout(cull.device, cull.globalSetLayout, NULL);
+	vkDestroyDevice(cull.device, NULL);
+	vkDestroyInstance(cull.instance, NULL);
+}
+
+////
+//// Test
+////
+// Node slots are spread over the set so a shader reading the wrong slot fails the test
+#define NODE_INDEX(_i) (((_i) * 37 + 5) % NODE_CAPACITY)
+static_assert(NODE_CAPACITY % 37 != 0, "NODE_INDEX must visit every slot once");
+
+static int CompareU32(const void* pA, const void* pB)
+{
+	u32 a = *(const u32*)pA;
+	u32 b = *(const u32*)pB;
+	return (a > b) - (a < b);
+}
+
+// Hand layouts also check their labels against the reference test so a wrong label can't hide a wrong cull
+static bool RunLayout(const char* layoutName, int nodeCount, const CullNode* pNodes, bool handLabelled)
+{
+	CullGlobalState* pGlobal = cull.globalBuffer.pMapped;
+	CullNodeState*   pNodeStates = cull.nodeStateBuffer.pMapped;
+	CullState*       pCull = cull.cullBuffer.pMapped;
+	CullNodeIndices* pNodeIndices = cull.nodeIndicesBuffer.pMapped;
+
+	// Identity view so the layouts are in view space
+	pGlobal->view = MAT4_IDENT;
+	pGlobal->proj = Mat4PerspectiveVulkanReverseZ(CAMERA_Y_FOV, 1.0f, CAMERA_Z_NEAR, CAMERA_Z_FAR);
+	pGlobal->viewProj = mat4Mul(pGlobal->proj, pGlobal->view);
+
+	memset(pCull, 0, sizeof(CullState));
+	memset(pNodeIndices, 0xFF, sizeof(CullNodeIndices));
+	memset(pNodeStates, 0, sizeof(CullNodeState) * NODE_CAPACITY);
+
+	u32 expectedCounts[COMPOSITOR_MODE_COUNT] = {};
+	u32 expectedIndices[COMPOSITOR_MODE_COUNT][NODE_CAPACITY];
+	for (int i = 0; i < nodeCount; ++i) {
+		const CullNode* pNode = &pNodes[i];
+		u32             nodeIndex = NODE_INDEX(i);
+		pNodeStates[nodeIndex].model = Mat4Translation(pNode->pos);
+		pNodeStates[nodeIndex].compositorRadius = pNode->radius;
+		pCull->activeNodeIndices[pNode->mode * NODE_CAPACITY + pCull->activeCounts[pNode->mode]++] = nodeIndex;
+
+		bool visible = !CubeOutsideFrustum(mat4Mul(pGlobal->viewProj, pNodeStates[nodeIndex].model), pNode->radius);
+		TEST_CHECK(!handLabelled || pNode->visible == visible, "%s %s labelled %s but the reference test says %s",
+		           layoutName, pNode->name, pNode->visible ? "visible" : "culled", visible ? "visible" : "culled");
+		if (visible) expectedIndices[pNode->mode][expectedCounts[pNode->mode]++] = nodeIndex;
+	}
+
+	VK_CHECK(vkBeginCommandBuffer(cull.cmd, &(VkCommandBufferBeginInfo){
+		VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+	}));
+	vkCmdBindPipeline(cull.cmd, VK_PIPELINE_BIND_POINT_COMPUTE, cull.pipe);
+	vkCmdBindDescriptorSets(cull.cmd, VK_PIPELINE_BIND_POINT_COMPUTE, cull.pipeLayout, 0, 2, (VkDescriptorSet[]){cull.globalSet, cull.nodeSet}, 0, NULL);
+	// Same dispatch as the compositor, one workgroup per mode
+	vkCmdDispatch(cull.cmd, 1, COMPOSITOR_MODE_COUNT, 1);
+	vkCmdPipelineBarrier(cull.cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &(VkMemoryBarrier){
+		VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+		.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+		.dstAccessMask = VK_ACCESS_HOST_READ_BIT,
+	}, 0, NULL, 0, NULL);
+	VK_CHECK(vkEndCommandBuffer(cull.cmd));
+	VK_CHECK(vkQueueSubmit(cull.queue, 1, &(VkSubmitInfo){
+		VK_STRUCTURE_TYPE_SUBMIT_INFO,
+		.commandBufferCount = 1,
+		.pCommandBuffers    = &cull.cmd,
+	}, VK_NULL_HANDLE));
+	VK_CHECK(vkQueueWaitIdle(cull.queue));
+
+	for (u32 iMode = MODE_QUAD; iMode < COMPOSITOR_MODE_COUNT; ++iMode) {
+		if (pCull->activeCounts[iMode] == 0)
+			continue;
+
+		u32 count = pCull->indirect[INDIRECT_COUNT_OFFSETS[iMode]];
+		TEST_CHECK(count == expectedCounts[iMode], "%s mode %u %u visible expected %u", layoutName, iMode, count, expectedCounts[iMode]);
+
+		// Appended in whatever order the atomics land
+		u32* pVisible = pNodeIndices->nodeIndices + iMode * NODE_CAPACITY;
+		qsort(pVisible, count, sizeof(u32), CompareU32);
+		qsort(expectedIndices[iMode], count, sizeof(u32), CompareU32);
+		for (u32 i = 0; i < count; ++i)
+			TEST_CHECK(pVisible[i] == expectedIndices[iMode][i], "%s mode %u node %u visible expected %u", layoutName, iMode, pVisible[i], expectedIndices[iMode][i]);
+		TEST_CHECK(count == NODE_CAPACITY || pVisible[count] == UINT32_MAX, "%s mode %u wrote past its visible count", layoutName, iMode);
+
+		LOG("%s mode %u %u of %u visible\n", layoutName, iMode, count, pCull->activeCounts[iMode]);
+		// A layout that culls all or nothing doesn't test the frustum
+		TEST_CHECK(handLabelled || (count > 0 && count < pCull->activeCounts[iMode]),
+		           "%s mode %u culled all or nothing", layoutName, iMode);
+	}
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2) {
+		LOG_ERROR("Usage: cull_test compositor_node_cull.comp.spv\n");
+		return EXIT_FAILURE;
+	}
+
+	if (!CreateContext()) {
+		LOG("Skipped\n");
+		return CULL_TEST_SKIP;
+	}
+	CreatePipe(argv[1]);
+	CreateSets();
+
+	bool passed = RunLayout("Hand", COUNT(handLayout), handLayout, true);
+
+	CullNode ringLayout[NODE_CAPACITY];
+	RingLayout(ringLayout);
+	passed = passed && RunLayout("Ring", NODE_CAPACITY, ringLayout, false);
+
+	DestroyContext();
+	return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,1021 @@
+/*
+ * GBuffer Test
+ *
+ * Runs the multi dispatch and single pass gbuffer depth process on the same synthetic depth and checks
+ * they agree. The down pyramids must match inside the rect to fp16 rounding, rendered texels must come out
+ * as the projected depth and holes must be filled from the depth around them. Then times both paths.
+ * Recording mirrors GBufferProcessDepthMultiDispatch and GBufferProcessDepthSinglePass in node.c with
+ * descriptor sets in place of push descriptors so it runs on devices without VK_KHR_push_descriptor.
+ * Takes the compiled shader directory as the only argument. Exits with GBUFFER_TEST_SKIP when there is no device
+ * that runs the 32x32 workgroups.
+ */
+#include <stdlib.h>
+#include <vulkan/vulkan.h>
+
+#define MID_COMMON_IMPLEMENTATION
+#include "mid_common.h"
+#include "mid_math.h"
+
+#ifndef _WIN32
+// ASSERT calls the mingw assert hook
+void _assert(const char* message, const char* file, unsigned line)
+{
+	fprintf(stderr, "%s:%u %s\n", file, line, message);
+	abort();
+}
+#endif
+
+// ctest SKIP_RETURN_CODE
+#define GBUFFER_TEST_SKIP 77
+
+#define VK_CHECK(_command)                   \
+	({                                       \
+		VkResult _result = _command;         \
+		CHECK(_result, #_command " failed"); \
+	})
+
+#define TEST_CHECK(_condition, _format, ...)                               \
+	if (UNLIKELY(!(_condition))) {                                         \
+		LOG_ERROR("Failed: " #_condition " " _format "\n", ##__VA_ARGS__); \
+		return false;                                                      \
+	}
+
+////
+//// Shader Layouts
+////
+// Must match gbuffer_process_binding.glsl and pipe_gbuffer_process.h
+#define LOCAL_SIZE     32
+#define MAX_MIP_COUNT  12
+#define GBUFFER_FORMAT VK_FORMAT_R16G16B16A16_SFLOAT
+
+typedef struct ProcessState {
+	float depthNearZ;
+	float depthFarZ;
+	float cameraNearZ;
+	float cameraFarZ;
+} ProcessState;
+
+typedef struct GBufferProcessPush {
+	ProcessState state;
+	ivec2        rectOffset;
+	ivec2        rectExtent;
+} GBufferProcessPush;
+
+enum {
+	BIND_SRC_DEPTH,
+	BIND_SRC_GBUFFER,
+	BIND_DST_GBUFFER,
+	BIND_DST_GBUFFER_MIPS,
+	BIND_COUNTER,
+	BIND_COUNT
+};
+
+// The multi dispatch up pass only projects depth into a 1280 wide gbuffer
+#define GBUFFER_WIDTH  1280
+#define GBUFFER_HEIGHT 720
+#define MIP_COUNT      11
+static_assert(1 << (MIP_COUNT - 1) <= MAX(GBUFFER_WIDTH, GBUFFER_HEIGHT) && MAX(GBUFFER_WIDTH, GBUFFER_HEIGHT) < 1 << MIP_COUNT, "MIP_COUNT must be VK_MIP_LEVEL_COUNT");
+
+// Same near and far for depth and camera so the process output is 1 - depth, reverse Z
+static const ProcessState processState = {
+	.depthNearZ  = 0.1f,
+	.depthFarZ   = 100.0f,
+	.cameraNearZ = 0.1f,
+	.cameraFarZ  = 100.0f,
+};
+
+// Written before every run so a texel a path reads without writing it first shows up out of range
+#define UNWRITTEN_DEPTH 4.0f
+
+////
+//// Layouts
+////
+typedef struct GBufferHole {
+	const char* name;
+	int         x, y, w, h;
+	int         stride; // Only every stride texel is a hole
+} GBufferHole;
+
+// All inside the offset rect. Edge touches its right and bottom.
+static const GBufferHole holes[] = {
+	{"Scatter", 200, 100, 200, 100, 7},
+	{"Small",   500, 120, 4,   4,   1},
+	{"Block",   700, 300, 48,  48,  1},
+	{"Large",   200, 380, 360, 200, 1},
+	{"Edge",    1040, 500, 56, 140, 1},
+};
+
+typedef struct GBufferLayout {
+	const char* name;
+	ivec2       rectOffset;
+	ivec2       rectExtent;
+} GBufferLayout;
+
+static const GBufferLayout layouts[] = {
+	{"Full",   {{0, 0}},   {{GBUFFER_WIDTH, GBUFFER_HEIGHT}}},
+	{"Offset", {{96, 40}}, {{1000, 600}}},
+};
+
+// A tilted plane so a filled hole has one right answer
+static float PlaneDepth(int x, int y)
+{
+	return 0.25f + 0.5f * x / GBUFFER_WIDTH + 0.2f * y / GBUFFER_HEIGHT;
+}
+
+static bool IsHole(int x, int y)
+{
+	for (u32 i = 0; i < COUNT(holes); ++i) {
+		const GBufferHole* pHole = &holes[i];
+		if (x >= pHole->x && x < pHole->x + pHole->w && y >= pHole->y && y < pHole->y + pHole->h &&
+		    (x - pHole->x) % pHole->stride == 0 && (y - pHole->y) % pHole->stride == 0)
+			return true;
+	}
+	return false;
+}
+
+static bool InRect(int x, int y, ivec2 rectMin, ivec2 rectMax)
+{
+	return x >= rectMin.x && y >= rectMin.y && x < rectMax.x && y < rectMax.y;
+}
+
+////
+//// Vulkan
+////
+typedef struct GBufferBuffer {
+	VkBuffer       buffer;
+	VkDeviceMemory memory;
+	void*          pMapped;
+	VkDeviceSize   size;
+} GBufferBuffer;
+
+typedef struct GBufferImage {
+	VkImage        image;
+	VkDeviceMemory memory;
+	VkImageView    mipViews[MIP_COUNT];
+	VkImageView    pyramidView;
+} GBufferImage;
+
+enum {
+	PATH_MULTI_DISPATCH,
+	PATH_SINGLE_PASS,
+	PATH_COUNT,
+};
+
+static const char* pathNames[PATH_COUNT] = {
+	[PATH_MULTI_DISPATCH] = "multi dispatch",
+	[PATH_SINGLE_PASS]    = "single pass",
+};
+
+static struct {
+	VkInstance       instance;
+	VkPhysicalDevice physicalDevice;
+	VkDevice         device;
+	VkQueue          queue;
+	u32              queueFamilyIndex;
+	float            timestampPeriod;
+
+	VkSampler             linearSampler;
+	VkDescriptorSetLayout setLayout;
+	VkPipelineLayout      pipeLayout;
+	VkPipeline            downPipe;
+	VkPipeline            upPipe;
+	VkPipeline            downSinglePassPipe;
+	VkPipeline            upSinglePassPipe;
+	VkDescriptorPool      descriptorPool;
+	VkCommandPool         commandPool;
+	VkCommandBuffer       cmd;
+	VkQueryPool           timeQueryPool;
+
+	VkImage        depthImage;
+	VkDeviceMemory depthMemory;
+	VkImageView    depthView;
+	GBufferImage   gbuffers[PATH_COUNT];
+
+	GBufferBuffer depthBuffer;
+	GBufferBuffer readbackBuffers[PATH_COUNT];
+	GBufferBuffer counterBuffer;
+} gbuffer;
+
+// Returns false when there is no usable device so the test can be skipped
+static bool CreateContext()
+{
+	VkResult result = vkCreateInstance(&(VkInstanceCreateInfo){
+		VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
+		.pApplicationInfo = &(VkApplicationInfo){
+			VK_STRUCTURE_TYPE_APPLICATION_INFO,
+			.pApplicationName = "gbuffer_test",
+			.apiVersion       = VK_API_VERSION_1_2,
+		},
+	}, NULL, &gbuffer.instance);
+	if (result != VK_SUCCESS) {
+		LOG("No Vulkan instance %d\n", result);
+		return false;
+	}
+
+	u32 deviceCount = 0;
+	vkEnumeratePhysicalDevices(gbuffer.instance, &deviceCount, NULL);
+	VkPhysicalDevice devices[deviceCount + 1];
+	vkEnumeratePhysicalDevices(gbuffer.instance, &deviceCount, devices);
+	if (deviceCount == 0) {
+		LOG("No Vulkan device\n");
+		return false;
+	}
+
+	// Timings are only worth comparing on the device the compositor runs on so a GPU is preferred
+	gbuffer.physicalDevice = devices[0];
+	for (u32 i = 0; i < deviceCount; ++i) {
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(devices[i], &properties);
+		if (properties.deviceType != VK_PHYSICAL_DEVICE_TYPE_CPU) {
+			gbuffer.physicalDevice = devices[i];
+			break;
+		}
+	}
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(gbuffer.physicalDevice, &properties);
+	LOG("Device %s\n", properties.deviceName);
+	gbuffer.timestampPeriod = properties.limits.timestampPeriod;
+	if (properties.limits.maxComputeWorkGroupInvocations < LOCAL_SIZE * LOCAL_SIZE) {
+		LOG("Device runs %u invocations per workgroup, the process shaders need %d\n",
+		    properties.limits.maxComputeWorkGroupInvocations, LOCAL_SIZE * LOCAL_SIZE);
+		return false;
+	}
+
+	VkPhysicalDeviceFeatures2 features = {.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2};
+	vkGetPhysicalDeviceFeatures2(gbuffer.physicalDevice, &features);
+	if (!features.features.shaderStorageImageArrayDynamicIndexing) {
+		LOG("Device lacks dynamic storage image array indexing\n");
+		return false;
+	}
+
+	u32 queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(gbuffer.physicalDevice, &queueFamilyCount, NULL);
+	VkQueueFamilyProperties queueFamilies[queueFamilyCount + 1];
+	vkGetPhysicalDeviceQueueFamilyProperties(gbuffer.physicalDevice, &queueFamilyCount, queueFamilies);
+	gbuffer.queueFamilyIndex = UINT32_MAX;
+	for (u32 i = 0; i < queueFamilyCount && gbuffer.queueFamilyIndex == UINT32_MAX; ++i)
+		if ((queueFamilies[i].queueFlags & VK_QUEUE_COMPUTE_BIT) && queueFamilies[i].timestampValidBits > 0) gbuffer.queueFamilyIndex = i;
+	if (gbuffer.queueFamilyIndex == UINT32_MAX) {
+		LOG("Device has no compute queue with timestamps\n");
+		return false;
+	}
+
+	VK_CHECK(vkCreateDevice(gbuffer.physicalDevice, &(VkDeviceCreateInfo){
+		VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+		.queueCreateInfoCount = 1,
+		.pQueueCreateInfos = &(VkDeviceQueueCreateInfo){
+			VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+			.queueFamilyIndex = gbuffer.queueFamilyIndex,
+			.queueCount       = 1,
+			.pQueuePriorities = (f32[]){1.0f},
+		},
+		.pEnabledFeatures = &(VkPhysicalDeviceFeatures){
+			.shaderStorageImageArrayDynamicIndexing = VK_TRUE,
+		},
+	}, NULL, &gbuffer.device));
+	vkGetDeviceQueue(gbuffer.device, gbuffer.queueFamilyIndex, 0, &gbuffer.queue);
+	return true;
+}
+
+static u32 FindMemoryType(u32 memoryTypeBits, VkMemoryPropertyFlags propFlags)
+{
+	VkPhysicalDeviceMemoryProperties memProps;
+	vkGetPhysicalDeviceMemoryProperties(gbuffer.physicalDevice, &memProps);
+	for (u32 i = 0; i < memProps.memoryTypeCount; ++i)
+		if ((memoryTypeBits & (1u << i)) && (memProps.memoryTypes[i].propertyFlags & propFlags) == propFlags) return i;
+	return UINT32_MAX;
+}
+
+static void CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, GBufferBuffer* pBuffer)
+{
+	pBuffer->size = size;
+	VK_CHECK(vkCreateBuffer(gbuffer.device, &(VkBufferCreateInfo){
+		VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+		.size  = size,
+		.usage = usage,
+	}, NULL, &pBuffer->buffer));
+
+	VkMemoryRequirements memReqs;
+	vkGetBufferMemoryRequirements(gbuffer.device, pBuffer->buffer, &memReqs);
+	u32 memTypeIndex = FindMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	REQUIRE(memTypeIndex != UINT32_MAX, "No host visible coherent memory!");
+
+	VK_CHECK(vkAllocateMemory(gbuffer.device, &(VkMemoryAllocateInfo){
+		VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+		.allocationSize  = memReqs.size,
+		.memoryTypeIndex = memTypeIndex,
+	}, NULL, &pBuffer->memory));
+	VK_CHECK(vkBindBufferMemory(gbuffer.device, pBuffer->buffer, pBuffer->memory, 0));
+	VK_CHECK(vkMapMemory(gbuffer.device, pBuffer->memory, 0, VK_WHOLE_SIZE, 0, &pBuffer->pMapped));
+	memset(pBuffer->pMapped, 0, size);
+}
+
+static void DestroyBuffer(GBufferBuffer* pBuffer)
+{
+	vkUnmapMemory(gbuffer.device, pBuffer->memory);
+	vkDestroyBuffer(gbuffer.device, pBuffer->buffer, NULL);
+	vkFreeMemory(gbuffer.device, pBuffer->memory, NULL);
+}
+
+static void CreateImage(const VkImageCreateInfo* pInfo, VkImage* pImage, VkDeviceMemory* pMemory)
+{
+	VK_CHECK(vkCreateImage(gbuffer.device, pInfo, NULL, pImage));
+	VkMemoryRequirements memReqs;
+	vkGetImageMemoryRequirements(gbuffer.device, *pImage, &memReqs);
+	u32 memTypeIndex = FindMemoryType(memReqs.memoryTypeBits, 0);
+	REQUIRE(memTypeIndex != UINT32_MAX, "No image memory!");
+	VK_CHECK(vkAllocateMemory(gbuffer.device, &(VkMemoryAllocateInfo){
+		VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+		.allocationSize  = memReqs.size,
+		.memoryTypeIndex = memTypeIndex,
+	}, NULL, pMemory));
+	VK_CHECK(vkBindImageMemory(gbuffer.device, *pImage, *pMemory, 0));
+}
+
+static VkImageView CreateView(VkImage image, VkFormat format, u32 baseMipLevel, u32 levelCount)
+{
+	VkImageView view;
+	VK_CHECK(vkCreateImageView(gbuffer.device, &(VkImageViewCreateInfo){
+		VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+		.image    = image,
+		.viewType = VK_IMAGE_VIEW_TYPE_2D,
+		.format   = format,
+		.subresourceRange = {
+			.aspectMask   = VK_IMAGE_ASPECT_COLOR_BIT,
+			.baseMipLevel = baseMipLevel,
+			.levelCount   = levelCount,
+			.layerCount   = 1,
+		},
+	}, NULL, &view));
+	return view;
+}
+
+static void* ReadFile(const char* path, size_t* pSize)
+{
+	FILE* pFile = fopen(path, "rb");
+	REQUIRE(pFile != NULL, "Can't open shader!");
+	fseek(pFile, 0, SEEK_END);
+	*pSize = ftell(pFile);
+	fseek(pFile, 0, SEEK_SET);
+	void* pCode = malloc(*pSize);
+	REQUIRE(fread(pCode, 1, *pSize, pFile) == *pSize, "Can't read shader!");
+	fclose(pFile);
+	return pCode;
+}
+
+static VkPipeline CreatePipe(const char* shaderDir, const char* shaderName)
+{
+	char path[1024];
+	snprintf(path, sizeof(path), "%s/%s", shaderDir, shaderName);
+	size_t codeSize;
+	void*  pCode = ReadFile(path, &codeSize);
+	VkShaderModule shader;
+	VK_CHECK(vkCreateShaderModule(gbuffer.device, &(VkShaderModuleCreateInfo){
+		VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+		.codeSize = codeSize,
+		.pCode    = pCode,
+	}, NULL, &shader));
+	free(pCode);
+
+	VkPipeline pipe;
+	VK_CHECK(vkCreateComputePipelines(gbuffer.device, VK_NULL_HANDLE, 1, &(VkComputePipelineCreateInfo){
+		VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+		.stage = {
+			VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+			.stage  = VK_SHADER_STAGE_COMPUTE_BIT,
+			.module = shader,
+			.pName  = "main",
+		},
+		.layout = gbuffer.pipeLayout,
+	}, NULL, &pipe));
+	vkDestroyShaderModule(gbuffer.device, shader, NULL);
+	return pipe;
+}
+
+// Same bindings and sampler as CreateGBufferProcessSetLayout without the push descriptor flag
+static void CreatePipes(const char* shaderDir)
+{
+	VK_CHECK(vkCreateSampler(gbuffer.device, &(VkSamplerCreateInfo){
+		VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+		.magFilter    = VK_FILTER_LINEAR,
+		.minFilter    = VK_FILTER_LINEAR,
+		.mipmapMode   = VK_SAMPLER_MIPMAP_MODE_LINEAR,
+		.maxLod       = 16.0,
+		.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+		.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+		.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+		.borderColor  = VK_BORDER_COLOR_INT_OPAQUE_BLACK,
+	}, NULL, &gbuffer.linearSampler));
+
+	VK_CHECK(vkCreateDescriptorSetLayout(gbuffer.device, &(VkDescriptorSetLayoutCreateInfo){
+		VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+		.bindingCount = BIND_COUNT,
+		.pBindings = (VkDescriptorSetLayoutBinding[]){
+			[BIND_SRC_DEPTH] = {
+				.binding            = BIND_SRC_DEPTH,
+				.descriptorType     = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+				.descriptorCount    = 1,
+				.stageFlags         = VK_SHADER_STAGE_COMPUTE_BIT,
+				.pImmutableSamplers = &gbuffer.linearSampler,
+			},
+			[BIND_SRC_GBUFFER] = {
+				.binding            = BIND_SRC_GBUFFER,
+				.descriptorType     = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+				.descriptorCount    = 1,
+				.stageFlags         = VK_SHADER_STAGE_COMPUTE_BIT,
+				.pImmutableSamplers = &gbuffer.linearSampler,
+			},
+			[BIND_DST_GBUFFER] = {
+				.binding         = BIND_DST_GBUFFER,
+				.descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+				.descriptorCount = 1,
+				.stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT,
+			},
+			[BIND_DST_GBUFFER_MIPS] = {
+				.binding         = BIND_DST_GBUFFER_MIPS,
+				.descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+				.descriptorCount = MAX_MIP_COUNT,
+				.stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT,
+			},
+			[BIND_COUNTER] = {
+				.binding         = BIND_COUNTER,
+				.descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				.descriptorCount = 1,
+				.stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT,
+			},
+		},
+	}, NULL, &gbuffer.setLayout));
+
+	VK_CHECK(vkCreatePipelineLayout(gbuffer.device, &(VkPipelineLayoutCreateInfo){
+		VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+		.setLayoutCount = 1,
+		.pSetLayouts    = &gbuffer.setLayout,
+		.pushConstantRangeCount = 1,
+		.pPushConstantRanges = &(VkPushConstantRange){
+			.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+			.size       = sizeof(GBufferProcessPush),
+		},
+	}, NULL, &gbuffer.pipeLayout));
+
+	gbuffer.downPipe = CreatePipe(shaderDir, "compositor_gbuffer_process_down.comp.spv");
+	gbuffer.upPipe = CreatePipe(shaderDir, "compositor_gbuffer_process_up.comp.spv");
+	gbuffer.downSinglePassPipe = CreatePipe(shaderDir, "compositor_gbuffer_process_down_single_pass.comp.spv");
+	gbuffer.upSinglePassPipe = CreatePipe(shaderDir, "compositor_gbuffer_process_up_single_pass.comp.spv");
+}
+
+// Both paths dispatch at most once per mip each way
+#define MAX_SETS_PER_RUN (MIP_COUNT * 2 + 2)
+
+static void CreateResources()
+{
+	CreateImage(&(VkImageCreateInfo){
+		VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+		.imageType   = VK_IMAGE_TYPE_2D,
+		.format      = VK_FORMAT_R16_UNORM,
+		.extent      = {GBUFFER_WIDTH, GBUFFER_HEIGHT, 1},
+		.mipLevels   = 1,
+		.arrayLayers = 1,
+		.samples     = VK_SAMPLE_COUNT_1_BIT,
+		.usage       = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+	}, &gbuffer.depthImage, &gbuffer.depthMemory);
+	gbuffer.depthView = CreateView(gbuffer.depthImage, VK_FORMAT_R16_UNORM, 0, 1);
+
+	VkDeviceSize readbackSize = 0;
+	for (int iMip = 0; iMip < MIP_COUNT; ++iMip)
+		readbackSize += (VkDeviceSize)MAX(GBUFFER_WIDTH >> iMip, 1) * MAX(GBUFFER_HEIGHT >> iMip, 1) * sizeof(f16[4]);
+
+	for (int iPath = 0; iPath < PATH_COUNT; ++iPath) {
+		GBufferImage* pGBuffer = &gbuffer.gbuffers[iPath];
+		CreateImage(&(VkImageCreateInfo){
+			VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+			.imageType   = VK_IMAGE_TYPE_2D,
+			.format      = GBUFFER_FORMAT,
+			.extent      = {GBUFFER_WIDTH, GBUFFER_HEIGHT, 1},
+			.mipLevels   = MIP_COUNT,
+			.arrayLayers = 1,
+			.samples     = VK_SAMPLE_COUNT_1_BIT,
+			.usage       = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+		}, &pGBuffer->image, &pGBuffer->memory);
+		for (int iMip = 0; iMip < MIP_COUNT; ++iMip)
+			pGBuffer->mipViews[iMip] = CreateView(pGBuffer->image, GBUFFER_FORMAT, iMip, 1);
+		pGBuffer->pyramidView = CreateView(pGBuffer->image, GBUFFER_FORMAT, 1, MIP_COUNT - 1);
+
+		CreateBuffer(readbackSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, &gbuffer.readbackBuffers[iPath]);
+	}
+
+	CreateBuffer(sizeof(u16) * GBUFFER_WIDTH * GBUFFER_HEIGHT, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, &gbuffer.depthBuffer);
+	CreateBuffer(sizeof(u32), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, &gbuffer.counterBuffer);
+
+	VK_CHECK(vkCreateDescriptorPool(gbuffer.device, &(VkDescriptorPoolCreateInfo){
+		VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+		.maxSets       = MAX_SETS_PER_RUN,
+		.poolSizeCount = 3,
+		.pPoolSizes = (VkDescriptorPoolSize[]){
+			{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, MAX_SETS_PER_RUN * 2},
+			{VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, MAX_SETS_PER_RUN * (1 + MAX_MIP_COUNT)},
+			{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, MAX_SETS_PER_RUN},
+		},
+	}, NULL, &gbuffer.descriptorPool));
+
+	VK_CHECK(vkCreateQueryPool(gbuffer.device, &(VkQueryPoolCreateInfo){
+		VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+		.queryType  = VK_QUERY_TYPE_TIMESTAMP,
+		.queryCount = 2,
+	}, NULL, &gbuffer.timeQueryPool));
+
+	VK_CHECK(vkCreateCommandPool(gbuffer.device, &(VkCommandPoolCreateInfo){
+		VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+		.flags            = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+		.queueFamilyIndex = gbuffer.queueFamilyIndex,
+	}, NULL, &gbuffer.commandPool));
+	VK_CHECK(vkAllocateCommandBuffers(gbuffer.device, &(VkCommandBufferAllocateInfo){
+		VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+		.commandPool        = gbuffer.commandPool,
+		.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+		.commandBufferCount = 1,
+	}, &gbuffer.cmd));
+}
+
+static void DestroyContext()
+{
+	vkDestroyCommandPool(gbuffer.device, gbuffer.commandPool, NULL);
+	vkDestroyQueryPool(gbuffer.device, gbuffer.timeQueryPool, NULL);
+	vkDestroyDescriptorPool(gbuffer.device, gbuffer.descriptorPool, NULL);
+	DestroyBuffer(&gbuffer.counterBuffer);
+	DestroyBuffer(&gbuffer.depthBuffer);
+	for (int iPath = 0; iPath < PATH_COUNT; ++iPath) {
+		GBufferImage* pGBuffer = &gbuffer.gbuffers[iPath];
+		DestroyBuffer(&gbuffer.readbackBuffers[iPath]);
+		vkDestroyImageView(gbuffer.device, pGBuffer->pyramidView, NULL);
+		for (int iMip = 0; iMip < MIP_COUNT; ++iMip)
+			vkDestroyImageView(gbuffer.device, pGBuffer->mipViews[iMip], NULL);
+		vkDestroyImage(gbuffer.device, pGBuffer->image, NULL);
+		vkFreeMemory(gbuffer.device, pGBuffer->memory, NULL);
+	}
+	vkDestroyImageView(gbuffer.device, gbuffer.depthView, NULL);
+	vkDestroyImage(gbuffer.device, gbuffer.depthImage, NULL);
+	vkFreeMemory(gbuffer.device, gbuffer.depthMemory, NULL);
+	vkDestroyPipeline(gbuffer.device, gbuffer.downPipe, NULL);
+	vkDestroyPipeline(gbuffer.device, gbuffer.upPipe, NULL);
+	vkDestroyPipeline(gbuffer.device, gbuffer.downSinglePassPipe, NULL);
+	vkDestroyPipeline(gbuffer.device, gbuffer.upSinglePassPipe, NULL);
+	vkDestroyPipelineLayout(gbuffer.device, gbuffer.pipeLayout, NULL);
+	vkDestroyDescriptorSetLayout(gbuffer.device, gbuffer.setLayout, NULL);
+	vkDestroySampler(gbuffer.device, gbuffer.linearSampler, NULL);
+	vkDestroyDevice(gbuffer.device, NULL);
+	vkDestroyInstance(gbuffer.instance, NULL);
+}
+
+////
+//// Recording
+////
+// Stands in for CMD_PUSH_SETS. Bindings left out stay unwritten, the shaders that don't use them never read them.
+static void BindSet(VkCommandBuffer cmd, VkImageView srcDepth, VkImageView srcGBuffer, VkImageView dstGBuffer, const VkDescriptorImageInfo* pDstMips)
+{
+	VkDescriptorSet set;
+	VK_CHECK(vkAllocateDescriptorSets(gbuffer.device, &(VkDescriptorSetAllocateInfo){
+		VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+		.descriptorPool     = gbuffer.descriptorPool,
+		.descriptorSetCount = 1,
+		.pSetLayouts        = &gbuffer.setLayout,
+	}, &set));
+
+	VkDescriptorImageInfo imageInfos[] = {
+		[BIND_SRC_DEPTH]   = {.imageView = srcDepth, .imageLayout = VK_IMAGE_LAYOUT_GENERAL},
+		[BIND_SRC_GBUFFER] = {.imageView = srcGBuffer, .imageLayout = VK_IMAGE_LAYOUT_GENERAL},
+		[BIND_DST_GBUFFER] = {.imageView = dstGBuffer, .imageLayout = VK_IMAGE_LAYOUT_GENERAL},
+	};
+	VkDescriptorBufferInfo counterInfo = {gbuffer.counterBuffer.buffer, 0, VK_WHOLE_SIZE};
+
+	VkWriteDescriptorSet writes[BIND_COUNT];
+	u32                  writeCount = 0;
+	for (int iBind = BIND_SRC_DEPTH; iBind <= BIND_DST_GBUFFER; ++iBind) {
+		if (imageInfos[iBind].imageView == VK_NULL_HANDLE)
+			continue;
+		writes[writeCount++] = (VkWriteDescriptorSet){
+			VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			.dstSet          = set,
+			.dstBinding      = iBind,
+			.descriptorCount = 1,
+			.descriptorType  = iBind == BIND_DST_GBUFFER ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+			.pImageInfo      = &imageInfos[iBind],
+		};
+	}
+	if (pDstMips != NULL) {
+		writes[writeCount++] = (VkWriteDescriptorSet){
+			VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			.dstSet          = set,
+			.dstBinding      = BIND_DST_GBUFFER_MIPS,
+			.descriptorCount = MAX_MIP_COUNT,
+			.descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+			.pImageInfo      = pDstMips,
+		};
+		writes[writeCount++] = (VkWriteDescriptorSet){
+			VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			.dstSet          = set,
+			.dstBinding      = BIND_COUNTER,
+			.descriptorCount = 1,
+			.descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.pBufferInfo     = &counterInfo,
+		};
+	}
+	vkUpdateDescriptorSets(gbuffer.device, writeCount, writes, 0, NULL);
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, gbuffer.pipeLayout, 0, 1, &set, 0, NULL);
+}
+
+static void MipBarrier(VkCommandBuffer cmd, VkImage image, u32 baseMipLevel, u32 levelCount)
+{
+	vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &(VkImageMemoryBarrier){
+		VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+		.srcAccessMask       = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+		.dstAccessMask       = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+		.oldLayout           = VK_IMAGE_LAYOUT_GENERAL,
+		.newLayout           = VK_IMAGE_LAYOUT_GENERAL,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.image               = image,
+		.subresourceRange    = {VK_IMAGE_ASPECT_COLOR_BIT, baseMipLevel, levelCount, 0, 1},
+	});
+}
+
+// GBufferProcessDispatchRect
+static void DispatchRect(VkCommandBuffer cmd, const ProcessState* pProcessState, ivec2 rectOffset, ivec2 rectExtent, int iMip)
+{
+	int   mipScale = 1 << iMip;
+	ivec2 mipMin = {.vec = rectOffset.vec >> iMip};
+	ivec2 mipMax = {.vec = (rectOffset.vec + rectExtent.vec + mipScale - 1) >> iMip};
+	GBufferProcessPush push = {
+		.state = *pProcessState,
+		.rectOffset = mipMin,
+		.rectExtent = {.vec = mipMax.vec - mipMin.vec},
+	};
+	vkCmdPushConstants(cmd, gbuffer.pipeLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(GBufferProcessPush), &push);
+
+	ivec2 groupCount = iVec2Min(iVec2CeiDivide(push.rectExtent, LOCAL_SIZE), 1);
+	vkCmdDispatch(cmd, groupCount.x, groupCount.y, 1);
+}
+
+// GBufferProcessDepthMultiDispatch
+static void RecordMultiDispatch(VkCommandBuffer cmd, GBufferImage* pGBuffer, ivec2 rectOffset, ivec2 rectExtent, bool downOnly)
+{
+	ProcessState emptyProcessState = {
+		.depthFarZ = 1,
+		.depthNearZ = 0,
+		.cameraFarZ = 1,
+		.cameraNearZ = 0,
+	};
+
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, gbuffer.downPipe);
+	BindSet(cmd, gbuffer.depthView, VK_NULL_HANDLE, pGBuffer->mipViews[1], NULL);
+	DispatchRect(cmd, &emptyProcessState, rectOffset, rectExtent, 1);
+
+	for (int iMip = 2; iMip < MIP_COUNT; ++iMip) {
+		MipBarrier(cmd, pGBuffer->image, iMip - 1, 2);
+		BindSet(cmd, pGBuffer->mipViews[iMip - 1], VK_NULL_HANDLE, pGBuffer->mipViews[iMip], NULL);
+		DispatchRect(cmd, &emptyProcessState, rectOffset, rectExtent, iMip);
+	}
+	if (downOnly)
+		return;
+
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, gbuffer.upPipe);
+	for (int iMip = MIP_COUNT - 2; iMip >= 1; --iMip) {
+		MipBarrier(cmd, pGBuffer->image, iMip, 2);
+		BindSet(cmd, pGBuffer->mipViews[iMip + 1], pGBuffer->mipViews[iMip], pGBuffer->mipViews[iMip], NULL);
+		DispatchRect(cmd, &emptyProcessState, rectOffset, rectExtent, iMip);
+	}
+
+	MipBarrier(cmd, pGBuffer->image, 0, 2);
+	BindSet(cmd, pGBuffer->mipViews[1], gbuffer.depthView, pGBuffer->mipViews[0], NULL);
+	DispatchRect(cmd, &processState, rectOffset, rectExtent, 0);
+}
+
+// GBufferProcessDepthSinglePass
+static void RecordSinglePass(VkCommandBuffer cmd, GBufferImage* pGBuffer, ivec2 rectOffset, ivec2 rectExtent, bool downOnly)
+{
+	VkDescriptorImageInfo mipInfos[MAX_MIP_COUNT];
+	for (int iMip = 0; iMip < MAX_MIP_COUNT; ++iMip)
+		mipInfos[iMip] = (VkDescriptorImageInfo){
+			.imageView = pGBuffer->mipViews[MIN(iMip, MIP_COUNT - 1)],
+			.imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+		};
+
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, gbuffer.downSinglePassPipe);
+	BindSet(cmd, gbuffer.depthView, VK_NULL_HANDLE, VK_NULL_HANDLE, mipInfos);
+
+	GBufferProcessPush push = {
+		.state = processState,
+		.rectOffset = rectOffset,
+		.rectExtent = rectExtent,
+	};
+	vkCmdPushConstants(cmd, gbuffer.pipeLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(GBufferProcessPush), &push);
+
+	int   tileSize = LOCAL_SIZE * 2;
+	ivec2 tileMin = {.vec = rectOffset.vec / tileSize};
+	ivec2 tileMax = iVec2CeiDivide((ivec2){.vec = rectOffset.vec + rectExtent.vec}, tileSize);
+	ivec2 downGroupCount = iVec2Min((ivec2){.vec = tileMax.vec - tileMin.vec}, 1);
+	vkCmdDispatch(cmd, downGroupCount.x, downGroupCount.y, 1);
+	if (downOnly)
+		return;
+
+	MipBarrier(cmd, pGBuffer->image, 1, VK_REMAINING_MIP_LEVELS);
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, gbuffer.upSinglePassPipe);
+	BindSet(cmd, gbuffer.depthView, pGBuffer->pyramidView, pGBuffer->mipViews[0], NULL);
+
+	ivec2 upGroupCount = iVec2Min(iVec2CeiDivide(rectExtent, LOCAL_SIZE), 1);
+	vkCmdDispatch(cmd, upGroupCount.x, upGroupCount.y, 1);
+}
+
+static void Submit()
+{
+	VK_CHECK(vkEndCommandBuffer(gbuffer.cmd));
+	VK_CHECK(vkQueueSubmit(gbuffer.queue, 1, &(VkSubmitInfo){
+		VK_STRUCTURE_TYPE_SUBMIT_INFO,
+		.commandBufferCount = 1,
+		.pCommandBuffers    = &gbuffer.cmd,
+	}, VK_NULL_HANDLE));
+	VK_CHECK(vkQueueWaitIdle(gbuffer.queue));
+}
+
+static void Begin()
+{
+	VK_CHECK(vkResetDescriptorPool(gbuffer.device, gbuffer.descriptorPool, 0));
+	VK_CHECK(vkBeginCommandBuffer(gbuffer.cmd, &(VkCommandBufferBeginInfo){
+		VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+	}));
+}
+
+static void UploadDepth(const GBufferLayout* pLayout)
+{
+	ivec2 rectMax = {.vec = pLayout->rectOffset.vec + pLayout->rectExtent.vec};
+	u16*  pDepth = gbuffer.depthBuffer.pMapped;
+	for (int y = 0; y < GBUFFER_HEIGHT; ++y)
+		for (int x = 0; x < GBUFFER_WIDTH; ++x) {
+			// Outside the rect wasn't rendered this frame
+			bool rendered = InRect(x, y, pLayout->rectOffset, rectMax) && !IsHole(x, y);
+			pDepth[y * GBUFFER_WIDTH + x] = rendered ? (u16)(PlaneDepth(x, y) * 65535.0f + 0.5f) : 0;
+		}
+
+	Begin();
+	VkImageSubresourceRange range = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+	vkCmdPipelineBarrier(gbuffer.cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 1, &(VkImageMemoryBarrier){
+		VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+		.dstAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT,
+		.oldLayout           = VK_IMAGE_LAYOUT_UNDEFINED,
+		.newLayout           = VK_IMAGE_LAYOUT_GENERAL,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.image               = gbuffer.depthImage,
+		.subresourceRange    = range,
+	});
+	vkCmdCopyBufferToImage(gbuffer.cmd, gbuffer.depthBuffer.buffer, gbuffer.depthImage, VK_IMAGE_LAYOUT_GENERAL, 1, &(VkBufferImageCopy){
+		.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1},
+		.imageExtent      = {GBUFFER_WIDTH, GBUFFER_HEIGHT, 1},
+	});
+	vkCmdPipelineBarrier(gbuffer.cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &(VkImageMemoryBarrier){
+		VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+		.srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT,
+		.dstAccessMask       = VK_ACCESS_SHADER_READ_BIT,
+		.oldLayout           = VK_IMAGE_LAYOUT_GENERAL,
+		.newLayout           = VK_IMAGE_LAYOUT_GENERAL,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.image               = gbuffer.depthImage,
+		.subresourceRange    = range,
+	});
+	Submit();
+}
+
+// Process the depth on one path and read every mip back. Returns the GPU time of the process alone.
+static double RunPath(int iPath, const GBufferLayout* pLayout, bool downOnly)
+{
+	GBufferImage* pGBuffer = &gbuffer.gbuffers[iPath];
+	VkImageSubresourceRange range = {VK_IMAGE_ASPECT_COLOR_BIT, 0, MIP_COUNT, 0, 1};
+
+	Begin();
+	vkCmdResetQueryPool(gbuffer.cmd, gbuffer.timeQueryPool, 0, 2);
+	vkCmdPipelineBarrier(gbuffer.cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 1, &(VkImageMemoryBarrier){
+		VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+		.dstAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT,
+		.oldLayout           = VK_IMAGE_LAYOUT_UNDEFINED,
+		.newLayout           = VK_IMAGE_LAYOUT_GENERAL,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.image               = pGBuffer->image,
+		.subresourceRange    = range,
+	});
+	vkCmdClearColorImage(gbuffer.cmd, pGBuffer->image, VK_IMAGE_LAYOUT_GENERAL, &(VkClearColorValue){.float32 = {UNWRITTEN_DEPTH}}, 1, &range);
+	vkCmdPipelineBarrier(gbuffer.cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &(VkImageMemoryBarrier){
+		VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+		.srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT,
+		.dstAccessMask       = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+		.oldLayout           = VK_IMAGE_LAYOUT_GENERAL,
+		.newLayout           = VK_IMAGE_LAYOUT_GENERAL,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.image               = pGBuffer->image,
+		.subresourceRange    = range,
+	});
+
+	vkCmdWriteTimestamp(gbuffer.cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, gbuffer.timeQueryPool, 0);
+	if (iPath == PATH_SINGLE_PASS) RecordSinglePass(gbuffer.cmd, pGBuffer, pLayout->rectOffset, pLayout->rectExtent, downOnly);
+	else                           RecordMultiDispatch(gbuffer.cmd, pGBuffer, pLayout->rectOffset, pLayout->rectExtent, downOnly);
+	vkCmdWriteTimestamp(gbuffer.cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, gbuffer.timeQueryPool, 1);
+
+	vkCmdPipelineBarrier(gbuffer.cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 1, &(VkImageMemoryBarrier){
+		VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+		.srcAccessMask       = VK_ACCESS_SHADER_WRITE_BIT,
+		.dstAccessMask       = VK_ACCESS_TRANSFER_READ_BIT,
+		.oldLayout           = VK_IMAGE_LAYOUT_GENERAL,
+		.newLayout           = VK_IMAGE_LAYOUT_GENERAL,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.image               = pGBuffer->image,
+		.subresourceRange    = range,
+	});
+	VkBufferImageCopy regions[MIP_COUNT];
+	VkDeviceSize      offset = 0;
+	for (int iMip = 0; iMip < MIP_COUNT; ++iMip) {
+		u32 width = MAX(GBUFFER_WIDTH >> iMip, 1);
+		u32 height = MAX(GBUFFER_HEIGHT >> iMip, 1);
+		regions[iMip] = (VkBufferImageCopy){
+			.bufferOffset     = offset,
+			.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, iMip, 0, 1},
+			.imageExtent      = {width, height, 1},
+		};
+		offset += (VkDeviceSize)width * height * sizeof(f16[4]);
+	}
+	vkCmdCopyImageToBuffer(gbuffer.cmd, pGBuffer->image, VK_IMAGE_LAYOUT_GENERAL, gbuffer.readbackBuffers[iPath].buffer, MIP_COUNT, regions);
+	vkCmdPipelineBarrier(gbuffer.cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &(VkMemoryBarrier){
+		VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+		.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+		.dstAccessMask = VK_ACCESS_HOST_READ_BIT,
+	}, 0, NULL, 0, NULL);
+	Submit();
+
+	u64 timestamps[2];
+	VK_CHECK(vkGetQueryPoolResults(gbuffer.device, gbuffer.timeQueryPool, 0, 2, sizeof(timestamps), timestamps, sizeof(u64), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT));
+	return (double)(timestamps[1] - timestamps[0]) * gbuffer.timestampPeriod / 1000000.0;
+}
+
+////
+//// Test
+////
+static f16* ReadbackMip(int iPath, int iMip)
+{
+	VkDeviceSize offset = 0;
+	for (int i = 0; i < iMip; ++i)
+		offset += (VkDeviceSize)MAX(GBUFFER_WIDTH >> i, 1) * MAX(GBUFFER_HEIGHT >> i, 1) * 4;
+	return (f16*)gbuffer.readbackBuffers[iPath].pMapped + offset;
+}
+
+// Projected depth the process turns a 16 bit depth into
+#define PROCESS_TOLERANCE 0.002f
+
+// Single pass keeps its tile levels in fp32 shared memory where multi dispatch rounds every level to fp16
+#define PYRAMID_TOLERANCE (1.0f / 1024.0f)
+
+// The down pass is the same reduction on both paths so every pyramid texel inside the rect must match. Missing
+// texels must match exactly, an average on one side and zero on the other is a different reduction.
+// Texels straddling the rect edge are only counted. Multi dispatch reduces whatever the finer mip held just
+// outside its rect there where single pass masks it as missing.
+static bool CheckPyramid(const GBufferLayout* pLayout)
+{
+	for (int iPath = 0; iPath < PATH_COUNT; ++iPath)
+		RunPath(iPath, pLayout, true);
+
+	int   edgeMismatchCount = 0;
+	ivec2 rectMax = {.vec = pLayout->rectOffset.vec + pLayout->rectExtent.vec};
+	for (int iMip = 1; iMip < MIP_COUNT; ++iMip) {
+		int   width = MAX(GBUFFER_WIDTH >> iMip, 1);
+		int   height = MAX(GBUFFER_HEIGHT >> iMip, 1);
+		int   mipScale = 1 << iMip;
+		ivec2 mipMin = {.vec = pLayout->rectOffset.vec >> iMip};
+		ivec2 mipMax = {.vec = (rectMax.vec + mipScale - 1) >> iMip};
+		ivec2 innerMin = {.vec = (pLayout->rectOffset.vec + mipScale - 1) >> iMip};
+		ivec2 innerMax = {.vec = rectMax.vec >> iMip};
+		f16*  pMulti = ReadbackMip(PATH_MULTI_DISPATCH, iMip);
+		f16*  pSingle = ReadbackMip(PATH_SINGLE_PASS, iMip);
+
+		int mismatchCount = 0, texelCount = 0, firstX = 0, firstY = 0;
+		for (int y = mipMin.y; y < MIN(mipMax.y, height); ++y)
+			for (int x = mipMin.x; x < MIN(mipMax.x, width); ++x) {
+				int   i = (y * width + x) * 4;
+				float multi = pMulti[i], single = pSingle[i];
+				bool  isMatch = (multi == 0) == (single == 0) && fabsf(multi - single) <= PYRAMID_TOLERANCE;
+				if (x < innerMin.x || y < innerMin.y || x >= innerMax.x || y >= innerMax.y) {
+					edgeMismatchCount += !isMatch;
+					continue;
+				}
+				texelCount++;
+				if (isMatch)
+					continue;
+				if (mismatchCount++ == 0) {
+					firstX = x;
+					firstY = y;
+				}
+			}
+		TEST_CHECK(mismatchCount == 0, "%s mip %d %d of %d texels differ, first at %d %d multi dispatch %f single pass %f",
+		           pLayout->name, iMip, mismatchCount, texelCount, firstX, firstY,
+		           (float)pMulti[(firstY * width + firstX) * 4], (float)pSingle[(firstY * width + firstX) * 4]);
+	}
+
+	u32 counter = *(u32*)gbuffer.counterBuffer.pMapped;
+	TEST_CHECK(counter == 0, "%s single pass left its workgroup counter at %u", pLayout->name, counter);
+	LOG("%s down pyramids match through mip %d within %f, %d rect edge texels differ\n",
+	    pLayout->name, MIP_COUNT - 1, PYRAMID_TOLERANCE, edgeMismatchCount);
+	return true;
+}
+
+static bool CheckDepth(int iPath, const GBufferLayout* pLayout)
+{
+	ivec2 rectMax = {.vec = pLayout->rectOffset.vec + pLayout->rectExtent.vec};
+	u16*  pDepth = gbuffer.depthBuffer.pMapped;
+	f16*  pOut = ReadbackMip(iPath, 0);
+
+	float minRendered = 1.0f, maxRendered = 0.0f;
+	for (int y = pLayout->rectOffset.y; y < rectMax.y; ++y)
+		for (int x = pLayout->rectOffset.x; x < rectMax.x; ++x) {
+			u16 depth = pDepth[y * GBUFFER_WIDTH + x];
+			if (depth == 0)
+				continue;
+			float expected = 1.0f - depth / 65535.0f;
+			float out = pOut[(y * GBUFFER_WIDTH + x) * 4];
+			TEST_CHECK(fabsf(out - expected) <= PROCESS_TOLERANCE, "%s %s rendered texel %d %d is %f expected %f",
+			           pLayout->name, pathNames[iPath], x, y, out, expected);
+			minRendered = MIN(minRendered, expected);
+			maxRendered = MAX(maxRendered, expected);
+		}
+
+	// A filled hole can only blend the depth around it, anything out of range read a texel nothing wrote.
+	// Multi dispatch does that on a rect not aligned to the coarser mips, see CheckPyramid, so it is only counted.
+	int   holeCount = 0, unwrittenCount = 0;
+	float sumError = 0, maxError = 0;
+	for (int y = pLayout->rectOffset.y; y < rectMax.y; ++y)
+		for (int x = pLayout->rectOffset.x; x < rectMax.x; ++x) {
+			if (pDepth[y * GBUFFER_WIDTH + x] != 0)
+				continue;
+			float out = pOut[(y * GBUFFER_WIDTH + x) * 4];
+			if (out < minRendered - PROCESS_TOLERANCE || out > maxRendered + PROCESS_TOLERANCE) {
+				TEST_CHECK(iPath == PATH_MULTI_DISPATCH, "%s %s hole texel %d %d is %f outside the rendered %f to %f",
+				           pLayout->name, pathNames[iPath], x, y, out, minRendered, maxRendered);
+				unwrittenCount++;
+				continue;
+			}
+			float error = fabsf(out - (1.0f - PlaneDepth(x, y)));
+			sumError += error;
+			maxError = MAX(maxError, error);
+			holeCount++;
+		}
+
+	LOG("%s %s %d holes filled, error from the plane mean %.5f max %.5f, %d filled from unwritten texels\n",
+	    pLayout->name, pathNames[iPath], holeCount, sumError / MAX(holeCount, 1), maxError, unwrittenCount);
+	return true;
+}
+
+#define TIMING_RUN_COUNT 32
+
+static bool RunLayout(const GBufferLayout* pLayout)
+{
+	UploadDepth(pLayout);
+	if (!CheckPyramid(pLayout))
+		return false;
+
+	for (int iPath = 0; iPath < PATH_COUNT; ++iPath) {
+		RunPath(iPath, pLayout, false);
+		if (!CheckDepth(iPath, pLayout))
+			return false;
+	}
+
+	// Alternated so neither path gets a warmer device
+	double totalMs[PATH_COUNT] = {};
+	for (int iRun = 0; iRun < TIMING_RUN_COUNT; ++iRun)
+		for (int iPath = 0; iPath < PATH_COUNT; ++iPath)
+			totalMs[iPath] += RunPath(iPath, pLayout, false);
+	LOG("%s multi dispatch %.4fms single pass %.4fms\n", pLayout->name,
+	    totalMs[PATH_MULTI_DISPATCH] / TIMING_RUN_COUNT, totalMs[PATH_SINGLE_PASS] / TIMING_RUN_COUNT);
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2) {
+		LOG_ERROR("Usage: gbuffer_test shader_dir\n");
+		return EXIT_FAILURE;
+	}
+
+	if (!CreateContext()) {
+		LOG("Skipped\n");
+		return GBUFFER_TEST_SKIP;
+	}
+	CreatePipes(argv[1]);
+	CreateResources();
+
+	bool passed = true;
+	for (u32 i = 0; i < COUNT(layouts) && passed; ++i)
+		passed = RunLayout(&layouts[i]);
+
+	DestroyContext();
+	return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
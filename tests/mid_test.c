@@ -0,0 +1,748 @@
+/*
+ * Mid Test
+ *
+ * Stress tests and benchmarks for the channel and block headers. Needs no Vulkan so it builds anywhere.
+ * Returns non zero on the first failed check. Benchmarks only log.
+ */
+#include <pthread.h>
+#include <sched.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <time.h>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#ifndef _WIN32
+// ASSERT calls the mingw assert hook
+void _assert(const char* message, const char* file, unsigned line);
+#endif
+
+#define MID_COMMON_IMPLEMENTATION
+#include "mid_common.h"
+
+#define MID_QRING_IMPLEMENTATION
+#include "mid_channel.h"
+
+#include "mid_block.h"
+
+#ifndef _WIN32
+void _assert(const char* message, const char* file, unsigned line)
+{
+	fprintf(stderr, "%s:%u %s\n", file, line, message);
+	abort();
+}
+#endif
+
+#define TEST_CHECK(_condition, _format, ...)                               \
+	if (UNLIKELY(!(_condition))) {                                         \
+		LOG_ERROR("Failed: " #_condition " " _format "\n", ##__VA_ARGS__); \
+		return false;                                                      \
+	}
+
+static double TimeMs()
+{
+	struct timespec ts;
+	timespec_get(&ts, TIME_UTC);
+	return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1000000.0;
+}
+
+////
+//// MPSC Stress
+////
+#define MPSC_PRODUCER_COUNT     64
+#define MPSC_PRODUCER_SEND_COUNT 20000
+#define MPSC_CAPACITY           256
+#define MPSC_WAIT_TIMEOUT_MS    1000
+
+typedef struct MpscValue {
+	u32 producer;
+	u32 sequence;
+} MpscValue;
+
+static struct {
+	MidChannelMpscRing ring;
+	u32                sequences[MPSC_CAPACITY];
+	MpscValue          values[MPSC_CAPACITY];
+	_Atomic u32        startedCount;
+} mpsc;
+
+static void* MpscProducer(void* pArg)
+{
+	u32 producer = (u32)(uintptr_t)pArg;
+	atomic_fetch_add(&mpsc.startedCount, 1);
+	while (atomic_load(&mpsc.startedCount) < MPSC_PRODUCER_COUNT) sched_yield();
+
+	for (u32 i = 0; i < MPSC_PRODUCER_SEND_COUNT; ++i) {
+		MpscValue value = {.producer = producer, .sequence = i};
+		while (MID_CHANNEL_MPSC_SEND(&mpsc.ring, mpsc.sequences, mpsc.values, &value) != MID_SUCCESS) sched_yield();
+	}
+	return NULL;
+}
+
+// Every producer's values must arrive once each and in the order that producer sent them
+static bool TestMpscStress()
+{
+	memset(&mpsc, 0, sizeof(mpsc));
+	pthread_t threads[MPSC_PRODUCER_COUNT];
+	for (u32 i = 0; i < MPSC_PRODUCER_COUNT; ++i)
+		pthread_create(&threads[i], NULL, MpscProducer, (void*)(uintptr_t)i);
+
+	u32    nextSequences[MPSC_PRODUCER_COUNT] = {};
+	u32    recvCount = 0;
+	double startMs = TimeMs();
+	while (recvCount < MPSC_PRODUCER_COUNT * MPSC_PRODUCER_SEND_COUNT) {
+		MpscValue value;
+		if (MID_CHANNEL_MPSC_RECV(&mpsc.ring, mpsc.sequences, mpsc.values, &value) != MID_SUCCESS) {
+			// Wait can wake still empty when the tail slot is claimed but not yet written.
+			// Only sleeping the whole timeout with producers still sending means a wake was lost.
+			double waitStartMs = TimeMs();
+			MID_CHANNEL_MPSC_WAIT(&mpsc.ring, mpsc.sequences, mpsc.values, MPSC_WAIT_TIMEOUT_MS);
+			TEST_CHECK(TimeMs() - waitStartMs < MPSC_WAIT_TIMEOUT_MS, "Consumer slept the whole timeout with %u received", recvCount);
+			continue;
+		}
+		TEST_CHECK(value.producer < MPSC_PRODUCER_COUNT, "Producer %u", value.producer);
+		TEST_CHECK(value.sequence == nextSequences[value.producer], "Producer %u sent %u expected %u", value.producer, value.sequence, nextSequences[value.producer]);
+		nextSequences[value.producer]++;
+		recvCount++;
+	}
+	double elapsedMs = TimeMs() - startMs;
+
+	for (u32 i = 0; i < MPSC_PRODUCER_COUNT; ++i)
+		pthread_join(threads[i], NULL);
+
+	MpscValue value;
+	TEST_CHECK(MID_CHANNEL_MPSC_RECV(&mpsc.ring, mpsc.sequences, mpsc.values, &value) == MID_EMPTY, "Ring not empty after every send was received");
+	LOG("MPSC %d producers %u values %.2fms %.1fns per value\n", MPSC_PRODUCER_COUNT, recvCount, elapsedMs, elapsedMs * 1000000.0 / recvCount);
+	return true;
+}
+
+////
+//// Aligned Wait
+////
+#define WAIT_SEND_COUNT      20000
+#define WAIT_CAPACITY        16
+#define WAIT_TIMEOUT_MS      1000
+#define WAIT_PAUSE_INTERVAL  64
+
+static struct {
+	MidChannelAlignedRing16 ring;
+	u32                     values[WAIT_CAPACITY];
+} alignedWait;
+
+// Pauses every WAIT_PAUSE_INTERVAL sends so the receiver drains and goes to sleep
+static void* WaitProducer(void* pArg)
+{
+	for (u32 i = 0; i < WAIT_SEND_COUNT; ++i) {
+		if (i % WAIT_PAUSE_INTERVAL == 0) {
+			struct timespec pause = {.tv_nsec = 50000};
+			nanosleep(&pause, NULL);
+		}
+		while (MID_CHANNEL_SEND_WAKE(&alignedWait.ring, alignedWait.values, &i) != MID_SUCCESS) sched_yield();
+	}
+	return NULL;
+}
+
+// Every value must arrive in order, and the receiver must never sleep the whole timeout while sends are still coming
+static bool TestAlignedWait()
+{
+	memset(&alignedWait, 0, sizeof(alignedWait));
+	pthread_t thread;
+	pthread_create(&thread, NULL, WaitProducer, NULL);
+
+	double startMs = TimeMs();
+	for (u32 i = 0; i < WAIT_SEND_COUNT; ++i) {
+		u32    value;
+		double waitStartMs = TimeMs();
+		TEST_CHECK(MID_CHANNEL_RECV_WAIT(&alignedWait.ring, alignedWait.values, &value, WAIT_TIMEOUT_MS) == MID_SUCCESS, "Receiver timed out with %u received", i);
+		TEST_CHECK(TimeMs() - waitStartMs < WAIT_TIMEOUT_MS, "Receiver slept the whole timeout with %u received", i);
+		TEST_CHECK(value == i, "Received %u expected %u", value, i);
+	}
+	double elapsedMs = TimeMs() - startMs;
+	pthread_join(thread, NULL);
+
+	u32 value;
+	TEST_CHECK(MID_CHANNEL_RECV_WAIT(&alignedWait.ring, alignedWait.values, &value, 1) == MID_EMPTY, "Ring not empty after every send was received");
+	LOG("Aligned wait %u values %.2fms\n", WAIT_SEND_COUNT, elapsedMs);
+	return true;
+}
+
+////
+//// Block Claim Contention
+////
+#define BLOCK_CONTENTION_CAPACITY       64
+#define BLOCK_CONTENTION_THREAD_MAX     16
+#define BLOCK_CONTENTION_ITERATION_COUNT 100000
+
+typedef struct BlockContentionSlot {
+	_Atomic u32 owner;
+} BlockContentionSlot;
+
+static struct {
+	BLOCK_T_N(BlockContentionSlot, BLOCK_CONTENTION_CAPACITY) block;
+	pthread_mutex_t lock;
+	bool            useLock;
+	_Atomic u32     failCount;
+} blockContention;
+
+// Each claim must hand out a slot no other thread holds, checked by swapping in the thread as owner
+static void* BlockContentionWorker(void* pArg)
+{
+	u32 owner = (u32)(uintptr_t)pArg + 1;
+	for (u32 i = 0; i < BLOCK_CONTENTION_ITERATION_COUNT; ++i) {
+		block_handle h;
+		if (blockContention.useLock) {
+			pthread_mutex_lock(&blockContention.lock);
+			h = BLOCK_CLAIM(blockContention.block, 0);
+			pthread_mutex_unlock(&blockContention.lock);
+		} else
+			h = BLOCK_CLAIM_ATOMIC(blockContention.block);
+
+		if (HANDLE_INVALID(h)) {
+			sched_yield();
+			continue;
+		}
+
+		BlockContentionSlot* pSlot = BLOCK_PTR_H(blockContention.block, h);
+		if (atomic_exchange(&pSlot->owner, owner) != 0) atomic_fetch_add(&blockContention.failCount, 1);
+		if (atomic_exchange(&pSlot->owner, 0) != owner) atomic_fetch_add(&blockContention.failCount, 1);
+
+		if (blockContention.useLock) {
+			pthread_mutex_lock(&blockContention.lock);
+			BLOCK_RELEASE(blockContention.block, h);
+			pthread_mutex_unlock(&blockContention.lock);
+		} else
+			BLOCK_RELEASE_ATOMIC(blockContention.block, h);
+	}
+	return NULL;
+}
+
+// BLOCK_CLAIM_ATOMIC against BLOCK_CLAIM under a mutex, which is what sharing a block needed before
+static bool TestBlockClaimContention()
+{
+	static const int threadCounts[] = {1, 4, BLOCK_CONTENTION_THREAD_MAX};
+	for (u32 iCount = 0; iCount < COUNT(threadCounts); ++iCount) {
+		double elapsedMs[2];
+		for (int useLock = 0; useLock < 2; ++useLock) {
+			memset(&blockContention, 0, sizeof(blockContention));
+			pthread_mutex_init(&blockContention.lock, NULL);
+			blockContention.useLock = useLock;
+
+			pthread_t threads[BLOCK_CONTENTION_THREAD_MAX];
+			double    startMs = TimeMs();
+			for (int i = 0; i < threadCounts[iCount]; ++i)
+				pthread_create(&threads[i], NULL, BlockContentionWorker, (void*)(uintptr_t)i);
+			for (int i = 0; i < threadCounts[iCount]; ++i)
+				pthread_join(threads[i], NULL);
+			elapsedMs[useLock] = TimeMs() - startMs;
+			pthread_mutex_destroy(&blockContention.lock);
+
+			TEST_CHECK(blockContention.failCount == 0, "%u slots claimed by two threads at once", blockContention.failCount);
+			TEST_CHECK(BLOCK_COUNT(blockContention.block) == 0, "%d slots left claimed", BLOCK_COUNT(blockContention.block));
+		}
+
+		double claimCount = (double)threadCounts[iCount] * BLOCK_CONTENTION_ITERATION_COUNT;
+		LOG("Block claim %2d threads atomic %.1fns mutex %.1fns per claim and release\n", threadCounts[iCount],
+		    elapsedMs[0] * 1000000.0 / claimCount, elapsedMs[1] * 1000000.0 / claimCount);
+	}
+	return true;
+}
+
+////
+//// Stale Handle
+////
+#define STALE_HANDLE_CAPACITY 16
+
+static struct {
+	BLOCK32_T_N(u32, STALE_HANDLE_CAPACITY) block;
+} staleHandle;
+
+// Session ids are node handles claimed like this. A released one must fail BLOCK_HANDLE_LIVE before its slot
+// is claimed again and through every reuse until the 12 bit generation wraps.
+static bool TestStaleHandle()
+{
+	memset(&staleHandle, 0, sizeof(staleHandle));
+	block_handle32 hReleased = BLOCK_CLAIM_ATOMIC(staleHandle.block);
+	TEST_CHECK(BLOCK_HANDLE_LIVE(staleHandle.block, hReleased), "Claimed handle not live");
+	TEST_CHECK(HANDLE32_EQUAL(HANDLE32(hReleased.id), hReleased), "Handle did not round trip through its id");
+	BLOCK_RELEASE_ATOMIC(staleHandle.block, hReleased);
+	TEST_CHECK(!BLOCK_HANDLE_LIVE(staleHandle.block, hReleased), "Released handle still live");
+
+	// What a u16 session id kept of the handle, only the index
+	u32 truncatedMatchCount = 0;
+	u32 reuseCount = HANDLE32_GENERATION_MAX - 1;
+	for (u32 i = 0; i < reuseCount; ++i) {
+		block_handle32 h = BLOCK_CLAIM_ATOMIC(staleHandle.block);
+		TEST_CHECK(HANDLE_INDEX(h) == HANDLE_INDEX(hReleased), "Reuse %u claimed slot %d", i, HANDLE_INDEX(h));
+		TEST_CHECK(BLOCK_HANDLE_LIVE(staleHandle.block, h), "Reuse %u not live", i);
+		TEST_CHECK(!BLOCK_HANDLE_LIVE(staleHandle.block, hReleased), "Released handle live again at reuse %u", i);
+		truncatedMatchCount += (u16)h.id == (u16)hReleased.id;
+		BLOCK_RELEASE_ATOMIC(staleHandle.block, h);
+	}
+
+	LOG("Stale handle rejected through %u reuses, a u16 id matched %u of them\n", reuseCount, truncatedMatchCount);
+	return true;
+}
+
+////
+//// Bit Scan
+////
+#define BIT_SCAN_FILL_COUNT  256
+#define BIT_SCAN_BENCH_COUNT 1000000
+
+// What the scans did before the word and chunk paths
+static int BitScanLinear(int byteCapacity, const bitset_t* pSet, bool one, int startBit)
+{
+	for (int i = startBit; i < byteCapacity * CHAR_BIT; ++i)
+		if ((BITTEST(pSet, i) != 0) == one) return i;
+	return -1;
+}
+
+static u64 BitScanRandom(u64* pState)
+{
+	*pState ^= *pState << 13;
+	*pState ^= *pState >> 7;
+	*pState ^= *pState << 17;
+	return *pState;
+}
+
+/*
+ * Ones and zeros from every start bit against the linear scan, over fills from empty to full with runs
+ * of set words so the chunk path skips. Then first zero on a set full but its last bit, the worst case.
+ * Called with a constant byteCapacity so the scan inlines down to the path that size takes at runtime.
+ */
+static inline bool BitScanCheck(int byteCapacity, bitset_t* pSet)
+{
+	u64 state = 0x9E3779B97F4A7C15ull;
+	int bitCapacity = byteCapacity * CHAR_BIT;
+	for (int iFill = 0; iFill < BIT_SCAN_FILL_COUNT; ++iFill) {
+		int density = iFill % (CHAR_BIT + 1);
+		for (int i = 0; i < byteCapacity; ++i) {
+			u8 byte = 0;
+			for (int j = 0; j < density; ++j) byte |= 1 << (BitScanRandom(&state) % CHAR_BIT);
+			pSet[i] = density == CHAR_BIT ? 0xFF : byte;
+		}
+		for (int startBit = 0; startBit < bitCapacity; ++startBit) {
+			int one = BitScanFirst(byteCapacity, pSet, 0, startBit);
+			int zero = BitScanFirst(byteCapacity, pSet, ~(bitword_t)0, startBit);
+			TEST_CHECK(one == BitScanLinear(byteCapacity, pSet, true, startBit), "%d bits fill %d first one from %d is %d", bitCapacity, iFill, startBit, one);
+			TEST_CHECK(zero == BitScanLinear(byteCapacity, pSet, false, startBit), "%d bits fill %d first zero from %d is %d", bitCapacity, iFill, startBit, zero);
+		}
+	}
+
+	memset(pSet, 0xFF, byteCapacity);
+	BITCLEAR(pSet, bitCapacity - 1);
+	volatile int sink = 0;
+	double startMs = TimeMs();
+	for (int i = 0; i < BIT_SCAN_BENCH_COUNT; ++i) {
+		__asm__ volatile("" : : "r"(pSet) : "memory");
+		sink += BitScanFirstZero(byteCapacity, pSet);
+	}
+	double scanMs = TimeMs() - startMs;
+
+	startMs = TimeMs();
+	for (int i = 0; i < BIT_SCAN_BENCH_COUNT; ++i) {
+		__asm__ volatile("" : : "r"(pSet) : "memory");
+		sink += BitScanLinear(byteCapacity, pSet, false, 0);
+	}
+	double linearMs = TimeMs() - startMs;
+	TEST_CHECK(sink == (bitCapacity - 1) * BIT_SCAN_BENCH_COUNT * 2, "Last bit not found every scan");
+
+	LOG("Bit scan %3d bits scan %.2fns linear %.2fns per first zero\n", bitCapacity,
+	    scanMs * 1000000.0 / BIT_SCAN_BENCH_COUNT, linearMs * 1000000.0 / BIT_SCAN_BENCH_COUNT);
+	return true;
+}
+
+// 8 to 512 bits covers the byte, word and chunk paths
+static bool TestBitScan()
+{
+	ALIGN(64) bitset_t set[BITNBYTES(512)];
+	return BitScanCheck(BITNBYTES(8), set) &&
+	       BitScanCheck(BITNBYTES(16), set) &&
+	       BitScanCheck(BITNBYTES(32), set) &&
+	       BitScanCheck(BITNBYTES(64), set) &&
+	       BitScanCheck(BITNBYTES(128), set) &&
+	       BitScanCheck(BITNBYTES(256), set) &&
+	       BitScanCheck(BITNBYTES(512), set);
+}
+
+////
+//// SPSC Ping Pong
+////
+#define PING_PONG_COUNT    100000
+#define PING_PONG_CAPACITY 64
+
+// Spin a while before yielding so a single core machine still makes progress
+#define SPIN_UNTIL(_condition) \
+	for (int _spin = 0; !(_condition); ++_spin) if (_spin > 256) sched_yield();
+
+// Each side pinned to its own CPU so ring writes really move cache lines between cores
+static struct {
+	int cpus[2];
+#ifdef _WIN32
+	DWORD_PTR processMask;
+#else
+	cpu_set_t processSet;
+#endif
+} pingPongAffinity;
+
+// Picks the first two CPUs the process may run on. False when there is only one.
+static bool PingPongFindCpus()
+{
+	int cpuCount = 0;
+#ifdef _WIN32
+	DWORD_PTR systemMask;
+	GetProcessAffinityMask(GetCurrentProcess(), &pingPongAffinity.processMask, &systemMask);
+	for (int i = 0; i < (int)sizeof(DWORD_PTR) * CHAR_BIT && cpuCount < 2; ++i)
+		if (pingPongAffinity.processMask & ((DWORD_PTR)1 << i)) pingPongAffinity.cpus[cpuCount++] = i;
+#else
+	sched_getaffinity(0, sizeof(cpu_set_t), &pingPongAffinity.processSet);
+	for (int i = 0; i < CPU_SETSIZE && cpuCount < 2; ++i)
+		if (CPU_ISSET(i, &pingPongAffinity.processSet)) pingPongAffinity.cpus[cpuCount++] = i;
+#endif
+	return cpuCount == 2;
+}
+
+// Pins the calling thread, or a forked process's only thread
+static void PingPongPin(int iSide)
+{
+#ifdef _WIN32
+	SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << pingPongAffinity.cpus[iSide]);
+#else
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(pingPongAffinity.cpus[iSide], &set);
+	sched_setaffinity(0, sizeof(cpu_set_t), &set);
+#endif
+}
+
+static void PingPongUnpin()
+{
+#ifdef _WIN32
+	SetThreadAffinityMask(GetCurrentThread(), pingPongAffinity.processMask);
+#else
+	sched_setaffinity(0, sizeof(cpu_set_t), &pingPongAffinity.processSet);
+#endif
+}
+
+// Both directions of a round trip laid out like node shared memory, rings then values
+#define PING_PONG_DECL(_Ring)                          \
+	struct CACHE_ALIGN {                               \
+		_Ring ping;                                    \
+		_Ring pong;                                    \
+		u32   pingValues[PING_PONG_CAPACITY];          \
+		u32   pongValues[PING_PONG_CAPACITY];          \
+	}
+
+typedef PING_PONG_DECL(MidChannelRing8)        PingPong;
+typedef PING_PONG_DECL(MidChannelAlignedRing8) AlignedPingPong;
+
+#define PING_PONG_FUNC_IMPL(_PingPong)                                                                 \
+	static void _PingPong##Echo(_PingPong* p)                                                          \
+	{                                                                                                  \
+		PingPongPin(1);                                                                                \
+		for (u32 i = 0; i < PING_PONG_COUNT; ++i) {                                                    \
+			u32 value;                                                                                 \
+			SPIN_UNTIL(MID_CHANNEL_RECV(&p->ping, p->pingValues, &value) == MID_SUCCESS);              \
+			SPIN_UNTIL(MID_CHANNEL_SEND(&p->pong, p->pongValues, &value) == MID_SUCCESS);              \
+		}                                                                                              \
+	}                                                                                                  \
+	static void* _PingPong##EchoThread(void* pArg)                                                     \
+	{                                                                                                  \
+		_PingPong##Echo(pArg);                                                                         \
+		return NULL;                                                                                   \
+	}                                                                                                  \
+	/* Returns the number of replies which didn't match what was sent */                              \
+	static u32 _PingPong##Send(_PingPong* p)                                                           \
+	{                                                                                                  \
+		u32 mismatchCount = 0;                                                                         \
+		for (u32 i = 0; i < PING_PONG_COUNT; ++i) {                                                    \
+			u32 value;                                                                                 \
+			SPIN_UNTIL(MID_CHANNEL_SEND(&p->ping, p->pingValues, &i) == MID_SUCCESS);                  \
+			SPIN_UNTIL(MID_CHANNEL_RECV(&p->pong, p->pongValues, &value) == MID_SUCCESS);              \
+			mismatchCount += value != i;                                                               \
+		}                                                                                              \
+		return mismatchCount;                                                                          \
+	}
+
+PING_PONG_FUNC_IMPL(PingPong);
+PING_PONG_FUNC_IMPL(AlignedPingPong);
+
+// Zeroed memory the echo side can reach whether it is a thread or a forked process
+static void* PingPongAlloc(int size)
+{
+#ifdef _WIN32
+	void* p = ALIGNED_MALLOC(64, size);
+	memset(p, 0, size);
+	return p;
+#else
+	return mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+#endif
+}
+
+static void PingPongFree(void* p, int size)
+{
+#ifdef _WIN32
+	ALIGNED_FREE(p);
+#else
+	munmap(p, size);
+#endif
+}
+
+#define PING_PONG_RUN_THREAD(_PingPong, _pElapsedMs) ({                      \
+	_PingPong* _p = PingPongAlloc(sizeof(_PingPong));                        \
+	pthread_t  _thread;                                                      \
+	double     _startMs = TimeMs();                                          \
+	pthread_create(&_thread, NULL, _PingPong##EchoThread, _p);               \
+	u32 _mismatchCount = _PingPong##Send(_p);                                \
+	pthread_join(_thread, NULL);                                             \
+	*(_pElapsedMs) = TimeMs() - _startMs;                                    \
+	PingPongFree(_p, sizeof(_PingPong));                                     \
+	_mismatchCount;                                                          \
+})
+
+#ifndef _WIN32
+#define PING_PONG_RUN_PROCESS(_PingPong, _pElapsedMs) ({                     \
+	_PingPong* _p = PingPongAlloc(sizeof(_PingPong));                        \
+	double     _startMs = TimeMs();                                          \
+	pid_t      _pid = fork();                                                \
+	if (_pid == 0) {                                                         \
+		_PingPong##Echo(_p);                                                 \
+		_exit(EXIT_SUCCESS);                                                 \
+	}                                                                        \
+	u32 _mismatchCount = _PingPong##Send(_p);                                \
+	int _status;                                                             \
+	waitpid(_pid, &_status, 0);                                              \
+	*(_pElapsedMs) = TimeMs() - _startMs;                                    \
+	PingPongFree(_p, sizeof(_PingPong));                                     \
+	_mismatchCount;                                                          \
+})
+#endif
+
+// Round trips through the cache line split ring against the packed one, echoed by a thread then by a process.
+// Sides share a core without two CPUs, which measures the scheduler rather than coherence traffic, so that skips.
+static bool TestSpscPingPong()
+{
+	double elapsedMs, alignedElapsedMs;
+	u32    mismatchCount;
+
+	if (!PingPongFindCpus()) {
+		LOG("SPSC ping pong skipped, needs two CPUs to pin each side to its own\n");
+		return true;
+	}
+	PingPongPin(0);
+
+	mismatchCount = PING_PONG_RUN_THREAD(PingPong, &elapsedMs);
+	TEST_CHECK(mismatchCount == 0, "%u thread replies did not match", mismatchCount);
+	mismatchCount = PING_PONG_RUN_THREAD(AlignedPingPong, &alignedElapsedMs);
+	TEST_CHECK(mismatchCount == 0, "%u aligned thread replies did not match", mismatchCount);
+	LOG("SPSC ping pong thread aligned %.1fns packed %.1fns per round trip\n",
+	    alignedElapsedMs * 1000000.0 / PING_PONG_COUNT, elapsedMs * 1000000.0 / PING_PONG_COUNT);
+
+#ifdef _WIN32
+	LOG("SPSC ping pong process skipped, needs fork\n");
+#else
+	mismatchCount = PING_PONG_RUN_PROCESS(PingPong, &elapsedMs);
+	TEST_CHECK(mismatchCount == 0, "%u process replies did not match", mismatchCount);
+	mismatchCount = PING_PONG_RUN_PROCESS(AlignedPingPong, &alignedElapsedMs);
+	TEST_CHECK(mismatchCount == 0, "%u aligned process replies did not match", mismatchCount);
+	LOG("SPSC ping pong process aligned %.1fns packed %.1fns per round trip\n",
+	    alignedElapsedMs * 1000000.0 / PING_PONG_COUNT, elapsedMs * 1000000.0 / PING_PONG_COUNT);
+#endif
+	PingPongUnpin();
+	return true;
+}
+
+////
+//// Batch Throughput
+////
+#define BATCH_VALUE_COUNT (1 << 20)
+#define BATCH_CAPACITY    256
+#define BATCH_SIZE_MAX    64
+
+static struct {
+	MidChannelRing8 ring;
+	u32             values[BATCH_CAPACITY];
+	int             batchSize;
+	bool            batched;
+} batch;
+
+// Sends 0..BATCH_VALUE_COUNT a batch at a time, per element or with one SEND_N per batch
+static void* BatchProducer(void* pArg)
+{
+	u32 src[BATCH_SIZE_MAX];
+	for (u32 i = 0; i < BATCH_VALUE_COUNT; i += batch.batchSize) {
+		for (int j = 0; j < batch.batchSize; ++j) src[j] = i + j;
+		if (batch.batched) {
+			for (int sent = 0; sent < batch.batchSize;) {
+				int count = MID_CHANNEL_SEND_N(&batch.ring, batch.values, src + sent, batch.batchSize - sent);
+				sent += count;
+				if (count == 0) sched_yield();
+			}
+		} else {
+			for (int j = 0; j < batch.batchSize; ++j)
+				SPIN_UNTIL(MID_CHANNEL_SEND(&batch.ring, batch.values, &src[j]) == MID_SUCCESS);
+		}
+	}
+	return NULL;
+}
+
+// Returns the number of values received out of order
+static u32 BatchConsume()
+{
+	u32 dst[BATCH_SIZE_MAX];
+	u32 mismatchCount = 0;
+	for (u32 i = 0; i < BATCH_VALUE_COUNT;) {
+		int count = 0;
+		if (batch.batched)
+			count = MID_CHANNEL_RECV_N(&batch.ring, batch.values, dst, batch.batchSize);
+		else
+			while (count < batch.batchSize && MID_CHANNEL_RECV(&batch.ring, batch.values, &dst[count]) == MID_SUCCESS) count++;
+		if (count == 0) sched_yield();
+		for (int j = 0; j < count; ++j) mismatchCount += dst[j] != i + j;
+		i += count;
+	}
+	return mismatchCount;
+}
+
+// Per element SEND/RECV against SEND_N/RECV_N streaming to another thread at 1, 8 and 64 values per batch
+static bool TestBatchThroughput()
+{
+	static const int batchSizes[] = {1, 8, BATCH_SIZE_MAX};
+	for (u32 iSize = 0; iSize < COUNT(batchSizes); ++iSize) {
+		double elapsedMs[2];
+		for (int batched = 0; batched < 2; ++batched) {
+			memset(&batch, 0, sizeof(batch));
+			batch.batchSize = batchSizes[iSize];
+			batch.batched = batched;
+
+			pthread_t thread;
+			double    startMs = TimeMs();
+			pthread_create(&thread, NULL, BatchProducer, NULL);
+			u32 mismatchCount = BatchConsume();
+			pthread_join(thread, NULL);
+			elapsedMs[batched] = TimeMs() - startMs;
+			TEST_CHECK(mismatchCount == 0, "%u values out of order at batch %d", mismatchCount, batch.batchSize);
+		}
+		LOG("Batch %2d per element %.2fns batched %.2fns per value\n", batchSizes[iSize],
+		    elapsedMs[0] * 1000000.0 / BATCH_VALUE_COUNT, elapsedMs[1] * 1000000.0 / BATCH_VALUE_COUNT);
+	}
+	return true;
+}
+
+////
+//// Key Index
+////
+#define KEY_INDEX_CAPACITY_MAX     256
+#define KEY_INDEX_LOOKUP_PASS_COUNT 2000
+
+// Same as the runtime's path hash so keys have the same weak low bits
+static u32 CalcDJB2(const char* str, int max)
+{
+	char c;
+	int  i = 0;
+	u32  hash = 5381;
+	while ((c = *str++) && i++ < max)
+		hash = ((hash << 5) + hash) + c;
+	return hash;
+}
+
+// What BLOCK_FIND did before the key index
+static int KeyLinearFind(int capacity, const block_key* pKeys, block_key key)
+{
+	for (int i = 0; i < capacity; ++i)
+		if (pKeys[i] == key) return i;
+	return -1;
+}
+
+static struct {
+	BLOCK_T_N(u32, KEY_INDEX_CAPACITY_MAX) block;
+	block_key hitKeys[KEY_INDEX_CAPACITY_MAX];
+	block_key missKeys[KEY_INDEX_CAPACITY_MAX];
+} keyIndex;
+
+// BLOCK_FIND against a scan of keys with 16, 64 and 256 of 256 slots occupied, half the lookups missing
+static bool TestKeyIndex()
+{
+	static const int occupiedCounts[] = {16, 64, KEY_INDEX_CAPACITY_MAX};
+	for (u32 iCount = 0; iCount < COUNT(occupiedCounts); ++iCount) {
+		int occupiedCount = occupiedCounts[iCount];
+		memset(&keyIndex, 0, sizeof(keyIndex));
+		for (int i = 0; i < occupiedCount; ++i) {
+			char path[64];
+			snprintf(path, sizeof(path), "/user/hand/left/input/action_%d/click", i);
+			keyIndex.hitKeys[i] = CalcDJB2(path, sizeof(path));
+			snprintf(path, sizeof(path), "/user/hand/right/input/action_%d/click", i);
+			keyIndex.missKeys[i] = CalcDJB2(path, sizeof(path));
+			block_handle h = BLOCK_CLAIM(keyIndex.block, keyIndex.hitKeys[i]);
+			TEST_CHECK(HANDLE_VALID(h), "Claim %d failed", i);
+		}
+
+		for (int i = 0; i < occupiedCount; ++i) {
+			block_handle h = BLOCK_FIND(keyIndex.block, keyIndex.hitKeys[i]);
+			TEST_CHECK(HANDLE_VALID(h) && HANDLE_INDEX(h) == KeyLinearFind(occupiedCount, keyIndex.block.keys, keyIndex.hitKeys[i]), "Key %d not found", i);
+			if (KeyLinearFind(occupiedCount, keyIndex.hitKeys, keyIndex.missKeys[i]) != -1) continue;
+			h = BLOCK_FIND(keyIndex.block, keyIndex.missKeys[i]);
+			TEST_CHECK(HANDLE_INVALID(h), "Missing key %d found", i);
+		}
+
+		// Sum indices so the lookups aren't optimized out
+		volatile int sink = 0;
+		double startMs = TimeMs();
+		for (int iPass = 0; iPass < KEY_INDEX_LOOKUP_PASS_COUNT; ++iPass) {
+			for (int i = 0; i < occupiedCount; ++i) {
+				sink += HANDLE_INDEX(BLOCK_FIND(keyIndex.block, keyIndex.hitKeys[i]));
+				sink += HANDLE_INDEX(BLOCK_FIND(keyIndex.block, keyIndex.missKeys[i]));
+			}
+		}
+		double indexMs = TimeMs() - startMs;
+
+		startMs = TimeMs();
+		for (int iPass = 0; iPass < KEY_INDEX_LOOKUP_PASS_COUNT; ++iPass) {
+			for (int i = 0; i < occupiedCount; ++i) {
+				sink += KeyLinearFind(KEY_INDEX_CAPACITY_MAX, keyIndex.block.keys, keyIndex.hitKeys[i]);
+				sink += KeyLinearFind(KEY_INDEX_CAPACITY_MAX, keyIndex.block.keys, keyIndex.missKeys[i]);
+			}
+		}
+		double linearMs = TimeMs() - startMs;
+
+		double lookupCount = (double)KEY_INDEX_LOOKUP_PASS_COUNT * occupiedCount * 2;
+		LOG("Key index %3d occupied index %.1fns linear %.1fns per lookup\n", occupiedCount,
+		    indexMs * 1000000.0 / lookupCount, linearMs * 1000000.0 / lookupCount);
+	}
+	return true;
+}
+
+////
+//// Main
+////
+typedef struct Test {
+	const char* name;
+	bool (*pFunc)();
+} Test;
+
+static const Test tests[] = {
+	{"MpscStress", TestMpscStress},
+	{"AlignedWait", TestAlignedWait},
+	{"BlockClaimContention", TestBlockClaimContention},
+	{"StaleHandle", TestStaleHandle},
+	{"BitScan", TestBitScan},
+	{"SpscPingPong", TestSpscPingPong},
+	{"BatchThroughput", TestBatchThroughput},
+	{"KeyIndex", TestKeyIndex},
+};
+
+int main()
+{
+	for (u32 i = 0; i < COUNT(tests); ++i) {
+		LOG("%s\n", tests[i].name);
+		if (!tests[i].pFunc()) {
+			LOG_ERROR("%s failed\n", tests[i].name);
+			return EXIT_FAILURE;
+		}
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,387 @@
+/*
+ * Submit Test
+ *
+ * Drains queued command buffers the way vkSubmitQueuedCommandBuffers in mid_vulkan.h does, one vkQueueSubmit2
+ * with a submit info and timeline signal per buffer, and the way it did before, one vkQueueSubmit2 per buffer.
+ * Checks every buffer's timeline signal and write lands either way, then logs the main thread time each drain
+ * takes with 8, 32 and 64 thread nodes queuing a buffer every cycle.
+ * Exits with SUBMIT_TEST_SKIP when there is no device with timeline semaphores and synchronization2.
+ */
+#include <stdlib.h>
+#include <time.h>
+#include <vulkan/vulkan.h>
+
+#define MID_COMMON_IMPLEMENTATION
+#include "mid_common.h"
+
+#ifndef _WIN32
+// ASSERT calls the mingw assert hook
+void _assert(const char* message, const char* file, unsigned line)
+{
+	fprintf(stderr, "%s:%u %s\n", file, line, message);
+	abort();
+}
+#endif
+
+// ctest SKIP_RETURN_CODE
+#define SUBMIT_TEST_SKIP 77
+
+#define VK_CHECK(_command)                   \
+	({                                       \
+		VkResult _result = _command;         \
+		CHECK(_result, #_command " failed"); \
+	})
+
+#define TEST_CHECK(_condition, _format, ...)                               \
+	if (UNLIKELY(!(_condition))) {                                         \
+		LOG_ERROR("Failed: " #_condition " " _format "\n", ##__VA_ARGS__); \
+		return false;                                                      \
+	}
+
+static double TimeMs()
+{
+	struct timespec ts;
+	timespec_get(&ts, TIME_UTC);
+	return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1000000.0;
+}
+
+////
+//// Vulkan
+////
+// MXC_NODE_CAPACITY
+#define NODE_CAPACITY 64
+
+// VkQueuedCommandBuffer in mid_vulkan.h
+typedef struct QueuedCommandBuffer {
+	VkCommandBuffer cmd;
+	VkSemaphore     timeline;
+	u64             timelineSignalValue;
+} QueuedCommandBuffer;
+
+typedef struct SubmitBuffer {
+	VkBuffer       buffer;
+	VkDeviceMemory memory;
+	void*          pMapped;
+} SubmitBuffer;
+
+static struct {
+	VkInstance       instance;
+	VkPhysicalDevice physicalDevice;
+	VkDevice         device;
+	VkQueue          queue;
+	u32              queueFamilyIndex;
+
+	VkCommandPool   commandPool;
+	VkCommandBuffer cmds[NODE_CAPACITY];
+	// Each thread node signals its own timeline
+	VkSemaphore timelines[NODE_CAPACITY];
+	u64         timelineValue;
+
+	// Every node fills its own u32 with the cycle's signal value
+	SubmitBuffer nodeBuffer;
+} submit;
+
+// Returns false when there is no usable device so the test can be skipped
+static bool CreateContext()
+{
+	VkResult result = vkCreateInstance(&(VkInstanceCreateInfo){
+		VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
+		.pApplicationInfo = &(VkApplicationInfo){
+			VK_STRUCTURE_TYPE_APPLICATION_INFO,
+			.pApplicationName = "submit_test",
+			.apiVersion       = VK_API_VERSION_1_3,
+		},
+	}, NULL, &submit.instance);
+	if (result != VK_SUCCESS) {
+		LOG("No Vulkan instance %d\n", result);
+		return false;
+	}
+
+	u32 deviceCount = 0;
+	vkEnumeratePhysicalDevices(submit.instance, &deviceCount, NULL);
+	VkPhysicalDevice devices[deviceCount + 1];
+	vkEnumeratePhysicalDevices(submit.instance, &deviceCount, devices);
+	if (deviceCount == 0) {
+		LOG("No Vulkan device\n");
+		return false;
+	}
+
+	// Submit cost is the driver's so time it on the one the compositor runs on when there is a GPU
+	submit.physicalDevice = devices[0];
+	for (u32 i = 0; i < deviceCount; ++i) {
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(devices[i], &properties);
+		if (properties.deviceType != VK_PHYSICAL_DEVICE_TYPE_CPU) {
+			submit.physicalDevice = devices[i];
+			break;
+		}
+	}
+
+	// Driver and header versions so a result says which ICD and SDK it came from
+	VkPhysicalDeviceDriverProperties driverProperties = {.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DRIVER_PROPERTIES};
+	VkPhysicalDeviceProperties2      properties = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2, .pNext = &driverProperties};
+	vkGetPhysicalDeviceProperties2(submit.physicalDevice, &properties);
+	LOG("Device %s driver %s %s headers 1.%u.%u\n", properties.properties.deviceName, driverProperties.driverName,
+	    driverProperties.driverInfo, VK_API_VERSION_MINOR(VK_HEADER_VERSION_COMPLETE), VK_HEADER_VERSION);
+	if (VK_API_VERSION_MINOR(properties.properties.apiVersion) < 3) {
+		LOG("Device is Vulkan 1.%u, vkQueueSubmit2 needs 1.3\n", VK_API_VERSION_MINOR(properties.properties.apiVersion));
+		return false;
+	}
+
+	VkPhysicalDeviceSynchronization2Features synchronization2Features = {.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES};
+	VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures = {
+		VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES,
+		.pNext = &synchronization2Features,
+	};
+	vkGetPhysicalDeviceFeatures2(submit.physicalDevice, &(VkPhysicalDeviceFeatures2){
+		VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+		.pNext = &timelineFeatures,
+	});
+	if (!timelineFeatures.timelineSemaphore || !synchronization2Features.synchronization2) {
+		LOG("Device lacks timeline semaphores or synchronization2\n");
+		return false;
+	}
+
+	u32 queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(submit.physicalDevice, &queueFamilyCount, NULL);
+	VkQueueFamilyProperties queueFamilies[queueFamilyCount + 1];
+	vkGetPhysicalDeviceQueueFamilyProperties(submit.physicalDevice, &queueFamilyCount, queueFamilies);
+	submit.queueFamilyIndex = UINT32_MAX;
+	for (u32 i = 0; i < queueFamilyCount && submit.queueFamilyIndex == UINT32_MAX; ++i)
+		if (queueFamilies[i].queueFlags & VK_QUEUE_COMPUTE_BIT) submit.queueFamilyIndex = i;
+	if (submit.queueFamilyIndex == UINT32_MAX) {
+		LOG("Device has no compute queue\n");
+		return false;
+	}
+
+	VK_CHECK(vkCreateDevice(submit.physicalDevice, &(VkDeviceCreateInfo){
+		VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+		.pNext = &(VkPhysicalDeviceTimelineSemaphoreFeatures){
+			VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES,
+			.pNext = &(VkPhysicalDeviceSynchronization2Features){
+				VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES,
+				.synchronization2 = VK_TRUE,
+			},
+			.timelineSemaphore = VK_TRUE,
+		},
+		.queueCreateInfoCount = 1,
+		.pQueueCreateInfos = &(VkDeviceQueueCreateInfo){
+			VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+			.queueFamilyIndex = submit.queueFamilyIndex,
+			.queueCount       = 1,
+			.pQueuePriorities = (f32[]){1.0f},
+		},
+	}, NULL, &submit.device));
+	vkGetDeviceQueue(submit.device, submit.queueFamilyIndex, 0, &submit.queue);
+	return true;
+}
+
+static void CreateResources()
+{
+	VkDeviceSize size = sizeof(u32) * NODE_CAPACITY;
+	VK_CHECK(vkCreateBuffer(submit.device, &(VkBufferCreateInfo){
+		VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+		.size  = size,
+		.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+	}, NULL, &submit.nodeBuffer.buffer));
+
+	VkMemoryRequirements memReqs;
+	vkGetBufferMemoryRequirements(submit.device, submit.nodeBuffer.buffer, &memReqs);
+	VkPhysicalDeviceMemoryProperties memProps;
+	vkGetPhysicalDeviceMemoryProperties(submit.physicalDevice, &memProps);
+	VkMemoryPropertyFlags propFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	u32 memTypeIndex = UINT32_MAX;
+	for (u32 i = 0; i < memProps.memoryTypeCount && memTypeIndex == UINT32_MAX; ++i)
+		if ((memReqs.memoryTypeBits & (1u << i)) && (memProps.memoryTypes[i].propertyFlags & propFlags) == propFlags) memTypeIndex = i;
+	REQUIRE(memTypeIndex != UINT32_MAX, "No host visible coherent memory!");
+
+	VK_CHECK(vkAllocateMemory(submit.device, &(VkMemoryAllocateInfo){
+		VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+		.allocationSize  = memReqs.size,
+		.memoryTypeIndex = memTypeIndex,
+	}, NULL, &submit.nodeBuffer.memory));
+	VK_CHECK(vkBindBufferMemory(submit.device, submit.nodeBuffer.buffer, submit.nodeBuffer.memory, 0));
+	VK_CHECK(vkMapMemory(submit.device, submit.nodeBuffer.memory, 0, VK_WHOLE_SIZE, 0, &submit.nodeBuffer.pMapped));
+	memset(submit.nodeBuffer.pMapped, 0, size);
+
+	VK_CHECK(vkCreateCommandPool(submit.device, &(VkCommandPoolCreateInfo){
+		VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+		.flags            = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+		.queueFamilyIndex = submit.queueFamilyIndex,
+	}, NULL, &submit.commandPool));
+	VK_CHECK(vkAllocateCommandBuffers(submit.device, &(VkCommandBufferAllocateInfo){
+		VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+		.commandPool        = submit.commandPool,
+		.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+		.commandBufferCount = NODE_CAPACITY,
+	}, submit.cmds));
+
+	for (int i = 0; i < NODE_CAPACITY; ++i)
+		VK_CHECK(vkCreateSemaphore(submit.device, &(VkSemaphoreCreateInfo){
+			VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+			.pNext = &(VkSemaphoreTypeCreateInfo){
+				VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+				.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+				.initialValue  = 0,
+			},
+		}, NULL, &submit.timelines[i]));
+}
+
+static void DestroyContext()
+{
+	for (int i = 0; i < NODE_CAPACITY; ++i)
+		vkDestroySemaphore(submit.device, submit.timelines[i], NULL);
+	vkDestroyCommandPool(submit.device, submit.commandPool, NULL);
+	vkUnmapMemory(submit.device, submit.nodeBuffer.memory);
+	vkDestroyBuffer(submit.device, submit.nodeBuffer.buffer, NULL);
+	vkFreeMemory(submit.device, submit.nodeBuffer.memory, NULL);
+	vkDestroyDevice(submit.device, NULL);
+	vkDestroyInstance(submit.instance, NULL);
+}
+
+////
+//// Drains
+////
+enum {
+	DRAIN_EACH,
+	DRAIN_BATCHED,
+	DRAIN_COUNT,
+};
+
+static const char* drainNames[DRAIN_COUNT] = {
+	[DRAIN_EACH]    = "submit per buffer",
+	[DRAIN_BATCHED] = "batched submit",
+};
+
+// CmdSubmit in mid_vulkan.h, which vkSubmitQueuedCommandBuffers called once per buffer before it batched
+static void SubmitEach(int queuedCount, const QueuedCommandBuffer* pQueued)
+{
+	for (int i = 0; i < queuedCount; ++i) {
+		VkSubmitInfo2 submitInfo = {
+			VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
+			.commandBufferInfoCount = 1,
+			.pCommandBufferInfos = (VkCommandBufferSubmitInfo[]){
+				{
+					VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
+					.commandBuffer = pQueued[i].cmd,
+				},
+			},
+			.signalSemaphoreInfoCount = 1,
+			.pSignalSemaphoreInfos = (VkSemaphoreSubmitInfo[]){
+				{
+					VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+					.value = pQueued[i].timelineSignalValue,
+					.semaphore = pQueued[i].timeline,
+					.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+				},
+			},
+		};
+		VK_CHECK(vkQueueSubmit2(submit.queue, 1, &submitInfo, VK_NULL_HANDLE));
+	}
+}
+
+// vkSubmitQueuedCommandBuffers in mid_vulkan.h
+static void SubmitBatched(int queuedCount, const QueuedCommandBuffer* pQueued)
+{
+	VkCommandBufferSubmitInfo cmdInfos[NODE_CAPACITY];
+	VkSemaphoreSubmitInfo     signalInfos[NODE_CAPACITY];
+	VkSubmitInfo2             submitInfos[NODE_CAPACITY];
+	for (int i = 0; i < queuedCount; ++i) {
+		cmdInfos[i] = (VkCommandBufferSubmitInfo){
+			VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
+			.commandBuffer = pQueued[i].cmd,
+		};
+		signalInfos[i] = (VkSemaphoreSubmitInfo){
+			VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+			.value = pQueued[i].timelineSignalValue,
+			.semaphore = pQueued[i].timeline,
+			.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+		};
+		submitInfos[i] = (VkSubmitInfo2){
+			VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
+			.commandBufferInfoCount = 1,
+			.pCommandBufferInfos = &cmdInfos[i],
+			.signalSemaphoreInfoCount = 1,
+			.pSignalSemaphoreInfos = &signalInfos[i],
+		};
+	}
+	VK_CHECK(vkQueueSubmit2(submit.queue, queuedCount, submitInfos, VK_NULL_HANDLE));
+}
+
+////
+//// Test
+////
+#define CYCLE_COUNT 256
+
+// Recorded off the clock like a thread node would before it enqueues
+static void RecordNode(int iNode, u32 value)
+{
+	VkCommandBuffer cmd = submit.cmds[iNode];
+	VK_CHECK(vkResetCommandBuffer(cmd, 0));
+	VK_CHECK(vkBeginCommandBuffer(cmd, &(VkCommandBufferBeginInfo){
+		VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+	}));
+	vkCmdFillBuffer(cmd, submit.nodeBuffer.buffer, sizeof(u32) * iNode, sizeof(u32), value);
+	VK_CHECK(vkEndCommandBuffer(cmd));
+}
+
+// Every node queues one buffer a cycle then the main thread drains them all, alternating drains so neither gets a warmer driver
+static bool RunNodeCount(int nodeCount)
+{
+	double drainMs[DRAIN_COUNT] = {};
+	for (int iCycle = 0; iCycle < CYCLE_COUNT; ++iCycle)
+		for (int iDrain = 0; iDrain < DRAIN_COUNT; ++iDrain) {
+			u64 signalValue = ++submit.timelineValue;
+
+			QueuedCommandBuffer queued[NODE_CAPACITY];
+			for (int i = 0; i < nodeCount; ++i) {
+				RecordNode(i, (u32)signalValue);
+				queued[i] = (QueuedCommandBuffer){submit.cmds[i], submit.timelines[i], signalValue};
+			}
+
+			double startMs = TimeMs();
+			if (iDrain == DRAIN_EACH)
+				SubmitEach(nodeCount, queued);
+			else
+				SubmitBatched(nodeCount, queued);
+			drainMs[iDrain] += TimeMs() - startMs;
+
+			u64 waitValues[NODE_CAPACITY];
+			for (int i = 0; i < nodeCount; ++i)
+				waitValues[i] = signalValue;
+			VK_CHECK(vkWaitSemaphores(submit.device, &(VkSemaphoreWaitInfo){
+				VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+				.semaphoreCount = nodeCount,
+				.pSemaphores    = submit.timelines,
+				.pValues        = waitValues,
+			}, UINT64_MAX));
+
+			u32* pValues = submit.nodeBuffer.pMapped;
+			for (int i = 0; i < nodeCount; ++i)
+				TEST_CHECK(pValues[i] == (u32)signalValue, "%d nodes %s node %d wrote %u expected %u",
+				           nodeCount, drainNames[iDrain], i, pValues[i], (u32)signalValue);
+		}
+
+	LOG("%d nodes main thread drain per cycle %s %.4fms %s %.4fms\n", nodeCount,
+	    drainNames[DRAIN_EACH], drainMs[DRAIN_EACH] / CYCLE_COUNT,
+	    drainNames[DRAIN_BATCHED], drainMs[DRAIN_BATCHED] / CYCLE_COUNT);
+	return true;
+}
+
+int main()
+{
+	if (!CreateContext()) {
+		LOG("Skipped\n");
+		return SUBMIT_TEST_SKIP;
+	}
+	CreateResources();
+
+	static const int nodeCounts[] = {8, 32, 64};
+	bool passed = true;
+	for (u32 i = 0; i < COUNT(nodeCounts) && passed; ++i)
+		passed = RunNodeCount(nodeCounts[i]);
+
+	DestroyContext();
+	return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}